@@ -0,0 +1,107 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Runs the benchmark of the firmware (BENCHMARK) for one board role and
+// prints two tables:
+// - the table the firmware prints over USART_STEER_COM at startup. Its
+//   cycles come from the simulated DWT, where only library calls and
+//   intrinsics take time, so it shows the peripheral accesses per call and
+//   is the same on every run
+// - the same functions measured in nanoseconds on this host (calls into
+//   the simulated peripherals included)
+
+#include "../Inc/sim.h"
+#include "../../Inc/setup.h"
+#include "../../Inc/defines.h"
+#include "../../Inc/benchmark.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#ifdef MASTER
+#define ROLE "master"
+#else
+#define ROLE "slave"
+#endif
+
+#define VBATT_36V 1489									// ADC value of a 36V battery
+
+int FirmwareMain(void);
+
+//----------------------------------------------------------------------------
+// Returns nanoseconds of the host clock
+//----------------------------------------------------------------------------
+static uint32_t HostNanoseconds(void)
+{
+	struct timespec time;
+	
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (uint32_t)(time.tv_sec * 1000000000ULL + time.tv_nsec);
+}
+
+int main(void)
+{
+	BENCHMARK_RESULT results[COUNT_BENCHMARKS];
+	uint8_t table[1024];
+	uint16_t length;
+	uint8_t index;
+	
+	// Board powers up with a valid hall position (sinus commutation needs one),
+	// the firmware prints its table after the initialization
+	SIM_SetPowerPin(SELF_HOLD_PORT, SELF_HOLD_PIN);
+#ifdef MASTER
+	SIM_SetPin(BUTTON_PORT, BUTTON_PIN, SET);
+	SIM_SetPin(CHARGE_STATE_PORT, CHARGE_STATE_PIN, SET);
+#endif
+	SIM_SetPin(HALL_A_PORT, HALL_A_PIN, SET);
+	SIM_SetAdc(VBATT_CHANNEL, VBATT_36V);
+	SIM_SetAdc(CURRENT_DC_CHANNEL, 2000);
+	SIM_Start(FirmwareMain);
+	SIM_RunMs(1000);
+	
+	length = SIM_UsartTransmitted(USART_STEER_COM, table, sizeof(table) - 1);
+	table[length] = 0;
+	if (length == 0)
+	{
+		printf("%s: firmware printed no benchmark table\n", ROLE);
+		return 1;
+	}
+	printf("== %s, simulated board\n%s", ROLE, (char *)table);
+	
+	BenchmarkMeasure(results, HostNanoseconds);
+	printf("== %s, host\n", ROLE);
+	printf("%-20s%8s%8s\n", "Nanoseconds per call", "min", "avg");
+	for (index = 0; index < COUNT_BENCHMARKS; index++)
+	{
+		printf("%-20s%8u%8u\n", results[index].name, results[index].min, results[index].avg);
+	}
+	
+	return 0;
+}
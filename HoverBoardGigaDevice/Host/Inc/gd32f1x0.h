@@ -0,0 +1,713 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Host build: replaces the GD32F1x0 firmware library and the CMSIS core
+// header. Names, values and signatures follow the firmware library as far as
+// the firmware uses them, the functions work on the simulated peripherals
+// of Host/Src/gd32f1x0.c driven by the virtual clock of Host/Src/sim.c
+
+#ifndef GD32F1X0_H
+#define GD32F1X0_H
+
+#include <stdint.h>
+
+//----------------------------------------------------------------------------
+// Basic types
+//----------------------------------------------------------------------------
+typedef enum {RESET = 0, SET = !RESET} FlagStatus, ITStatus;
+typedef enum {DISABLE = 0, ENABLE = !DISABLE} EventStatus, ControlStatus;
+typedef enum {ERROR = 0, SUCCESS = !ERROR} ErrStatus;
+typedef FlagStatus bit_status;
+
+#define BIT(x)             ((uint32_t)((uint32_t)0x01U << (x)))
+#define BITS(start, end)   ((0xFFFFFFFFUL << (start)) & (0xFFFFFFFFUL >> (31U - (uint32_t)(end))))
+#define REG32(addr)        (*(volatile uint32_t *)(uint32_t)(addr))
+
+#define __I     volatile const
+#define __O     volatile
+#define __IO    volatile
+#define __INLINE         inline
+#define __STATIC_INLINE  static inline
+
+//----------------------------------------------------------------------------
+// Interrupt numbers
+//----------------------------------------------------------------------------
+typedef enum
+{
+	NonMaskableInt_IRQn          = -14,
+	HardFault_IRQn               = -13,
+	SVCall_IRQn                  = -5,
+	PendSV_IRQn                  = -2,
+	SysTick_IRQn                 = -1,
+	WWDGT_IRQn                   = 0,
+	LVD_IRQn                     = 1,
+	RTC_IRQn                     = 2,
+	FMC_IRQn                     = 3,
+	RCU_IRQn                     = 4,
+	EXTI0_1_IRQn                 = 5,
+	EXTI2_3_IRQn                 = 6,
+	EXTI4_15_IRQn                = 7,
+	DMA_Channel0_IRQn            = 9,
+	DMA_Channel1_2_IRQn          = 10,
+	DMA_Channel3_4_IRQn          = 11,
+	ADC_CMP_IRQn                 = 12,
+	TIMER0_BRK_UP_TRG_COM_IRQn   = 13,
+	TIMER0_Channel_IRQn          = 14,
+	TIMER1_IRQn                  = 15,
+	TIMER2_IRQn                  = 16,
+	TIMER13_IRQn                 = 19,
+	TIMER14_IRQn                 = 20,
+	TIMER15_IRQn                 = 21,
+	TIMER16_IRQn                 = 22,
+	USART0_IRQn                  = 27,
+	USART1_IRQn                  = 28
+} IRQn_Type;
+
+#define SIM_COUNT_IRQS 29	// Count of peripheral interrupt numbers!!
+
+//----------------------------------------------------------------------------
+// Cortex-M3 core (CMSIS subset)
+//----------------------------------------------------------------------------
+typedef struct
+{
+	__IO uint32_t CTRL;
+	__IO uint32_t LOAD;
+	__IO uint32_t VAL;
+	__I  uint32_t CALIB;
+} SysTick_Type;
+
+typedef struct
+{
+	__IO uint32_t CTRL;
+	__IO uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct
+{
+	__IO uint32_t DHCSR;
+	__O  uint32_t DCRSR;
+	__IO uint32_t DCRDR;
+	__IO uint32_t DEMCR;
+} CoreDebug_Type;
+
+typedef struct
+{
+	__I  uint32_t CPUID;
+	__IO uint32_t ICSR;
+} SCB_Type;
+
+// Core registers, kept up to date with the virtual clock by sim.c
+extern SysTick_Type simSysTick;
+extern DWT_Type simDwt;
+extern CoreDebug_Type simCoreDebug;
+extern SCB_Type simScb;
+
+#define SysTick    (&simSysTick)
+#define DWT        (&simDwt)
+#define CoreDebug  (&simCoreDebug)
+#define SCB        (&simScb)
+
+#define SysTick_CTRL_COUNTFLAG_Msk   BIT(16)
+#define SysTick_CTRL_CLKSOURCE_Msk   BIT(2)
+#define SysTick_CTRL_TICKINT_Msk     BIT(1)
+#define SysTick_CTRL_ENABLE_Msk      BIT(0)
+#define SysTick_LOAD_RELOAD_Msk      BITS(0, 23)
+#define DWT_CTRL_CYCCNTENA_Msk       BIT(0)
+#define CoreDebug_DEMCR_TRCENA_Msk   BIT(24)
+#define SCB_ICSR_PENDSTSET_Msk       BIT(26)
+
+extern uint32_t SystemCoreClock;
+void SystemCoreClockUpdate(void);
+uint32_t SysTick_Config(uint32_t ticks);
+void NVIC_SetPriority(IRQn_Type IRQn, uint32_t priority);
+
+// Intrinsics: only these and the peripheral functions let the virtual time
+// pass, interrupts are taken in between
+void __NOP(void);
+void __WFI(void);
+void __disable_irq(void);
+void __enable_irq(void);
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t priMask);
+
+//----------------------------------------------------------------------------
+// NVIC
+//----------------------------------------------------------------------------
+#define NVIC_PRIGROUP_PRE0_SUB4  ((uint32_t)0x700)
+#define NVIC_PRIGROUP_PRE1_SUB3  ((uint32_t)0x600)
+#define NVIC_PRIGROUP_PRE2_SUB2  ((uint32_t)0x500)
+#define NVIC_PRIGROUP_PRE3_SUB1  ((uint32_t)0x400)
+#define NVIC_PRIGROUP_PRE4_SUB0  ((uint32_t)0x300)
+
+void nvic_priority_group_set(uint32_t nvic_prigroup);
+void nvic_irq_enable(uint8_t nvic_irq, uint8_t nvic_irq_pre_priority, uint8_t nvic_irq_sub_priority);
+void nvic_irq_disable(uint8_t nvic_irq);
+
+//----------------------------------------------------------------------------
+// RCU
+//----------------------------------------------------------------------------
+typedef enum
+{
+	RCU_DMA, RCU_CRC, RCU_GPIOA, RCU_GPIOB, RCU_GPIOC, RCU_GPIOD, RCU_GPIOF, RCU_TSI,
+	RCU_CFGCMP, RCU_ADC, RCU_TIMER0, RCU_SPI0, RCU_USART0, RCU_TIMER14, RCU_TIMER15,
+	RCU_TIMER16, RCU_TIMER1, RCU_TIMER2, RCU_TIMER5, RCU_TIMER13, RCU_WWDGT, RCU_SPI1,
+	RCU_USART1, RCU_I2C0, RCU_I2C1, RCU_PMU
+} rcu_periph_enum;
+
+typedef enum
+{
+	RCU_FLAG_IRC40KSTB, RCU_FLAG_LXTALSTB, RCU_FLAG_IRC8MSTB, RCU_FLAG_HXTALSTB,
+	RCU_FLAG_PLLSTB, RCU_FLAG_IRC14MSTB, RCU_FLAG_V12RST, RCU_FLAG_OBLRST,
+	RCU_FLAG_EPRST, RCU_FLAG_PORRST, RCU_FLAG_SWRST, RCU_FLAG_FWDGTRST,
+	RCU_FLAG_WWDGTRST, RCU_FLAG_LPRST
+} rcu_flag_enum;
+
+#define RCU_ADCCK_IRC14M         ((uint32_t)0x00000000U)
+#define RCU_ADCCK_APB2_DIV2      ((uint32_t)0x00000001U)
+#define RCU_ADCCK_APB2_DIV4      ((uint32_t)0x00000002U)
+#define RCU_ADCCK_APB2_DIV6      ((uint32_t)0x00000003U)
+#define RCU_ADCCK_APB2_DIV8      ((uint32_t)0x00000004U)
+
+void rcu_periph_clock_enable(rcu_periph_enum periph);
+void rcu_adc_clock_config(uint32_t adc_clock_source);
+FlagStatus rcu_flag_get(rcu_flag_enum flag);
+void rcu_all_reset_flag_clear(void);
+
+//----------------------------------------------------------------------------
+// GPIO
+//----------------------------------------------------------------------------
+#define GPIOA  ((uint32_t)0x48000000U)
+#define GPIOB  ((uint32_t)0x48000400U)
+#define GPIOC  ((uint32_t)0x48000800U)
+#define GPIOD  ((uint32_t)0x48000C00U)
+#define GPIOF  ((uint32_t)0x48001400U)
+
+#define GPIO_PIN_0   BIT(0)
+#define GPIO_PIN_1   BIT(1)
+#define GPIO_PIN_2   BIT(2)
+#define GPIO_PIN_3   BIT(3)
+#define GPIO_PIN_4   BIT(4)
+#define GPIO_PIN_5   BIT(5)
+#define GPIO_PIN_6   BIT(6)
+#define GPIO_PIN_7   BIT(7)
+#define GPIO_PIN_8   BIT(8)
+#define GPIO_PIN_9   BIT(9)
+#define GPIO_PIN_10  BIT(10)
+#define GPIO_PIN_11  BIT(11)
+#define GPIO_PIN_12  BIT(12)
+#define GPIO_PIN_13  BIT(13)
+#define GPIO_PIN_14  BIT(14)
+#define GPIO_PIN_15  BIT(15)
+#define GPIO_PIN_ALL BITS(0, 15)
+
+#define GPIO_MODE_INPUT    ((uint32_t)0x00000000U)
+#define GPIO_MODE_OUTPUT   ((uint32_t)0x00000001U)
+#define GPIO_MODE_AF       ((uint32_t)0x00000002U)
+#define GPIO_MODE_ANALOG   ((uint32_t)0x00000003U)
+
+#define GPIO_PUPD_NONE     ((uint32_t)0x00000000U)
+#define GPIO_PUPD_PULLUP   ((uint32_t)0x00000001U)
+#define GPIO_PUPD_PULLDOWN ((uint32_t)0x00000002U)
+
+#define GPIO_OTYPE_PP      ((uint8_t)0x00U)
+#define GPIO_OTYPE_OD      ((uint8_t)0x01U)
+
+#define GPIO_OSPEED_2MHZ   ((uint32_t)0x00000000U)
+#define GPIO_OSPEED_10MHZ  ((uint32_t)0x00000001U)
+#define GPIO_OSPEED_50MHZ  ((uint32_t)0x00000003U)
+
+#define GPIO_AF_0  ((uint32_t)0x00000000U)
+#define GPIO_AF_1  ((uint32_t)0x00000001U)
+#define GPIO_AF_2  ((uint32_t)0x00000002U)
+#define GPIO_AF_3  ((uint32_t)0x00000003U)
+#define GPIO_AF_4  ((uint32_t)0x00000004U)
+
+void gpio_mode_set(uint32_t gpio_periph, uint32_t mode, uint32_t pull_up_down, uint32_t pin);
+void gpio_output_options_set(uint32_t gpio_periph, uint8_t otype, uint32_t speed, uint32_t pin);
+void gpio_af_set(uint32_t gpio_periph, uint32_t alt_func_num, uint32_t pin);
+void gpio_bit_set(uint32_t gpio_periph, uint32_t pin);
+void gpio_bit_reset(uint32_t gpio_periph, uint32_t pin);
+void gpio_bit_write(uint32_t gpio_periph, uint32_t pin, bit_status bit_value);
+FlagStatus gpio_input_bit_get(uint32_t gpio_periph, uint32_t pin);
+FlagStatus gpio_output_bit_get(uint32_t gpio_periph, uint32_t pin);
+
+//----------------------------------------------------------------------------
+// EXTI and SYSCFG
+//----------------------------------------------------------------------------
+typedef enum
+{
+	EXTI_0 = BIT(0), EXTI_1 = BIT(1), EXTI_2 = BIT(2), EXTI_3 = BIT(3),
+	EXTI_4 = BIT(4), EXTI_5 = BIT(5), EXTI_6 = BIT(6), EXTI_7 = BIT(7),
+	EXTI_8 = BIT(8), EXTI_9 = BIT(9), EXTI_10 = BIT(10), EXTI_11 = BIT(11),
+	EXTI_12 = BIT(12), EXTI_13 = BIT(13), EXTI_14 = BIT(14), EXTI_15 = BIT(15)
+} exti_line_enum;
+
+typedef enum {EXTI_INTERRUPT = 0, EXTI_EVENT} exti_mode_enum;
+typedef enum {EXTI_TRIG_RISING = 0, EXTI_TRIG_FALLING, EXTI_TRIG_BOTH} exti_trig_type_enum;
+
+#define EXTI_SOURCE_GPIOA  ((uint8_t)0x00U)
+#define EXTI_SOURCE_GPIOB  ((uint8_t)0x01U)
+#define EXTI_SOURCE_GPIOC  ((uint8_t)0x02U)
+#define EXTI_SOURCE_GPIOD  ((uint8_t)0x03U)
+#define EXTI_SOURCE_GPIOF  ((uint8_t)0x05U)
+
+#define EXTI_SOURCE_PIN0   ((uint8_t)0x00U)
+#define EXTI_SOURCE_PIN1   ((uint8_t)0x01U)
+#define EXTI_SOURCE_PIN2   ((uint8_t)0x02U)
+#define EXTI_SOURCE_PIN3   ((uint8_t)0x03U)
+#define EXTI_SOURCE_PIN4   ((uint8_t)0x04U)
+#define EXTI_SOURCE_PIN5   ((uint8_t)0x05U)
+#define EXTI_SOURCE_PIN6   ((uint8_t)0x06U)
+#define EXTI_SOURCE_PIN7   ((uint8_t)0x07U)
+#define EXTI_SOURCE_PIN8   ((uint8_t)0x08U)
+#define EXTI_SOURCE_PIN9   ((uint8_t)0x09U)
+#define EXTI_SOURCE_PIN10  ((uint8_t)0x0AU)
+#define EXTI_SOURCE_PIN11  ((uint8_t)0x0BU)
+#define EXTI_SOURCE_PIN12  ((uint8_t)0x0CU)
+#define EXTI_SOURCE_PIN13  ((uint8_t)0x0DU)
+#define EXTI_SOURCE_PIN14  ((uint8_t)0x0EU)
+#define EXTI_SOURCE_PIN15  ((uint8_t)0x0FU)
+
+// Pending register (bit set by the edge, cleared by writing a one)
+extern volatile uint32_t simExtiPd;
+#define EXTI_PD simExtiPd
+
+void syscfg_exti_line_config(uint8_t exti_port, uint8_t exti_pin);
+void exti_init(exti_line_enum linex, exti_mode_enum mode, exti_trig_type_enum trig_type);
+void exti_interrupt_enable(exti_line_enum linex);
+void exti_interrupt_disable(exti_line_enum linex);
+FlagStatus exti_interrupt_flag_get(exti_line_enum linex);
+void exti_interrupt_flag_clear(exti_line_enum linex);
+
+//----------------------------------------------------------------------------
+// TIMER
+//----------------------------------------------------------------------------
+#define TIMER0   ((uint32_t)0x40012C00U)
+#define TIMER1   ((uint32_t)0x40000000U)
+#define TIMER2   ((uint32_t)0x40000400U)
+#define TIMER13  ((uint32_t)0x40002000U)
+#define TIMER14  ((uint32_t)0x40014000U)
+#define TIMER15  ((uint32_t)0x40014400U)
+#define TIMER16  ((uint32_t)0x40014800U)
+
+typedef struct
+{
+	uint16_t prescaler;
+	uint16_t alignedmode;
+	uint16_t counterdirection;
+	uint32_t period;
+	uint16_t clockdivision;
+	uint8_t  repetitioncounter;
+} timer_parameter_struct;
+
+typedef struct
+{
+	uint16_t runoffstate;
+	uint16_t ideloffstate;
+	uint16_t deadtime;
+	uint16_t breakpolarity;
+	uint16_t outputautostate;
+	uint16_t protectmode;
+	uint16_t breakstate;
+} timer_break_parameter_struct;
+
+typedef struct
+{
+	uint16_t outputstate;
+	uint16_t outputnstate;
+	uint16_t ocpolarity;
+	uint16_t ocnpolarity;
+	uint16_t ocidlestate;
+	uint16_t ocnidlestate;
+} timer_oc_parameter_struct;
+
+#define TIMER_CH_0  ((uint16_t)0x0000U)
+#define TIMER_CH_1  ((uint16_t)0x0001U)
+#define TIMER_CH_2  ((uint16_t)0x0002U)
+#define TIMER_CH_3  ((uint16_t)0x0003U)
+
+#define TIMER_COUNTER_EDGE         ((uint16_t)0x0000U)
+#define TIMER_COUNTER_CENTER_DOWN  ((uint16_t)0x0020U)
+#define TIMER_COUNTER_CENTER_UP    ((uint16_t)0x0040U)
+#define TIMER_COUNTER_CENTER_BOTH  ((uint16_t)0x0060U)
+#define TIMER_COUNTER_UP           ((uint16_t)0x0000U)
+#define TIMER_COUNTER_DOWN         ((uint16_t)0x0010U)
+#define TIMER_CKDIV_DIV1           ((uint16_t)0x0000U)
+
+#define TIMER_OC_MODE_TIMING   ((uint16_t)0x0000U)
+#define TIMER_OC_MODE_ACTIVE   ((uint16_t)0x0010U)
+#define TIMER_OC_MODE_INACTIVE ((uint16_t)0x0020U)
+#define TIMER_OC_MODE_TOGGLE   ((uint16_t)0x0030U)
+#define TIMER_OC_MODE_LOW      ((uint16_t)0x0040U)
+#define TIMER_OC_MODE_HIGH     ((uint16_t)0x0050U)
+#define TIMER_OC_MODE_PWM0     ((uint16_t)0x0060U)
+#define TIMER_OC_MODE_PWM1     ((uint16_t)0x0070U)
+
+#define TIMER_OC_SHADOW_ENABLE   ((uint16_t)0x0008U)
+#define TIMER_OC_SHADOW_DISABLE  ((uint16_t)0x0000U)
+#define TIMER_OC_FAST_ENABLE     ((uint16_t)0x0004U)
+#define TIMER_OC_FAST_DISABLE    ((uint16_t)0x0000U)
+
+#define TIMER_CCX_ENABLE          ((uint32_t)0x00000001U)
+#define TIMER_CCX_DISABLE         ((uint32_t)0x00000000U)
+#define TIMER_CCXN_ENABLE         ((uint16_t)0x0004U)
+#define TIMER_CCXN_DISABLE        ((uint16_t)0x0000U)
+#define TIMER_OC_POLARITY_HIGH    ((uint16_t)0x0000U)
+#define TIMER_OC_POLARITY_LOW     ((uint16_t)0x0002U)
+#define TIMER_OCN_POLARITY_HIGH   ((uint16_t)0x0000U)
+#define TIMER_OCN_POLARITY_LOW    ((uint16_t)0x0008U)
+#define TIMER_OC_IDLE_STATE_HIGH  ((uint16_t)0x0100U)
+#define TIMER_OC_IDLE_STATE_LOW   ((uint16_t)0x0000U)
+#define TIMER_OCN_IDLE_STATE_HIGH ((uint16_t)0x0200U)
+#define TIMER_OCN_IDLE_STATE_LOW  ((uint16_t)0x0000U)
+
+#define TIMER_ROS_STATE_ENABLE    ((uint16_t)0x0800U)
+#define TIMER_ROS_STATE_DISABLE   ((uint16_t)0x0000U)
+#define TIMER_IOS_STATE_ENABLE    ((uint16_t)0x0400U)
+#define TIMER_IOS_STATE_DISABLE   ((uint16_t)0x0000U)
+#define TIMER_CCHP_PROT_OFF       ((uint16_t)0x0000U)
+#define TIMER_BREAK_ENABLE        ((uint16_t)0x1000U)
+#define TIMER_BREAK_DISABLE       ((uint16_t)0x0000U)
+#define TIMER_BREAK_POLARITY_LOW  ((uint16_t)0x0000U)
+#define TIMER_BREAK_POLARITY_HIGH ((uint16_t)0x2000U)
+#define TIMER_OUTAUTO_ENABLE      ((uint16_t)0x4000U)
+#define TIMER_OUTAUTO_DISABLE     ((uint16_t)0x0000U)
+
+#define TIMER_TRI_OUT_SRC_RESET   ((uint32_t)0x00000000U)
+#define TIMER_TRI_OUT_SRC_ENABLE  ((uint32_t)0x00000010U)
+#define TIMER_TRI_OUT_SRC_UPDATE  ((uint32_t)0x00000020U)
+#define TIMER_TRI_OUT_SRC_CH0     ((uint32_t)0x00000030U)
+#define TIMER_TRI_OUT_SRC_O0CPRE  ((uint32_t)0x00000040U)
+#define TIMER_TRI_OUT_SRC_O1CPRE  ((uint32_t)0x00000050U)
+#define TIMER_TRI_OUT_SRC_O2CPRE  ((uint32_t)0x00000060U)
+#define TIMER_TRI_OUT_SRC_O3CPRE  ((uint32_t)0x00000070U)
+
+#define TIMER_INT_UP       BIT(0)
+#define TIMER_INT_CH0      BIT(1)
+#define TIMER_INT_CH1      BIT(2)
+#define TIMER_INT_CH2      BIT(3)
+#define TIMER_INT_CH3      BIT(4)
+#define TIMER_INT_FLAG_UP  TIMER_INT_UP
+#define TIMER_INT_FLAG_CH0 TIMER_INT_CH0
+#define TIMER_INT_FLAG_CH1 TIMER_INT_CH1
+#define TIMER_INT_FLAG_CH2 TIMER_INT_CH2
+#define TIMER_INT_FLAG_CH3 TIMER_INT_CH3
+
+void timer_deinit(uint32_t timer_periph);
+void timer_init(uint32_t timer_periph, timer_parameter_struct *initpara);
+void timer_enable(uint32_t timer_periph);
+void timer_disable(uint32_t timer_periph);
+void timer_auto_reload_shadow_enable(uint32_t timer_periph);
+void timer_auto_reload_shadow_disable(uint32_t timer_periph);
+void timer_autoreload_value_config(uint32_t timer_periph, uint32_t autoreload);
+void timer_counter_value_config(uint32_t timer_periph, uint32_t counter);
+uint32_t timer_counter_read(uint32_t timer_periph);
+void timer_break_config(uint32_t timer_periph, timer_break_parameter_struct *breakpara);
+void timer_primary_output_config(uint32_t timer_periph, ControlStatus newvalue);
+void timer_automatic_output_enable(uint32_t timer_periph);
+void timer_automatic_output_disable(uint32_t timer_periph);
+void timer_channel_output_config(uint32_t timer_periph, uint16_t channel, timer_oc_parameter_struct *ocpara);
+void timer_channel_output_mode_config(uint32_t timer_periph, uint16_t channel, uint16_t ocmode);
+void timer_channel_output_pulse_value_config(uint32_t timer_periph, uint16_t channel, uint32_t pulse);
+void timer_channel_output_shadow_config(uint32_t timer_periph, uint16_t channel, uint16_t ocshadow);
+void timer_channel_output_fast_config(uint32_t timer_periph, uint16_t channel, uint16_t ocfast);
+void timer_channel_output_state_config(uint32_t timer_periph, uint16_t channel, uint32_t state);
+void timer_channel_complementary_output_state_config(uint32_t timer_periph, uint16_t channel, uint16_t ocnstate);
+void timer_master_output_trigger_source_select(uint32_t timer_periph, uint32_t outrigger);
+void timer_interrupt_enable(uint32_t timer_periph, uint32_t interrupt);
+void timer_interrupt_disable(uint32_t timer_periph, uint32_t interrupt);
+FlagStatus timer_interrupt_flag_get(uint32_t timer_periph, uint32_t interrupt);
+void timer_interrupt_flag_clear(uint32_t timer_periph, uint32_t interrupt);
+
+//----------------------------------------------------------------------------
+// DMA
+//----------------------------------------------------------------------------
+typedef enum {DMA_CH0 = 0, DMA_CH1, DMA_CH2, DMA_CH3, DMA_CH4, DMA_CH5, DMA_CH6} dma_channel_enum;
+
+typedef struct
+{
+	uint32_t periph_addr;
+	uint32_t periph_width;
+	uint32_t memory_addr;
+	uint32_t memory_width;
+	uint32_t number;
+	uint32_t priority;
+	uint8_t  periph_inc;
+	uint8_t  memory_inc;
+	uint8_t  direction;
+} dma_parameter_struct;
+
+#define DMA_PERIPHERAL_TO_MEMORY      ((uint8_t)0x00U)
+#define DMA_MEMORY_TO_PERIPHERAL      ((uint8_t)0x01U)
+#define DMA_PERIPH_INCREASE_DISABLE   ((uint8_t)0x00U)
+#define DMA_PERIPH_INCREASE_ENABLE    ((uint8_t)0x01U)
+#define DMA_MEMORY_INCREASE_DISABLE   ((uint8_t)0x00U)
+#define DMA_MEMORY_INCREASE_ENABLE    ((uint8_t)0x01U)
+#define DMA_PERIPHERAL_WIDTH_8BIT     ((uint32_t)0x00000000U)
+#define DMA_PERIPHERAL_WIDTH_16BIT    ((uint32_t)0x00000100U)
+#define DMA_PERIPHERAL_WIDTH_32BIT    ((uint32_t)0x00000200U)
+#define DMA_MEMORY_WIDTH_8BIT         ((uint32_t)0x00000000U)
+#define DMA_MEMORY_WIDTH_16BIT        ((uint32_t)0x00000400U)
+#define DMA_MEMORY_WIDTH_32BIT        ((uint32_t)0x00000800U)
+#define DMA_PRIORITY_LOW              ((uint32_t)0x00000000U)
+#define DMA_PRIORITY_MEDIUM           ((uint32_t)0x00001000U)
+#define DMA_PRIORITY_HIGH             ((uint32_t)0x00002000U)
+#define DMA_PRIORITY_ULTRA_HIGH       ((uint32_t)0x00003000U)
+
+#define DMA_CHXCTL_FTFIE   BIT(1)
+#define DMA_CHXCTL_HTFIE   BIT(2)
+#define DMA_CHXCTL_ERRIE   BIT(3)
+#define DMA_INT_FLAG_G     BIT(0)
+#define DMA_INT_FLAG_FTF   BIT(1)
+#define DMA_INT_FLAG_HTF   BIT(2)
+#define DMA_INT_FLAG_ERR   BIT(3)
+#define DMA_FLAG_G         DMA_INT_FLAG_G
+#define DMA_FLAG_FTF       DMA_INT_FLAG_FTF
+#define DMA_FLAG_HTF       DMA_INT_FLAG_HTF
+#define DMA_FLAG_ERR       DMA_INT_FLAG_ERR
+
+void dma_deinit(dma_channel_enum channelx);
+void dma_init(dma_channel_enum channelx, dma_parameter_struct init_struct);
+void dma_circulation_enable(dma_channel_enum channelx);
+void dma_circulation_disable(dma_channel_enum channelx);
+void dma_memory_to_memory_enable(dma_channel_enum channelx);
+void dma_memory_to_memory_disable(dma_channel_enum channelx);
+void dma_channel_enable(dma_channel_enum channelx);
+void dma_channel_disable(dma_channel_enum channelx);
+void dma_periph_address_config(dma_channel_enum channelx, uint32_t address);
+void dma_memory_address_config(dma_channel_enum channelx, uint32_t address);
+void dma_transfer_number_config(dma_channel_enum channelx, uint32_t number);
+uint32_t dma_transfer_number_get(dma_channel_enum channelx);
+FlagStatus dma_flag_get(dma_channel_enum channelx, uint32_t flag);
+void dma_flag_clear(dma_channel_enum channelx, uint32_t flag);
+FlagStatus dma_interrupt_flag_get(dma_channel_enum channelx, uint32_t int_flag);
+void dma_interrupt_flag_clear(dma_channel_enum channelx, uint32_t int_flag);
+void dma_interrupt_enable(dma_channel_enum channelx, uint32_t source);
+void dma_interrupt_disable(dma_channel_enum channelx, uint32_t source);
+
+//----------------------------------------------------------------------------
+// ADC
+//----------------------------------------------------------------------------
+#define ADC_REGULAR_CHANNEL      ((uint8_t)0x01U)
+#define ADC_INSERTED_CHANNEL     ((uint8_t)0x02U)
+
+#define ADC_INSERTED_CHANNEL_0   ((uint8_t)0x00U)
+#define ADC_INSERTED_CHANNEL_1   ((uint8_t)0x01U)
+#define ADC_INSERTED_CHANNEL_2   ((uint8_t)0x02U)
+#define ADC_INSERTED_CHANNEL_3   ((uint8_t)0x03U)
+
+#define ADC_CHANNEL_0   ((uint8_t)0x00U)
+#define ADC_CHANNEL_1   ((uint8_t)0x01U)
+#define ADC_CHANNEL_2   ((uint8_t)0x02U)
+#define ADC_CHANNEL_3   ((uint8_t)0x03U)
+#define ADC_CHANNEL_4   ((uint8_t)0x04U)
+#define ADC_CHANNEL_5   ((uint8_t)0x05U)
+#define ADC_CHANNEL_6   ((uint8_t)0x06U)
+#define ADC_CHANNEL_7   ((uint8_t)0x07U)
+#define ADC_CHANNEL_8   ((uint8_t)0x08U)
+#define ADC_CHANNEL_9   ((uint8_t)0x09U)
+#define ADC_CHANNEL_16  ((uint8_t)0x10U)
+#define ADC_CHANNEL_17  ((uint8_t)0x11U)
+#define ADC_CHANNEL_18  ((uint8_t)0x12U)
+#define SIM_COUNT_ADC_CHANNELS 19	// Count of ADC channels!!
+
+#define ADC_SAMPLETIME_1POINT5    ((uint32_t)0x00000000U)
+#define ADC_SAMPLETIME_7POINT5    ((uint32_t)0x00000001U)
+#define ADC_SAMPLETIME_13POINT5   ((uint32_t)0x00000002U)
+#define ADC_SAMPLETIME_28POINT5   ((uint32_t)0x00000003U)
+#define ADC_SAMPLETIME_41POINT5   ((uint32_t)0x00000004U)
+#define ADC_SAMPLETIME_55POINT5   ((uint32_t)0x00000005U)
+#define ADC_SAMPLETIME_71POINT5   ((uint32_t)0x00000006U)
+#define ADC_SAMPLETIME_239POINT5  ((uint32_t)0x00000007U)
+
+#define ADC_DATAALIGN_RIGHT       ((uint32_t)0x00000000U)
+#define ADC_DATAALIGN_LEFT        ((uint32_t)0x00000800U)
+
+#define ADC_SCAN_MODE             ((uint32_t)0x00000100U)
+#define ADC_INSERTED_CHANNEL_AUTO ((uint32_t)0x00000400U)
+#define ADC_CONTINUOUS_MODE       ((uint32_t)0x00000002U)
+
+#define ADC_EXTTRIG_REGULAR_T0_CH0     ((uint32_t)0x00000000U)
+#define ADC_EXTTRIG_REGULAR_T0_CH1     ((uint32_t)0x00020000U)
+#define ADC_EXTTRIG_REGULAR_T0_CH2     ((uint32_t)0x00040000U)
+#define ADC_EXTTRIG_REGULAR_T1_CH1     ((uint32_t)0x00060000U)
+#define ADC_EXTTRIG_REGULAR_T2_TRGO    ((uint32_t)0x00080000U)
+#define ADC_EXTTRIG_REGULAR_T14_CH0    ((uint32_t)0x000A0000U)
+#define ADC_EXTTRIG_REGULAR_EXTI_11    ((uint32_t)0x000C0000U)
+#define ADC_EXTTRIG_REGULAR_SWRCST     ((uint32_t)0x000E0000U)
+#define ADC_EXTTRIG_INSERTED_T0_TRGO   ((uint32_t)0x00000000U)
+#define ADC_EXTTRIG_INSERTED_T0_CH3    ((uint32_t)0x00001000U)
+#define ADC_EXTTRIG_INSERTED_T1_TRGO   ((uint32_t)0x00002000U)
+#define ADC_EXTTRIG_INSERTED_T1_CH0    ((uint32_t)0x00003000U)
+#define ADC_EXTTRIG_INSERTED_T2_CH3    ((uint32_t)0x00004000U)
+#define ADC_EXTTRIG_INSERTED_T14_TRGO  ((uint32_t)0x00005000U)
+#define ADC_EXTTRIG_INSERTED_EXTI_15   ((uint32_t)0x00006000U)
+#define ADC_EXTTRIG_INSERTED_SWICST    ((uint32_t)0x00007000U)
+
+#define ADC_INT_WDE       BIT(6)
+#define ADC_INT_EOC       BIT(5)
+#define ADC_INT_EOIC      BIT(7)
+#define ADC_INT_FLAG_WDE  BIT(0)
+#define ADC_INT_FLAG_EOC  BIT(1)
+#define ADC_INT_FLAG_EOIC BIT(2)
+#define ADC_FLAG_WDE      BIT(0)
+#define ADC_FLAG_EOC      BIT(1)
+#define ADC_FLAG_EOIC     BIT(2)
+#define ADC_FLAG_STIC     BIT(3)
+#define ADC_FLAG_STRC     BIT(4)
+
+// Regular data register (read by the DMA)
+extern volatile uint32_t simAdcRdata;
+#define ADC_RDATA simAdcRdata
+
+void adc_enable(void);
+void adc_disable(void);
+void adc_calibration_enable(void);
+void adc_dma_mode_enable(void);
+void adc_dma_mode_disable(void);
+void adc_tempsensor_vrefint_enable(void);
+void adc_tempsensor_vrefint_disable(void);
+void adc_vbat_enable(void);
+void adc_vbat_disable(void);
+void adc_watchdog_disable(void);
+void adc_special_function_config(uint32_t function, ControlStatus newvalue);
+void adc_data_alignment_config(uint32_t data_alignment);
+void adc_channel_length_config(uint8_t channel_group, uint32_t length);
+void adc_regular_channel_config(uint8_t rank, uint8_t channel, uint32_t sample_time);
+void adc_inserted_channel_config(uint8_t rank, uint8_t channel, uint32_t sample_time);
+void adc_external_trigger_config(uint8_t channel_group, ControlStatus newvalue);
+void adc_external_trigger_source_config(uint8_t channel_group, uint32_t external_trigger_source);
+void adc_software_trigger_enable(uint8_t channel_group);
+uint16_t adc_regular_data_read(void);
+uint16_t adc_inserted_data_read(uint8_t inserted_channel);
+FlagStatus adc_flag_get(uint32_t flag);
+void adc_flag_clear(uint32_t flag);
+FlagStatus adc_interrupt_flag_get(uint32_t int_flag);
+void adc_interrupt_flag_clear(uint32_t int_flag);
+void adc_interrupt_enable(uint32_t interrupt);
+void adc_interrupt_disable(uint32_t interrupt);
+
+//----------------------------------------------------------------------------
+// USART
+//----------------------------------------------------------------------------
+#define USART0  ((uint32_t)0x40013800U)
+#define USART1  ((uint32_t)0x40004400U)
+
+#define USART_PM_NONE          ((uint32_t)0x00000000U)
+#define USART_PM_EVEN          ((uint32_t)0x00000400U)
+#define USART_PM_ODD           ((uint32_t)0x00000600U)
+#define USART_WL_8BIT          ((uint32_t)0x00000000U)
+#define USART_WL_9BIT          ((uint32_t)0x00001000U)
+#define USART_STB_1BIT         ((uint32_t)0x00000000U)
+#define USART_STB_2BIT         ((uint32_t)0x00002000U)
+#define USART_OVSMOD_8         ((uint32_t)0x00008000U)
+#define USART_OVSMOD_16        ((uint32_t)0x00000000U)
+#define USART_TRANSMIT_ENABLE  ((uint32_t)0x00000008U)
+#define USART_TRANSMIT_DISABLE ((uint32_t)0x00000000U)
+#define USART_RECEIVE_ENABLE   ((uint32_t)0x00000004U)
+#define USART_RECEIVE_DISABLE  ((uint32_t)0x00000000U)
+#define USART_DENR_ENABLE      ((uint32_t)0x00000040U)
+#define USART_DENR_DISABLE     ((uint32_t)0x00000000U)
+#define USART_DENT_ENABLE      ((uint32_t)0x00000080U)
+#define USART_DENT_DISABLE     ((uint32_t)0x00000000U)
+
+typedef enum
+{
+	USART_FLAG_PERR = BIT(0), USART_FLAG_FERR = BIT(1), USART_FLAG_NERR = BIT(2),
+	USART_FLAG_ORERR = BIT(3), USART_FLAG_IDLE = BIT(4), USART_FLAG_RBNE = BIT(5),
+	USART_FLAG_TC = BIT(6), USART_FLAG_TBE = BIT(7)
+} usart_flag_enum;
+
+typedef enum
+{
+	USART_INT_IDLE = BIT(4), USART_INT_RBNE = BIT(5), USART_INT_TC = BIT(6), USART_INT_TBE = BIT(7)
+} usart_interrupt_enum;
+
+typedef enum
+{
+	USART_INT_FLAG_IDLE = BIT(4), USART_INT_FLAG_RBNE = BIT(5), USART_INT_FLAG_TC = BIT(6),
+	USART_INT_FLAG_TBE = BIT(7), USART_INT_FLAG_RBNE_ORERR = BIT(3)
+} usart_interrupt_flag_enum;
+
+void usart_deinit(uint32_t usart_periph);
+void usart_baudrate_set(uint32_t usart_periph, uint32_t baudval);
+void usart_parity_config(uint32_t usart_periph, uint32_t paritycfg);
+void usart_word_length_set(uint32_t usart_periph, uint32_t wlen);
+void usart_stop_bit_set(uint32_t usart_periph, uint32_t stblen);
+void usart_oversample_config(uint32_t usart_periph, uint32_t oversamp);
+void usart_enable(uint32_t usart_periph);
+void usart_disable(uint32_t usart_periph);
+void usart_transmit_config(uint32_t usart_periph, uint32_t txconfig);
+void usart_receive_config(uint32_t usart_periph, uint32_t rxconfig);
+void usart_dma_receive_config(uint32_t usart_periph, uint32_t dmacmd);
+void usart_dma_transmit_config(uint32_t usart_periph, uint32_t dmacmd);
+void usart_data_transmit(uint32_t usart_periph, uint32_t data);
+uint16_t usart_data_receive(uint32_t usart_periph);
+FlagStatus usart_flag_get(uint32_t usart_periph, usart_flag_enum flag);
+void usart_flag_clear(uint32_t usart_periph, usart_flag_enum flag);
+void usart_interrupt_enable(uint32_t usart_periph, usart_interrupt_enum interrupt);
+void usart_interrupt_disable(uint32_t usart_periph, usart_interrupt_enum interrupt);
+FlagStatus usart_interrupt_flag_get(uint32_t usart_periph, usart_interrupt_flag_enum int_flag);
+void usart_interrupt_flag_clear(uint32_t usart_periph, usart_interrupt_flag_enum int_flag);
+
+//----------------------------------------------------------------------------
+// FMC (flash)
+//----------------------------------------------------------------------------
+typedef enum {FMC_READY = 0, FMC_BUSY, FMC_PGERR, FMC_WPERR, FMC_TOERR} fmc_state_enum;
+
+#define FMC_FLAG_BUSY   BIT(0)
+#define FMC_FLAG_PGERR  BIT(2)
+#define FMC_FLAG_WPERR  BIT(4)
+#define FMC_FLAG_END    BIT(5)
+
+void fmc_unlock(void);
+void fmc_lock(void);
+fmc_state_enum fmc_page_erase(uint32_t page_address);
+fmc_state_enum fmc_word_program(uint32_t address, uint32_t data);
+FlagStatus fmc_flag_get(uint32_t flag);
+void fmc_flag_clear(uint32_t flag);
+
+//----------------------------------------------------------------------------
+// FWDGT (free watchdog)
+//----------------------------------------------------------------------------
+#define FWDGT_PSC_DIV4    ((uint8_t)0x00U)
+#define FWDGT_PSC_DIV8    ((uint8_t)0x01U)
+#define FWDGT_PSC_DIV16   ((uint8_t)0x02U)
+#define FWDGT_PSC_DIV32   ((uint8_t)0x03U)
+#define FWDGT_PSC_DIV64   ((uint8_t)0x04U)
+#define FWDGT_PSC_DIV128  ((uint8_t)0x05U)
+#define FWDGT_PSC_DIV256  ((uint8_t)0x06U)
+
+ErrStatus fwdgt_config(uint16_t reload_value, uint8_t prescaler_div);
+ErrStatus fwdgt_window_value_config(uint16_t window_value);
+void fwdgt_enable(void);
+void fwdgt_counter_reload(void);
+
+#endif
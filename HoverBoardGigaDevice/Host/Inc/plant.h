@@ -0,0 +1,99 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Plant model of one board: battery, inverter, hub motor, wheel and the
+// rider share it carries. It runs on every update event of the PWM timer
+// and feeds the hall sensor pins and the ADC channels of the simulated board.
+
+#ifndef PLANT_H
+#define PLANT_H
+
+#include "gd32f1x0.h"
+
+// Parameters of the plant
+typedef struct
+{
+	double batteryVoltageFull;		// Open circuit voltage of the full battery [V]
+	double batteryVoltageEmpty;		// Open circuit voltage of the empty battery [V]
+	double batteryCapacity;				// [Ah]
+	double batteryCharge;					// State of charge at start (0 to 1)
+	double batteryResistance;			// Internal resistance including wiring [Ohm]
+	double phaseResistance;				// [Ohm]
+	double phaseInductance;				// [H]
+	double backEmfConstant;				// Peak phase back-EMF per wheel speed [Vs/rad]
+	double frictionTorque;				// Bearing and iron losses [Nm]
+	uint8_t polePairs;
+	double wheelRadius;						// [m]
+	double mass;									// Share of board and rider carried by the wheel [kg]
+	double rollingResistance;			// Coefficient of rolling resistance
+	double dragArea;							// Drag coefficient times frontal area share [m^2]
+	double slope;									// Grade, positive uphill in the turning direction of positive pwm
+} PLANT_CONFIG;
+
+// State of the plant
+typedef struct
+{
+	double time;									// [s]
+	double speed;									// Ground speed, positive for positive pwm [m/s]
+	double electricalAngle;				// Rotor angle [rad]
+	double phaseCurrent[3];				// Currents into the phases y, b, g [A]
+	double currentDC;							// Battery current, positive when discharging [A]
+	double batteryVoltage;				// Terminal voltage [V]
+	double batteryCharge;					// State of charge (0 to 1)
+	double torque;								// Motor torque [Nm]
+	double powerBattery;					// Power drawn from the battery [W]
+	double powerMechanical;				// Power delivered to the wheel [W]
+	double energyBattery;					// Energy drawn since start [J]
+	double energyMechanical;			// Energy delivered since start [J]
+	uint8_t hall;									// Hall inputs (bit 0 A, bit 1 B, bit 2 C)
+} PLANT_STATE;
+
+//----------------------------------------------------------------------------
+// Returns parameters of a hoverboard (36V battery, 6.5" hub motor, half of
+// board and rider)
+//----------------------------------------------------------------------------
+void PLANT_GetDefaultConfig(PLANT_CONFIG *config);
+
+//----------------------------------------------------------------------------
+// Connects the plant to the simulated board (before the firmware starts)
+//----------------------------------------------------------------------------
+void PLANT_Init(const PLANT_CONFIG *config);
+
+//----------------------------------------------------------------------------
+// Changes the grade of the road
+//----------------------------------------------------------------------------
+void PLANT_SetSlope(double slope);
+
+//----------------------------------------------------------------------------
+// Returns state of the plant
+//----------------------------------------------------------------------------
+const PLANT_STATE *PLANT_GetState(void);
+
+#endif
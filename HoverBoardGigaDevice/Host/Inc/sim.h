@@ -0,0 +1,159 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SIM_H
+#define SIM_H
+
+#include "gd32f1x0.h"
+
+// Simulated core clock (cycles per second)
+#define SIM_CORE_CLOCK 72000000
+
+// Cycles every firmware library call and intrinsic takes, firmware code
+// between the calls takes no time
+#define SIM_CALL_CYCLES 8
+
+// State of the simulated board
+typedef enum
+{
+	SIM_STATE_RUNNING = 0,
+	SIM_STATE_POWER_OFF = 1,				// Self hold pin was released
+	SIM_STATE_WATCHDOG_RESET = 2,		// Free watchdog has not been reloaded in time
+	SIM_STATE_DEADLOCK = 3,					// WFI without any interrupt source left
+	SIM_STATE_IRQ_STORM = 4					// Interrupt returned without clearing its flag
+} SIM_STATE;
+
+//----------------------------------------------------------------------------
+// Starts firmware entry function (e.g. the renamed main) as a coroutine,
+// it runs whenever SIM_Run lets time pass
+//----------------------------------------------------------------------------
+void SIM_Start(int (*entry)(void));
+
+//----------------------------------------------------------------------------
+// Lets number of cycles pass, runs the started firmware (otherwise only the
+// peripherals and interrupts)
+//----------------------------------------------------------------------------
+void SIM_Run(uint64_t cycles);
+
+//----------------------------------------------------------------------------
+// Lets number of milliseconds pass
+//----------------------------------------------------------------------------
+void SIM_RunMs(uint32_t ms);
+
+//----------------------------------------------------------------------------
+// Returns simulated cycles since start
+//----------------------------------------------------------------------------
+uint64_t SIM_Cycles(void);
+
+//----------------------------------------------------------------------------
+// Returns simulated seconds since start
+//----------------------------------------------------------------------------
+double SIM_Seconds(void);
+
+//----------------------------------------------------------------------------
+// Returns state of the board, firmware is not resumed after leaving running
+//----------------------------------------------------------------------------
+SIM_STATE SIM_GetState(void);
+
+//----------------------------------------------------------------------------
+// Returns how often interrupt handler has been called
+//----------------------------------------------------------------------------
+uint32_t SIM_GetIrqCount(IRQn_Type irq);
+
+//----------------------------------------------------------------------------
+// Sets level of an external signal (input pin), edges trigger the EXTI
+//----------------------------------------------------------------------------
+void SIM_SetPin(uint32_t port, uint32_t pin, FlagStatus level);
+
+//----------------------------------------------------------------------------
+// Returns level of pin (GPIO output, timer output or external signal)
+//----------------------------------------------------------------------------
+FlagStatus SIM_GetPin(uint32_t port, uint32_t pin);
+
+//----------------------------------------------------------------------------
+// Sets output pin, which switches the board off when released
+//----------------------------------------------------------------------------
+void SIM_SetPowerPin(uint32_t port, uint32_t pin);
+
+//----------------------------------------------------------------------------
+// Sets value of an ADC channel (used by the next conversion)
+//----------------------------------------------------------------------------
+void SIM_SetAdc(uint8_t channel, uint16_t value);
+
+//----------------------------------------------------------------------------
+// Queues bytes on the RX line of USART, they are received at baudrate
+// right after the bytes queued before
+//----------------------------------------------------------------------------
+void SIM_UsartReceive(uint32_t usart_periph, const uint8_t *data, uint16_t length);
+
+//----------------------------------------------------------------------------
+// Returns number of queued RX bytes not received yet
+//----------------------------------------------------------------------------
+uint16_t SIM_UsartReceivePending(uint32_t usart_periph);
+
+//----------------------------------------------------------------------------
+// Moves bytes completely sent on the TX line of USART into data, returns
+// number of bytes
+//----------------------------------------------------------------------------
+uint16_t SIM_UsartTransmitted(uint32_t usart_periph, uint8_t *data, uint16_t size);
+
+//----------------------------------------------------------------------------
+// Returns active compare value of timer channel
+//----------------------------------------------------------------------------
+uint32_t SIM_GetTimerCompare(uint32_t timer_periph, uint16_t channel);
+
+//----------------------------------------------------------------------------
+// Returns share of the period the output of timer channel is high while it
+// is enabled (0 to 1, mean value of the PWM)
+//----------------------------------------------------------------------------
+double SIM_GetTimerDuty(uint32_t timer_periph, uint16_t channel);
+
+//----------------------------------------------------------------------------
+// Returns whether outputs of timer are enabled (primary output of TIMER0)
+//----------------------------------------------------------------------------
+FlagStatus SIM_GetTimerOutputEnabled(uint32_t timer_periph);
+
+//----------------------------------------------------------------------------
+// Returns counter value of timer
+//----------------------------------------------------------------------------
+uint32_t SIM_GetTimerCounter(uint32_t timer_periph);
+
+//----------------------------------------------------------------------------
+// Returns cycles of one timer counter step
+//----------------------------------------------------------------------------
+uint32_t SIM_GetTimerTickCycles(uint32_t timer_periph);
+
+//----------------------------------------------------------------------------
+// Registers function called on every update event of timer (before its
+// interrupt), e.g. to advance a plant model
+//----------------------------------------------------------------------------
+void SIM_SetTimerUpdateHook(uint32_t timer_periph, void (*hook)(void));
+
+#endif
@@ -0,0 +1,85 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Interface between the simulated core (Host/Src/sim.c) and the simulated
+// peripherals (Host/Src/gd32f1x0.c)
+
+#ifndef SIMCORE_H
+#define SIMCORE_H
+
+#include "gd32f1x0.h"
+#include "../Inc/sim.h"
+
+// No event scheduled
+#define SIM_NEVER UINT64_MAX
+
+// Current cycle of the virtual clock
+extern uint64_t simNow;
+
+//----------------------------------------------------------------------------
+// Start of every firmware library call: lets the call cycles pass, takes
+// pending interrupts and returns to the test at its deadline
+//----------------------------------------------------------------------------
+void SIM_EnterCycles(uint32_t cycles);
+#define SIM_Enter() SIM_EnterCycles(SIM_CALL_CYCLES)
+
+//----------------------------------------------------------------------------
+// End of every firmware library call: takes interrupts raised by the call
+//----------------------------------------------------------------------------
+void SIM_Leave(void);
+
+//----------------------------------------------------------------------------
+// Lets cycles pass without taking interrupts (CPU stalled by flash access)
+//----------------------------------------------------------------------------
+void SIM_Stall(uint64_t cycles);
+
+//----------------------------------------------------------------------------
+// Leaves running state, the firmware is not resumed anymore
+//----------------------------------------------------------------------------
+void SIM_Stop(SIM_STATE state);
+
+// Implemented by the peripherals
+
+//----------------------------------------------------------------------------
+// Returns cycle of the next peripheral event (SIM_NEVER if none)
+//----------------------------------------------------------------------------
+uint64_t PERIPH_GetNextEvent(void);
+
+//----------------------------------------------------------------------------
+// Processes all peripheral events due at simNow
+//----------------------------------------------------------------------------
+void PERIPH_ProcessEvents(void);
+
+//----------------------------------------------------------------------------
+// Returns level of peripheral interrupt line
+//----------------------------------------------------------------------------
+FlagStatus PERIPH_GetIrqLine(IRQn_Type irq);
+
+#endif
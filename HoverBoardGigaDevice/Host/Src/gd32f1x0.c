@@ -0,0 +1,2378 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Simulated GD32F1x0 peripherals behind the firmware library functions:
+// RCU, GPIO, EXTI, TIMER, DMA, ADC, USART, FMC and FWDGT. Only the
+// functionality used by the firmware is modeled, each peripheral schedules
+// its events on the virtual clock of sim.c.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "gd32f1x0.h"
+#include "../Inc/sim.h"
+#include "../Inc/simCore.h"
+
+#define COUNT_PORTS 5
+#define COUNT_TIMERS 7
+#define COUNT_DMA_CHANNELS 7
+#define COUNT_USARTS 2
+
+// USART capture and input buffers
+#define USART_BUFFER_SIZE 4096
+
+// Flash
+#define FLASH_BASE 0x08000000U
+#define FLASH_SIZE (64 * 1024)
+#define FLASH_PAGE_SIZE 1024
+#define FLASH_ERASE_CYCLES (SIM_CORE_CLOCK / 1000 * 40)		// 40ms page erase
+#define FLASH_PROGRAM_CYCLES (SIM_CORE_CLOCK / 1000000 * 40)	// 40us word program
+
+// ADC clock APB2 / 6 (see rcu_adc_clock_config)
+#define ADC_CLOCK_DIV_DEFAULT 6
+
+//----------------------------------------------------------------------------
+// GPIO and EXTI
+//----------------------------------------------------------------------------
+typedef struct
+{
+	uint32_t periph;
+	uint8_t extiSource;
+	uint8_t mode[16];
+	uint8_t pull[16];
+	uint8_t af[16];
+	uint16_t output;
+	uint16_t external;
+	uint16_t driven;
+} SIM_GPIO;
+
+static SIM_GPIO gpio[COUNT_PORTS] =
+{
+	{GPIOA, EXTI_SOURCE_GPIOA}, {GPIOB, EXTI_SOURCE_GPIOB}, {GPIOC, EXTI_SOURCE_GPIOC},
+	{GPIOD, EXTI_SOURCE_GPIOD}, {GPIOF, EXTI_SOURCE_GPIOF}
+};
+
+volatile uint32_t simExtiPd = 0;
+static uint32_t extiInten = 0;
+static uint32_t extiRising = 0;
+static uint32_t extiFalling = 0;
+static uint8_t extiSource[16];
+
+// Power (self hold) pin
+static SIM_GPIO *powerPort = NULL;
+static uint16_t powerPin = 0;
+static FlagStatus powerOn = RESET;
+
+//----------------------------------------------------------------------------
+// TIMER
+//----------------------------------------------------------------------------
+typedef struct
+{
+	uint32_t periph;
+	IRQn_Type irqUp;
+	IRQn_Type irqChannel;
+	FlagStatus advanced;
+	void (*hook)(void);
+	
+	// Configuration
+	uint32_t tickCycles;
+	uint32_t car;
+	uint32_t carPreload;
+	FlagStatus arse;
+	FlagStatus center;
+	FlagStatus enabled;
+	uint32_t ccr[4];
+	uint32_t ccrPreload[4];
+	FlagStatus ccrShadow[4];
+	uint16_t ocMode[4];
+	FlagStatus ccEnable[4];
+	FlagStatus ccnEnable[4];
+	FlagStatus ocPolarityLow[4];
+	FlagStatus ocnPolarityLow[4];
+	FlagStatus ocIdleHigh[4];
+	FlagStatus ocnIdleHigh[4];
+	FlagStatus poen;
+	FlagStatus oaen;
+	uint32_t inten;
+	uint32_t intf;
+	uint32_t trgo;
+	
+	// Counter: phase 0 of the current period at base (running) or phase
+	// (stopped), center aligned period has 2 * car steps
+	uint64_t base;
+	uint32_t phase;
+	uint64_t nextUpdate;
+	uint64_t nextCompare;
+} SIM_TIMER;
+
+static SIM_TIMER timer[COUNT_TIMERS] =
+{
+	{TIMER0, TIMER0_BRK_UP_TRG_COM_IRQn, TIMER0_Channel_IRQn, SET},
+	{TIMER1, TIMER1_IRQn, TIMER1_IRQn, RESET},
+	{TIMER2, TIMER2_IRQn, TIMER2_IRQn, RESET},
+	{TIMER13, TIMER13_IRQn, TIMER13_IRQn, RESET},
+	{TIMER14, TIMER14_IRQn, TIMER14_IRQn, SET},
+	{TIMER15, TIMER15_IRQn, TIMER15_IRQn, SET},
+	{TIMER16, TIMER16_IRQn, TIMER16_IRQn, SET}
+};
+
+// Alternate function pins driven by timer channels
+typedef struct
+{
+	uint32_t port;
+	uint8_t pin;
+	uint8_t af;
+	uint32_t timer;
+	uint8_t channel;
+	FlagStatus complementary;
+} SIM_TIMER_PIN;
+
+static const SIM_TIMER_PIN timerPins[] =
+{
+	{GPIOA, 8, 2, TIMER0, 0, RESET},
+	{GPIOA, 9, 2, TIMER0, 1, RESET},
+	{GPIOA, 10, 2, TIMER0, 2, RESET},
+	{GPIOA, 11, 2, TIMER0, 3, RESET},
+	{GPIOA, 7, 2, TIMER0, 0, SET},
+	{GPIOB, 0, 2, TIMER0, 1, SET},
+	{GPIOB, 1, 2, TIMER0, 2, SET},
+	{GPIOB, 13, 2, TIMER0, 0, SET},
+	{GPIOB, 14, 2, TIMER0, 1, SET},
+	{GPIOB, 15, 2, TIMER0, 2, SET},
+	{GPIOA, 0, 2, TIMER1, 0, RESET},
+	{GPIOA, 1, 2, TIMER1, 1, RESET},
+	{GPIOA, 2, 2, TIMER1, 2, RESET},
+	{GPIOA, 3, 2, TIMER1, 3, RESET},
+	{GPIOA, 5, 2, TIMER1, 0, RESET},
+	{GPIOA, 15, 2, TIMER1, 0, RESET},
+	{GPIOB, 3, 2, TIMER1, 1, RESET},
+	{GPIOB, 10, 2, TIMER1, 2, RESET},
+	{GPIOB, 11, 2, TIMER1, 3, RESET}
+};
+
+//----------------------------------------------------------------------------
+// DMA
+//----------------------------------------------------------------------------
+typedef struct
+{
+	FlagStatus enabled;
+	FlagStatus circular;
+	uint8_t direction;
+	uint8_t memoryInc;
+	uint32_t memoryWidth;
+	uint32_t periphAddr;
+	uint32_t memoryAddr;
+	uint32_t number;
+	uint32_t remaining;
+	uint32_t inten;
+	uint32_t flags;
+} SIM_DMA;
+
+static SIM_DMA dma[COUNT_DMA_CHANNELS];
+
+//----------------------------------------------------------------------------
+// ADC
+//----------------------------------------------------------------------------
+static const uint16_t adcSampleHalfCycles[8] = {3, 15, 27, 57, 83, 111, 143, 479};
+
+typedef struct
+{
+	FlagStatus enabled;
+	FlagStatus dmaMode;
+	FlagStatus scan;
+	FlagStatus continuous;
+	uint32_t clockDiv;
+	uint8_t regularLength;
+	uint8_t regularChannel[16];
+	uint8_t regularSample[16];
+	uint8_t insertedLength;
+	uint8_t insertedChannel[4];
+	uint8_t insertedSample[4];
+	FlagStatus insertedTrigger;
+	uint32_t insertedSource;
+	uint32_t inten;
+	uint32_t flags;
+	uint16_t insertedData[4];
+	uint64_t regularDone;
+	uint64_t insertedDone;
+	uint16_t value[SIM_COUNT_ADC_CHANNELS];
+} SIM_ADC;
+
+static SIM_ADC adc =
+{
+	.clockDiv = ADC_CLOCK_DIV_DEFAULT,
+	.regularDone = SIM_NEVER,
+	.insertedDone = SIM_NEVER,
+	.value = {[ADC_CHANNEL_16] = 1799, [ADC_CHANNEL_17] = 1489}	// 25 degree celsius, 1.2V at 3.3V
+};
+
+volatile uint32_t simAdcRdata = 0;
+
+//----------------------------------------------------------------------------
+// USART
+//----------------------------------------------------------------------------
+typedef struct
+{
+	uint32_t periph;
+	IRQn_Type irq;
+	dma_channel_enum txDma;
+	dma_channel_enum rxDma;
+	uint32_t baud;
+	FlagStatus enabled;
+	FlagStatus txEnabled;
+	FlagStatus rxEnabled;
+	FlagStatus dmaTx;
+	FlagStatus dmaRx;
+	uint32_t inten;
+	uint32_t flags;
+	uint8_t rdata;
+	uint8_t tdata;
+	FlagStatus shifting;
+	uint8_t shiftByte;
+	uint64_t shiftDone;
+	uint8_t txCapture[USART_BUFFER_SIZE];
+	uint16_t txCount;
+	uint8_t rxQueue[USART_BUFFER_SIZE];
+	uint16_t rxHead;
+	uint16_t rxCount;
+	uint64_t rxNext;
+	uint64_t idleAt;
+	FlagStatus idleArmed;
+} SIM_USART;
+
+static SIM_USART usart[COUNT_USARTS] =
+{
+	{USART0, USART0_IRQn, DMA_CH1, DMA_CH2},
+	{USART1, USART1_IRQn, DMA_CH3, DMA_CH4}
+};
+
+//----------------------------------------------------------------------------
+// FMC and FWDGT
+//----------------------------------------------------------------------------
+static FlagStatus fmcUnlocked = RESET;
+static uint32_t fmcFlags = 0;
+
+static FlagStatus fwdgtEnabled = RESET;
+static uint64_t fwdgtPeriod = 0;
+static uint64_t fwdgtExpiry = SIM_NEVER;
+static uint16_t fwdgtReload = 0x0FFF;
+static uint16_t fwdgtWindow = 0x0FFF;
+
+static void SIM_ServiceUsart(SIM_USART *u);
+static void SIM_TriggerInserted(void);
+
+//----------------------------------------------------------------------------
+// Maps flash into the host address space, the firmware reads it directly
+//----------------------------------------------------------------------------
+__attribute__((constructor)) static void SIM_FlashInit(void)
+{
+	void *flash = mmap((void *)(uintptr_t)FLASH_BASE, FLASH_SIZE, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+	if (flash != (void *)(uintptr_t)FLASH_BASE)
+	{
+		fprintf(stderr, "SIM: flash can not be mapped\n");
+		exit(1);
+	}
+	memset(flash, 0xFF, FLASH_SIZE);
+}
+
+//----------------------------------------------------------------------------
+// Returns number of lowest bit set in pin mask
+//----------------------------------------------------------------------------
+static uint8_t SIM_PinNumber(uint32_t pin)
+{
+	return (uint8_t)__builtin_ctz(pin | 0x10000);
+}
+
+//----------------------------------------------------------------------------
+// Returns GPIO port
+//----------------------------------------------------------------------------
+static SIM_GPIO *SIM_GetPort(uint32_t periph)
+{
+	uint8_t index;
+	
+	for (index = 0; index < COUNT_PORTS; index++)
+	{
+		if (gpio[index].periph == periph)
+		{
+			return &gpio[index];
+		}
+	}
+	fprintf(stderr, "SIM: unknown GPIO port 0x%08X\n", periph);
+	abort();
+}
+
+//----------------------------------------------------------------------------
+// Returns timer
+//----------------------------------------------------------------------------
+static SIM_TIMER *SIM_GetTimer(uint32_t periph)
+{
+	uint8_t index;
+	
+	for (index = 0; index < COUNT_TIMERS; index++)
+	{
+		if (timer[index].periph == periph)
+		{
+			return &timer[index];
+		}
+	}
+	fprintf(stderr, "SIM: unknown timer 0x%08X\n", periph);
+	abort();
+}
+
+//----------------------------------------------------------------------------
+// Returns USART
+//----------------------------------------------------------------------------
+static SIM_USART *SIM_GetUsart(uint32_t periph)
+{
+	if (periph == USART0)
+	{
+		return &usart[0];
+	}
+	if (periph == USART1)
+	{
+		return &usart[1];
+	}
+	fprintf(stderr, "SIM: unknown USART 0x%08X\n", periph);
+	abort();
+}
+
+//============================================================================
+// TIMER
+//============================================================================
+
+//----------------------------------------------------------------------------
+// Returns number of counter steps of one period
+//----------------------------------------------------------------------------
+static uint32_t SIM_TimerLength(SIM_TIMER *t)
+{
+	if (t->center == SET)
+	{
+		return t->car > 0 ? 2 * t->car : 1;
+	}
+	return t->car + 1;
+}
+
+//----------------------------------------------------------------------------
+// Returns current phase of the counter
+//----------------------------------------------------------------------------
+static uint32_t SIM_TimerPhase(SIM_TIMER *t)
+{
+	if (t->enabled == RESET)
+	{
+		return t->phase;
+	}
+	return (uint32_t)(((simNow - t->base) / t->tickCycles) % SIM_TimerLength(t));
+}
+
+//----------------------------------------------------------------------------
+// Returns counter value at phase
+//----------------------------------------------------------------------------
+static uint32_t SIM_TimerCounter(SIM_TIMER *t, uint32_t phase)
+{
+	if (t->center == SET && phase > t->car)
+	{
+		return 2 * t->car - phase;
+	}
+	return phase;
+}
+
+//----------------------------------------------------------------------------
+// Returns first cycle after simNow, at which the counter reaches phase
+//----------------------------------------------------------------------------
+static uint64_t SIM_TimerNextPhase(SIM_TIMER *t, uint32_t phase)
+{
+	uint64_t length = (uint64_t)SIM_TimerLength(t) * t->tickCycles;
+	uint64_t elapsed = simNow - t->base;
+	uint64_t cycle = t->base + elapsed / length * length + (uint64_t)phase * t->tickCycles;
+	
+	while (cycle <= simNow)
+	{
+		cycle += length;
+	}
+	return cycle;
+}
+
+//----------------------------------------------------------------------------
+// Schedules next update and compare event of timer
+//----------------------------------------------------------------------------
+static void SIM_TimerSchedule(SIM_TIMER *t)
+{
+	uint64_t next;
+	uint8_t channel;
+	
+	t->nextUpdate = SIM_NEVER;
+	t->nextCompare = SIM_NEVER;
+	if (t->enabled == RESET)
+	{
+		return;
+	}
+	
+	// Update on overflow (and underflow when center aligned)
+	t->nextUpdate = SIM_TimerNextPhase(t, 0);
+	if (t->center == SET)
+	{
+		next = SIM_TimerNextPhase(t, t->car);
+		t->nextUpdate = next < t->nextUpdate ? next : t->nextUpdate;
+	}
+	
+	// Compare events are only needed for enabled channel interrupts
+	for (channel = 0; channel < 4; channel++)
+	{
+		if ((t->inten & (TIMER_INT_CH0 << channel)) == 0 || t->ccr[channel] > t->car)
+		{
+			continue;
+		}
+		next = SIM_TimerNextPhase(t, t->ccr[channel]);
+		t->nextCompare = next < t->nextCompare ? next : t->nextCompare;
+		if (t->center == SET && t->ccr[channel] > 0 && t->ccr[channel] < t->car)
+		{
+			next = SIM_TimerNextPhase(t, 2 * t->car - t->ccr[channel]);
+			t->nextCompare = next < t->nextCompare ? next : t->nextCompare;
+		}
+	}
+}
+
+//----------------------------------------------------------------------------
+// Continues counter at phase with the current configuration
+//----------------------------------------------------------------------------
+static void SIM_TimerRebase(SIM_TIMER *t, uint32_t phase)
+{
+	phase %= SIM_TimerLength(t);
+	t->phase = phase;
+	t->base = simNow - (uint64_t)phase * t->tickCycles;
+	SIM_TimerSchedule(t);
+}
+
+//----------------------------------------------------------------------------
+// Update event: loads shadow registers and sets the update flag
+//----------------------------------------------------------------------------
+static void SIM_TimerUpdate(SIM_TIMER *t)
+{
+	uint8_t channel;
+	uint32_t counter = SIM_TimerCounter(t, SIM_TimerPhase(t));
+	
+	for (channel = 0; channel < 4; channel++)
+	{
+		if (t->ccrShadow[channel] == SET)
+		{
+			t->ccr[channel] = t->ccrPreload[channel];
+		}
+	}
+	if (t->arse == SET && t->carPreload != t->car)
+	{
+		// Counter continues from its current value and direction
+		t->car = t->carPreload;
+		SIM_TimerRebase(t, counter == 0 ? 0 : t->car);
+	}
+	if (t->oaen == SET)
+	{
+		t->poen = SET;
+	}
+	t->intf |= TIMER_INT_FLAG_UP;
+}
+
+//----------------------------------------------------------------------------
+// Processes due timer events
+//----------------------------------------------------------------------------
+static void SIM_TimerProcess(SIM_TIMER *t)
+{
+	uint8_t channel;
+	uint32_t counter;
+	
+	if (t->nextUpdate <= simNow)
+	{
+		SIM_TimerUpdate(t);
+		SIM_TimerSchedule(t);
+		if (t->hook != NULL)
+		{
+			t->hook();
+		}
+		if (t->periph == TIMER0 && t->trgo == TIMER_TRI_OUT_SRC_UPDATE)
+		{
+			SIM_TriggerInserted();
+		}
+	}
+	if (t->nextCompare <= simNow)
+	{
+		counter = SIM_TimerCounter(t, SIM_TimerPhase(t));
+		for (channel = 0; channel < 4; channel++)
+		{
+			if (t->ccr[channel] == counter)
+			{
+				t->intf |= TIMER_INT_FLAG_CH0 << channel;
+			}
+		}
+		SIM_TimerSchedule(t);
+	}
+}
+
+//----------------------------------------------------------------------------
+// Returns reference output of timer channel (active level)
+//----------------------------------------------------------------------------
+static FlagStatus SIM_TimerReference(SIM_TIMER *t, uint8_t channel)
+{
+	uint32_t counter = SIM_TimerCounter(t, SIM_TimerPhase(t));
+	
+	switch (t->ocMode[channel])
+	{
+		case TIMER_OC_MODE_PWM0:
+			return counter < t->ccr[channel] ? SET : RESET;
+		case TIMER_OC_MODE_PWM1:
+			return counter < t->ccr[channel] ? RESET : SET;
+		case TIMER_OC_MODE_HIGH:
+			return SET;
+		default:
+			return RESET;
+	}
+}
+
+//----------------------------------------------------------------------------
+// Returns level of a timer output pin (dead time not simulated)
+//----------------------------------------------------------------------------
+static FlagStatus SIM_TimerOutput(SIM_TIMER *t, uint8_t channel, FlagStatus complementary)
+{
+	FlagStatus reference = SIM_TimerReference(t, channel);
+	FlagStatus outputEnabled = t->advanced == RESET || t->poen == SET ? SET : RESET;
+	
+	if (complementary == RESET)
+	{
+		if (t->ccEnable[channel] == RESET || outputEnabled == RESET)
+		{
+			return t->ocIdleHigh[channel];
+		}
+		return reference != t->ocPolarityLow[channel] ? SET : RESET;
+	}
+	if (t->ccnEnable[channel] == RESET || outputEnabled == RESET)
+	{
+		return t->ocnIdleHigh[channel];
+	}
+	return (reference == RESET) != (t->ocnPolarityLow[channel] == SET) ? SET : RESET;
+}
+
+//============================================================================
+// GPIO and EXTI
+//============================================================================
+
+//----------------------------------------------------------------------------
+// Returns level of pin number
+//----------------------------------------------------------------------------
+static FlagStatus SIM_PinLevel(SIM_GPIO *port, uint8_t number)
+{
+	uint16_t mask = (uint16_t)(1 << number);
+	uint8_t index;
+	
+	if (port->mode[number] == GPIO_MODE_OUTPUT)
+	{
+		return port->output & mask ? SET : RESET;
+	}
+	if (port->mode[number] == GPIO_MODE_AF)
+	{
+		for (index = 0; index < sizeof(timerPins) / sizeof(timerPins[0]); index++)
+		{
+			if (timerPins[index].port == port->periph && timerPins[index].pin == number &&
+				timerPins[index].af == port->af[number])
+			{
+				return SIM_TimerOutput(SIM_GetTimer(timerPins[index].timer), timerPins[index].channel,
+					timerPins[index].complementary);
+			}
+		}
+	}
+	if (port->driven & mask)
+	{
+		return port->external & mask ? SET : RESET;
+	}
+	return port->pull[number] == GPIO_PUPD_PULLUP ? SET : RESET;
+}
+
+//----------------------------------------------------------------------------
+// Detects edges of pin number for the EXTI
+//----------------------------------------------------------------------------
+static void SIM_PinEdge(SIM_GPIO *port, uint8_t number, FlagStatus before, FlagStatus after)
+{
+	uint32_t line = 1U << number;
+	
+	if (before == after || extiSource[number] != port->extiSource)
+	{
+		return;
+	}
+	if ((after == SET && (extiRising & line)) || (after == RESET && (extiFalling & line)))
+	{
+		simExtiPd |= line;
+	}
+}
+
+//----------------------------------------------------------------------------
+// Writes output register, releasing the power pin switches the board off
+//----------------------------------------------------------------------------
+static void SIM_WriteOutput(SIM_GPIO *port, uint16_t output)
+{
+	port->output = output;
+	if (port == powerPort)
+	{
+		if (output & powerPin)
+		{
+			powerOn = SET;
+		}
+		else if (powerOn == SET)
+		{
+			SIM_Stop(SIM_STATE_POWER_OFF);
+		}
+	}
+}
+
+void gpio_mode_set(uint32_t gpio_periph, uint32_t mode, uint32_t pull_up_down, uint32_t pin)
+{
+	SIM_GPIO *port;
+	uint8_t number;
+	
+	SIM_Enter();
+	port = SIM_GetPort(gpio_periph);
+	for (number = 0; number < 16; number++)
+	{
+		if (pin & (1U << number))
+		{
+			port->mode[number] = (uint8_t)mode;
+			port->pull[number] = (uint8_t)pull_up_down;
+		}
+	}
+	SIM_Leave();
+}
+
+void gpio_output_options_set(uint32_t gpio_periph, uint8_t otype, uint32_t speed, uint32_t pin)
+{
+	(void)gpio_periph;
+	(void)otype;
+	(void)speed;
+	(void)pin;
+	SIM_Enter();
+	SIM_Leave();
+}
+
+void gpio_af_set(uint32_t gpio_periph, uint32_t alt_func_num, uint32_t pin)
+{
+	SIM_GPIO *port;
+	uint8_t number;
+	
+	SIM_Enter();
+	port = SIM_GetPort(gpio_periph);
+	for (number = 0; number < 16; number++)
+	{
+		if (pin & (1U << number))
+		{
+			port->af[number] = (uint8_t)alt_func_num;
+		}
+	}
+	SIM_Leave();
+}
+
+void gpio_bit_set(uint32_t gpio_periph, uint32_t pin)
+{
+	SIM_GPIO *port;
+	
+	SIM_Enter();
+	port = SIM_GetPort(gpio_periph);
+	SIM_WriteOutput(port, port->output | (uint16_t)pin);
+	SIM_Leave();
+}
+
+void gpio_bit_reset(uint32_t gpio_periph, uint32_t pin)
+{
+	SIM_GPIO *port;
+	
+	SIM_Enter();
+	port = SIM_GetPort(gpio_periph);
+	SIM_WriteOutput(port, port->output & (uint16_t)~pin);
+	SIM_Leave();
+}
+
+void gpio_bit_write(uint32_t gpio_periph, uint32_t pin, bit_status bit_value)
+{
+	SIM_GPIO *port;
+	
+	SIM_Enter();
+	port = SIM_GetPort(gpio_periph);
+	SIM_WriteOutput(port, bit_value != RESET ? port->output | (uint16_t)pin : port->output & (uint16_t)~pin);
+	SIM_Leave();
+}
+
+FlagStatus gpio_input_bit_get(uint32_t gpio_periph, uint32_t pin)
+{
+	FlagStatus level;
+	
+	SIM_Enter();
+	level = SIM_PinLevel(SIM_GetPort(gpio_periph), SIM_PinNumber(pin));
+	SIM_Leave();
+	return level;
+}
+
+FlagStatus gpio_output_bit_get(uint32_t gpio_periph, uint32_t pin)
+{
+	FlagStatus level;
+	
+	SIM_Enter();
+	level = SIM_GetPort(gpio_periph)->output & pin ? SET : RESET;
+	SIM_Leave();
+	return level;
+}
+
+void syscfg_exti_line_config(uint8_t exti_port, uint8_t exti_pin)
+{
+	SIM_Enter();
+	extiSource[exti_pin & 0x0F] = exti_port;
+	SIM_Leave();
+}
+
+void exti_init(exti_line_enum linex, exti_mode_enum mode, exti_trig_type_enum trig_type)
+{
+	SIM_Enter();
+	extiInten &= ~(uint32_t)linex;
+	extiRising &= ~(uint32_t)linex;
+	extiFalling &= ~(uint32_t)linex;
+	if (mode == EXTI_INTERRUPT)
+	{
+		extiInten |= linex;
+	}
+	if (trig_type == EXTI_TRIG_RISING || trig_type == EXTI_TRIG_BOTH)
+	{
+		extiRising |= linex;
+	}
+	if (trig_type == EXTI_TRIG_FALLING || trig_type == EXTI_TRIG_BOTH)
+	{
+		extiFalling |= linex;
+	}
+	SIM_Leave();
+}
+
+void exti_interrupt_enable(exti_line_enum linex)
+{
+	SIM_Enter();
+	extiInten |= linex;
+	SIM_Leave();
+}
+
+void exti_interrupt_disable(exti_line_enum linex)
+{
+	SIM_Enter();
+	extiInten &= ~(uint32_t)linex;
+	SIM_Leave();
+}
+
+FlagStatus exti_interrupt_flag_get(exti_line_enum linex)
+{
+	FlagStatus flag;
+	
+	SIM_Enter();
+	flag = (simExtiPd & linex) && (extiInten & linex) ? SET : RESET;
+	SIM_Leave();
+	return flag;
+}
+
+void exti_interrupt_flag_clear(exti_line_enum linex)
+{
+	SIM_Enter();
+	simExtiPd &= ~(uint32_t)linex;
+	SIM_Leave();
+}
+
+//============================================================================
+// RCU
+//============================================================================
+
+void rcu_periph_clock_enable(rcu_periph_enum periph)
+{
+	(void)periph;
+	SIM_Enter();
+	SIM_Leave();
+}
+
+void rcu_adc_clock_config(uint32_t adc_clock_source)
+{
+	static const uint32_t div[5] = {0, 2, 4, 6, 8};
+	
+	SIM_Enter();
+	// IRC14M is about APB2 / 5
+	adc.clockDiv = adc_clock_source < 5 && adc_clock_source > 0 ? div[adc_clock_source] : 5;
+	SIM_Leave();
+}
+
+FlagStatus rcu_flag_get(rcu_flag_enum flag)
+{
+	(void)flag;
+	SIM_Enter();
+	SIM_Leave();
+	return RESET;
+}
+
+void rcu_all_reset_flag_clear(void)
+{
+	SIM_Enter();
+	SIM_Leave();
+}
+
+//============================================================================
+// TIMER functions
+//============================================================================
+
+//----------------------------------------------------------------------------
+// Resets timer to its reset values (keeps the test hook)
+//----------------------------------------------------------------------------
+static void SIM_TimerReset(SIM_TIMER *t)
+{
+	SIM_TIMER reset = {t->periph, t->irqUp, t->irqChannel, t->advanced, t->hook};
+	
+	*t = reset;
+	t->tickCycles = 1;
+	t->car = t->carPreload = 0xFFFF;
+	t->nextUpdate = t->nextCompare = SIM_NEVER;
+}
+
+//----------------------------------------------------------------------------
+// Initial state of the timers
+//----------------------------------------------------------------------------
+__attribute__((constructor)) static void SIM_TimerInit(void)
+{
+	uint8_t index;
+	
+	for (index = 0; index < COUNT_TIMERS; index++)
+	{
+		SIM_TimerReset(&timer[index]);
+	}
+}
+
+void timer_deinit(uint32_t timer_periph)
+{
+	SIM_Enter();
+	SIM_TimerReset(SIM_GetTimer(timer_periph));
+	SIM_Leave();
+}
+
+void timer_init(uint32_t timer_periph, timer_parameter_struct *initpara)
+{
+	SIM_TIMER *t;
+	
+	SIM_Enter();
+	t = SIM_GetTimer(timer_periph);
+	t->tickCycles = initpara->prescaler + 1U;
+	
+	// Only TIMER0, TIMER1 and TIMER2 have the aligned mode, the library
+	// ignores it for the other timers, they always count up
+	if (timer_periph == TIMER0 || timer_periph == TIMER1 || timer_periph == TIMER2)
+	{
+		t->center = initpara->alignedmode != TIMER_COUNTER_EDGE ? SET : RESET;
+	}
+	t->car = t->carPreload = initpara->period;
+	
+	// Update event generated by software loads the shadow registers and
+	// restarts the counter
+	SIM_TimerUpdate(t);
+	SIM_TimerRebase(t, 0);
+	SIM_Leave();
+}
+
+void timer_enable(uint32_t timer_periph)
+{
+	SIM_TIMER *t;
+	
+	SIM_Enter();
+	t = SIM_GetTimer(timer_periph);
+	if (t->enabled == RESET)
+	{
+		t->enabled = SET;
+		SIM_TimerRebase(t, t->phase);
+	}
+	SIM_Leave();
+}
+
+void timer_disable(uint32_t timer_periph)
+{
+	SIM_TIMER *t;
+	
+	SIM_Enter();
+	t = SIM_GetTimer(timer_periph);
+	if (t->enabled == SET)
+	{
+		t->phase = SIM_TimerPhase(t);
+		t->enabled = RESET;
+		SIM_TimerSchedule(t);
+	}
+	SIM_Leave();
+}
+
+void timer_auto_reload_shadow_enable(uint32_t timer_periph)
+{
+	SIM_Enter();
+	SIM_GetTimer(timer_periph)->arse = SET;
+	SIM_Leave();
+}
+
+void timer_auto_reload_shadow_disable(uint32_t timer_periph)
+{
+	SIM_Enter();
+	SIM_GetTimer(timer_periph)->arse = RESET;
+	SIM_Leave();
+}
+
+void timer_autoreload_value_config(uint32_t timer_periph, uint32_t autoreload)
+{
+	SIM_TIMER *t;
+	uint32_t counter;
+	
+	SIM_Enter();
+	t = SIM_GetTimer(timer_periph);
+	t->carPreload = autoreload;
+	if (t->arse == RESET)
+	{
+		counter = SIM_TimerCounter(t, SIM_TimerPhase(t));
+		t->car = autoreload;
+		SIM_TimerRebase(t, counter <= t->car ? counter : 0);
+	}
+	SIM_Leave();
+}
+
+void timer_counter_value_config(uint32_t timer_periph, uint32_t counter)
+{
+	SIM_Enter();
+	SIM_TimerRebase(SIM_GetTimer(timer_periph), counter);
+	SIM_Leave();
+}
+
+uint32_t timer_counter_read(uint32_t timer_periph)
+{
+	SIM_TIMER *t;
+	uint32_t counter;
+	
+	SIM_Enter();
+	t = SIM_GetTimer(timer_periph);
+	counter = SIM_TimerCounter(t, SIM_TimerPhase(t));
+	SIM_Leave();
+	return counter;
+}
+
+void timer_break_config(uint32_t timer_periph, timer_break_parameter_struct *breakpara)
+{
+	SIM_Enter();
+	SIM_GetTimer(timer_periph)->oaen = breakpara->outputautostate == TIMER_OUTAUTO_ENABLE ? SET : RESET;
+	SIM_Leave();
+}
+
+void timer_primary_output_config(uint32_t timer_periph, ControlStatus newvalue)
+{
+	SIM_Enter();
+	SIM_GetTimer(timer_periph)->poen = newvalue == ENABLE ? SET : RESET;
+	SIM_Leave();
+}
+
+void timer_automatic_output_enable(uint32_t timer_periph)
+{
+	SIM_Enter();
+	SIM_GetTimer(timer_periph)->oaen = SET;
+	SIM_Leave();
+}
+
+void timer_automatic_output_disable(uint32_t timer_periph)
+{
+	SIM_TIMER *t;
+	
+	SIM_Enter();
+	t = SIM_GetTimer(timer_periph);
+	
+	// Outputs stay off until enabled again (firmware clears POEN by break)
+	t->oaen = RESET;
+	t->poen = RESET;
+	SIM_Leave();
+}
+
+void timer_channel_output_config(uint32_t timer_periph, uint16_t channel, timer_oc_parameter_struct *ocpara)
+{
+	SIM_TIMER *t;
+	
+	SIM_Enter();
+	t = SIM_GetTimer(timer_periph);
+	channel &= 3;
+	t->ccEnable[channel] = ocpara->outputstate == TIMER_CCX_ENABLE ? SET : RESET;
+	t->ccnEnable[channel] = ocpara->outputnstate == TIMER_CCXN_ENABLE ? SET : RESET;
+	t->ocPolarityLow[channel] = ocpara->ocpolarity == TIMER_OC_POLARITY_LOW ? SET : RESET;
+	t->ocnPolarityLow[channel] = ocpara->ocnpolarity == TIMER_OCN_POLARITY_LOW ? SET : RESET;
+	t->ocIdleHigh[channel] = ocpara->ocidlestate == TIMER_OC_IDLE_STATE_HIGH ? SET : RESET;
+	t->ocnIdleHigh[channel] = ocpara->ocnidlestate == TIMER_OCN_IDLE_STATE_HIGH ? SET : RESET;
+	SIM_Leave();
+}
+
+void timer_channel_output_mode_config(uint32_t timer_periph, uint16_t channel, uint16_t ocmode)
+{
+	SIM_Enter();
+	SIM_GetTimer(timer_periph)->ocMode[channel & 3] = ocmode;
+	SIM_Leave();
+}
+
+void timer_channel_output_pulse_value_config(uint32_t timer_periph, uint16_t channel, uint32_t pulse)
+{
+	SIM_TIMER *t;
+	
+	SIM_Enter();
+	t = SIM_GetTimer(timer_periph);
+	channel &= 3;
+	t->ccrPreload[channel] = pulse;
+	if (t->ccrShadow[channel] == RESET)
+	{
+		t->ccr[channel] = pulse;
+		SIM_TimerSchedule(t);
+	}
+	SIM_Leave();
+}
+
+void timer_channel_output_shadow_config(uint32_t timer_periph, uint16_t channel, uint16_t ocshadow)
+{
+	SIM_Enter();
+	SIM_GetTimer(timer_periph)->ccrShadow[channel & 3] = ocshadow == TIMER_OC_SHADOW_ENABLE ? SET : RESET;
+	SIM_Leave();
+}
+
+void timer_channel_output_fast_config(uint32_t timer_periph, uint16_t channel, uint16_t ocfast)
+{
+	(void)timer_periph;
+	(void)channel;
+	(void)ocfast;
+	SIM_Enter();
+	SIM_Leave();
+}
+
+void timer_channel_output_state_config(uint32_t timer_periph, uint16_t channel, uint32_t state)
+{
+	SIM_Enter();
+	SIM_GetTimer(timer_periph)->ccEnable[channel & 3] = state == TIMER_CCX_ENABLE ? SET : RESET;
+	SIM_Leave();
+}
+
+void timer_channel_complementary_output_state_config(uint32_t timer_periph, uint16_t channel, uint16_t ocnstate)
+{
+	SIM_Enter();
+	SIM_GetTimer(timer_periph)->ccnEnable[channel & 3] = ocnstate == TIMER_CCXN_ENABLE ? SET : RESET;
+	SIM_Leave();
+}
+
+void timer_master_output_trigger_source_select(uint32_t timer_periph, uint32_t outrigger)
+{
+	SIM_Enter();
+	SIM_GetTimer(timer_periph)->trgo = outrigger;
+	SIM_Leave();
+}
+
+void timer_interrupt_enable(uint32_t timer_periph, uint32_t interrupt)
+{
+	SIM_TIMER *t;
+	
+	SIM_Enter();
+	t = SIM_GetTimer(timer_periph);
+	t->inten |= interrupt;
+	SIM_TimerSchedule(t);
+	SIM_Leave();
+}
+
+void timer_interrupt_disable(uint32_t timer_periph, uint32_t interrupt)
+{
+	SIM_TIMER *t;
+	
+	SIM_Enter();
+	t = SIM_GetTimer(timer_periph);
+	t->inten &= ~interrupt;
+	SIM_TimerSchedule(t);
+	SIM_Leave();
+}
+
+FlagStatus timer_interrupt_flag_get(uint32_t timer_periph, uint32_t interrupt)
+{
+	SIM_TIMER *t;
+	FlagStatus flag;
+	
+	SIM_Enter();
+	t = SIM_GetTimer(timer_periph);
+	flag = (t->intf & interrupt) && (t->inten & interrupt) ? SET : RESET;
+	SIM_Leave();
+	return flag;
+}
+
+void timer_interrupt_flag_clear(uint32_t timer_periph, uint32_t interrupt)
+{
+	SIM_Enter();
+	SIM_GetTimer(timer_periph)->intf &= ~interrupt;
+	SIM_Leave();
+}
+
+//============================================================================
+// DMA
+//============================================================================
+
+//----------------------------------------------------------------------------
+// Counts one transfer of channel, sets half and full transfer flags
+//----------------------------------------------------------------------------
+static void SIM_DmaCount(SIM_DMA *d)
+{
+	d->remaining--;
+	d->flags |= DMA_FLAG_G;
+	if (d->number - d->remaining == d->number / 2)
+	{
+		d->flags |= DMA_FLAG_HTF;
+	}
+	if (d->remaining == 0)
+	{
+		d->flags |= DMA_FLAG_FTF;
+		if (d->circular == SET)
+		{
+			d->remaining = d->number;
+		}
+	}
+}
+
+//----------------------------------------------------------------------------
+// Returns memory address of the next transfer
+//----------------------------------------------------------------------------
+static void *SIM_DmaMemory(SIM_DMA *d)
+{
+	uint32_t width = d->memoryWidth == DMA_MEMORY_WIDTH_32BIT ? 4 : d->memoryWidth == DMA_MEMORY_WIDTH_16BIT ? 2 : 1;
+	uint32_t offset = d->memoryInc == DMA_MEMORY_INCREASE_ENABLE ? (d->number - d->remaining) * width : 0;
+	return (void *)(uintptr_t)(d->memoryAddr + offset);
+}
+
+//----------------------------------------------------------------------------
+// Peripheral request: writes value into memory, returns RESET if channel
+// is not ready
+//----------------------------------------------------------------------------
+static FlagStatus SIM_DmaWrite(dma_channel_enum channel, uint32_t value)
+{
+	SIM_DMA *d = &dma[channel];
+	void *memory;
+	
+	if (d->enabled == RESET || d->remaining == 0 || d->direction != DMA_PERIPHERAL_TO_MEMORY)
+	{
+		return RESET;
+	}
+	memory = SIM_DmaMemory(d);
+	if (d->memoryWidth == DMA_MEMORY_WIDTH_32BIT)
+	{
+		*(uint32_t *)memory = value;
+	}
+	else if (d->memoryWidth == DMA_MEMORY_WIDTH_16BIT)
+	{
+		*(uint16_t *)memory = (uint16_t)value;
+	}
+	else
+	{
+		*(uint8_t *)memory = (uint8_t)value;
+	}
+	SIM_DmaCount(d);
+	return SET;
+}
+
+//----------------------------------------------------------------------------
+// Peripheral request: reads byte from memory, returns RESET if channel is
+// not ready
+//----------------------------------------------------------------------------
+static FlagStatus SIM_DmaRead(dma_channel_enum channel, uint8_t *value)
+{
+	SIM_DMA *d = &dma[channel];
+	
+	if (d->enabled == RESET || d->remaining == 0 || d->direction != DMA_MEMORY_TO_PERIPHERAL)
+	{
+		return RESET;
+	}
+	*value = *(uint8_t *)SIM_DmaMemory(d);
+	SIM_DmaCount(d);
+	return SET;
+}
+
+//----------------------------------------------------------------------------
+// Lets peripherals request the DMA after its configuration changed
+//----------------------------------------------------------------------------
+static void SIM_DmaChanged(void)
+{
+	uint8_t index;
+	
+	for (index = 0; index < COUNT_USARTS; index++)
+	{
+		SIM_ServiceUsart(&usart[index]);
+	}
+}
+
+void dma_deinit(dma_channel_enum channelx)
+{
+	SIM_Enter();
+	memset(&dma[channelx], 0, sizeof(SIM_DMA));
+	SIM_Leave();
+}
+
+void dma_init(dma_channel_enum channelx, dma_parameter_struct init_struct)
+{
+	SIM_DMA *d;
+	
+	SIM_Enter();
+	d = &dma[channelx];
+	d->direction = init_struct.direction;
+	d->memoryInc = init_struct.memory_inc;
+	d->memoryWidth = init_struct.memory_width;
+	d->periphAddr = init_struct.periph_addr;
+	d->memoryAddr = init_struct.memory_addr;
+	d->number = d->remaining = init_struct.number & 0xFFFF;
+	SIM_Leave();
+}
+
+void dma_circulation_enable(dma_channel_enum channelx)
+{
+	SIM_Enter();
+	dma[channelx].circular = SET;
+	SIM_Leave();
+}
+
+void dma_circulation_disable(dma_channel_enum channelx)
+{
+	SIM_Enter();
+	dma[channelx].circular = RESET;
+	SIM_Leave();
+}
+
+void dma_memory_to_memory_enable(dma_channel_enum channelx)
+{
+	(void)channelx;
+	SIM_Enter();
+	fprintf(stderr, "SIM: memory to memory DMA is not simulated\n");
+	SIM_Leave();
+}
+
+void dma_memory_to_memory_disable(dma_channel_enum channelx)
+{
+	(void)channelx;
+	SIM_Enter();
+	SIM_Leave();
+}
+
+void dma_channel_enable(dma_channel_enum channelx)
+{
+	SIM_Enter();
+	dma[channelx].enabled = SET;
+	SIM_DmaChanged();
+	SIM_Leave();
+}
+
+void dma_channel_disable(dma_channel_enum channelx)
+{
+	SIM_Enter();
+	dma[channelx].enabled = RESET;
+	SIM_Leave();
+}
+
+void dma_periph_address_config(dma_channel_enum channelx, uint32_t address)
+{
+	SIM_Enter();
+	dma[channelx].periphAddr = address;
+	SIM_Leave();
+}
+
+void dma_memory_address_config(dma_channel_enum channelx, uint32_t address)
+{
+	SIM_Enter();
+	dma[channelx].memoryAddr = address;
+	SIM_Leave();
+}
+
+void dma_transfer_number_config(dma_channel_enum channelx, uint32_t number)
+{
+	SIM_Enter();
+	// Only written while the channel is disabled
+	if (dma[channelx].enabled == RESET)
+	{
+		dma[channelx].number = dma[channelx].remaining = number & 0xFFFF;
+	}
+	SIM_Leave();
+}
+
+uint32_t dma_transfer_number_get(dma_channel_enum channelx)
+{
+	uint32_t remaining;
+	
+	SIM_Enter();
+	remaining = dma[channelx].remaining;
+	SIM_Leave();
+	return remaining;
+}
+
+FlagStatus dma_flag_get(dma_channel_enum channelx, uint32_t flag)
+{
+	FlagStatus status;
+	
+	SIM_Enter();
+	status = dma[channelx].flags & flag ? SET : RESET;
+	SIM_Leave();
+	return status;
+}
+
+void dma_flag_clear(dma_channel_enum channelx, uint32_t flag)
+{
+	SIM_Enter();
+	dma[channelx].flags &= flag & DMA_FLAG_G ? 0 : ~flag;
+	SIM_Leave();
+}
+
+FlagStatus dma_interrupt_flag_get(dma_channel_enum channelx, uint32_t int_flag)
+{
+	FlagStatus status;
+	
+	SIM_Enter();
+	status = (dma[channelx].flags & int_flag) && (int_flag == DMA_INT_FLAG_G || (dma[channelx].inten & int_flag)) ? SET : RESET;
+	SIM_Leave();
+	return status;
+}
+
+void dma_interrupt_flag_clear(dma_channel_enum channelx, uint32_t int_flag)
+{
+	SIM_Enter();
+	dma[channelx].flags &= int_flag & DMA_INT_FLAG_G ? 0 : ~int_flag;
+	SIM_Leave();
+}
+
+void dma_interrupt_enable(dma_channel_enum channelx, uint32_t source)
+{
+	SIM_Enter();
+	dma[channelx].inten |= source;
+	SIM_Leave();
+}
+
+void dma_interrupt_disable(dma_channel_enum channelx, uint32_t source)
+{
+	SIM_Enter();
+	dma[channelx].inten &= ~source;
+	SIM_Leave();
+}
+
+//============================================================================
+// ADC
+//============================================================================
+
+//----------------------------------------------------------------------------
+// Returns cycles of the conversion of a group
+//----------------------------------------------------------------------------
+static uint64_t SIM_AdcCycles(const uint8_t sample[], uint8_t length)
+{
+	uint64_t halfCycles = 0;
+	uint8_t rank;
+	
+	for (rank = 0; rank < length; rank++)
+	{
+		halfCycles += adcSampleHalfCycles[sample[rank] & 7] + 25;
+	}
+	return halfCycles * adc.clockDiv / 2;
+}
+
+//----------------------------------------------------------------------------
+// Starts conversion of the regular group
+//----------------------------------------------------------------------------
+static void SIM_StartRegular(void)
+{
+	if (adc.enabled == RESET || adc.regularDone != SIM_NEVER || adc.regularLength == 0)
+	{
+		return;
+	}
+	adc.regularDone = simNow + SIM_AdcCycles(adc.regularSample, adc.scan == SET ? adc.regularLength : 1);
+}
+
+//----------------------------------------------------------------------------
+// Starts conversion of the inserted group (timer trigger)
+//----------------------------------------------------------------------------
+static void SIM_TriggerInserted(void)
+{
+	if (adc.enabled == RESET || adc.insertedTrigger == RESET || adc.insertedSource != ADC_EXTTRIG_INSERTED_T0_TRGO ||
+		adc.insertedDone != SIM_NEVER || adc.insertedLength == 0)
+	{
+		return;
+	}
+	adc.insertedDone = simNow + SIM_AdcCycles(adc.insertedSample, adc.insertedLength);
+}
+
+//----------------------------------------------------------------------------
+// Processes finished conversions
+//----------------------------------------------------------------------------
+static void SIM_AdcProcess(void)
+{
+	uint8_t rank;
+	uint8_t length;
+	
+	if (adc.insertedDone <= simNow)
+	{
+		adc.insertedDone = SIM_NEVER;
+		for (rank = 0; rank < adc.insertedLength; rank++)
+		{
+			adc.insertedData[rank] = adc.value[adc.insertedChannel[rank]];
+		}
+		adc.flags |= ADC_FLAG_EOIC;
+	}
+	
+	// Whole regular scan is transferred at its end
+	if (adc.regularDone <= simNow)
+	{
+		adc.regularDone = SIM_NEVER;
+		length = adc.scan == SET ? adc.regularLength : 1;
+		for (rank = 0; rank < length; rank++)
+		{
+			simAdcRdata = adc.value[adc.regularChannel[rank]];
+			if (adc.dmaMode == SET)
+			{
+				SIM_DmaWrite(DMA_CH0, simAdcRdata);
+			}
+		}
+		adc.flags |= ADC_FLAG_EOC;
+		if (adc.continuous == SET)
+		{
+			SIM_StartRegular();
+		}
+	}
+}
+
+void adc_enable(void)
+{
+	SIM_Enter();
+	adc.enabled = SET;
+	SIM_Leave();
+}
+
+void adc_disable(void)
+{
+	SIM_Enter();
+	adc.enabled = RESET;
+	adc.regularDone = adc.insertedDone = SIM_NEVER;
+	SIM_Leave();
+}
+
+void adc_calibration_enable(void)
+{
+	SIM_Enter();
+	SIM_Leave();
+}
+
+void adc_dma_mode_enable(void)
+{
+	SIM_Enter();
+	adc.dmaMode = SET;
+	SIM_Leave();
+}
+
+void adc_dma_mode_disable(void)
+{
+	SIM_Enter();
+	adc.dmaMode = RESET;
+	SIM_Leave();
+}
+
+void adc_tempsensor_vrefint_enable(void)
+{
+	SIM_Enter();
+	SIM_Leave();
+}
+
+void adc_tempsensor_vrefint_disable(void)
+{
+	SIM_Enter();
+	SIM_Leave();
+}
+
+void adc_vbat_enable(void)
+{
+	SIM_Enter();
+	SIM_Leave();
+}
+
+void adc_vbat_disable(void)
+{
+	SIM_Enter();
+	SIM_Leave();
+}
+
+void adc_watchdog_disable(void)
+{
+	SIM_Enter();
+	SIM_Leave();
+}
+
+void adc_special_function_config(uint32_t function, ControlStatus newvalue)
+{
+	SIM_Enter();
+	if (function & ADC_SCAN_MODE)
+	{
+		adc.scan = newvalue == ENABLE ? SET : RESET;
+	}
+	if (function & ADC_CONTINUOUS_MODE)
+	{
+		adc.continuous = newvalue == ENABLE ? SET : RESET;
+	}
+	SIM_Leave();
+}
+
+void adc_data_alignment_config(uint32_t data_alignment)
+{
+	SIM_Enter();
+	if (data_alignment != ADC_DATAALIGN_RIGHT)
+	{
+		fprintf(stderr, "SIM: only right aligned ADC data is simulated\n");
+	}
+	SIM_Leave();
+}
+
+void adc_channel_length_config(uint8_t channel_group, uint32_t length)
+{
+	SIM_Enter();
+	if (channel_group == ADC_REGULAR_CHANNEL)
+	{
+		adc.regularLength = (uint8_t)(length > 16 ? 16 : length);
+	}
+	else if (channel_group == ADC_INSERTED_CHANNEL)
+	{
+		adc.insertedLength = (uint8_t)(length > 4 ? 4 : length);
+	}
+	SIM_Leave();
+}
+
+void adc_regular_channel_config(uint8_t rank, uint8_t channel, uint32_t sample_time)
+{
+	SIM_Enter();
+	if (rank < 16 && channel < SIM_COUNT_ADC_CHANNELS)
+	{
+		adc.regularChannel[rank] = channel;
+		adc.regularSample[rank] = (uint8_t)sample_time;
+	}
+	SIM_Leave();
+}
+
+void adc_inserted_channel_config(uint8_t rank, uint8_t channel, uint32_t sample_time)
+{
+	SIM_Enter();
+	if (rank < 4 && channel < SIM_COUNT_ADC_CHANNELS)
+	{
+		adc.insertedChannel[rank] = channel;
+		adc.insertedSample[rank] = (uint8_t)sample_time;
+	}
+	SIM_Leave();
+}
+
+void adc_external_trigger_config(uint8_t channel_group, ControlStatus newvalue)
+{
+	SIM_Enter();
+	if (channel_group & ADC_INSERTED_CHANNEL)
+	{
+		adc.insertedTrigger = newvalue == ENABLE ? SET : RESET;
+	}
+	SIM_Leave();
+}
+
+void adc_external_trigger_source_config(uint8_t channel_group, uint32_t external_trigger_source)
+{
+	SIM_Enter();
+	if (channel_group & ADC_INSERTED_CHANNEL)
+	{
+		adc.insertedSource = external_trigger_source;
+	}
+	SIM_Leave();
+}
+
+void adc_software_trigger_enable(uint8_t channel_group)
+{
+	SIM_Enter();
+	if (channel_group & ADC_REGULAR_CHANNEL)
+	{
+		SIM_StartRegular();
+	}
+	SIM_Leave();
+}
+
+uint16_t adc_regular_data_read(void)
+{
+	uint16_t value;
+	
+	SIM_Enter();
+	value = (uint16_t)simAdcRdata;
+	adc.flags &= ~ADC_FLAG_EOC;
+	SIM_Leave();
+	return value;
+}
+
+uint16_t adc_inserted_data_read(uint8_t inserted_channel)
+{
+	uint16_t value;
+	
+	SIM_Enter();
+	value = adc.insertedData[inserted_channel & 3];
+	SIM_Leave();
+	return value;
+}
+
+FlagStatus adc_flag_get(uint32_t flag)
+{
+	FlagStatus status;
+	
+	SIM_Enter();
+	status = adc.flags & flag ? SET : RESET;
+	SIM_Leave();
+	return status;
+}
+
+void adc_flag_clear(uint32_t flag)
+{
+	SIM_Enter();
+	adc.flags &= ~flag;
+	SIM_Leave();
+}
+
+//----------------------------------------------------------------------------
+// Returns interrupt enable bit of an ADC flag
+//----------------------------------------------------------------------------
+static uint32_t SIM_AdcIntenOfFlag(uint32_t flag)
+{
+	return (flag & ADC_INT_FLAG_WDE ? ADC_INT_WDE : 0) |
+		(flag & ADC_INT_FLAG_EOC ? ADC_INT_EOC : 0) |
+		(flag & ADC_INT_FLAG_EOIC ? ADC_INT_EOIC : 0);
+}
+
+FlagStatus adc_interrupt_flag_get(uint32_t int_flag)
+{
+	FlagStatus status;
+	
+	SIM_Enter();
+	status = (adc.flags & int_flag) && (adc.inten & SIM_AdcIntenOfFlag(int_flag)) ? SET : RESET;
+	SIM_Leave();
+	return status;
+}
+
+void adc_interrupt_flag_clear(uint32_t int_flag)
+{
+	SIM_Enter();
+	adc.flags &= ~int_flag;
+	SIM_Leave();
+}
+
+void adc_interrupt_enable(uint32_t interrupt)
+{
+	SIM_Enter();
+	adc.inten |= interrupt;
+	SIM_Leave();
+}
+
+void adc_interrupt_disable(uint32_t interrupt)
+{
+	SIM_Enter();
+	adc.inten &= ~interrupt;
+	SIM_Leave();
+}
+
+//============================================================================
+// USART
+//============================================================================
+
+//----------------------------------------------------------------------------
+// Returns cycles of one frame (start, 8 data and stop bit)
+//----------------------------------------------------------------------------
+static uint64_t SIM_UsartByteCycles(SIM_USART *u)
+{
+	return u->baud > 0 ? (uint64_t)SIM_CORE_CLOCK * 10 / u->baud : SIM_CORE_CLOCK;
+}
+
+//----------------------------------------------------------------------------
+// Moves data between DMA, data register and shift register
+//----------------------------------------------------------------------------
+static void SIM_ServiceUsart(SIM_USART *u)
+{
+	uint8_t value;
+	
+	if (u->enabled == RESET)
+	{
+		return;
+	}
+	
+	// Received byte waiting for the DMA
+	if ((u->flags & USART_FLAG_RBNE) && u->dmaRx == SET && SIM_DmaWrite(u->rxDma, u->rdata) == SET)
+	{
+		u->flags &= ~USART_FLAG_RBNE;
+	}
+	
+	if (u->txEnabled == RESET)
+	{
+		return;
+	}
+	while (1)
+	{
+		if (!(u->flags & USART_FLAG_TBE) && u->shifting == RESET)
+		{
+			u->shiftByte = u->tdata;
+			u->shifting = SET;
+			u->shiftDone = simNow + SIM_UsartByteCycles(u);
+			u->flags |= USART_FLAG_TBE;
+			continue;
+		}
+		if ((u->flags & USART_FLAG_TBE) && u->dmaTx == SET && SIM_DmaRead(u->txDma, &value) == SET)
+		{
+			u->tdata = value;
+			u->flags &= ~(USART_FLAG_TBE | USART_FLAG_TC);
+			continue;
+		}
+		break;
+	}
+}
+
+//----------------------------------------------------------------------------
+// Processes due events of USART
+//----------------------------------------------------------------------------
+static void SIM_UsartProcess(SIM_USART *u)
+{
+	uint8_t value;
+	
+	// Byte left the TX line
+	if (u->shifting == SET && u->shiftDone <= simNow)
+	{
+		u->shifting = RESET;
+		if (u->txCount < USART_BUFFER_SIZE)
+		{
+			u->txCapture[u->txCount++] = u->shiftByte;
+		}
+		if (u->flags & USART_FLAG_TBE)
+		{
+			u->flags |= USART_FLAG_TC;
+		}
+		SIM_ServiceUsart(u);
+	}
+	
+	// Byte completely received
+	if (u->rxNext <= simNow)
+	{
+		value = u->rxQueue[u->rxHead];
+		u->rxHead = (u->rxHead + 1) % USART_BUFFER_SIZE;
+		u->rxCount--;
+		if (u->enabled == SET && u->rxEnabled == SET)
+		{
+			if (u->flags & USART_FLAG_RBNE)
+			{
+				u->flags |= USART_FLAG_ORERR;
+			}
+			else
+			{
+				u->rdata = value;
+				u->flags |= USART_FLAG_RBNE;
+			}
+			u->idleArmed = SET;
+			SIM_ServiceUsart(u);
+		}
+		u->rxNext = u->rxCount > 0 ? u->rxNext + SIM_UsartByteCycles(u) : SIM_NEVER;
+		u->idleAt = u->rxCount > 0 || u->idleArmed == RESET ? SIM_NEVER : simNow + SIM_UsartByteCycles(u);
+	}
+	
+	// Line idle for one frame after reception
+	if (u->idleAt <= simNow)
+	{
+		u->idleAt = SIM_NEVER;
+		u->idleArmed = RESET;
+		u->flags |= USART_FLAG_IDLE;
+	}
+}
+
+//----------------------------------------------------------------------------
+// Resets USART (keeps the line state)
+//----------------------------------------------------------------------------
+static void SIM_UsartReset(SIM_USART *u)
+{
+	u->baud = 0;
+	u->enabled = u->txEnabled = u->rxEnabled = RESET;
+	u->dmaTx = u->dmaRx = RESET;
+	u->inten = 0;
+	u->flags = USART_FLAG_TBE | USART_FLAG_TC;
+	u->shifting = RESET;
+	u->idleArmed = RESET;
+	u->idleAt = SIM_NEVER;
+	if (u->rxCount == 0)
+	{
+		u->rxNext = SIM_NEVER;
+	}
+}
+
+//----------------------------------------------------------------------------
+// Initial state of the USARTs
+//----------------------------------------------------------------------------
+__attribute__((constructor)) static void SIM_UsartInit(void)
+{
+	uint8_t index;
+	
+	for (index = 0; index < COUNT_USARTS; index++)
+	{
+		SIM_UsartReset(&usart[index]);
+		usart[index].rxNext = SIM_NEVER;
+	}
+}
+
+void usart_deinit(uint32_t usart_periph)
+{
+	SIM_Enter();
+	SIM_UsartReset(SIM_GetUsart(usart_periph));
+	SIM_Leave();
+}
+
+void usart_baudrate_set(uint32_t usart_periph, uint32_t baudval)
+{
+	SIM_Enter();
+	SIM_GetUsart(usart_periph)->baud = baudval;
+	SIM_Leave();
+}
+
+void usart_parity_config(uint32_t usart_periph, uint32_t paritycfg)
+{
+	SIM_Enter();
+	if (paritycfg != USART_PM_NONE)
+	{
+		fprintf(stderr, "SIM: USART 0x%08X parity is not simulated\n", usart_periph);
+	}
+	SIM_Leave();
+}
+
+void usart_word_length_set(uint32_t usart_periph, uint32_t wlen)
+{
+	SIM_Enter();
+	if (wlen != USART_WL_8BIT)
+	{
+		fprintf(stderr, "SIM: USART 0x%08X only 8 bit words are simulated\n", usart_periph);
+	}
+	SIM_Leave();
+}
+
+void usart_stop_bit_set(uint32_t usart_periph, uint32_t stblen)
+{
+	(void)usart_periph;
+	(void)stblen;
+	SIM_Enter();
+	SIM_Leave();
+}
+
+void usart_oversample_config(uint32_t usart_periph, uint32_t oversamp)
+{
+	(void)usart_periph;
+	(void)oversamp;
+	SIM_Enter();
+	SIM_Leave();
+}
+
+void usart_enable(uint32_t usart_periph)
+{
+	SIM_USART *u;
+	
+	SIM_Enter();
+	u = SIM_GetUsart(usart_periph);
+	u->enabled = SET;
+	SIM_ServiceUsart(u);
+	SIM_Leave();
+}
+
+void usart_disable(uint32_t usart_periph)
+{
+	SIM_Enter();
+	SIM_GetUsart(usart_periph)->enabled = RESET;
+	SIM_Leave();
+}
+
+void usart_transmit_config(uint32_t usart_periph, uint32_t txconfig)
+{
+	SIM_USART *u;
+	
+	SIM_Enter();
+	u = SIM_GetUsart(usart_periph);
+	u->txEnabled = txconfig == USART_TRANSMIT_ENABLE ? SET : RESET;
+	SIM_ServiceUsart(u);
+	SIM_Leave();
+}
+
+void usart_receive_config(uint32_t usart_periph, uint32_t rxconfig)
+{
+	SIM_Enter();
+	SIM_GetUsart(usart_periph)->rxEnabled = rxconfig == USART_RECEIVE_ENABLE ? SET : RESET;
+	SIM_Leave();
+}
+
+void usart_dma_receive_config(uint32_t usart_periph, uint32_t dmacmd)
+{
+	SIM_USART *u;
+	
+	SIM_Enter();
+	u = SIM_GetUsart(usart_periph);
+	u->dmaRx = dmacmd == USART_DENR_ENABLE ? SET : RESET;
+	SIM_ServiceUsart(u);
+	SIM_Leave();
+}
+
+void usart_dma_transmit_config(uint32_t usart_periph, uint32_t dmacmd)
+{
+	SIM_USART *u;
+	
+	SIM_Enter();
+	u = SIM_GetUsart(usart_periph);
+	u->dmaTx = dmacmd == USART_DENT_ENABLE ? SET : RESET;
+	SIM_ServiceUsart(u);
+	SIM_Leave();
+}
+
+void usart_data_transmit(uint32_t usart_periph, uint32_t data)
+{
+	SIM_USART *u;
+	
+	SIM_Enter();
+	u = SIM_GetUsart(usart_periph);
+	u->tdata = (uint8_t)data;
+	u->flags &= ~(USART_FLAG_TBE | USART_FLAG_TC);
+	SIM_ServiceUsart(u);
+	SIM_Leave();
+}
+
+uint16_t usart_data_receive(uint32_t usart_periph)
+{
+	SIM_USART *u;
+	uint16_t value;
+	
+	SIM_Enter();
+	u = SIM_GetUsart(usart_periph);
+	value = u->rdata;
+	u->flags &= ~(USART_FLAG_RBNE | USART_FLAG_ORERR);
+	SIM_Leave();
+	return value;
+}
+
+FlagStatus usart_flag_get(uint32_t usart_periph, usart_flag_enum flag)
+{
+	FlagStatus status;
+	
+	SIM_Enter();
+	status = SIM_GetUsart(usart_periph)->flags & flag ? SET : RESET;
+	SIM_Leave();
+	return status;
+}
+
+void usart_flag_clear(uint32_t usart_periph, usart_flag_enum flag)
+{
+	SIM_Enter();
+	SIM_GetUsart(usart_periph)->flags &= ~(uint32_t)flag;
+	SIM_Leave();
+}
+
+void usart_interrupt_enable(uint32_t usart_periph, usart_interrupt_enum interrupt)
+{
+	SIM_Enter();
+	SIM_GetUsart(usart_periph)->inten |= interrupt;
+	SIM_Leave();
+}
+
+void usart_interrupt_disable(uint32_t usart_periph, usart_interrupt_enum interrupt)
+{
+	SIM_Enter();
+	SIM_GetUsart(usart_periph)->inten &= ~(uint32_t)interrupt;
+	SIM_Leave();
+}
+
+FlagStatus usart_interrupt_flag_get(uint32_t usart_periph, usart_interrupt_flag_enum int_flag)
+{
+	SIM_USART *u;
+	FlagStatus status;
+	
+	SIM_Enter();
+	u = SIM_GetUsart(usart_periph);
+	if (int_flag == USART_INT_FLAG_RBNE_ORERR)
+	{
+		status = (u->flags & USART_FLAG_ORERR) && (u->inten & USART_INT_RBNE) ? SET : RESET;
+	}
+	else
+	{
+		status = (u->flags & int_flag) && (u->inten & int_flag) ? SET : RESET;
+	}
+	SIM_Leave();
+	return status;
+}
+
+void usart_interrupt_flag_clear(uint32_t usart_periph, usart_interrupt_flag_enum int_flag)
+{
+	SIM_Enter();
+	SIM_GetUsart(usart_periph)->flags &= ~(uint32_t)int_flag;
+	SIM_Leave();
+}
+
+//============================================================================
+// FMC
+//============================================================================
+
+void fmc_unlock(void)
+{
+	SIM_Enter();
+	fmcUnlocked = SET;
+	SIM_Leave();
+}
+
+void fmc_lock(void)
+{
+	SIM_Enter();
+	fmcUnlocked = RESET;
+	SIM_Leave();
+}
+
+fmc_state_enum fmc_page_erase(uint32_t page_address)
+{
+	SIM_Enter();
+	if (fmcUnlocked == RESET || page_address < FLASH_BASE || page_address >= FLASH_BASE + FLASH_SIZE)
+	{
+		fmcFlags |= FMC_FLAG_WPERR;
+		SIM_Leave();
+		return FMC_WPERR;
+	}
+	
+	// CPU is stalled while the flash is busy
+	SIM_Stall(FLASH_ERASE_CYCLES);
+	memset((void *)(uintptr_t)(page_address & ~(uint32_t)(FLASH_PAGE_SIZE - 1)), 0xFF, FLASH_PAGE_SIZE);
+	fmcFlags |= FMC_FLAG_END;
+	SIM_Leave();
+	return FMC_READY;
+}
+
+fmc_state_enum fmc_word_program(uint32_t address, uint32_t data)
+{
+	volatile uint32_t *word = (volatile uint32_t *)(uintptr_t)address;
+	
+	SIM_Enter();
+	if (fmcUnlocked == RESET || address < FLASH_BASE || address >= FLASH_BASE + FLASH_SIZE || (address & 3))
+	{
+		fmcFlags |= FMC_FLAG_WPERR;
+		SIM_Leave();
+		return FMC_WPERR;
+	}
+	SIM_Stall(FLASH_PROGRAM_CYCLES);
+	
+	// Only an erased word can be programmed
+	if (*word != 0xFFFFFFFF)
+	{
+		fmcFlags |= FMC_FLAG_PGERR;
+		SIM_Leave();
+		return FMC_PGERR;
+	}
+	*word = data;
+	fmcFlags |= FMC_FLAG_END;
+	SIM_Leave();
+	return FMC_READY;
+}
+
+FlagStatus fmc_flag_get(uint32_t flag)
+{
+	FlagStatus status;
+	
+	SIM_Enter();
+	status = fmcFlags & flag ? SET : RESET;
+	SIM_Leave();
+	return status;
+}
+
+void fmc_flag_clear(uint32_t flag)
+{
+	SIM_Enter();
+	fmcFlags &= ~flag;
+	SIM_Leave();
+}
+
+//============================================================================
+// FWDGT (clocked by IRC40K)
+//============================================================================
+
+ErrStatus fwdgt_config(uint16_t reload_value, uint8_t prescaler_div)
+{
+	SIM_Enter();
+	fwdgtReload = reload_value & 0x0FFF;
+	fwdgtPeriod = (uint64_t)(fwdgtReload + 1) * (4U << prescaler_div) * (SIM_CORE_CLOCK / 40000);
+	SIM_Leave();
+	return SUCCESS;
+}
+
+ErrStatus fwdgt_window_value_config(uint16_t window_value)
+{
+	SIM_Enter();
+	fwdgtWindow = window_value & 0x0FFF;
+	SIM_Leave();
+	return SUCCESS;
+}
+
+void fwdgt_enable(void)
+{
+	SIM_Enter();
+	fwdgtEnabled = SET;
+	fwdgtExpiry = simNow + fwdgtPeriod;
+	SIM_Leave();
+}
+
+void fwdgt_counter_reload(void)
+{
+	uint64_t counter;
+	
+	SIM_Enter();
+	if (fwdgtEnabled == SET)
+	{
+		// Reload above the window value resets the device
+		counter = (fwdgtExpiry - simNow) * (fwdgtReload + 1) / fwdgtPeriod;
+		if (counter > fwdgtWindow)
+		{
+			SIM_Stop(SIM_STATE_WATCHDOG_RESET);
+		}
+		fwdgtExpiry = simNow + fwdgtPeriod;
+	}
+	SIM_Leave();
+}
+
+//============================================================================
+// Event scheduling
+//============================================================================
+
+uint64_t PERIPH_GetNextEvent(void)
+{
+	uint64_t next = fwdgtExpiry;
+	uint8_t index;
+	
+	for (index = 0; index < COUNT_TIMERS; index++)
+	{
+		next = timer[index].nextUpdate < next ? timer[index].nextUpdate : next;
+		next = timer[index].nextCompare < next ? timer[index].nextCompare : next;
+	}
+	for (index = 0; index < COUNT_USARTS; index++)
+	{
+		if (usart[index].shifting == SET && usart[index].shiftDone < next)
+		{
+			next = usart[index].shiftDone;
+		}
+		next = usart[index].rxNext < next ? usart[index].rxNext : next;
+		next = usart[index].idleAt < next ? usart[index].idleAt : next;
+	}
+	next = adc.regularDone < next ? adc.regularDone : next;
+	next = adc.insertedDone < next ? adc.insertedDone : next;
+	return next;
+}
+
+void PERIPH_ProcessEvents(void)
+{
+	uint8_t index;
+	
+	if (fwdgtExpiry <= simNow)
+	{
+		fwdgtExpiry = SIM_NEVER;
+		SIM_Stop(SIM_STATE_WATCHDOG_RESET);
+	}
+	for (index = 0; index < COUNT_TIMERS; index++)
+	{
+		SIM_TimerProcess(&timer[index]);
+	}
+	SIM_AdcProcess();
+	for (index = 0; index < COUNT_USARTS; index++)
+	{
+		SIM_UsartProcess(&usart[index]);
+	}
+}
+
+//----------------------------------------------------------------------------
+// Returns DMA interrupt line of channels first to last
+//----------------------------------------------------------------------------
+static FlagStatus SIM_DmaIrqLine(uint8_t first, uint8_t last)
+{
+	uint8_t channel;
+	
+	for (channel = first; channel <= last; channel++)
+	{
+		if (dma[channel].flags & dma[channel].inten & (DMA_FLAG_FTF | DMA_FLAG_HTF | DMA_FLAG_ERR))
+		{
+			return SET;
+		}
+	}
+	return RESET;
+}
+
+FlagStatus PERIPH_GetIrqLine(IRQn_Type irq)
+{
+	uint8_t index;
+	
+	switch (irq)
+	{
+		case EXTI0_1_IRQn:
+			return simExtiPd & extiInten & 0x0003 ? SET : RESET;
+		case EXTI2_3_IRQn:
+			return simExtiPd & extiInten & 0x000C ? SET : RESET;
+		case EXTI4_15_IRQn:
+			return simExtiPd & extiInten & 0xFFF0 ? SET : RESET;
+		case DMA_Channel0_IRQn:
+			return SIM_DmaIrqLine(0, 0);
+		case DMA_Channel1_2_IRQn:
+			return SIM_DmaIrqLine(1, 2);
+		case DMA_Channel3_4_IRQn:
+			return SIM_DmaIrqLine(3, 4);
+		case ADC_CMP_IRQn:
+			return adc.flags & ADC_FLAG_EOIC && adc.inten & ADC_INT_EOIC ? SET :
+				adc.flags & ADC_FLAG_EOC && adc.inten & ADC_INT_EOC ? SET : RESET;
+		case TIMER0_BRK_UP_TRG_COM_IRQn:
+			return timer[0].intf & timer[0].inten & TIMER_INT_UP ? SET : RESET;
+		case TIMER0_Channel_IRQn:
+			return timer[0].intf & timer[0].inten & (TIMER_INT_CH0 | TIMER_INT_CH1 | TIMER_INT_CH2 | TIMER_INT_CH3) ? SET : RESET;
+		case USART0_IRQn:
+		case USART1_IRQn:
+			index = irq == USART0_IRQn ? 0 : 1;
+			return (usart[index].flags & usart[index].inten & (USART_FLAG_IDLE | USART_FLAG_RBNE | USART_FLAG_TC | USART_FLAG_TBE)) ||
+				((usart[index].flags & USART_FLAG_ORERR) && (usart[index].inten & USART_INT_RBNE)) ? SET : RESET;
+		default:
+			for (index = 1; index < COUNT_TIMERS; index++)
+			{
+				if (timer[index].irqUp == irq)
+				{
+					return timer[index].intf & timer[index].inten ? SET : RESET;
+				}
+			}
+			return RESET;
+	}
+}
+
+//============================================================================
+// Test interface
+//============================================================================
+
+void SIM_SetPin(uint32_t port, uint32_t pin, FlagStatus level)
+{
+	SIM_GPIO *p = SIM_GetPort(port);
+	uint8_t number = SIM_PinNumber(pin);
+	FlagStatus before = SIM_PinLevel(p, number);
+	
+	p->driven |= (uint16_t)pin;
+	p->external = level == SET ? p->external | (uint16_t)pin : p->external & (uint16_t)~pin;
+	SIM_PinEdge(p, number, before, SIM_PinLevel(p, number));
+}
+
+FlagStatus SIM_GetPin(uint32_t port, uint32_t pin)
+{
+	return SIM_PinLevel(SIM_GetPort(port), SIM_PinNumber(pin));
+}
+
+void SIM_SetPowerPin(uint32_t port, uint32_t pin)
+{
+	powerPort = SIM_GetPort(port);
+	powerPin = (uint16_t)pin;
+	powerOn = powerPort->output & powerPin ? SET : RESET;
+}
+
+void SIM_SetAdc(uint8_t channel, uint16_t value)
+{
+	if (channel < SIM_COUNT_ADC_CHANNELS)
+	{
+		adc.value[channel] = value & 0x0FFF;
+	}
+}
+
+void SIM_UsartReceive(uint32_t usart_periph, const uint8_t *data, uint16_t length)
+{
+	SIM_USART *u = SIM_GetUsart(usart_periph);
+	uint16_t index;
+	
+	for (index = 0; index < length && u->rxCount < USART_BUFFER_SIZE; index++)
+	{
+		u->rxQueue[(u->rxHead + u->rxCount) % USART_BUFFER_SIZE] = data[index];
+		u->rxCount++;
+		
+		// Start bit on an idle line, idle detection is cancelled
+		if (u->rxNext == SIM_NEVER)
+		{
+			u->rxNext = simNow + SIM_UsartByteCycles(u);
+			u->idleAt = SIM_NEVER;
+		}
+	}
+}
+
+uint16_t SIM_UsartReceivePending(uint32_t usart_periph)
+{
+	return SIM_GetUsart(usart_periph)->rxCount;
+}
+
+uint16_t SIM_UsartTransmitted(uint32_t usart_periph, uint8_t *data, uint16_t size)
+{
+	SIM_USART *u = SIM_GetUsart(usart_periph);
+	uint16_t count = u->txCount < size ? u->txCount : size;
+	
+	memcpy(data, u->txCapture, count);
+	memmove(u->txCapture, u->txCapture + count, u->txCount - count);
+	u->txCount -= count;
+	return count;
+}
+
+uint32_t SIM_GetTimerCompare(uint32_t timer_periph, uint16_t channel)
+{
+	return SIM_GetTimer(timer_periph)->ccr[channel & 3];
+}
+
+double SIM_GetTimerDuty(uint32_t timer_periph, uint16_t channel)
+{
+	SIM_TIMER *t = SIM_GetTimer(timer_periph);
+	uint8_t index = channel & 3;
+	double steps = t->center == SET ? t->car : t->car + 1;
+	double duty = (t->ccr[index] < steps ? t->ccr[index] : steps) / steps;
+	
+	switch (t->ocMode[index])
+	{
+		case TIMER_OC_MODE_PWM0:
+			break;
+		case TIMER_OC_MODE_PWM1:
+			duty = 1 - duty;
+			break;
+		case TIMER_OC_MODE_HIGH:
+			duty = 1;
+			break;
+		default:
+			duty = 0;
+			break;
+	}
+	return t->ocPolarityLow[index] == SET ? 1 - duty : duty;
+}
+
+FlagStatus SIM_GetTimerOutputEnabled(uint32_t timer_periph)
+{
+	SIM_TIMER *t = SIM_GetTimer(timer_periph);
+	return t->advanced == RESET || t->poen == SET ? SET : RESET;
+}
+
+uint32_t SIM_GetTimerCounter(uint32_t timer_periph)
+{
+	SIM_TIMER *t = SIM_GetTimer(timer_periph);
+	return SIM_TimerCounter(t, SIM_TimerPhase(t));
+}
+
+uint32_t SIM_GetTimerTickCycles(uint32_t timer_periph)
+{
+	return SIM_GetTimer(timer_periph)->tickCycles;
+}
+
+void SIM_SetTimerUpdateHook(uint32_t timer_periph, void (*hook)(void))
+{
+	SIM_GetTimer(timer_periph)->hook = hook;
+}
@@ -0,0 +1,301 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Plant model of one board (average value model of the inverter, updated on
+// every update event of the PWM timer):
+// - Battery: open circuit voltage falls linearly with the charge, internal
+//   resistance makes it sag under load
+// - Inverter: each phase is connected to the mean PWM voltage, with disabled
+//   outputs the current freewheels through the diodes until it is zero
+// - Motor: star connected phases with resistance, inductance and sinusoidal
+//   back-EMF, hall sensors switch every 60 degrees electrical
+// - Wheel: mass of board and rider share, rolling resistance, drag and slope
+
+#include "../Inc/plant.h"
+#include "../Inc/sim.h"
+#include "../../Inc/defines.h"
+
+#include <math.h>
+#include <string.h>
+
+#define PLANT_SUBSTEPS 4								// Integration steps per update event
+#define PLANT_GRAVITY 9.81
+#define PLANT_AIR_DENSITY 1.2
+#define PLANT_ADC_OFFSET_DC 2000				// ADC value of the DC current sensor without current
+#define PLANT_TWO_PI (2 * M_PI)
+
+static PLANT_CONFIG config;
+static PLANT_STATE state;
+static uint64_t lastCycles = 0;
+
+// Hall inputs of each 60 degree sector, sector 0 is centered at 0 degrees.
+// Inverse of the default hall_to_pos table turned by half a revolution: the
+// timer runs in PWM1 mode, pos_to_angle is the angle of the low side duty
+// cycle, so positive pwm turns the wheel forward
+static const uint8_t hallOfSector[6] = {4, 5, 1, 3, 2, 6};
+
+// Timer channels of the phases y, b, g
+static const uint16_t phaseChannel[3] = {TIMER_BLDC_CHANNEL_Y, TIMER_BLDC_CHANNEL_B, TIMER_BLDC_CHANNEL_G};
+
+//----------------------------------------------------------------------------
+// Returns hall inputs of the rotor angle
+//----------------------------------------------------------------------------
+static uint8_t PLANT_Hall(double angle)
+{
+	int sector = (int)floor((angle + M_PI / 6) / (M_PI / 3));
+	
+	return hallOfSector[((sector % 6) + 6) % 6];
+}
+
+//----------------------------------------------------------------------------
+// Sets hall pins and ADC values of the board
+//----------------------------------------------------------------------------
+static void PLANT_Outputs(void)
+{
+	uint8_t hall = PLANT_Hall(state.electricalAngle);
+	double adcCurrent = PLANT_ADC_OFFSET_DC + state.currentDC / MOTOR_AMP_CONV_DC_AMP;
+	double adcVoltage = state.batteryVoltage / ADC_BATTERY_VOLT;
+	
+	if (hall != state.hall)
+	{
+		state.hall = hall;
+		SIM_SetPin(HALL_A_PORT, HALL_A_PIN, hall & 1 ? SET : RESET);
+		SIM_SetPin(HALL_B_PORT, HALL_B_PIN, hall & 2 ? SET : RESET);
+		SIM_SetPin(HALL_C_PORT, HALL_C_PIN, hall & 4 ? SET : RESET);
+	}
+	SIM_SetAdc(CURRENT_DC_CHANNEL, (uint16_t)fmin(fmax(adcCurrent + 0.5, 0), 4095));
+	SIM_SetAdc(VBATT_CHANNEL, (uint16_t)fmin(fmax(adcVoltage + 0.5, 0), 4095));
+}
+
+//----------------------------------------------------------------------------
+// Electrical step: phase currents, returns DC current
+//----------------------------------------------------------------------------
+static double PLANT_Electrical(double dt, const double duty[3], FlagStatus enabled, const double emf[3])
+{
+	double voltage[3];
+	double neutral;
+	double currentDC = 0;
+	uint8_t phase;
+	
+	for (phase = 0; phase < 3; phase++)
+	{
+		if (enabled == SET)
+		{
+			voltage[phase] = duty[phase] * state.batteryVoltage;
+		}
+		else
+		{
+			// Current into the motor flows through the lower diode, current out of the
+			// motor through the upper diode back into the battery
+			voltage[phase] = state.phaseCurrent[phase] > 0 ? 0 : (state.phaseCurrent[phase] < 0 ? state.batteryVoltage : -1);
+		}
+	}
+	
+	// Star point of the phases which conduct
+	if (enabled == RESET)
+	{
+		uint8_t count = 0;
+		double sum = 0;
+		for (phase = 0; phase < 3; phase++)
+		{
+			if (voltage[phase] >= 0)
+			{
+				sum += voltage[phase] - emf[phase];
+				count++;
+			}
+		}
+		if (count < 2)
+		{
+			memset(state.phaseCurrent, 0, sizeof(state.phaseCurrent));
+			return 0;
+		}
+		neutral = sum / count;
+	}
+	else
+	{
+		neutral = (voltage[0] + voltage[1] + voltage[2] - emf[0] - emf[1] - emf[2]) / 3;
+	}
+	
+	for (phase = 0; phase < 3; phase++)
+	{
+		double before = state.phaseCurrent[phase];
+		
+		if (voltage[phase] < 0)
+		{
+			continue;
+		}
+		
+		// Implicit in the resistance, stable for any step
+		state.phaseCurrent[phase] = (before + dt / config.phaseInductance * (voltage[phase] - neutral - emf[phase])) /
+			(1 + dt * config.phaseResistance / config.phaseInductance);
+		
+		// Diodes do not conduct backwards
+		if (enabled == RESET && before * state.phaseCurrent[phase] < 0)
+		{
+			state.phaseCurrent[phase] = 0;
+		}
+		currentDC += voltage[phase] / state.batteryVoltage * state.phaseCurrent[phase];
+	}
+	
+	return currentDC;
+}
+
+//----------------------------------------------------------------------------
+// Advances the plant to the update event of the PWM timer
+//----------------------------------------------------------------------------
+static void PLANT_Update(void)
+{
+	uint64_t now = SIM_Cycles();
+	double dt = (double)(now - lastCycles) / SIM_CORE_CLOCK / PLANT_SUBSTEPS;
+	FlagStatus enabled = SIM_GetTimerOutputEnabled(TIMER_BLDC);
+	double duty[3];
+	double emf[3];
+	double shape[3];
+	double omega;
+	double force;
+	double load;
+	double voltageOpen;
+	uint8_t phase;
+	uint8_t step;
+	
+	lastCycles = now;
+	for (phase = 0; phase < 3; phase++)
+	{
+		duty[phase] = SIM_GetTimerDuty(TIMER_BLDC, phaseChannel[phase]);
+	}
+	
+	for (step = 0; step < PLANT_SUBSTEPS; step++)
+	{
+		// Back-EMF of the phases y, b and g (120 degrees apart like the sinus commutation)
+		omega = state.speed / config.wheelRadius;
+		shape[0] = sin(state.electricalAngle);
+		shape[1] = sin(state.electricalAngle - PLANT_TWO_PI / 3);
+		shape[2] = sin(state.electricalAngle + PLANT_TWO_PI / 3);
+		for (phase = 0; phase < 3; phase++)
+		{
+			emf[phase] = config.backEmfConstant * omega * shape[phase];
+		}
+		
+		state.currentDC = PLANT_Electrical(dt, duty, enabled, emf);
+		
+		// Battery
+		voltageOpen = config.batteryVoltageEmpty + (config.batteryVoltageFull - config.batteryVoltageEmpty) * state.batteryCharge;
+		state.batteryVoltage = voltageOpen - config.batteryResistance * state.currentDC;
+		state.batteryCharge -= state.currentDC * dt / (config.batteryCapacity * 3600);
+		
+		// Wheel: rolling resistance and friction hold it at rest until the force exceeds them
+		state.torque = config.backEmfConstant * (shape[0] * state.phaseCurrent[0] + shape[1] * state.phaseCurrent[1] + shape[2] * state.phaseCurrent[2]);
+		force = state.torque / config.wheelRadius - config.mass * PLANT_GRAVITY * config.slope;
+		load = config.mass * PLANT_GRAVITY * config.rollingResistance + config.frictionTorque / config.wheelRadius;
+		if (fabs(state.speed) < 1e-3 && fabs(force) <= load)
+		{
+			state.speed = 0;
+		}
+		else
+		{
+			force -= (state.speed != 0 ? copysign(load, state.speed) : copysign(load, force)) +
+				0.5 * PLANT_AIR_DENSITY * config.dragArea * state.speed * fabs(state.speed);
+			state.speed += force / config.mass * dt;
+		}
+		state.electricalAngle = fmod(state.electricalAngle + state.speed / config.wheelRadius * config.polePairs * dt, PLANT_TWO_PI);
+		
+		// Power and energy
+		state.powerBattery = state.batteryVoltage * state.currentDC;
+		state.powerMechanical = state.torque * state.speed / config.wheelRadius;
+		state.energyBattery += state.powerBattery * dt;
+		state.energyMechanical += state.powerMechanical * dt;
+		state.time += dt;
+	}
+	
+	PLANT_Outputs();
+}
+
+//----------------------------------------------------------------------------
+// Returns parameters of a hoverboard
+//----------------------------------------------------------------------------
+void PLANT_GetDefaultConfig(PLANT_CONFIG *plantConfig)
+{
+	double omegaNoLoad;
+	
+	memset(plantConfig, 0, sizeof(*plantConfig));
+	plantConfig->batteryVoltageFull = 42.0;
+	plantConfig->batteryVoltageEmpty = 32.0;
+	plantConfig->batteryCapacity = 4.4;
+	plantConfig->batteryCharge = 0.6;
+	plantConfig->batteryResistance = 0.25;
+	plantConfig->phaseResistance = 0.12;
+	plantConfig->phaseInductance = 0.00025;
+	plantConfig->frictionTorque = 0.3;
+	plantConfig->polePairs = 15;
+	plantConfig->wheelRadius = 0.0825;
+	plantConfig->mass = 45.0;
+	plantConfig->rollingResistance = 0.015;
+	plantConfig->dragArea = 0.25;
+	plantConfig->slope = 0;
+	
+	// Back-EMF the speed controller feed forward expects: duty cycle 1000 turns the
+	// motor without load at SPEED_NOLOAD_MH with SPEED_NOMINAL_MV. Block commutation
+	// applies 2000 of pwm_res (2250) steps between two phases, the mean line to line
+	// back-EMF over a sector is 3 * sqrt(3) / pi of the phase peak
+	omegaNoLoad = SPEED_NOLOAD_MH / 3600.0 / plantConfig->wheelRadius;
+	plantConfig->backEmfConstant = (2000.0 / 2250.0) * (SPEED_NOMINAL_MV / 1000.0) / (3 * sqrt(3) / M_PI * omegaNoLoad);
+}
+
+//----------------------------------------------------------------------------
+// Connects the plant to the simulated board
+//----------------------------------------------------------------------------
+void PLANT_Init(const PLANT_CONFIG *plantConfig)
+{
+	config = *plantConfig;
+	memset(&state, 0, sizeof(state));
+	state.batteryCharge = config.batteryCharge;
+	state.batteryVoltage = config.batteryVoltageEmpty + (config.batteryVoltageFull - config.batteryVoltageEmpty) * config.batteryCharge;
+	state.hall = 0xFF;
+	lastCycles = SIM_Cycles();
+	
+	PLANT_Outputs();
+	SIM_SetTimerUpdateHook(TIMER_BLDC, PLANT_Update);
+}
+
+//----------------------------------------------------------------------------
+// Changes the grade of the road
+//----------------------------------------------------------------------------
+void PLANT_SetSlope(double slope)
+{
+	config.slope = slope;
+}
+
+//----------------------------------------------------------------------------
+// Returns state of the plant
+//----------------------------------------------------------------------------
+const PLANT_STATE *PLANT_GetState(void)
+{
+	return &state;
+}
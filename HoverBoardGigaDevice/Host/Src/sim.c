@@ -0,0 +1,698 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Simulated Cortex-M3 core: virtual cycle clock, NVIC with preemption and
+// PRIMASK, SysTick, DWT cycle counter and the coroutine running the firmware.
+// Time only passes in firmware library calls and intrinsics, a busy loop
+// without any call is detected by a profiling timer signal and skipped to
+// the next peripheral event.
+
+#define _GNU_SOURCE
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <ucontext.h>
+
+#include "gd32f1x0.h"
+#include "../Inc/sim.h"
+#include "../Inc/simCore.h"
+
+// Interrupts taken by one handler within one millisecond counted as storm
+#define SIM_STORM_LIMIT 1000
+
+// Stack of the firmware coroutine (static, so addresses fit into 32 bits)
+#define SIM_STACK_SIZE (1024 * 1024)
+
+// Vector number of systick in the tables below
+#define SIM_SYSTICK SIM_COUNT_IRQS
+#define SIM_COUNT_VECTORS (SIM_COUNT_IRQS + 1)
+
+// Core registers
+SysTick_Type simSysTick;
+DWT_Type simDwt;
+CoreDebug_Type simCoreDebug;
+SCB_Type simScb;
+uint32_t SystemCoreClock = SIM_CORE_CLOCK;
+
+uint64_t simNow = 0;
+
+// Interrupt handlers of the firmware, handlers not linked stay NULL
+extern void SysTick_Handler(void) __attribute__((weak));
+extern void EXTI0_1_IRQHandler(void) __attribute__((weak));
+extern void EXTI2_3_IRQHandler(void) __attribute__((weak));
+extern void EXTI4_15_IRQHandler(void) __attribute__((weak));
+extern void DMA_Channel0_IRQHandler(void) __attribute__((weak));
+extern void DMA_Channel1_2_IRQHandler(void) __attribute__((weak));
+extern void DMA_Channel3_4_IRQHandler(void) __attribute__((weak));
+extern void ADC_CMP_IRQHandler(void) __attribute__((weak));
+extern void TIMER0_BRK_UP_TRG_COM_IRQHandler(void) __attribute__((weak));
+extern void TIMER0_Channel_IRQHandler(void) __attribute__((weak));
+extern void TIMER1_IRQHandler(void) __attribute__((weak));
+extern void TIMER2_IRQHandler(void) __attribute__((weak));
+extern void TIMER13_IRQHandler(void) __attribute__((weak));
+extern void TIMER14_IRQHandler(void) __attribute__((weak));
+extern void TIMER15_IRQHandler(void) __attribute__((weak));
+extern void TIMER16_IRQHandler(void) __attribute__((weak));
+extern void USART0_IRQHandler(void) __attribute__((weak));
+extern void USART1_IRQHandler(void) __attribute__((weak));
+
+static void (* const vectors[SIM_COUNT_VECTORS])(void) =
+{
+	[EXTI0_1_IRQn] = EXTI0_1_IRQHandler,
+	[EXTI2_3_IRQn] = EXTI2_3_IRQHandler,
+	[EXTI4_15_IRQn] = EXTI4_15_IRQHandler,
+	[DMA_Channel0_IRQn] = DMA_Channel0_IRQHandler,
+	[DMA_Channel1_2_IRQn] = DMA_Channel1_2_IRQHandler,
+	[DMA_Channel3_4_IRQn] = DMA_Channel3_4_IRQHandler,
+	[ADC_CMP_IRQn] = ADC_CMP_IRQHandler,
+	[TIMER0_BRK_UP_TRG_COM_IRQn] = TIMER0_BRK_UP_TRG_COM_IRQHandler,
+	[TIMER0_Channel_IRQn] = TIMER0_Channel_IRQHandler,
+	[TIMER1_IRQn] = TIMER1_IRQHandler,
+	[TIMER2_IRQn] = TIMER2_IRQHandler,
+	[TIMER13_IRQn] = TIMER13_IRQHandler,
+	[TIMER14_IRQn] = TIMER14_IRQHandler,
+	[TIMER15_IRQn] = TIMER15_IRQHandler,
+	[TIMER16_IRQn] = TIMER16_IRQHandler,
+	[USART0_IRQn] = USART0_IRQHandler,
+	[USART1_IRQn] = USART1_IRQHandler,
+	[SIM_SYSTICK] = SysTick_Handler
+};
+
+// NVIC
+static FlagStatus irqEnabled[SIM_COUNT_VECTORS];
+static uint8_t irqPriority[SIM_COUNT_VECTORS];
+static uint32_t irqCount[SIM_COUNT_VECTORS];
+static uint32_t irqStormCount[SIM_COUNT_VECTORS];
+static uint64_t irqStormStart[SIM_COUNT_VECTORS];
+static uint32_t irqTaken = 0;
+static int32_t executionPriority = 256;		// Thread mode
+static uint32_t primask = 0;
+
+// Systick
+static FlagStatus sysTickPending = RESET;
+static uint64_t sysTickNext = SIM_NEVER;
+
+// DWT cycle counter
+static FlagStatus dwtRunning = RESET;
+static uint64_t dwtBase = 0;
+static uint32_t dwtValue = 0;
+
+// Coroutine
+static SIM_STATE simState = SIM_STATE_RUNNING;
+static ucontext_t harnessContext;
+static ucontext_t firmwareContext;
+static uint8_t firmwareStack[SIM_STACK_SIZE] __attribute__((aligned(16)));
+static int (*firmwareEntry)(void) = NULL;
+static FlagStatus firmwareStarted = RESET;
+static volatile FlagStatus inFirmware = RESET;
+static uint64_t deadline = 0;
+
+// Busy loop detection
+static volatile uint32_t simBusy = 0;
+static volatile uint32_t simProgress = 0;
+static uint32_t spinProgress = 0;
+static uint8_t spinTicks = 0;
+
+static void SIM_Dispatch(void);
+
+//----------------------------------------------------------------------------
+// Returns cycle of the next event of core and peripherals
+//----------------------------------------------------------------------------
+static uint64_t SIM_GetNextEvent(void)
+{
+	uint64_t next = PERIPH_GetNextEvent();
+	return sysTickNext < next ? sysTickNext : next;
+}
+
+//----------------------------------------------------------------------------
+// Processes all events due at simNow
+//----------------------------------------------------------------------------
+static void SIM_ProcessEvents(void)
+{
+	if (sysTickNext <= simNow)
+	{
+		sysTickNext += simSysTick.LOAD + 1;
+		simSysTick.CTRL |= SysTick_CTRL_COUNTFLAG_Msk;
+		if (simSysTick.CTRL & SysTick_CTRL_TICKINT_Msk)
+		{
+			sysTickPending = SET;
+		}
+	}
+	PERIPH_ProcessEvents();
+}
+
+//----------------------------------------------------------------------------
+// Updates the core registers read directly by the firmware
+//----------------------------------------------------------------------------
+static void SIM_UpdateCore(void)
+{
+	FlagStatus running;
+	
+	if (sysTickNext != SIM_NEVER)
+	{
+		simSysTick.VAL = (uint32_t)(sysTickNext - simNow - 1);
+	}
+	simScb.ICSR = sysTickPending == SET ? SCB_ICSR_PENDSTSET_Msk : 0;
+	
+	// Cycle counter written by the firmware is continued from the new value
+	if (simDwt.CYCCNT != dwtValue)
+	{
+		dwtValue = simDwt.CYCCNT;
+		dwtBase = simNow - dwtValue;
+	}
+	running = (simCoreDebug.DEMCR & CoreDebug_DEMCR_TRCENA_Msk) && (simDwt.CTRL & DWT_CTRL_CYCCNTENA_Msk) ? SET : RESET;
+	if (running == SET && dwtRunning == RESET)
+	{
+		dwtBase = simNow - dwtValue;
+	}
+	dwtRunning = running;
+	if (dwtRunning == SET)
+	{
+		dwtValue = (uint32_t)(simNow - dwtBase);
+		simDwt.CYCCNT = dwtValue;
+	}
+}
+
+//----------------------------------------------------------------------------
+// Returns to the test, never returns again once the board has stopped
+//----------------------------------------------------------------------------
+static void SIM_Yield(void)
+{
+	do
+	{
+		// Cleared before the switch, so the signal never sees the test as firmware
+		inFirmware = RESET;
+		swapcontext(&firmwareContext, &harnessContext);
+	} while (simState != SIM_STATE_RUNNING);
+}
+
+//----------------------------------------------------------------------------
+// Returns to the test when its deadline is reached
+//----------------------------------------------------------------------------
+static void SIM_CheckYield(void)
+{
+	if (inFirmware == SET && (simNow >= deadline || simState != SIM_STATE_RUNNING))
+	{
+		SIM_Yield();
+	}
+}
+
+//----------------------------------------------------------------------------
+// Lets time pass up to target, events are processed in order
+//----------------------------------------------------------------------------
+static void SIM_AdvanceTo(uint64_t target, FlagStatus dispatch)
+{
+	uint64_t next;
+	
+	while (1)
+	{
+		if (dispatch == SET)
+		{
+			SIM_Dispatch();
+		}
+		next = SIM_GetNextEvent();
+		if (next > target)
+		{
+			break;
+		}
+		if (next > simNow)
+		{
+			simNow = next;
+		}
+		SIM_ProcessEvents();
+	}
+	if (target > simNow)
+	{
+		simNow = target;
+	}
+}
+
+//----------------------------------------------------------------------------
+// Returns priority of vector
+//----------------------------------------------------------------------------
+static int32_t SIM_GetPriority(uint32_t vector)
+{
+	return irqPriority[vector];
+}
+
+//----------------------------------------------------------------------------
+// Returns pending vector with the highest priority, that is able to preempt
+// (-1 if none), PRIMASK is not considered
+//----------------------------------------------------------------------------
+static int32_t SIM_GetPendingVector(void)
+{
+	int32_t best = -1;
+	int32_t bestPriority = executionPriority;
+	uint32_t vector;
+	
+	if (sysTickPending == SET && SIM_GetPriority(SIM_SYSTICK) < bestPriority)
+	{
+		best = SIM_SYSTICK;
+		bestPriority = SIM_GetPriority(SIM_SYSTICK);
+	}
+	
+	// Same priority: lower vector number wins (systick has the lowest number)
+	for (vector = 0; vector < SIM_COUNT_IRQS; vector++)
+	{
+		if (irqEnabled[vector] == SET && SIM_GetPriority(vector) < bestPriority &&
+			PERIPH_GetIrqLine((IRQn_Type)vector) == SET)
+		{
+			best = vector;
+			bestPriority = SIM_GetPriority(vector);
+		}
+	}
+	
+	return best;
+}
+
+//----------------------------------------------------------------------------
+// Calls interrupt handler
+//----------------------------------------------------------------------------
+static void SIM_TakeIrq(int32_t vector)
+{
+	int32_t previousPriority = executionPriority;
+	uint32_t busy = simBusy;
+	
+	if (vectors[vector] == NULL)
+	{
+		fprintf(stderr, "SIM: interrupt %d has no handler\n", vector == SIM_SYSTICK ? SysTick_IRQn : vector);
+		abort();
+	}
+	
+	// Handler which does not clear its flag is called again and again
+	if (simNow - irqStormStart[vector] > SIM_CORE_CLOCK / 1000)
+	{
+		irqStormStart[vector] = simNow;
+		irqStormCount[vector] = 0;
+	}
+	if (++irqStormCount[vector] > SIM_STORM_LIMIT)
+	{
+		fprintf(stderr, "SIM: interrupt %d storm\n", vector == SIM_SYSTICK ? SysTick_IRQn : vector);
+		SIM_Stop(SIM_STATE_IRQ_STORM);
+		return;
+	}
+	
+	if (vector == SIM_SYSTICK)
+	{
+		sysTickPending = RESET;
+	}
+	irqCount[vector]++;
+	irqTaken++;
+	
+	executionPriority = SIM_GetPriority(vector);
+	SIM_UpdateCore();
+	simBusy = 0;
+	vectors[vector]();
+	simBusy = busy;
+	executionPriority = previousPriority;
+}
+
+//----------------------------------------------------------------------------
+// Takes all pending interrupts able to preempt
+//----------------------------------------------------------------------------
+static void SIM_Dispatch(void)
+{
+	int32_t vector;
+	
+	while (primask == 0 && simState == SIM_STATE_RUNNING)
+	{
+		vector = SIM_GetPendingVector();
+		if (vector < 0)
+		{
+			break;
+		}
+		SIM_TakeIrq(vector);
+	}
+}
+
+//----------------------------------------------------------------------------
+// Start of every firmware library call
+//----------------------------------------------------------------------------
+void SIM_EnterCycles(uint32_t cycles)
+{
+	simBusy++;
+	simProgress++;
+	SIM_AdvanceTo(simNow + cycles, SET);
+	SIM_UpdateCore();
+	SIM_CheckYield();
+}
+
+//----------------------------------------------------------------------------
+// End of every firmware library call
+//----------------------------------------------------------------------------
+void SIM_Leave(void)
+{
+	SIM_Dispatch();
+	SIM_UpdateCore();
+	simBusy--;
+}
+
+//----------------------------------------------------------------------------
+// Lets cycles pass without taking interrupts
+//----------------------------------------------------------------------------
+void SIM_Stall(uint64_t cycles)
+{
+	uint64_t end = simNow + cycles;
+	
+	// The test keeps its deadlines while the core waits (e.g. samples outputs)
+	while (simNow < end)
+	{
+		SIM_AdvanceTo(inFirmware == SET && deadline < end ? deadline : end, RESET);
+		SIM_CheckYield();
+	}
+}
+
+//----------------------------------------------------------------------------
+// Leaves running state
+//----------------------------------------------------------------------------
+void SIM_Stop(SIM_STATE state)
+{
+	if (simState == SIM_STATE_RUNNING)
+	{
+		simState = state;
+	}
+}
+
+//----------------------------------------------------------------------------
+// Lets time pass until the next event (firmware loops without library call)
+//----------------------------------------------------------------------------
+static void SIM_Spin(void)
+{
+	uint64_t next;
+	
+	simBusy++;
+	next = SIM_GetNextEvent();
+	if (next > deadline)
+	{
+		simNow = simNow > deadline ? simNow : deadline;
+	}
+	else
+	{
+		simNow = next > simNow ? next : simNow;
+		SIM_ProcessEvents();
+		SIM_Dispatch();
+	}
+	SIM_UpdateCore();
+	simBusy--;
+	SIM_CheckYield();
+}
+
+//----------------------------------------------------------------------------
+// Profiling timer signal (every millisecond of CPU time)
+// -> firmware without any library call for two signals is spinning
+//----------------------------------------------------------------------------
+static void SIM_SignalHandler(int signal)
+{
+	(void)signal;
+	
+	if (inFirmware == RESET || simBusy != 0)
+	{
+		spinTicks = 0;
+		return;
+	}
+	if (simProgress != spinProgress)
+	{
+		spinProgress = simProgress;
+		spinTicks = 0;
+		return;
+	}
+	if (++spinTicks >= 2)
+	{
+		spinTicks = 0;
+		SIM_Spin();
+	}
+}
+
+//----------------------------------------------------------------------------
+// Coroutine function
+//----------------------------------------------------------------------------
+static void SIM_FirmwareThread(void)
+{
+	firmwareEntry();
+	
+	// Firmware main must not return
+	fprintf(stderr, "SIM: firmware returned\n");
+	SIM_Stop(SIM_STATE_DEADLOCK);
+	SIM_Yield();
+}
+
+//----------------------------------------------------------------------------
+// Starts firmware entry function as a coroutine
+//----------------------------------------------------------------------------
+void SIM_Start(int (*entry)(void))
+{
+	struct sigaction action;
+	struct itimerval interval;
+	
+	firmwareEntry = entry;
+	getcontext(&firmwareContext);
+	firmwareContext.uc_stack.ss_sp = firmwareStack;
+	firmwareContext.uc_stack.ss_size = sizeof(firmwareStack);
+	firmwareContext.uc_link = NULL;
+	makecontext(&firmwareContext, SIM_FirmwareThread, 0);
+	firmwareStarted = SET;
+	
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = SIM_SignalHandler;
+	action.sa_flags = SA_RESTART | SA_NODEFER;
+	sigaction(SIGPROF, &action, NULL);
+	interval.it_interval.tv_sec = 0;
+	interval.it_interval.tv_usec = 1000;
+	interval.it_value = interval.it_interval;
+	setitimer(ITIMER_PROF, &interval, NULL);
+}
+
+//----------------------------------------------------------------------------
+// Lets number of cycles pass
+//----------------------------------------------------------------------------
+void SIM_Run(uint64_t cycles)
+{
+	deadline = simNow + cycles;
+	
+	if (firmwareStarted == SET && simState == SIM_STATE_RUNNING)
+	{
+		inFirmware = SET;
+		swapcontext(&harnessContext, &firmwareContext);
+		inFirmware = RESET;
+	}
+	
+	// Stopped board: peripherals keep running, nothing is executed anymore
+	SIM_AdvanceTo(deadline, firmwareStarted == SET ? RESET : SET);
+	SIM_UpdateCore();
+}
+
+//----------------------------------------------------------------------------
+// Lets number of milliseconds pass
+//----------------------------------------------------------------------------
+void SIM_RunMs(uint32_t ms)
+{
+	SIM_Run((uint64_t)ms * (SIM_CORE_CLOCK / 1000));
+}
+
+//----------------------------------------------------------------------------
+// Returns simulated cycles since start
+//----------------------------------------------------------------------------
+uint64_t SIM_Cycles(void)
+{
+	return simNow;
+}
+
+//----------------------------------------------------------------------------
+// Returns simulated seconds since start
+//----------------------------------------------------------------------------
+double SIM_Seconds(void)
+{
+	return (double)simNow / SIM_CORE_CLOCK;
+}
+
+//----------------------------------------------------------------------------
+// Returns state of the board
+//----------------------------------------------------------------------------
+SIM_STATE SIM_GetState(void)
+{
+	return simState;
+}
+
+//----------------------------------------------------------------------------
+// Returns how often interrupt handler has been called
+//----------------------------------------------------------------------------
+uint32_t SIM_GetIrqCount(IRQn_Type irq)
+{
+	return irqCount[irq == SysTick_IRQn ? SIM_SYSTICK : (uint32_t)irq];
+}
+
+//----------------------------------------------------------------------------
+// CMSIS core functions
+//----------------------------------------------------------------------------
+void SystemCoreClockUpdate(void)
+{
+	SIM_Enter();
+	SystemCoreClock = SIM_CORE_CLOCK;
+	SIM_Leave();
+}
+
+uint32_t SysTick_Config(uint32_t ticks)
+{
+	SIM_Enter();
+	if (ticks - 1 > SysTick_LOAD_RELOAD_Msk)
+	{
+		SIM_Leave();
+		return 1;
+	}
+	simSysTick.LOAD = ticks - 1;
+	simSysTick.CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk | SysTick_CTRL_ENABLE_Msk;
+	irqPriority[SIM_SYSTICK] = 15;
+	sysTickNext = simNow + ticks;
+	SIM_Leave();
+	return 0;
+}
+
+void NVIC_SetPriority(IRQn_Type IRQn, uint32_t priority)
+{
+	SIM_Enter();
+	if (IRQn == SysTick_IRQn)
+	{
+		irqPriority[SIM_SYSTICK] = priority & 0x0F;
+	}
+	else if (IRQn >= 0 && IRQn < SIM_COUNT_IRQS)
+	{
+		irqPriority[IRQn] = priority & 0x0F;
+	}
+	SIM_Leave();
+}
+
+void nvic_priority_group_set(uint32_t nvic_prigroup)
+{
+	SIM_Enter();
+	// Only 4 bits preemption priority (PRE4_SUB0) is simulated
+	if (nvic_prigroup != NVIC_PRIGROUP_PRE4_SUB0)
+	{
+		fprintf(stderr, "SIM: only NVIC_PRIGROUP_PRE4_SUB0 is simulated\n");
+	}
+	SIM_Leave();
+}
+
+void nvic_irq_enable(uint8_t nvic_irq, uint8_t nvic_irq_pre_priority, uint8_t nvic_irq_sub_priority)
+{
+	(void)nvic_irq_sub_priority;
+	SIM_Enter();
+	if (nvic_irq < SIM_COUNT_IRQS)
+	{
+		irqPriority[nvic_irq] = nvic_irq_pre_priority & 0x0F;
+		irqEnabled[nvic_irq] = SET;
+	}
+	SIM_Leave();
+}
+
+void nvic_irq_disable(uint8_t nvic_irq)
+{
+	SIM_Enter();
+	if (nvic_irq < SIM_COUNT_IRQS)
+	{
+		irqEnabled[nvic_irq] = RESET;
+	}
+	SIM_Leave();
+}
+
+//----------------------------------------------------------------------------
+// Intrinsics
+//----------------------------------------------------------------------------
+void __NOP(void)
+{
+	// Counts with the wait loop around it (load, compare and branch)
+	SIM_Enter();
+	SIM_Leave();
+}
+
+void __WFI(void)
+{
+	uint32_t taken;
+	uint64_t next;
+	
+	SIM_Enter();
+	taken = irqTaken;
+	
+	// Wake up by an interrupt able to preempt (taken only without PRIMASK)
+	while (irqTaken == taken && SIM_GetPendingVector() < 0 && simState == SIM_STATE_RUNNING)
+	{
+		next = SIM_GetNextEvent();
+		if (next == SIM_NEVER)
+		{
+			fprintf(stderr, "SIM: WFI without interrupt source\n");
+			SIM_Stop(SIM_STATE_DEADLOCK);
+			break;
+		}
+		if (inFirmware == SET && next > deadline)
+		{
+			simNow = simNow > deadline ? simNow : deadline;
+			SIM_UpdateCore();
+			SIM_Yield();
+			continue;
+		}
+		simNow = next > simNow ? next : simNow;
+		SIM_ProcessEvents();
+		SIM_Dispatch();
+	}
+	
+	SIM_Leave();
+}
+
+void __disable_irq(void)
+{
+	SIM_Enter();
+	primask = 1;
+	SIM_Leave();
+}
+
+void __enable_irq(void)
+{
+	SIM_Enter();
+	primask = 0;
+	SIM_Leave();
+}
+
+uint32_t __get_PRIMASK(void)
+{
+	uint32_t value;
+	
+	SIM_Enter();
+	value = primask;
+	SIM_Leave();
+	return value;
+}
+
+void __set_PRIMASK(uint32_t priMask)
+{
+	SIM_Enter();
+	primask = priMask & 1;
+	SIM_Leave();
+}
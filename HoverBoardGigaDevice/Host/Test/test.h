@@ -0,0 +1,77 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Minimal test helpers of the host tests, every test is its own program
+
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+
+static int testChecks = 0;
+static int testFailures = 0;
+
+//----------------------------------------------------------------------------
+// Checks condition, failures are printed and counted
+//----------------------------------------------------------------------------
+#define CHECK(condition) \
+	do \
+	{ \
+		testChecks++; \
+		if (!(condition)) \
+		{ \
+			testFailures++; \
+			printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+		} \
+	} while (0)
+
+//----------------------------------------------------------------------------
+// Checks integer value against expected range (min and max included)
+//----------------------------------------------------------------------------
+#define CHECK_RANGE(value, min, max) \
+	do \
+	{ \
+		long long checkValue = (long long)(value); \
+		testChecks++; \
+		if (checkValue < (long long)(min) || checkValue > (long long)(max)) \
+		{ \
+			testFailures++; \
+			printf("%s:%d: check failed: %s = %lld not in [%lld, %lld]\n", __FILE__, __LINE__, #value, \
+				checkValue, (long long)(min), (long long)(max)); \
+		} \
+	} while (0)
+
+//----------------------------------------------------------------------------
+// Prints result, returns exit code of the test program
+//----------------------------------------------------------------------------
+#define TEST_RESULT() \
+	(printf("%d checks, %d failed\n", testChecks, testFailures), testFailures > 0 ? 1 : 0)
+
+#endif
@@ -0,0 +1,135 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Checks the table driven CalcCRC against the former bit by bit calculation
+// and compares their speed on the host
+
+#include "../../Inc/comms.h"
+#include "test.h"
+
+#include <time.h>
+
+#define RANDOM_FRAMES 1000000
+#define BENCHMARK_FRAMES 1000000
+#define BENCHMARK_FRAME_BYTES 8
+
+static uint32_t random_state = 1;
+volatile uint16_t benchmarkResult;
+
+
+//----------------------------------------------------------------------------
+// Returns pseudo random number (reproducible)
+//----------------------------------------------------------------------------
+static uint32_t Random(void)
+{
+	random_state = random_state * 1103515245 + 12345;
+	return (random_state >> 16) & 0x7FFF;
+}
+
+//----------------------------------------------------------------------------
+// Former CRC calculation (CRC-CCITT bit by bit), reference of the test
+//----------------------------------------------------------------------------
+static uint16_t CalcCRCBitwise(uint8_t *ptr, int count)
+{
+  uint16_t  crc;
+  uint8_t i;
+  crc = 0;
+  while (--count >= 0)
+  {
+    crc = crc ^ (uint16_t) *ptr++ << 8;
+    i = 8;
+    do
+    {
+      if (crc & 0x8000)
+      {
+        crc = crc << 1 ^ 0x1021;
+      }
+      else
+      {
+        crc = crc << 1;
+      }
+    } while(--i);
+  }
+  return (crc);
+}
+
+//----------------------------------------------------------------------------
+// Returns nanoseconds per call of a CRC function on a steering frame
+//----------------------------------------------------------------------------
+static double Benchmark(uint16_t (*function)(uint8_t *, int))
+{
+	uint8_t frame[BENCHMARK_FRAME_BYTES] = {'/', 0x01, 0xF4, 0xFF, 0x38};
+	struct timespec start;
+	struct timespec stop;
+	uint32_t index;
+	
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (index = 0; index < BENCHMARK_FRAMES; index++)
+	{
+		frame[1] = (uint8_t)index;
+		benchmarkResult = function(frame, BENCHMARK_FRAME_BYTES - 3);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &stop);
+	return ((stop.tv_sec - start.tv_sec) * 1e9 + (stop.tv_nsec - start.tv_nsec)) / BENCHMARK_FRAMES;
+}
+
+int main(void)
+{
+	uint8_t check[] = "123456789";
+	uint8_t frame[64];
+	uint32_t index;
+	uint8_t length;
+	uint8_t byte;
+	int errors = 0;
+	
+	// Check value of CRC-16/XMODEM (polynomial 0x1021, initial value 0)
+	CHECK(CalcCRC(check, 9) == 0x31C3);
+	CHECK(CalcCRC(check, 0) == 0);
+	
+	// Bit identical to the former calculation
+	for (index = 0; index < RANDOM_FRAMES; index++)
+	{
+		length = (uint8_t)(Random() % sizeof(frame));
+		for (byte = 0; byte < length; byte++)
+		{
+			frame[byte] = (uint8_t)Random();
+		}
+		if (CalcCRC(frame, length) != CalcCRCBitwise(frame, length))
+		{
+			errors++;
+		}
+	}
+	CHECK(errors == 0);
+	
+	printf("CRC of a %d byte frame: bitwise %.1f ns, table %.1f ns\n", BENCHMARK_FRAME_BYTES - 3,
+		Benchmark(CalcCRCBitwise), Benchmark(CalcCRC));
+	
+	return TEST_RESULT();
+}
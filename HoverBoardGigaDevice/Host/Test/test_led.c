@@ -0,0 +1,232 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Compares the RGB LED outputs of the slave (TIMER1 PWM and the mosfet
+// output switched per period) with the former software PWM: counters of
+// 256 steps in the 32kHz calculation ISR, high while below setValue
+
+#include "../Inc/sim.h"
+#include "../../Inc/setup.h"
+#include "../../Inc/defines.h"
+#include "../../Inc/led.h"
+#include "test.h"
+
+#include <stdlib.h>
+
+#define FORMER_PWM_CYCLES (SIM_CORE_CLOCK / 32000)	// Step of the former software PWM
+#define LED_PERIOD_STEPS 256
+
+int FirmwareMain(void);
+
+extern uint8_t setValue_Red;
+extern uint8_t setValue_Green;
+extern uint8_t setValue_Blue;
+
+// High time of the three outputs
+typedef struct
+{
+	uint32_t upper;
+	uint32_t lower;
+	uint32_t mosfet;
+} LED_DUTY;
+
+//----------------------------------------------------------------------------
+// Runs to the middle of the next timer step, returns its start
+//----------------------------------------------------------------------------
+static uint64_t AlignToStep(void)
+{
+	uint32_t tick = SIM_GetTimerTickCycles(TIMER_LED);
+	uint64_t start = SIM_Cycles() - SIM_Cycles() % tick + tick;
+	
+	SIM_Run(start + tick / 2 - SIM_Cycles());
+	return start;
+}
+
+//----------------------------------------------------------------------------
+// Runs to the middle of timer step (calls overrun their deadline by a few
+// cycles, so every step is sampled at its absolute time)
+//----------------------------------------------------------------------------
+static void RunToStep(uint64_t start, uint32_t step)
+{
+	uint32_t tick = SIM_GetTimerTickCycles(TIMER_LED);
+	uint64_t target = start + (uint64_t)step * tick + tick / 2;
+	
+	if (target > SIM_Cycles())
+	{
+		SIM_Run(target - SIM_Cycles());
+	}
+}
+
+//----------------------------------------------------------------------------
+// Counts timer steps the timer outputs are high during one LED period and
+// the periods the mosfet output is high (sampled in the middle)
+//----------------------------------------------------------------------------
+static LED_DUTY Measure(uint32_t mosfetPeriods)
+{
+	LED_DUTY duty = {0};
+	uint64_t start = AlignToStep();
+	uint32_t step;
+	
+	for (step = 0; step < LED_PERIOD_STEPS; step++)
+	{
+		RunToStep(start, step);
+		duty.upper += SIM_GetPin(UPPER_LED_PORT, UPPER_LED_PIN) == SET;
+		duty.lower += SIM_GetPin(LOWER_LED_PORT, LOWER_LED_PIN) == SET;
+	}
+	for (step = 0; step < mosfetPeriods; step++)
+	{
+		RunToStep(start, (step + 1) * LED_PERIOD_STEPS + LED_PERIOD_STEPS / 2);
+		duty.mosfet += SIM_GetPin(MOSFET_OUT_PORT, MOSFET_OUT_PIN) == SET;
+	}
+	return duty;
+}
+
+//----------------------------------------------------------------------------
+// Constant set values: the timer outputs are high for exactly setValue of
+// 256 steps, like the software counters, the mosfet output for setValue of
+// 256 periods
+//----------------------------------------------------------------------------
+static void TestConstant(void)
+{
+	LED_DUTY duty;
+	uint16_t hue;
+	uint8_t brightness;
+	int errors = 0;
+	
+	SetRGBProgram(LED_HSB);
+	SetHSBSaturation(128);
+	for (hue = 0; hue <= 764; hue += 51)
+	{
+		for (brightness = 0; brightness < 64; brightness += 9)
+		{
+			SetHSBHue(hue);
+			SetHSBBrightness(brightness);
+			
+			// New values take effect with the next period
+			SIM_RunMs(2);
+			duty = Measure(LED_PERIOD_STEPS);
+			if (duty.upper != setValue_Red || duty.lower != setValue_Green || duty.mosfet != setValue_Blue)
+			{
+				printf("hue %u brightness %u: %u %u %u measured %u %u %u\n", hue, brightness, setValue_Red, setValue_Green, setValue_Blue, duty.upper, duty.lower, duty.mosfet);
+				errors++;
+			}
+		}
+	}
+	CHECK(errors == 0);
+}
+
+//----------------------------------------------------------------------------
+// Runs LED program for number of milliseconds, returns high time of the
+// outputs and of the former software PWM (in timer steps, the former steps
+// are scaled to timer steps)
+//----------------------------------------------------------------------------
+static void RunProgram(LED_PROGRAM program, uint32_t ms, LED_DUTY *duty, LED_DUTY *former)
+{
+	uint32_t tick = SIM_GetTimerTickCycles(TIMER_LED);
+	uint32_t steps = (uint64_t)ms * (SIM_CORE_CLOCK / 1000) / tick;
+	uint64_t start;
+	uint64_t formerNext;
+	uint8_t counter = 0;
+	uint32_t step;
+	double formerUpper = 0;
+	double formerLower = 0;
+	double formerMosfet = 0;
+	
+	SetRGBProgram(program);
+	*duty = (LED_DUTY){0};
+	
+	start = AlignToStep();
+	formerNext = start;
+	for (step = 0; step < steps; step++)
+	{
+		RunToStep(start, step);
+		duty->upper += SIM_GetPin(UPPER_LED_PORT, UPPER_LED_PIN) == SET;
+		duty->lower += SIM_GetPin(LOWER_LED_PORT, LOWER_LED_PIN) == SET;
+		duty->mosfet += SIM_GetPin(MOSFET_OUT_PORT, MOSFET_OUT_PIN) == SET;
+		
+		// Former software PWM with the set values of the same time
+		while (formerNext <= start + (uint64_t)step * tick + tick / 2)
+		{
+			counter++;
+			formerUpper += counter >= setValue_Red ? 0 : 1;
+			formerLower += counter >= setValue_Green ? 0 : 1;
+			formerMosfet += counter >= setValue_Blue ? 0 : 1;
+			formerNext += FORMER_PWM_CYCLES;
+		}
+	}
+	former->upper = formerUpper * FORMER_PWM_CYCLES / tick + 0.5;
+	former->lower = formerLower * FORMER_PWM_CYCLES / tick + 0.5;
+	former->mosfet = formerMosfet * FORMER_PWM_CYCLES / tick + 0.5;
+}
+
+//----------------------------------------------------------------------------
+// All LED programs keep their duty cycles: high time over two seconds
+// differs by less than one period of the former software PWM (8ms, the
+// programs change the set values while it runs)
+//----------------------------------------------------------------------------
+static void TestPrograms(void)
+{
+	LED_PROGRAM program;
+	LED_DUTY duty;
+	LED_DUTY former;
+	uint32_t tolerance = LED_PERIOD_STEPS * FORMER_PWM_CYCLES / SIM_GetTimerTickCycles(TIMER_LED);
+	
+	SetHSBHue(100);
+	SetHSBSaturation(100);
+	SetHSBBrightness(40);
+	SetSpeedBlink(200);
+	SetSpeedFading(2);
+	SetSpeedStrobe(40);
+	for (program = LED_OFF; program <= LED_HSB_STROBE; program++)
+	{
+		RunProgram(program, 2000, &duty, &former);
+		printf("program %d: upper %u/%u, lower %u/%u, mosfet %u/%u steps\n", program,
+			duty.upper, former.upper, duty.lower, former.lower, duty.mosfet, former.mosfet);
+		CHECK_RANGE(duty.upper, (int32_t)former.upper - (int32_t)tolerance, former.upper + tolerance);
+		CHECK_RANGE(duty.lower, (int32_t)former.lower - (int32_t)tolerance, former.lower + tolerance);
+		CHECK_RANGE(duty.mosfet, (int32_t)former.mosfet - (int32_t)tolerance, former.mosfet + tolerance);
+		if (program != LED_OFF)
+		{
+			CHECK(duty.upper + duty.lower + duty.mosfet > 0);
+		}
+	}
+}
+
+int main(void)
+{
+	SIM_SetPowerPin(SELF_HOLD_PORT, SELF_HOLD_PIN);
+	SIM_Start(FirmwareMain);
+	SIM_RunMs(100);
+	
+	TestConstant();
+	TestPrograms();
+	
+	return TEST_RESULT();
+}
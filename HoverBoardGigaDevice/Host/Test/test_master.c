@@ -0,0 +1,287 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Runs the complete master firmware on the simulated board: power up with
+// the button, steering requests and slave frames, timeouts and power off.
+// Every scenario runs in its own process, so it starts from reset state.
+
+#include "../Inc/sim.h"
+#include "../../Inc/setup.h"
+#include "../../Inc/defines.h"
+#include "../../Inc/comms.h"
+#include "test.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define SLAVE_FRAME_BYTES 25						// Master to slave frame
+#define STEER_FRAME_BYTES 9							// Frame of the steering device
+#define VBATT_36V 1489									// ADC value of a 36V battery
+#define VBATT_28V 1150									// ADC value of a 28V battery (below BAT_LOW_DEAD)
+
+int FirmwareMain(void);
+
+// Slave frames sent by the master
+typedef struct
+{
+	uint32_t count;
+	uint32_t invalid;
+	int16_t pwm;
+	uint8_t flags;
+	uint8_t data[4096];								// Bytes of the frame still being sent
+	uint16_t length;
+} SLAVE_FRAMES;
+
+//----------------------------------------------------------------------------
+// Powers the board up: button is held while the firmware starts, released
+// after 500ms (the master waits for it before it starts its tasks)
+//----------------------------------------------------------------------------
+static void PowerUp(uint16_t vbatt)
+{
+	SIM_SetPowerPin(SELF_HOLD_PORT, SELF_HOLD_PIN);
+	SIM_SetPin(BUTTON_PORT, BUTTON_PIN, SET);
+	SIM_SetPin(CHARGE_STATE_PORT, CHARGE_STATE_PIN, SET);
+	SIM_SetPin(HALL_A_PORT, HALL_A_PIN, SET);
+	SIM_SetAdc(VBATT_CHANNEL, vbatt);
+	SIM_SetAdc(CURRENT_DC_CHANNEL, 2000);
+	SIM_Start(FirmwareMain);
+	SIM_RunMs(500);
+	SIM_SetPin(BUTTON_PORT, BUTTON_PIN, RESET);
+}
+
+//----------------------------------------------------------------------------
+// Parses the slave frames sent since the last call
+//----------------------------------------------------------------------------
+static void ReadSlaveFrames(SLAVE_FRAMES *frames)
+{
+	uint16_t length = frames->length + SIM_UsartTransmitted(USART_MASTERSLAVE, &frames->data[frames->length], sizeof(frames->data) - frames->length);
+	uint8_t *data = frames->data;
+	uint16_t index = 0;
+	uint16_t crc;
+	
+	while (index + SLAVE_FRAME_BYTES <= length)
+	{
+		crc = CalcCRC(&data[index], SLAVE_FRAME_BYTES - 3);
+		if (data[index] != '/' || data[index + 1] != 3 || data[index + SLAVE_FRAME_BYTES - 1] != '\n' ||
+			data[index + SLAVE_FRAME_BYTES - 3] != ((crc >> 8) & 0xFF) || data[index + SLAVE_FRAME_BYTES - 2] != (crc & 0xFF))
+		{
+			frames->invalid++;
+			index++;
+			continue;
+		}
+		frames->pwm = (int16_t)((data[index + 2] << 8) | data[index + 3]);
+		frames->flags = data[index + 4];
+		frames->count++;
+		index += SLAVE_FRAME_BYTES;
+	}
+	
+	// Keep the frame not sent completely yet
+	frames->length = length - index;
+	memmove(data, &data[index], frames->length);
+}
+
+//----------------------------------------------------------------------------
+// Returns number of steering requests ("/\n") sent since the last call
+//----------------------------------------------------------------------------
+static uint32_t ReadSteerRequests(void)
+{
+	uint8_t data[4096];
+	uint16_t length = SIM_UsartTransmitted(USART_STEER_COM, data, sizeof(data));
+	uint16_t index;
+	uint32_t count = 0;
+	
+	for (index = 0; index + 1 < length; index++)
+	{
+		if (data[index] == '/' && data[index + 1] == '\n')
+		{
+			count++;
+		}
+	}
+	return count;
+}
+
+//----------------------------------------------------------------------------
+// Sends frame of the steering device
+//----------------------------------------------------------------------------
+static void SendSteerFrame(int16_t speedValue, int16_t steerValue)
+{
+	uint8_t buffer[STEER_FRAME_BYTES];
+	uint8_t index = 0;
+	uint16_t crc;
+	
+	buffer[index++] = '/';
+	buffer[index++] = ((uint16_t)speedValue >> 8) & 0xFF;
+	buffer[index++] = (uint16_t)speedValue & 0xFF;
+	buffer[index++] = ((uint16_t)steerValue >> 8) & 0xFF;
+	buffer[index++] = (uint16_t)steerValue & 0xFF;
+	buffer[index++] = 0;
+	crc = CalcCRC(buffer, index);
+	buffer[index++] = (crc >> 8) & 0xFF;
+	buffer[index++] = crc & 0xFF;
+	buffer[index++] = '\n';
+	SIM_UsartReceive(USART_STEER_COM, buffer, index);
+}
+
+//----------------------------------------------------------------------------
+// Idle board: tasks run with their periods, interrupts with their rates,
+// the watchdog is served
+//----------------------------------------------------------------------------
+static void ScenarioIdle(void)
+{
+	SLAVE_FRAMES frames = {0};
+	uint32_t systick;
+	uint32_t adc;
+	
+	PowerUp(VBATT_36V);
+	SIM_RunMs(500);
+	ReadSlaveFrames(&frames);
+	ReadSteerRequests();
+	frames.count = 0;
+	
+	systick = SIM_GetIrqCount(SysTick_IRQn);
+	adc = SIM_GetIrqCount(ADC_CMP_IRQn);
+	SIM_RunMs(4000);
+	CHECK(SIM_GetState() == SIM_STATE_RUNNING);
+	CHECK_RANGE(SIM_GetIrqCount(SysTick_IRQn) - systick, 3999, 4001);
+	CHECK_RANGE(SIM_GetIrqCount(ADC_CMP_IRQn) - adc, 127990, 128010);
+	
+	// Steering requests every 100ms, slave frames every 50ms
+	CHECK_RANGE(ReadSteerRequests(), 39, 41);
+	ReadSlaveFrames(&frames);
+	CHECK_RANGE(frames.count, 79, 81);
+	CHECK(frames.invalid == 0);
+	
+	// No steering device: slave is not enabled, master outputs are off
+	CHECK(frames.pwm == 0);
+	CHECK((frames.flags & BIT(0)) == 0);
+	CHECK(SIM_GetTimerOutputEnabled(TIMER_BLDC) == RESET);
+}
+
+//----------------------------------------------------------------------------
+// Steering frames drive both boards, outputs go off after their timeout
+//----------------------------------------------------------------------------
+static void ScenarioSteering(void)
+{
+	SLAVE_FRAMES frames = {0};
+	uint32_t time;
+	
+	PowerUp(VBATT_36V);
+	SIM_RunMs(500);
+	
+	// Steering device answers every request
+	for (time = 0; time < 2000; time += 100)
+	{
+		SendSteerFrame(500, 0);
+		SIM_RunMs(100);
+	}
+	frames.count = 0;
+	ReadSlaveFrames(&frames);
+	CHECK(frames.count > 0);
+	CHECK(frames.invalid == 0);
+	CHECK(frames.pwm == 500);
+	CHECK((frames.flags & BIT(0)) != 0);
+	CHECK(SIM_GetTimerOutputEnabled(TIMER_BLDC) == SET);
+	
+	// Steering device is gone: both boards are switched off after TIMEOUT_MS
+	SIM_RunMs(TIMEOUT_MS - 200);
+	ReadSlaveFrames(&frames);
+	CHECK((frames.flags & BIT(0)) != 0);
+	SIM_RunMs(400);
+	ReadSlaveFrames(&frames);
+	CHECK((frames.flags & BIT(0)) == 0);
+	CHECK(SIM_GetTimerOutputEnabled(TIMER_BLDC) == RESET);
+	CHECK(SIM_GetState() == SIM_STATE_RUNNING);
+}
+
+//----------------------------------------------------------------------------
+// Button press turns both boards off after the shutdown sound
+//----------------------------------------------------------------------------
+static void ScenarioButton(void)
+{
+	SLAVE_FRAMES frames = {0};
+	
+	PowerUp(VBATT_36V);
+	SIM_RunMs(1000);
+	
+	SIM_SetPin(BUTTON_PORT, BUTTON_PIN, SET);
+	SIM_RunMs(200);
+	CHECK(SIM_GetState() == SIM_STATE_RUNNING);
+	SIM_SetPin(BUTTON_PORT, BUTTON_PIN, RESET);
+	SIM_RunMs(2000);
+	CHECK(SIM_GetState() == SIM_STATE_POWER_OFF);
+	
+	// Last frame tells the slave to shut off
+	ReadSlaveFrames(&frames);
+	CHECK(frames.invalid == 0);
+	CHECK((frames.flags & BIT(7)) != 0);
+}
+
+//----------------------------------------------------------------------------
+// Dead battery turns the board off
+//----------------------------------------------------------------------------
+static void ScenarioDeadBattery(void)
+{
+	PowerUp(VBATT_28V);
+	SIM_RunMs(8000);
+	CHECK(SIM_GetState() == SIM_STATE_POWER_OFF);
+}
+
+//----------------------------------------------------------------------------
+// Runs scenario in a child process, returns SET when it passed
+//----------------------------------------------------------------------------
+static FlagStatus RunScenario(const char *name, void (*scenario)(void))
+{
+	int status = 0;
+	pid_t pid;
+	
+	printf("%s: ", name);
+	fflush(stdout);
+	pid = fork();
+	if (pid == 0)
+	{
+		testChecks = 0;
+		testFailures = 0;
+		scenario();
+		exit(TEST_RESULT());
+	}
+	waitpid(pid, &status, 0);
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? SET : RESET;
+}
+
+int main(void)
+{
+	CHECK(RunScenario("idle", ScenarioIdle) == SET);
+	CHECK(RunScenario("steering", ScenarioSteering) == SET);
+	CHECK(RunScenario("button", ScenarioButton) == SET);
+	CHECK(RunScenario("dead battery", ScenarioDeadBattery) == SET);
+	return TEST_RESULT();
+}
@@ -0,0 +1,288 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Round trip of the master-slave frames (see MasterSlaveProtocol.md): the
+// master frame is captured on the USART, slave frames are fed to the master
+// parser, telemetry is encoded and decoded
+
+#include "../Inc/sim.h"
+#include "../../Inc/setup.h"
+#include "../../Inc/defines.h"
+#include "../../Inc/comms.h"
+#include "../../Inc/commsMasterSlave.h"
+#include "../../Inc/bldc.h"
+#include "test.h"
+
+#include <string.h>
+
+#define SLAVE_FRAME_BYTES (8 + MASTERSLAVE_TELEMETRY_BYTES + 4)		// Master to slave
+#define MASTER_FRAME_BYTES (6 + MASTERSLAVE_TELEMETRY_BYTES + 4)	// Slave to master
+#define MASTERSLAVE_BYTE_CYCLES (SIM_CORE_CLOCK / 115200 * 10)
+
+extern int32_t currentDCFiltered_mA;
+extern int32_t batteryVoltage_mV;
+extern int32_t realSpeed_mh;
+extern int32_t temperature_dC;
+extern uint8_t slaveError;
+
+static uint32_t random_state = 4711;
+
+//----------------------------------------------------------------------------
+// Returns pseudo random number (reproducible)
+//----------------------------------------------------------------------------
+static uint32_t Random(void)
+{
+	random_state = random_state * 1103515245 + 12345;
+	return (random_state >> 16) & 0x7FFF;
+}
+
+//----------------------------------------------------------------------------
+// Returns random telemetry
+//----------------------------------------------------------------------------
+static MASTERSLAVE_TELEMETRY RandomTelemetry(void)
+{
+	MASTERSLAVE_TELEMETRY telemetry;
+	
+	telemetry.currentDC = (int16_t)(Random() << 1 ^ Random());
+	telemetry.battery = (int16_t)(Random() << 1 ^ Random());
+	telemetry.realSpeed = (int16_t)(Random() << 1 ^ Random());
+	telemetry.temperature = (int16_t)(Random() << 1 ^ Random());
+	telemetry.faults = Random() & 0xFF;
+	telemetry.hall = Random() & 0x07;
+	telemetry.hallLearnState = Random() & 0xFF;
+	telemetry.isrLoad = (int16_t)(Random() << 1 ^ Random());
+	return telemetry;
+}
+
+//----------------------------------------------------------------------------
+// Returns SET when telemetries are equal
+//----------------------------------------------------------------------------
+static FlagStatus TelemetryEqual(const MASTERSLAVE_TELEMETRY *a, const MASTERSLAVE_TELEMETRY *b)
+{
+	return a->currentDC == b->currentDC && a->battery == b->battery && a->realSpeed == b->realSpeed &&
+		a->temperature == b->temperature && a->faults == b->faults && a->hall == b->hall &&
+		a->hallLearnState == b->hallLearnState && a->isrLoad == b->isrLoad ? SET : RESET;
+}
+
+//----------------------------------------------------------------------------
+// Runs until queued bytes are received and sent frames have left the USART
+//----------------------------------------------------------------------------
+static void RunUntilIdle(void)
+{
+	while (SIM_UsartReceivePending(USART_MASTERSLAVE) > 0)
+	{
+		SIM_Run(MASTERSLAVE_BYTE_CYCLES);
+	}
+	SIM_Run((SLAVE_FRAME_BYTES + 2) * MASTERSLAVE_BYTE_CYCLES);
+}
+
+//----------------------------------------------------------------------------
+// Sends master frame and captures it, returns SET when one valid frame has
+// been sent
+//----------------------------------------------------------------------------
+static FlagStatus CaptureSlaveFrame(uint8_t frame[], int16_t pwm, FlagStatus enable, FlagStatus shutoff, uint8_t identifier, int16_t value)
+{
+	uint8_t data[64];
+	uint16_t length;
+	uint16_t crc;
+	
+	SendSlave(pwm, enable, shutoff, SET, RESET, identifier, value);
+	RunUntilIdle();
+	length = SIM_UsartTransmitted(USART_MASTERSLAVE, data, sizeof(data));
+	if (length != SLAVE_FRAME_BYTES)
+	{
+		return RESET;
+	}
+	memcpy(frame, data, length);
+	crc = CalcCRC(frame, SLAVE_FRAME_BYTES - 3);
+	return frame[0] == '/' && frame[1] == MASTERSLAVE_PROTOCOL_VERSION && frame[SLAVE_FRAME_BYTES - 1] == '\n' &&
+		frame[SLAVE_FRAME_BYTES - 3] == ((crc >> 8) & 0xFF) && frame[SLAVE_FRAME_BYTES - 2] == (crc & 0xFF) ? SET : RESET;
+}
+
+//----------------------------------------------------------------------------
+// Builds frame of the slave, returns its length
+//----------------------------------------------------------------------------
+static uint8_t BuildMasterFrame(uint8_t buffer[], uint8_t flags, uint8_t faultsReceived, const MASTERSLAVE_TELEMETRY *telemetry)
+{
+	uint8_t index = 0;
+	uint16_t crc;
+	
+	buffer[index++] = '/';
+	buffer[index++] = MASTERSLAVE_PROTOCOL_VERSION;
+	buffer[index++] = flags;
+	buffer[index++] = faultsReceived;
+	buffer[index++] = PARAM_NONE;
+	buffer[index++] = 0;
+	buffer[index++] = 0;
+	index += EncodeTelemetry(&buffer[index], telemetry);
+	crc = CalcCRC(buffer, index);
+	buffer[index++] = (crc >> 8) & 0xFF;
+	buffer[index++] = crc & 0xFF;
+	buffer[index++] = '\n';
+	return index;
+}
+
+//----------------------------------------------------------------------------
+// Telemetry survives encoding, fields are big endian
+//----------------------------------------------------------------------------
+static void TestTelemetry(void)
+{
+	MASTERSLAVE_TELEMETRY telemetry;
+	MASTERSLAVE_TELEMETRY decoded;
+	uint8_t buffer[MASTERSLAVE_TELEMETRY_BYTES + 1];
+	uint16_t index;
+	int errors = 0;
+	
+	for (index = 0; index < 10000; index++)
+	{
+		telemetry = RandomTelemetry();
+		memset(&decoded, 0, sizeof(decoded));
+		buffer[MASTERSLAVE_TELEMETRY_BYTES] = 0xA5;
+		if (EncodeTelemetry(buffer, &telemetry) != MASTERSLAVE_TELEMETRY_BYTES || buffer[MASTERSLAVE_TELEMETRY_BYTES] != 0xA5)
+		{
+			errors++;
+		}
+		DecodeTelemetry(buffer, &decoded);
+		if (TelemetryEqual(&telemetry, &decoded) == RESET)
+		{
+			errors++;
+		}
+	}
+	CHECK(errors == 0);
+	
+	telemetry.battery = 3600;
+	EncodeTelemetry(buffer, &telemetry);
+	CHECK(buffer[2] == 0x0E && buffer[3] == 0x10);
+}
+
+//----------------------------------------------------------------------------
+// Master frame carries command, process values and the general value
+//----------------------------------------------------------------------------
+static void TestSlaveFrame(void)
+{
+	uint8_t frame[SLAVE_FRAME_BYTES];
+	MASTERSLAVE_TELEMETRY telemetry;
+	
+	currentDCFiltered_mA = -12345;
+	batteryVoltage_mV = 36120;
+	realSpeed_mh = -15000;
+	temperature_dC = 412;
+	
+	CHECK(CaptureSlaveFrame(frame, -400, SET, RESET, 7, -1234) == SET);
+	CHECK((int16_t)((frame[2] << 8) | frame[3]) == -400);
+	CHECK(frame[4] == (BIT(1) | BIT(0)));
+	CHECK(frame[5] == 0);
+	DecodeTelemetry(&frame[6], &telemetry);
+	CHECK(telemetry.currentDC == 1234);
+	CHECK(telemetry.battery == 3612);
+	CHECK(telemetry.realSpeed == -1500);
+	CHECK(telemetry.temperature == 412);
+	CHECK((telemetry.faults & BLDC_FAULT_TIMEOUT) != 0);
+	CHECK(frame[6 + MASTERSLAVE_TELEMETRY_BYTES] == 7);
+	CHECK((int16_t)((frame[7 + MASTERSLAVE_TELEMETRY_BYTES] << 8) | frame[8 + MASTERSLAVE_TELEMETRY_BYTES]) == -1234);
+	
+	// Pwm is limited, shut off is bit 7
+	CHECK(CaptureSlaveFrame(frame, 5000, RESET, SET, 0, 0) == SET);
+	CHECK((int16_t)((frame[2] << 8) | frame[3]) == 1000);
+	CHECK(frame[4] == (BIT(7) | BIT(1)));
+}
+
+//----------------------------------------------------------------------------
+// Slave frame is decoded by the master, its faults are acknowledged once
+//----------------------------------------------------------------------------
+static void TestMasterFrame(void)
+{
+	uint8_t buffer[MASTER_FRAME_BYTES];
+	uint8_t frame[SLAVE_FRAME_BYTES];
+	MASTERSLAVE_TELEMETRY telemetry;
+	MASTERSLAVE_TELEMETRY received;
+	uint8_t length;
+	uint16_t index;
+	int errors = 0;
+	
+	for (index = 0; index < 200; index++)
+	{
+		telemetry = RandomTelemetry();
+		length = BuildMasterFrame(buffer, 0, 0, &telemetry);
+		SIM_UsartReceive(USART_MASTERSLAVE, buffer, length);
+		RunUntilIdle();
+		GetTelemetrySlave(&received);
+		if (TelemetryEqual(&telemetry, &received) == RESET || slaveError != telemetry.faults)
+		{
+			errors++;
+		}
+	}
+	CHECK(errors == 0);
+	
+	// LEDs and mosfet output of the master are set by the slave
+	telemetry.faults = BLDC_FAULT_OVERCURRENT;
+	length = BuildMasterFrame(buffer, BIT(2) | BIT(0), 0, &telemetry);
+	SIM_UsartReceive(USART_MASTERSLAVE, buffer, length);
+	RunUntilIdle();
+	CHECK(SIM_GetPin(UPPER_LED_PORT, UPPER_LED_PIN) == SET);
+	CHECK(SIM_GetPin(LOWER_LED_PORT, LOWER_LED_PIN) == RESET);
+	CHECK(SIM_GetPin(MOSFET_OUT_PORT, MOSFET_OUT_PIN) == SET);
+	
+	// Received faults are sent back with the next frame only
+	CHECK(CaptureSlaveFrame(frame, 0, SET, RESET, 0, 0) == SET);
+	CHECK(frame[5] == BLDC_FAULT_OVERCURRENT);
+	CHECK(CaptureSlaveFrame(frame, 0, SET, RESET, 0, 0) == SET);
+	CHECK(frame[5] == 0);
+	
+	// Corrupted frame is dropped
+	telemetry.battery++;
+	length = BuildMasterFrame(buffer, 0, 0, &telemetry);
+	buffer[10] ^= 0x01;
+	SIM_UsartReceive(USART_MASTERSLAVE, buffer, length);
+	RunUntilIdle();
+	GetTelemetrySlave(&received);
+	CHECK(received.battery == telemetry.battery - 1);
+	
+	// Frame of another protocol version is dropped
+	length = BuildMasterFrame(buffer, 0, 0, &telemetry);
+	buffer[1] = MASTERSLAVE_PROTOCOL_VERSION - 1;
+	SIM_UsartReceive(USART_MASTERSLAVE, buffer, length);
+	RunUntilIdle();
+	GetTelemetrySlave(&received);
+	CHECK(received.battery == telemetry.battery - 1);
+}
+
+int main(void)
+{
+	Interrupt_init();
+	GPIO_init();
+	USART_MasterSlave_init();
+	
+	TestTelemetry();
+	TestSlaveFrame();
+	TestMasterFrame();
+	
+	return TEST_RESULT();
+}
@@ -0,0 +1,296 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Rides the master firmware on the plant model: accelerates with full input,
+// cruises with half input and stops, on flat road with both commutations and
+// up a hill. Every ride writes a trace (build/ride_<name>.csv) of speed,
+// currents, battery voltage, power and efficiency every 10ms and is checked
+// for top speed, current limit, battery sag, efficiency and standstill.
+
+#include "../Inc/sim.h"
+#include "../Inc/plant.h"
+#include "../../Inc/setup.h"
+#include "../../Inc/defines.h"
+#include "../../Inc/config.h"
+#include "../../Inc/comms.h"
+#include "../../Inc/bldc.h"
+#include "test.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define STEER_FRAME_BYTES 9							// Frame of the steering device
+#define STEER_PERIOD_MS 100							// Steering device sends every 100ms
+#define TRACE_PERIOD_MS 10							// Trace rows every 10ms
+#define ACCELERATE_MS 8000							// Full input
+#define CRUISE_MS 6000									// Half input
+#define STOP_MS 5000										// No input
+
+int FirmwareMain(void);
+
+// Ride of one scenario
+typedef struct
+{
+	const char *name;
+	COMMUTATION_MODE commutation;
+	double slope;
+} RIDE;
+
+// Results of a ride
+typedef struct
+{
+	double topSpeed;									// [km/h]
+	double currentMax;								// Highest 10ms mean of the battery current [A]
+	double voltageSag;								// Open circuit voltage minus lowest 10ms mean [V]
+	double cruiseEfficiency;					// Mechanical by battery energy while cruising
+	double cruiseCurrent;							// Mean battery current while cruising [A]
+	double endSpeed;									// [km/h]
+} RIDE_RESULT;
+
+//----------------------------------------------------------------------------
+// Sends frame of the steering device
+//----------------------------------------------------------------------------
+static void SendSteerFrame(int16_t speedValue, int16_t steerValue)
+{
+	uint8_t buffer[STEER_FRAME_BYTES];
+	uint8_t index = 0;
+	uint16_t crc;
+	
+	buffer[index++] = '/';
+	buffer[index++] = ((uint16_t)speedValue >> 8) & 0xFF;
+	buffer[index++] = (uint16_t)speedValue & 0xFF;
+	buffer[index++] = ((uint16_t)steerValue >> 8) & 0xFF;
+	buffer[index++] = (uint16_t)steerValue & 0xFF;
+	buffer[index++] = 0;
+	crc = CalcCRC(buffer, index);
+	buffer[index++] = (crc >> 8) & 0xFF;
+	buffer[index++] = crc & 0xFF;
+	buffer[index++] = '\n';
+	SIM_UsartReceive(USART_STEER_COM, buffer, index);
+}
+
+//----------------------------------------------------------------------------
+// Returns input of the steering device at the time of the ride
+//----------------------------------------------------------------------------
+static int16_t Command(uint32_t time)
+{
+	if (time < ACCELERATE_MS)
+	{
+		return 1000;
+	}
+	if (time < ACCELERATE_MS + CRUISE_MS)
+	{
+		return 500;
+	}
+	return 0;
+}
+
+//----------------------------------------------------------------------------
+// Rides the profile, writes the trace and returns the results
+//----------------------------------------------------------------------------
+static void Ride(const RIDE *ride, RIDE_RESULT *result)
+{
+	PLANT_CONFIG config;
+	PLANT_STATE last;
+	const PLANT_STATE *state = PLANT_GetState();
+	double voltageOpen;
+	double energyBattery = 0;
+	double energyMechanical = 0;
+	double powerBattery;
+	double powerMechanical;
+	double current;
+	double currentSquares = 0;
+	double voltage = 0;
+	double speed;
+	char fileName[64];
+	FILE *file;
+	uint32_t time;
+	
+	memset(result, 0, sizeof(*result));
+	snprintf(fileName, sizeof(fileName), "build/ride_%s.csv", ride->name);
+	file = fopen(fileName, "w");
+	CHECK(file != NULL);
+	if (file == NULL)
+	{
+		return;
+	}
+	fprintf(file, "time_s,command,speed_kmh,current_dc_a,current_phase_rms_a,battery_v,power_battery_w,power_mechanical_w,efficiency\n");
+	
+	// Board is on, the road starts after the firmware waited for the button
+	PLANT_GetDefaultConfig(&config);
+	PLANT_Init(&config);
+	voltageOpen = state->batteryVoltage;
+	SIM_SetPowerPin(SELF_HOLD_PORT, SELF_HOLD_PIN);
+	SIM_SetPin(BUTTON_PORT, BUTTON_PIN, SET);
+	SIM_SetPin(CHARGE_STATE_PORT, CHARGE_STATE_PIN, SET);
+	SIM_Start(FirmwareMain);
+	SIM_RunMs(500);
+	SIM_SetPin(BUTTON_PORT, BUTTON_PIN, RESET);
+	SIM_RunMs(500);
+	SetCommutationMode(ride->commutation);
+	last = *state;
+	
+	for (time = 0; time < ACCELERATE_MS + CRUISE_MS + STOP_MS; time++)
+	{
+		if (time % STEER_PERIOD_MS == 0)
+		{
+			SendSteerFrame(Command(time), 0);
+		}
+		if (time == 0)
+		{
+			// The rider stands on the hill when the motor starts
+			PLANT_SetSlope(ride->slope);
+		}
+		SIM_RunMs(1);
+		currentSquares += (state->phaseCurrent[0] * state->phaseCurrent[0] + state->phaseCurrent[1] * state->phaseCurrent[1] +
+			state->phaseCurrent[2] * state->phaseCurrent[2]) / 3;
+		voltage += state->batteryVoltage;
+		if ((time + 1) % TRACE_PERIOD_MS != 0)
+		{
+			continue;
+		}
+		
+		// Mean values of the trace period from the energies, samples would only see the ripple
+		powerBattery = (state->energyBattery - last.energyBattery) / (state->time - last.time);
+		powerMechanical = (state->energyMechanical - last.energyMechanical) / (state->time - last.time);
+		voltage /= TRACE_PERIOD_MS;
+		current = powerBattery / voltage;
+		speed = fabs(state->speed) * 3.6;
+		fprintf(file, "%.3f,%d,%.2f,%.2f,%.2f,%.2f,%.1f,%.1f,", state->time, Command(time), speed, current,
+			sqrt(currentSquares / TRACE_PERIOD_MS), voltage, powerBattery, powerMechanical);
+		if (powerBattery > 1)
+		{
+			fprintf(file, "%.3f", powerMechanical / powerBattery);
+		}
+		fprintf(file, "\n");
+		
+		result->topSpeed = fmax(result->topSpeed, speed);
+		result->currentMax = fmax(result->currentMax, current);
+		result->voltageSag = fmax(result->voltageSag, voltageOpen - voltage);
+		if (time >= ACCELERATE_MS + CRUISE_MS / 2 && time < ACCELERATE_MS + CRUISE_MS)
+		{
+			// Second half of cruising, the speed has settled
+			energyBattery += state->energyBattery - last.energyBattery;
+			energyMechanical += state->energyMechanical - last.energyMechanical;
+			result->cruiseCurrent += current / (CRUISE_MS / 2 / TRACE_PERIOD_MS);
+		}
+		result->endSpeed = speed;
+		last = *state;
+		currentSquares = 0;
+		voltage = 0;
+	}
+	fclose(file);
+	
+	result->cruiseEfficiency = energyBattery > 0 ? energyMechanical / energyBattery : 0;
+	printf("top %5.1f km/h, max %5.1f A, sag %4.1f V, cruise %4.1f A %3.0f%%, end %4.1f km/h: ", result->topSpeed,
+		result->currentMax, result->voltageSag, result->cruiseCurrent, result->cruiseEfficiency * 100, result->endSpeed);
+	CHECK(SIM_GetState() == SIM_STATE_RUNNING);
+}
+
+//----------------------------------------------------------------------------
+// Flat road with block commutation
+//----------------------------------------------------------------------------
+static void ScenarioBlock(void)
+{
+	static const RIDE ride = {"block", COMMUTATION_BLOCK, 0};
+	RIDE_RESULT result;
+	
+	Ride(&ride, &result);
+	CHECK(result.topSpeed > 18 && result.topSpeed < 30);
+	CHECK(result.currentMax < DC_CUR_LIMIT * 1.2);
+	CHECK(result.voltageSag > 1);
+	CHECK(result.cruiseEfficiency > 0.6 && result.cruiseEfficiency < 0.98);
+	CHECK(result.endSpeed < 1);
+}
+
+//----------------------------------------------------------------------------
+// Flat road with sinus commutation
+//----------------------------------------------------------------------------
+static void ScenarioSinus(void)
+{
+	static const RIDE ride = {"sinus", COMMUTATION_SINUS, 0};
+	RIDE_RESULT result;
+	
+	Ride(&ride, &result);
+	CHECK(result.topSpeed > 18 && result.topSpeed < 30);
+	CHECK(result.currentMax < DC_CUR_LIMIT * 1.2);
+	CHECK(result.voltageSag > 1);
+	CHECK(result.cruiseEfficiency > 0.6 && result.cruiseEfficiency < 0.98);
+	CHECK(result.endSpeed < 1);
+}
+
+//----------------------------------------------------------------------------
+// Hill of 6%: the current limit holds, the board is slower (the master wheel
+// turns backwards for a positive input, SPEED_COEFFICIENT)
+//----------------------------------------------------------------------------
+static void ScenarioHill(void)
+{
+	static const RIDE ride = {"hill", COMMUTATION_BLOCK, -0.06};
+	RIDE_RESULT result;
+	
+	Ride(&ride, &result);
+	CHECK(result.topSpeed > 8 && result.topSpeed < 18);
+	CHECK(result.currentMax < DC_CUR_LIMIT * 1.2);
+	CHECK(result.voltageSag > 1);
+	CHECK(result.cruiseCurrent > 2);
+}
+
+//----------------------------------------------------------------------------
+// Runs scenario in a child process, returns SET when it passed
+//----------------------------------------------------------------------------
+static FlagStatus RunScenario(const char *name, void (*scenario)(void))
+{
+	int status = 0;
+	pid_t pid;
+	
+	printf("%s: ", name);
+	fflush(stdout);
+	pid = fork();
+	if (pid == 0)
+	{
+		testChecks = 0;
+		testFailures = 0;
+		scenario();
+		exit(TEST_RESULT());
+	}
+	waitpid(pid, &status, 0);
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? SET : RESET;
+}
+
+int main(void)
+{
+	CHECK(RunScenario("block", ScenarioBlock) == SET);
+	CHECK(RunScenario("sinus", ScenarioSinus) == SET);
+	CHECK(RunScenario("hill", ScenarioHill) == SET);
+	return TEST_RESULT();
+}
@@ -0,0 +1,276 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Runs the complete slave firmware on the simulated board: master frames,
+// answers, timeout and shut off command
+
+#include "../Inc/sim.h"
+#include "../../Inc/setup.h"
+#include "../../Inc/defines.h"
+#include "../../Inc/comms.h"
+#include "test.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define SLAVE_FRAME_BYTES 25						// Master to slave frame
+#define MASTER_FRAME_BYTES 23						// Slave to master frame
+#define TELEMETRY_BYTES 13
+#define PROTOCOL_VERSION 3
+
+int FirmwareMain(void);
+
+//----------------------------------------------------------------------------
+// Powers the board up (the slave is held by the master, no button)
+//----------------------------------------------------------------------------
+static void PowerUp(void)
+{
+	SIM_SetPowerPin(SELF_HOLD_PORT, SELF_HOLD_PIN);
+	SIM_SetPin(HALL_A_PORT, HALL_A_PIN, SET);
+	SIM_SetAdc(VBATT_CHANNEL, 1489);
+	SIM_SetAdc(CURRENT_DC_CHANNEL, 2000);
+	SIM_Start(FirmwareMain);
+	SIM_RunMs(500);
+}
+
+//----------------------------------------------------------------------------
+// Sends frame of the master
+//----------------------------------------------------------------------------
+static void SendMasterFrame(uint8_t version, int16_t pwm, FlagStatus enable, FlagStatus shutoff)
+{
+	uint8_t buffer[SLAVE_FRAME_BYTES] = {0};
+	uint8_t index = 0;
+	uint16_t crc;
+	
+	buffer[index++] = '/';
+	buffer[index++] = version;
+	buffer[index++] = ((uint16_t)pwm >> 8) & 0xFF;
+	buffer[index++] = (uint16_t)pwm & 0xFF;
+	buffer[index++] = (shutoff << 7) | (SET << 1) | (enable << 0);
+	buffer[index++] = 0;
+	index += TELEMETRY_BYTES;
+	buffer[index++] = 0;
+	buffer[index++] = 0;
+	buffer[index++] = 0;
+	crc = CalcCRC(buffer, index);
+	buffer[index++] = (crc >> 8) & 0xFF;
+	buffer[index++] = crc & 0xFF;
+	buffer[index++] = '\n';
+	SIM_UsartReceive(USART_MASTERSLAVE, buffer, index);
+}
+
+//----------------------------------------------------------------------------
+// Returns number of valid answers sent since the last call, invalid bytes
+// are counted
+//----------------------------------------------------------------------------
+static uint32_t ReadAnswers(uint32_t *invalid)
+{
+	uint8_t data[4096];
+	uint16_t length = SIM_UsartTransmitted(USART_MASTERSLAVE, data, sizeof(data));
+	uint16_t index = 0;
+	uint32_t count = 0;
+	uint16_t crc;
+	
+	while (index + MASTER_FRAME_BYTES <= length)
+	{
+		crc = CalcCRC(&data[index], MASTER_FRAME_BYTES - 3);
+		if (data[index] != '/' || data[index + 1] != PROTOCOL_VERSION || data[index + MASTER_FRAME_BYTES - 1] != '\n' ||
+			data[index + MASTER_FRAME_BYTES - 3] != ((crc >> 8) & 0xFF) || data[index + MASTER_FRAME_BYTES - 2] != (crc & 0xFF))
+		{
+			index++;
+			(*invalid)++;
+			continue;
+		}
+		count++;
+		index += MASTER_FRAME_BYTES;
+	}
+	*invalid += length - index;
+	return count;
+}
+
+//----------------------------------------------------------------------------
+// Sends master frames every 50ms for number of milliseconds, the answer is
+// complete before the next frame
+//----------------------------------------------------------------------------
+static void RunFrames(uint8_t version, int16_t pwm, FlagStatus enable, uint32_t ms)
+{
+	uint32_t time;
+	
+	for (time = 0; time < ms; time += 50)
+	{
+		SendMasterFrame(version, pwm, enable, RESET);
+		SIM_RunMs(50);
+	}
+}
+
+//----------------------------------------------------------------------------
+// Every master frame is answered, outputs follow enable and timeout
+//----------------------------------------------------------------------------
+static void ScenarioFrames(void)
+{
+	uint32_t invalid = 0;
+	
+	PowerUp();
+	CHECK(SIM_GetTimerOutputEnabled(TIMER_BLDC) == RESET);
+	CHECK(ReadAnswers(&invalid) == 0);
+	
+	RunFrames(PROTOCOL_VERSION, 300, SET, 2000);
+	CHECK(ReadAnswers(&invalid) == 40);
+	CHECK(invalid == 0);
+	CHECK(SIM_GetTimerOutputEnabled(TIMER_BLDC) == SET);
+	CHECK(SIM_GetPin(LED_GREEN_PORT, LED_GREEN) == SET);
+	
+	// Disabled by the master
+	RunFrames(PROTOCOL_VERSION, 300, RESET, 500);
+	CHECK(ReadAnswers(&invalid) == 10);
+	CHECK(SIM_GetTimerOutputEnabled(TIMER_BLDC) == RESET);
+	
+	// Master frames stop: outputs go off after TIMEOUT_MS
+	RunFrames(PROTOCOL_VERSION, 300, SET, 500);
+	CHECK(SIM_GetTimerOutputEnabled(TIMER_BLDC) == SET);
+	SIM_RunMs(TIMEOUT_MS - 200);
+	CHECK(SIM_GetTimerOutputEnabled(TIMER_BLDC) == SET);
+	SIM_RunMs(400);
+	CHECK(SIM_GetTimerOutputEnabled(TIMER_BLDC) == RESET);
+	CHECK(SIM_GetState() == SIM_STATE_RUNNING);
+}
+
+//----------------------------------------------------------------------------
+// Frames of another protocol version are ignored
+//----------------------------------------------------------------------------
+static void ScenarioVersion(void)
+{
+	uint32_t invalid = 0;
+	
+	PowerUp();
+	RunFrames(PROTOCOL_VERSION - 1, 300, SET, 1000);
+	CHECK(ReadAnswers(&invalid) == 0);
+	CHECK(invalid == 0);
+	CHECK(SIM_GetTimerOutputEnabled(TIMER_BLDC) == RESET);
+	CHECK(SIM_GetState() == SIM_STATE_RUNNING);
+}
+
+//----------------------------------------------------------------------------
+// Shut off command turns the board off at once
+//----------------------------------------------------------------------------
+static void ScenarioShutOff(void)
+{
+	PowerUp();
+	RunFrames(PROTOCOL_VERSION, 300, SET, 500);
+	CHECK(SIM_GetState() == SIM_STATE_RUNNING);
+	
+	SendMasterFrame(PROTOCOL_VERSION, 0, RESET, SET);
+	SIM_RunMs(50);
+	CHECK(SIM_GetState() == SIM_STATE_POWER_OFF);
+}
+
+//----------------------------------------------------------------------------
+// Sends bluetooth request, returns the answer (empty without answer)
+//----------------------------------------------------------------------------
+static void Bluetooth(const char *request, char answer[], uint16_t size)
+{
+	uint16_t length;
+	
+	SIM_UsartReceive(USART_STEER_COM, (const uint8_t *)request, strlen(request));
+	SIM_RunMs(20);
+	length = SIM_UsartTransmitted(USART_STEER_COM, (uint8_t *)answer, size - 1);
+	answer[length] = 0;
+}
+
+//----------------------------------------------------------------------------
+// Values written over bluetooth are read back
+//----------------------------------------------------------------------------
+static void ScenarioBluetooth(void)
+{
+	char answer[64];
+	
+	PowerUp();
+	Bluetooth("/150+00000\n", answer, sizeof(answer));
+	CHECK(strcmp(answer, "/150+00000\n") == 0);
+	Bluetooth("/151+00001\n", answer, sizeof(answer));
+	CHECK(strcmp(answer, "") == 0);
+	
+	// Parameter store writes the value to flash, the CPU stalls meanwhile
+	SIM_RunMs(200);
+	Bluetooth("/150+00000\n", answer, sizeof(answer));
+	CHECK(strcmp(answer, "/150+00001\n") == 0);
+	
+	// Current of the master is sent as it is, without master frames it is 0
+	Bluetooth("/010+00000\n", answer, sizeof(answer));
+	CHECK(strcmp(answer, "/010+00000\n") == 0);
+	
+	// Task of the scheduler values is selected by writing its number
+	Bluetooth("/781+00003\n", answer, sizeof(answer));
+	CHECK(strcmp(answer, "") == 0);
+	Bluetooth("/780+00000\n", answer, sizeof(answer));
+	CHECK(strcmp(answer, "/780+00003\n") == 0);
+	
+	// Task number out of range is ignored
+	Bluetooth("/781+00099\n", answer, sizeof(answer));
+	Bluetooth("/780+00000\n", answer, sizeof(answer));
+	CHECK(strcmp(answer, "/780+00003\n") == 0);
+	
+	// Chip temperature of the slave
+	Bluetooth("/850+00000\n", answer, sizeof(answer));
+	CHECK(strncmp(answer, "/850+", 5) == 0);
+}
+
+//----------------------------------------------------------------------------
+// Runs scenario in a child process, returns SET when it passed
+//----------------------------------------------------------------------------
+static FlagStatus RunScenario(const char *name, void (*scenario)(void))
+{
+	int status = 0;
+	pid_t pid;
+	
+	printf("%s: ", name);
+	fflush(stdout);
+	pid = fork();
+	if (pid == 0)
+	{
+		testChecks = 0;
+		testFailures = 0;
+		scenario();
+		exit(TEST_RESULT());
+	}
+	waitpid(pid, &status, 0);
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? SET : RESET;
+}
+
+int main(void)
+{
+	CHECK(RunScenario("frames", ScenarioFrames) == SET);
+	CHECK(RunScenario("version", ScenarioVersion) == SET);
+	CHECK(RunScenario("shut off", ScenarioShutOff) == SET);
+	CHECK(RunScenario("bluetooth", ScenarioBluetooth) == SET);
+	return TEST_RESULT();
+}
@@ -0,0 +1,225 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Runs the speed controller in a closed loop against a simulated hub motor
+// with rider load (DC motor model, one wheel, half of the rider mass)
+
+#include "../../Inc/config.h"
+#include "../../Inc/control.h"
+#include "test.h"
+
+// Motor and load
+#define MOTOR_RESISTANCE 0.3				// Winding resistance in ohm
+#define MOTOR_KE (SPEED_NOMINAL_MV / 1000.0 / (SPEED_NOLOAD_MH / 3600.0 / WHEEL_RADIUS))	// V per rad/s
+#define WHEEL_RADIUS 0.0825					// 6.5 inch wheel in m
+#define LOAD_MASS 50.0							// Half of rider and board in kg
+#define ROLLING_RESISTANCE 0.015
+#define GRAVITY 9.81
+
+// Simulation steps of the calculation ISR (twice per PWM period)
+#define CALC_FREQ (PWM_FREQ * 2)
+#define CYCLE_TIME (1.0 / CALC_FREQ)
+
+typedef struct
+{
+	double speed;						// m/s
+	double current;					// DC current in A
+	double slope;						// Road gradient (0.05 = 5%)
+	double batteryVoltage;	// V
+	int32_t pwm;						// Applied duty cycle (-1000 to 1000)
+	uint8_t currentLimited;	// Current chopping since the last controller run
+} MOTOR;
+
+//----------------------------------------------------------------------------
+// Advances motor by one calculation cycle
+//----------------------------------------------------------------------------
+static void Motor_Step(MOTOR *motor)
+{
+	double voltage = motor->pwm / 1000.0 * motor->batteryVoltage;
+	double omega = motor->speed / WHEEL_RADIUS;
+	double force;
+	
+	// Current chopping of the bridge at DC_CUR_LIMIT
+	motor->current = (voltage - MOTOR_KE * omega) / MOTOR_RESISTANCE;
+	if (motor->current > DC_CUR_LIMIT || motor->current < -DC_CUR_LIMIT)
+	{
+		motor->current = motor->current > 0 ? DC_CUR_LIMIT : -DC_CUR_LIMIT;
+		motor->currentLimited = 1;
+	}
+	force = MOTOR_KE * motor->current / WHEEL_RADIUS - LOAD_MASS * GRAVITY * motor->slope;
+	if (motor->speed > 0.01)
+	{
+		force -= LOAD_MASS * GRAVITY * ROLLING_RESISTANCE;
+	}
+	else if (motor->speed < -0.01)
+	{
+		force += LOAD_MASS * GRAVITY * ROLLING_RESISTANCE;
+	}
+	motor->speed += force / LOAD_MASS * CYCLE_TIME;
+}
+
+//----------------------------------------------------------------------------
+// Returns motor speed in m/h
+//----------------------------------------------------------------------------
+static int32_t Motor_Speed(MOTOR *motor)
+{
+	return (int32_t)(motor->speed * 3600.0);
+}
+
+//----------------------------------------------------------------------------
+// Returns no-load duty cycle of the controller for speed (m/h) and battery
+// voltage (mV), the feed-forward part of its output
+//----------------------------------------------------------------------------
+static int32_t FeedForward(int32_t speed, int32_t batteryVoltage)
+{
+	return speed * CONTROL_PWM_MAX / SPEED_NOLOAD_MH * SPEED_NOMINAL_MV / batteryVoltage;
+}
+
+//----------------------------------------------------------------------------
+// Runs the closed loop for seconds, target moves linearly from start to end
+// within the ramp time (rider input), returns maximum speed in m/h
+//----------------------------------------------------------------------------
+static int32_t Run(SPEED_CONTROLLER *ctrl, MOTOR *motor, int32_t start, int32_t end, double ramp, double seconds)
+{
+	uint32_t cycles = (uint32_t)(seconds * CALC_FREQ);
+	uint32_t rampCycles = (uint32_t)(ramp * CALC_FREQ);
+	uint32_t cycle;
+	int32_t target;
+	int32_t maximum = Motor_Speed(motor);
+	
+	for (cycle = 0; cycle < cycles; cycle++)
+	{
+		target = cycle < rampCycles ? start + (int32_t)((int64_t)(end - start) * cycle / rampCycles) : end;
+		if (cycle % SPEED_CONTROL_DIVIDER == 0)
+		{
+			motor->pwm = SPEED_Calculate(ctrl, target, Motor_Speed(motor), (int32_t)(motor->batteryVoltage * 1000), motor->currentLimited);
+			motor->currentLimited = 0;
+		}
+		Motor_Step(motor);
+		maximum = Motor_Speed(motor) > maximum ? Motor_Speed(motor) : maximum;
+	}
+	return maximum;
+}
+
+//----------------------------------------------------------------------------
+// Accelerate from rest on flat ground: small overshoot, no steady state
+// error, also backwards and as a step within the current limit
+//----------------------------------------------------------------------------
+static void TestAcceleration(void)
+{
+	SPEED_CONTROLLER ctrl;
+	MOTOR motor = {0, 0, 0, 36, 0, 0};
+	int32_t maximum;
+	
+	SPEED_Init(&ctrl, SPEED_KP, SPEED_KI, SPEED_NOLOAD_MH, SPEED_NOMINAL_MV);
+	maximum = Run(&ctrl, &motor, 0, 10000, 2, 5);
+	CHECK_RANGE(maximum, 10000, 10500);
+	CHECK_RANGE(Motor_Speed(&motor), 9800, 10200);
+	
+	Run(&ctrl, &motor, 10000, -10000, 4, 8);
+	CHECK_RANGE(Motor_Speed(&motor), -10200, -9800);
+	
+	// Small step is reached quickly without the current limit
+	Run(&ctrl, &motor, -10000, -10000, 0, 1);
+	maximum = Run(&ctrl, &motor, -9000, -9000, 0, 2);
+	CHECK_RANGE(maximum, -9000, -8700);
+	CHECK_RANGE(Motor_Speed(&motor), -9200, -8800);
+}
+
+//----------------------------------------------------------------------------
+// Uphill and downhill: the integrator removes the load error the pure
+// feed-forward would leave
+//----------------------------------------------------------------------------
+static void TestHill(void)
+{
+	SPEED_CONTROLLER ctrl;
+	MOTOR motor = {0, 0, 0, 36, 0, 0};
+	int32_t feedForward;
+	
+	SPEED_Init(&ctrl, SPEED_KP, SPEED_KI, SPEED_NOLOAD_MH, SPEED_NOMINAL_MV);
+	Run(&ctrl, &motor, 0, 12000, 3, 5);
+	motor.slope = 0.05;
+	Run(&ctrl, &motor, 12000, 12000, 0, 10);
+	feedForward = FeedForward(12000, 36000);
+	CHECK_RANGE(Motor_Speed(&motor), 11760, 12240);
+	CHECK(motor.pwm > feedForward);
+	CHECK(motor.current > 0);
+	
+	motor.slope = -0.05;
+	Run(&ctrl, &motor, 12000, 12000, 0, 10);
+	CHECK_RANGE(Motor_Speed(&motor), 11760, 12240);
+	CHECK(motor.pwm < feedForward);
+	CHECK(motor.current < 0);
+}
+
+//----------------------------------------------------------------------------
+// Battery sag: voltage compensation of the feed-forward keeps the speed
+//----------------------------------------------------------------------------
+static void TestBatterySag(void)
+{
+	SPEED_CONTROLLER ctrl;
+	MOTOR motor = {0, 0, 0, 40, 0, 0};
+	
+	SPEED_Init(&ctrl, SPEED_KP, SPEED_KI, SPEED_NOLOAD_MH, SPEED_NOMINAL_MV);
+	Run(&ctrl, &motor, 0, 15000, 3, 5);
+	motor.batteryVoltage = 32;
+	Run(&ctrl, &motor, 15000, 15000, 0, 0.5);
+	CHECK_RANGE(Motor_Speed(&motor), 14700, 15300);
+}
+
+//----------------------------------------------------------------------------
+// Unreachable target saturates the duty cycle, the integrator must not wind
+// up: after the target drops the duty cycle leaves the limit at once
+//----------------------------------------------------------------------------
+static void TestAntiWindup(void)
+{
+	SPEED_CONTROLLER ctrl;
+	MOTOR motor = {0, 0, 0.05, 36, 0, 0};
+	
+	SPEED_Init(&ctrl, SPEED_KP, SPEED_KI, SPEED_NOLOAD_MH, SPEED_NOMINAL_MV);
+	Run(&ctrl, &motor, 0, 40000, 3, 20);
+	CHECK(motor.pwm == CONTROL_PWM_MAX);
+	CHECK(ctrl.pi.integral <= (int64_t)ctrl.pi.outMax << 15);
+	
+	Run(&ctrl, &motor, 10000, 10000, 0, 0.05);
+	CHECK(motor.pwm < CONTROL_PWM_MAX);
+	Run(&ctrl, &motor, 10000, 10000, 0, 10);
+	CHECK_RANGE(Motor_Speed(&motor), 9800, 10200);
+}
+
+int main(void)
+{
+	TestAcceleration();
+	TestHill();
+	TestBatterySag();
+	TestAntiWindup();
+	
+	return TEST_RESULT();
+}
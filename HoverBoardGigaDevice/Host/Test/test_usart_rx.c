@@ -0,0 +1,213 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Replays steering device byte streams through the USART RX path: circular
+// DMA ring, half/full transfer and idle line interrupts and the frame parser
+
+#include "../Inc/sim.h"
+#include "../../Inc/setup.h"
+#include "../../Inc/defines.h"
+#include "../../Inc/comms.h"
+#include "test.h"
+
+#include <string.h>
+
+#define STEER_FRAME_BYTES 9							// Start, speed, steer, flags, crc and stop byte
+#define STEER_BYTE_CYCLES (SIM_CORE_CLOCK / 19200 * 10)
+
+extern int32_t speed;
+extern int32_t steer;
+
+static uint32_t random_state = 12345;
+
+//----------------------------------------------------------------------------
+// Returns pseudo random number (reproducible replay)
+//----------------------------------------------------------------------------
+static uint32_t Random(void)
+{
+	random_state = random_state * 1103515245 + 12345;
+	return (random_state >> 16) & 0x7FFF;
+}
+
+//----------------------------------------------------------------------------
+// Builds frame of the steering device, returns its length
+//----------------------------------------------------------------------------
+static uint8_t BuildFrame(uint8_t buffer[], int16_t speedValue, int16_t steerValue)
+{
+	uint8_t index = 0;
+	uint16_t crc;
+	
+	buffer[index++] = '/';
+	buffer[index++] = ((uint16_t)speedValue >> 8) & 0xFF;
+	buffer[index++] = (uint16_t)speedValue & 0xFF;
+	buffer[index++] = ((uint16_t)steerValue >> 8) & 0xFF;
+	buffer[index++] = (uint16_t)steerValue & 0xFF;
+	buffer[index++] = 0;
+	crc = CalcCRC(buffer, index);
+	buffer[index++] = (crc >> 8) & 0xFF;
+	buffer[index++] = crc & 0xFF;
+	buffer[index++] = '\n';
+	return index;
+}
+
+//----------------------------------------------------------------------------
+// Runs until all queued bytes are received and the idle line is detected
+//----------------------------------------------------------------------------
+static void RunUntilIdle(void)
+{
+	while (SIM_UsartReceivePending(USART_STEER_COM) > 0)
+	{
+		SIM_Run(STEER_BYTE_CYCLES);
+	}
+	SIM_Run(2 * STEER_BYTE_CYCLES);
+}
+
+//----------------------------------------------------------------------------
+// Frames separated by idle line (request/answer of the steering device)
+// -> every frame is parsed at its end, wherever it lies in the ring
+//----------------------------------------------------------------------------
+static void TestIdleFrames(void)
+{
+	uint8_t frame[STEER_FRAME_BYTES];
+	uint8_t length;
+	int16_t speedValue;
+	int16_t steerValue;
+	uint16_t index;
+	int errors = 0;
+	
+	for (index = 0; index < 500; index++)
+	{
+		speedValue = (int16_t)(Random() % 2001) - 1000;
+		steerValue = (int16_t)(Random() % 2001) - 1000;
+		length = BuildFrame(frame, speedValue, steerValue);
+		SIM_UsartReceive(USART_STEER_COM, frame, length);
+		RunUntilIdle();
+		if (speed != speedValue || steer != steerValue)
+		{
+			errors++;
+		}
+	}
+	CHECK(errors == 0);
+}
+
+//----------------------------------------------------------------------------
+// Noise and corrupted frames between valid frames are dropped
+//----------------------------------------------------------------------------
+static void TestCorruptedFrames(void)
+{
+	uint8_t frame[STEER_FRAME_BYTES];
+	uint8_t noise[16];
+	uint8_t length;
+	uint16_t index;
+	uint8_t byte;
+	int errors = 0;
+	
+	for (index = 0; index < 200; index++)
+	{
+		// Valid frame
+		length = BuildFrame(frame, (int16_t)index, (int16_t)-index);
+		SIM_UsartReceive(USART_STEER_COM, frame, length);
+		
+		// Noise without start character
+		for (byte = 0; byte < sizeof(noise); byte++)
+		{
+			noise[byte] = (uint8_t)Random();
+			noise[byte] = noise[byte] == '/' ? 0 : noise[byte];
+		}
+		SIM_UsartReceive(USART_STEER_COM, noise, (uint16_t)(Random() % sizeof(noise)));
+		
+		// Frame with one flipped bit
+		length = BuildFrame(frame, 999, 999);
+		frame[1 + Random() % (length - 2)] ^= (uint8_t)(1 << (Random() % 8));
+		if (frame[0] == '/' && frame[length - 1] == '\n')
+		{
+			SIM_UsartReceive(USART_STEER_COM, frame, length);
+		}
+		RunUntilIdle();
+		if (speed != index || steer != -index)
+		{
+			errors++;
+		}
+	}
+	CHECK(errors == 0);
+}
+
+//----------------------------------------------------------------------------
+// Back to back frames without idle line, many times the ring size
+// -> parsed in order on half/full transfer, nothing is lost
+//----------------------------------------------------------------------------
+static void TestBurst(void)
+{
+	uint8_t frame[STEER_FRAME_BYTES];
+	uint8_t length;
+	uint16_t index;
+	uint32_t interrupts;
+	int16_t lastSpeed = -1;
+	int errors = 0;
+	
+	speed = -1;
+	interrupts = SIM_GetIrqCount(USART0_IRQn) + SIM_GetIrqCount(DMA_Channel1_2_IRQn);
+	for (index = 0; index < 400; index++)
+	{
+		length = BuildFrame(frame, (int16_t)index, 0);
+		SIM_UsartReceive(USART_STEER_COM, frame, length);
+	}
+	
+	// Check parsed speed after every frame time: it increases and lags
+	// at most one half ring behind the received bytes
+	for (index = 0; index < 400; index++)
+	{
+		SIM_Run(STEER_FRAME_BYTES * STEER_BYTE_CYCLES);
+		if (speed < lastSpeed || speed < (int32_t)index - (USART_STEER_COM_RX_BUFFERSIZE / 2 / STEER_FRAME_BYTES + 1))
+		{
+			errors++;
+		}
+		lastSpeed = (int16_t)speed;
+	}
+	RunUntilIdle();
+	CHECK(errors == 0);
+	CHECK(speed == 399);
+	
+	// One interrupt per half ring instead of one per byte
+	interrupts = SIM_GetIrqCount(USART0_IRQn) + SIM_GetIrqCount(DMA_Channel1_2_IRQn) - interrupts;
+	CHECK_RANGE(interrupts, 1, 400 * STEER_FRAME_BYTES / (USART_STEER_COM_RX_BUFFERSIZE / 2) + 2);
+}
+
+int main(void)
+{
+	Interrupt_init();
+	USART_Steer_COM_init();
+	
+	TestIdleFrames();
+	TestCorruptedFrames();
+	TestBurst();
+	
+	return TEST_RESULT();
+}
@@ -0,0 +1,69 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef ANALOG_H
+#define ANALOG_H
+
+#include "gd32f1x0.h"
+#include "../Inc/config.h"
+
+// Channels of the regular scan sequence (order in the DMA buffer)
+typedef enum
+{
+	ANALOG_VBATT = 0,								// Battery voltage divider
+	ANALOG_CURRENT_DC = 1,					// DC link current
+	ANALOG_INPUT = 2,								// Free analog input PB0
+	ANALOG_TEMPERATURE = 3,					// Internal temperature sensor
+	ANALOG_VREFINT = 4							// Internal reference voltage
+} ANALOG_CHANNEL;
+
+#define COUNT_ANALOG_CHANNELS 5	// Count of analog channels!!
+
+// Scan sequences held by the circular DMA buffer and summed up per channel
+#define ANALOG_OVERSAMPLING 8
+
+// Size of the DMA buffer in samples
+#define ANALOG_BUFFER_SIZE (ANALOG_OVERSAMPLING * COUNT_ANALOG_CHANNELS)
+
+// Full scale of the oversampled values
+#define ANALOG_FULL_SCALE (4095 * ANALOG_OVERSAMPLING)
+
+//----------------------------------------------------------------------------
+// Calculates filtered and calibrated analog values => called every 1ms
+//----------------------------------------------------------------------------
+void CalculateAnalog(void);
+
+//----------------------------------------------------------------------------
+// Returns filtered raw value of a channel (sum of ANALOG_OVERSAMPLING samples)
+//----------------------------------------------------------------------------
+int32_t GetAnalogRaw(ANALOG_CHANNEL channel);
+
+#endif
@@ -0,0 +1,61 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "gd32f1x0.h"
+#include "../Inc/config.h"
+
+#define BENCHMARK_CALLS 1000			// Measured calls per function, the same count runs before to warm up
+#define COUNT_BENCHMARKS 4				// Functions measured by each board (mixer only on master, LED pwm only on slave)
+
+// Result of one measured function
+typedef struct
+{
+	const char *name;
+	uint32_t min;										// Counter ticks of one call
+	uint32_t avg;
+	uint32_t max;
+} BENCHMARK_RESULT;
+
+//----------------------------------------------------------------------------
+// Measures all functions with the given counter, interrupts are disabled
+// meanwhile
+//----------------------------------------------------------------------------
+void BenchmarkMeasure(BENCHMARK_RESULT results[COUNT_BENCHMARKS], uint32_t (*counter)(void));
+
+//----------------------------------------------------------------------------
+// Measures all functions with the DWT cycle counter and prints the table
+// over USART_STEER_COM
+//----------------------------------------------------------------------------
+void BenchmarkRun(void);
+
+#endif
@@ -34,6 +34,33 @@
 #include "gd32f1x0.h"
 #include "../Inc/config.h"
 
+// Modes for motor commutation
+typedef enum
+{
+	COMMUTATION_BLOCK = 0,
+	COMMUTATION_SINUS = 1
+} COMMUTATION_MODE;
+
+#define COUNT_COMMUTATION_MODES 2	// Count of commutation modes!!
+
+// Modes for the meaning of the pwm input
+typedef enum
+{
+	CONTROL_PWM = 0,								// Input is the duty cycle
+	CONTROL_SPEED = 1,							// Input is the target speed (1000 = SPEED_MAX_MH)
+	CONTROL_TORQUE = 2							// Input is the target DC current (1000 = TORQUE_MAX_MA)
+} CONTROL_MODE;
+
+#define COUNT_CONTROL_MODES 3	// Count of control modes!!
+
+// Calculation frequency: update events at both counter ends of the center aligned pwm
+#define BLDC_CALC_FREQ (PWM_FREQ * 2)
+
+// Fault flags (latched by the calculation ISR until acknowledged with AcknowledgeFaults)
+#define BLDC_FAULT_OVERCURRENT  BIT(0)		// Current chopping has been active
+#define BLDC_FAULT_HALL         BIT(1)		// Invalid hall sensor combination
+#define BLDC_FAULT_TIMEOUT      BIT(2)		// Timed out, no steering/master frames (not latched)
+
 //----------------------------------------------------------------------------
 // Set motor enable
 //----------------------------------------------------------------------------
@@ -45,8 +72,51 @@ void SetEnable(FlagStatus setEnable);
 void SetPWM(int16_t setPwm);
 
 //----------------------------------------------------------------------------
-// Calculation-Routine for BLDC => calculates with 16kHz
+// Sets/Gets commutation mode
+//----------------------------------------------------------------------------
+void SetCommutationMode(COMMUTATION_MODE mode);
+COMMUTATION_MODE GetCommutationMode(void);
+
+//----------------------------------------------------------------------------
+// Sets/Gets control mode
+//----------------------------------------------------------------------------
+void SetControlMode(CONTROL_MODE mode);
+CONTROL_MODE GetControlMode(void);
+
+//----------------------------------------------------------------------------
+// Sets/Gets field weakening
+//----------------------------------------------------------------------------
+void SetWeakening(FlagStatus setWeakening);
+FlagStatus GetWeakening(void);
+
+//----------------------------------------------------------------------------
+// Returns if braking is reduced by the regen voltage ceiling
+//----------------------------------------------------------------------------
+FlagStatus GetRegenVoltageLimited(void);
+
+//----------------------------------------------------------------------------
+// Returns fault flags latched until acknowledged
+//----------------------------------------------------------------------------
+uint8_t GetFaults(void);
+
+//----------------------------------------------------------------------------
+// Clears latched fault flags the other board has received
+//----------------------------------------------------------------------------
+void AcknowledgeFaults(uint8_t faults);
+
+//----------------------------------------------------------------------------
+// Returns hall sensor inputs (bit 0 A, bit 1 B, bit 2 C)
+//----------------------------------------------------------------------------
+uint8_t GetHallState(void);
+
+//----------------------------------------------------------------------------
+// Calculation-Routine for BLDC => calculates with 32kHz
 //----------------------------------------------------------------------------
 void CalculateBLDC(void);
 
+//----------------------------------------------------------------------------
+// Timestamps a hall sensor edge => called from EXTI interrupt
+//----------------------------------------------------------------------------
+void CalculateHallEdge(void);
+
 #endif
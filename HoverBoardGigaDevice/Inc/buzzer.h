@@ -0,0 +1,86 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef BUZZER_H
+#define BUZZER_H
+
+#include "gd32f1x0.h"
+#include "../Inc/config.h"
+
+// Only master has a buzzer
+#ifdef MASTER
+
+// Sounds of the buzzer (see sound table in buzzer.c)
+typedef enum
+{
+	BUZZER_SOUND_NONE = 0,
+	BUZZER_SOUND_STARTUP = 1,					// Rising sweep after power on (sequence)
+	BUZZER_SOUND_SHUTDOWN = 2,				// Falling sweep before power off (sequence)
+	BUZZER_SOUND_BACKWARDS = 3,				// Beeps while driving backwards
+	BUZZER_SOUND_REGEN_LIMIT = 4,			// Braking reduced by the regen voltage ceiling
+	BUZZER_SOUND_BATTERY_LOW = 5,			// Battery almost empty
+	BUZZER_SOUND_BATTERY_EMPTY = 6		// Battery empty, undervoltage lockout follows
+} BUZZER_SOUND;
+
+#define COUNT_BUZZER_SOUNDS 7	// Count of buzzer sounds!!
+
+// Step of a sound: tone, pause and repetitions of both
+typedef struct
+{
+	uint16_t frequency;								// Tone frequency in Hz, 0 = silent
+	uint16_t duration_ms;							// Tone duration in ms, 0 ends the sound
+	uint16_t pause_ms;								// Silence after the tone in ms
+	uint8_t repeat;										// Additional repetitions of tone and pause
+} BUZZER_STEP;
+
+//----------------------------------------------------------------------------
+// Plays a sound once, has priority over the background sound
+//----------------------------------------------------------------------------
+void BUZZER_PlaySequence(BUZZER_SOUND sound);
+
+//----------------------------------------------------------------------------
+// Returns if a sequence is playing
+//----------------------------------------------------------------------------
+FlagStatus BUZZER_IsPlaying(void);
+
+//----------------------------------------------------------------------------
+// Sets the background sound (repeated, restarts only when changed)
+//----------------------------------------------------------------------------
+void BUZZER_SetSound(BUZZER_SOUND sound);
+
+//----------------------------------------------------------------------------
+// Sound sequencer => called every 1ms
+//----------------------------------------------------------------------------
+void BUZZER_Update(void);
+
+#endif
+
+#endif
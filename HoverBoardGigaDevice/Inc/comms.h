@@ -34,11 +34,29 @@
 #include "gd32f1x0.h"
 #include "../Inc/config.h"
 
+#define USART_TX_FRAME_SIZE 25		// Maximum length of one transmit frame
+#define USART_TX_QUEUE_FRAMES 2		// Frames per USART transmit queue (double buffered)
+
 //----------------------------------------------------------------------------
-// Send buffer via USART
+// Send buffer via USART (non-blocking, sent by DMA)
 //----------------------------------------------------------------------------
 void SendBuffer(uint32_t usart_periph, uint8_t buffer[], uint8_t length);
 
+//----------------------------------------------------------------------------
+// Is called from DMA interrupt when a frame has been transferred
+//----------------------------------------------------------------------------
+void SendBufferComplete(uint32_t usart_periph);
+
+//----------------------------------------------------------------------------
+// Read one received byte from the USART ring buffer (RESET if none left)
+//----------------------------------------------------------------------------
+FlagStatus ReadBuffer(uint32_t usart_periph, uint8_t *character);
+
+//----------------------------------------------------------------------------
+// Waits until all queued frames have left the USART (shut off and benchmark)
+//----------------------------------------------------------------------------
+void FlushBuffer(uint32_t usart_periph);
+
 //----------------------------------------------------------------------------
 // Calculate CRC
 //----------------------------------------------------------------------------
@@ -33,6 +33,49 @@
 
 #include "gd32f1x0.h"
 #include "../Inc/config.h"
+#include "../Inc/profiler.h"
+#include "../Inc/param.h"
+#include "../Inc/scheduler.h"
+
+// Version of the frame layout (see MasterSlaveProtocol.md), frames of other
+// versions are ignored
+#define MASTERSLAVE_PROTOCOL_VERSION 3
+
+// Identifiers of the general value sent from master to slave (one per frame,
+// process values are part of every frame)
+#define MASTERSLAVE_ID_PROFILER     0 	// First profiler value, followed by all PROFILER_VALUEs
+#ifdef PROFILER
+#define MASTERSLAVE_ID_SCHEDULER    (MASTERSLAVE_ID_PROFILER + COUNT_PROFILER_VALUES)	// First scheduler value, all SCHEDULER_VALUEs of each task
+#else
+#define MASTERSLAVE_ID_SCHEDULER    MASTERSLAVE_ID_PROFILER
+#endif
+#define MASTERSLAVE_ID_PARAM        (MASTERSLAVE_ID_SCHEDULER + COUNT_SCHEDULER_TASKS * COUNT_SCHEDULER_VALUES)	// First parameter, followed by all PARAM_IDs
+#define COUNT_MASTERSLAVE_IDS       (MASTERSLAVE_ID_PARAM + COUNT_PARAMS)
+
+// Process values of one board, sent in every frame in both directions
+typedef struct
+{
+	int16_t currentDC;								// DC current in 10mA (absolute value)
+	int16_t battery;									// Battery voltage in 10mV
+	int16_t realSpeed;								// Speed in 10m/h
+	int16_t temperature;							// Chip temperature in 0.1°C
+	uint8_t faults;										// BLDC_FAULT_x flags latched until acknowledged by the other board
+	uint8_t hall;											// Hall sensor inputs (bit 0 A, bit 1 B, bit 2 C)
+	uint8_t hallLearnState;						// HALL_LEARN_STATE
+	int16_t isrLoad;									// Average load of the calculation ISR in permille
+} MASTERSLAVE_TELEMETRY;
+
+#define MASTERSLAVE_TELEMETRY_BYTES 13	// Encoded size of MASTERSLAVE_TELEMETRY
+
+//----------------------------------------------------------------------------
+// Writes telemetry to buffer (big endian), returns number of bytes written
+//----------------------------------------------------------------------------
+uint8_t EncodeTelemetry(uint8_t buffer[], const MASTERSLAVE_TELEMETRY *telemetry);
+
+//----------------------------------------------------------------------------
+// Reads telemetry from buffer (big endian)
+//----------------------------------------------------------------------------
+void DecodeTelemetry(const uint8_t buffer[], MASTERSLAVE_TELEMETRY *telemetry);
 
 //----------------------------------------------------------------------------
 // Update USART master slave input
@@ -43,13 +86,18 @@ void UpdateUSARTMasterSlaveInput(void);
 //----------------------------------------------------------------------------
 // Send slave frame via USART
 //----------------------------------------------------------------------------
-void SendSlave(int16_t pwmSlave, FlagStatus enable, FlagStatus shutoff, FlagStatus chargeState, uint8_t identifier, int16_t value);
+void SendSlave(int16_t pwmSlave, FlagStatus enable, FlagStatus shutoff, FlagStatus chargeState, FlagStatus weakening, uint8_t identifier, int16_t value);
+
+//----------------------------------------------------------------------------
+// Returns process values sent by slave
+//----------------------------------------------------------------------------
+void GetTelemetrySlave(MASTERSLAVE_TELEMETRY *telemetry);
 #endif
 #ifdef SLAVE
 //----------------------------------------------------------------------------
 // Send master frame via USART
 //----------------------------------------------------------------------------
-void SendMaster(FlagStatus upperLEDMaster, FlagStatus lowerLEDMaster, FlagStatus mosfetOutMaster, FlagStatus beepsBackwards);
+void SendMaster(FlagStatus upperLEDMaster, FlagStatus lowerLEDMaster, FlagStatus mosfetOutMaster, FlagStatus beepsBackwards, FlagStatus weakening, FlagStatus hallLearn, uint8_t paramIdentifier, int16_t paramValue);
 
 //----------------------------------------------------------------------------
 // Returns current value sent by master
@@ -66,6 +114,41 @@ int16_t GetBatteryMaster(void);
 //----------------------------------------------------------------------------
 int16_t GetRealSpeedMaster(void);
 
+//----------------------------------------------------------------------------
+// Returns hall learning state sent by master
+//----------------------------------------------------------------------------
+int16_t GetHallLearnStateMaster(void);
+
+//----------------------------------------------------------------------------
+// Returns temperature value sent by master
+//----------------------------------------------------------------------------
+int16_t GetTemperatureMaster(void);
+
+//----------------------------------------------------------------------------
+// Returns fault flags sent by master (latched until the slave acknowledged them)
+//----------------------------------------------------------------------------
+uint8_t GetFaultsMaster(void);
+
+//----------------------------------------------------------------------------
+// Returns profiler value sent by master
+//----------------------------------------------------------------------------
+int16_t GetProfilerValueMaster(PROFILER_VALUE value);
+
+//----------------------------------------------------------------------------
+// Returns scheduler value of a task sent by master
+//----------------------------------------------------------------------------
+int16_t GetSchedulerValueMaster(SCHEDULER_TASK task, SCHEDULER_VALUE value);
+
+//----------------------------------------------------------------------------
+// Returns parameter value sent by master
+//----------------------------------------------------------------------------
+int32_t GetParamMaster(PARAM_ID identifier);
+
+//----------------------------------------------------------------------------
+// Sets parameter of master (sent until master reports the value)
+//----------------------------------------------------------------------------
+void SetParamMaster(PARAM_ID identifier, int32_t value);
+
 //----------------------------------------------------------------------------
 // Sets upper LED value which will be send to master
 //----------------------------------------------------------------------------
@@ -105,6 +188,21 @@ void SetBeepsBackwardsMaster(FlagStatus value);
 // Returns beepsBackwardsMaster value sent by master
 //----------------------------------------------------------------------------
 FlagStatus GetBeepsBackwardsMaster(void);
+
+//----------------------------------------------------------------------------
+// Sets weakening value which will be send to master
+//----------------------------------------------------------------------------
+void SetWeakeningMaster(FlagStatus value);
+
+//----------------------------------------------------------------------------
+// Returns weakeningMaster value sent by master
+//----------------------------------------------------------------------------
+FlagStatus GetWeakeningMaster(void);
+
+//----------------------------------------------------------------------------
+// Sets hall learning request which will be send to master
+//----------------------------------------------------------------------------
+void SetHallLearnMaster(FlagStatus value);
 #endif
 
 #endif
@@ -35,24 +35,64 @@
 
 // ################################################################################
 
+#if !defined(MASTER) && !defined(SLAVE)				// Role may be selected by the build (host build)
 #define MASTER										  	// Select if firmware is for master or slave board
 //#define SLAVE 												// Select if firmware is for master or slave board
+#endif
 
 // ################################################################################
 
 #define PWM_FREQ         		16000     // PWM frequency in Hz
 #define DEAD_TIME        		60        // PWM deadtime (60 = 1s, measured by oscilloscope)
 
-#define DC_CUR_LIMIT     		15        // Motor DC current limit in amps
+#define DC_CUR_LIMIT     		15        // Motor DC current limit in amps (upper bound of the stored parameter)
+
+#define COMMUTATION_MODE_DEFAULT	COMMUTATION_BLOCK	// Commutation after startup: COMMUTATION_BLOCK or COMMUTATION_SINUS (space vector)
+
+#define CONTROL_MODE_DEFAULT	CONTROL_PWM	// Control after startup: CONTROL_PWM (input is duty cycle), CONTROL_SPEED (input is target speed) or CONTROL_TORQUE (input is target current)
+
+#define SPEED_MAX_MH        20000     // Target speed for input 1000 in m/h (speed control)
+#define SPEED_NOLOAD_MH     30000     // Speed at duty cycle 1000 without load at SPEED_NOMINAL_MV in m/h (feed-forward)
+#define SPEED_NOMINAL_MV    36000     // Battery voltage the no-load speed refers to in mV
+#define SPEED_KP            1638      // Speed controller proportional gain (Q15, pwm per m/h)
+#define SPEED_KI            3         // Speed controller integral gain (Q15, pwm per m/h and cycle)
+#define SPEED_CONTROL_DIVIDER 16      // Speed controller runs every n-th calculation cycle
+
+#define TORQUE_MAX_MA       13000     // Target DC current for input 1000 in mA (torque control), keep below DC_CUR_LIMIT
+#define TORQUE_KP           655       // Torque controller proportional gain (Q15, pwm per mA)
+#define TORQUE_KI           4         // Torque controller integral gain (Q15, pwm per mA and cycle)
+
+#define REGEN_BRAKING                 // Limit braking to regeneration into the battery (no plugging), active once the hall sensor learning measured the direction
+#define REGEN_CURRENT_MAX_MA 5000     // Maximum regenerative DC current in mA, keep below DC_CUR_LIMIT
+#define REGEN_VOLTAGE_MAX_MV 41500    // Battery voltage ceiling for regenerative braking in mV (10S: 42V fully charged)
+#define REGEN_MIN_SPEED_MH  2000      // Below this speed in m/h the duty cycle is not limited (reversing at standstill)
+#define REGEN_KP            164       // Regen limiter proportional gain (Q15, pwm per mA)
+#define REGEN_KI            16        // Regen limiter integral gain (Q15, pwm per mA and cycle)
+
+#define FIELD_WEAKENING_START   900     // Modulation (duty cycle, 0 to 1000) above which field weakening blends in
+#define FIELD_WEAKENING_ANGLE   20      // Maximum phase advance in electrical degrees (block and sinus commutation)
+
+#define HALL_LEARN_PWM      60        // Duty cycle of the open loop rotation during hall sensor learning (0 to 1000)
+
+#define PROFILER                      // Measure cycles of the calculation ISR with the DWT cycle counter, comment out to remove
+//#define BENCHMARK                   // Measure cycles of the control functions at startup and print them over USART_STEER_COM, uncomment to add
 
 // ################################################################################
 
-#define DELAY_IN_MAIN_LOOP 	5         // Delay in ms
+// Periods of the main loop tasks in ms (see scheduler.h)
+#define TASK_PERIOD_STEERING    100       // Request steering data
+#define TASK_PERIOD_SLAVE_FRAME 50        // Set pwm and send slave frame
+#define TASK_PERIOD_BATTERY     100       // Battery level
+#define TASK_PERIOD_INACTIVITY  50        // Power button and inactivity timeout
+#define TASK_PERIOD_SIGNALS     50        // Battery LEDs and buzzer sound
+#define TASK_PERIOD_STORAGE     100       // Store hall learning result and parameters
+
+// Following values are defaults of the parameter store (param.c), values set
+// over bluetooth are kept in flash
 
 #define TIMEOUT_MS          2000      // Time in milliseconds without steering commands before pwm emergency off
 
-#ifdef MASTER
-#define INACTIVITY_TIMEOUT 	8        	// Minutes of not driving until poweroff (not very precise)
+#define INACTIVITY_TIMEOUT 	8        	// Minutes of not driving until poweroff
 
 // ################################################################################
 
@@ -65,14 +105,23 @@
 //#define BAT_LOW_DEAD     27.0
 
 // ################################################################################
-#endif
 
 // ###### ARMCHAIR ######
-#define FILTER_SHIFT 12 						// Low-pass filter for pwm, rank k=12
+#define RAMP_ACCEL       2000       // Command ramp acceleration (input units per second, 1000 = full scale)
+#define RAMP_DECEL       3000       // Command ramp deceleration towards zero (input units per second)
+#define RAMP_REVERSAL    1500       // Command ramp while changing direction (input units per second)
+#define RAMP_JERK        0          // Command ramp jerk limitation (input units per second^2), 0 = off
 
-#ifdef MASTER
 #define SPEED_COEFFICIENT   -1
 #define STEER_COEFFICIENT   1
-#endif
+
+// ###### LED (slave) ######
+#define LED_PROGRAM_DEFAULT      0    // LED program after startup (0 = off, 1 = HSB, 2 = blink, 3 = fade, 4 = strobe)
+#define LED_HUE_DEFAULT          0    // LED hue (0 to 764)
+#define LED_SATURATION_DEFAULT   128  // LED saturation (0 to 128)
+#define LED_BRIGHTNESS_DEFAULT   63   // LED brightness (0 to 63)
+#define LED_SPEED_FADING_DEFAULT 150  // Fading delay in ms
+#define LED_SPEED_BLINK_DEFAULT  1274 // Blink delay in ms
+#define LED_SPEED_STROBE_DEFAULT 40   // Strobe delay in ms
 
 #endif
@@ -0,0 +1,144 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef CONTROL_H
+#define CONTROL_H
+
+// Only plain integer types are used, so the controllers also compile on a host
+#include "stdint.h"
+#include "../Inc/foc.h"
+
+// Maximum duty cycle value of the pwm input (-1000 to 1000)
+#define CONTROL_PWM_MAX 1000
+
+// Fractional bits of the command ramp (value and slopes)
+#define RAMP_SHIFT 20
+
+// Slew rate limited command ramp with optional jerk limitation (S-curve),
+// all values in Q20 per calculation cycle
+typedef struct
+{
+	int32_t value;									// Actual output
+	int32_t slope;									// Change of the output in the last cycle
+	int32_t accel;									// Maximum slope away from zero
+	int32_t decel;									// Maximum slope towards zero
+	int32_t reversal;								// Maximum slope while output and target have different signs
+	int32_t jerk;										// Maximum change of slope per cycle, 0 = no jerk limitation
+} RAMP;
+
+// Speed controller: PI with feed-forward of the no-load duty cycle
+typedef struct
+{
+	PI_CONTROLLER pi;
+	int32_t noLoadSpeed;						// Speed at full duty cycle without load (m/h)
+	int32_t nominalVoltage;					// Battery voltage the no-load speed refers to (mV)
+} SPEED_CONTROLLER;
+
+// DC current (torque) controller: PI from current error to duty cycle
+typedef struct
+{
+	PI_CONTROLLER pi;
+	int8_t direction;								// Sign of the last target, integrator restarts on change
+} TORQUE_CONTROLLER;
+
+// Regenerative braking limiter: PI from regen current and overvoltage to the
+// braking depth, the duty cycle range allowed below the back-EMF duty cycle
+typedef struct
+{
+	PI_CONTROLLER pi;
+	int32_t currentMax;							// Maximum regenerative DC current (mA)
+	int32_t voltageMax;							// Battery voltage ceiling (mV)
+} REGEN_LIMITER;
+
+//----------------------------------------------------------------------------
+// Sets ramp output to value without ramping (-1000 to 1000)
+//----------------------------------------------------------------------------
+void RAMP_Set(RAMP *ramp, int32_t value);
+
+//----------------------------------------------------------------------------
+// Moves ramp output one cycle towards the target (-1000 to 1000)
+//----------------------------------------------------------------------------
+int32_t RAMP_Calculate(RAMP *ramp, int32_t target);
+
+//----------------------------------------------------------------------------
+// Initializes speed controller with gains (Q15) and feed-forward parameters
+//----------------------------------------------------------------------------
+void SPEED_Init(SPEED_CONTROLLER *ctrl, int32_t kp, int32_t ki, int32_t noLoadSpeed, int32_t nominalVoltage);
+
+//----------------------------------------------------------------------------
+// Resets integrator of speed controller
+//----------------------------------------------------------------------------
+void SPEED_Reset(SPEED_CONTROLLER *ctrl);
+
+//----------------------------------------------------------------------------
+// Calculates duty cycle (-1000 to 1000) for target and actual speed (m/h),
+// the integrator does not grow while currentLimited is set
+//----------------------------------------------------------------------------
+int32_t SPEED_Calculate(SPEED_CONTROLLER *ctrl, int32_t target, int32_t speed, int32_t batteryVoltage, uint8_t currentLimited);
+
+//----------------------------------------------------------------------------
+// Calculates duty cycle (-1000 to 1000) which reaches speed (m/h) without load
+//----------------------------------------------------------------------------
+int32_t SPEED_FeedForward(SPEED_CONTROLLER *ctrl, int32_t speed, int32_t batteryVoltage);
+
+//----------------------------------------------------------------------------
+// Initializes torque controller with gains (Q15)
+//----------------------------------------------------------------------------
+void TORQUE_Init(TORQUE_CONTROLLER *ctrl, int32_t kp, int32_t ki);
+
+//----------------------------------------------------------------------------
+// Resets integrator of torque controller
+//----------------------------------------------------------------------------
+void TORQUE_Reset(TORQUE_CONTROLLER *ctrl);
+
+//----------------------------------------------------------------------------
+// Calculates duty cycle (-1000 to 1000) for target and measured DC current (mA)
+//----------------------------------------------------------------------------
+int32_t TORQUE_Calculate(TORQUE_CONTROLLER *ctrl, int32_t target, int32_t current);
+
+//----------------------------------------------------------------------------
+// Initializes regen limiter with gains (Q15), current (mA) and voltage (mV) limit
+//----------------------------------------------------------------------------
+void REGEN_Init(REGEN_LIMITER *ctrl, int32_t kp, int32_t ki, int32_t currentMax, int32_t voltageMax);
+
+//----------------------------------------------------------------------------
+// Resets regen limiter to full braking depth
+//----------------------------------------------------------------------------
+void REGEN_Reset(REGEN_LIMITER *ctrl);
+
+//----------------------------------------------------------------------------
+// Limits braking of the duty cycle (-1000 to 1000) below the back-EMF duty
+// cycle by measured DC current (mA) and battery voltage (mV)
+//----------------------------------------------------------------------------
+int32_t REGEN_Calculate(REGEN_LIMITER *ctrl, int32_t pwm, int32_t backEmfPwm, int32_t current, int32_t batteryVoltage);
+
+#endif
@@ -51,6 +51,13 @@
 #define MOSFET_OUT_PIN GPIO_PIN_13
 #define MOSFET_OUT_PORT GPIOC
 
+// RGB LED PWM defines (slave), upper and lower LED are timer outputs,
+// mosfet output has no timer function and is switched by the update interrupt
+#define RCU_TIMER_LED RCU_TIMER1
+#define TIMER_LED TIMER1
+#define TIMER_LED_CHANNEL_UPPER TIMER_CH_1
+#define TIMER_LED_CHANNEL_LOWER TIMER_CH_0
+
 // Brushless Control DC (BLDC) defines
 // Channel G
 #define RCU_TIMER_BLDC RCU_TIMER0
@@ -84,6 +91,21 @@
 #define HALL_B_PORT GPIOF
 #define HALL_C_PIN GPIO_PIN_14
 #define HALL_C_PORT GPIOC
+#define HALL_A_EXTI EXTI_11
+#define HALL_A_EXTI_PORT EXTI_SOURCE_GPIOB
+#define HALL_A_EXTI_PIN EXTI_SOURCE_PIN11
+#define HALL_B_EXTI EXTI_1
+#define HALL_B_EXTI_PORT EXTI_SOURCE_GPIOF
+#define HALL_B_EXTI_PIN EXTI_SOURCE_PIN1
+#define HALL_C_EXTI EXTI_14
+#define HALL_C_EXTI_PORT EXTI_SOURCE_GPIOC
+#define HALL_C_EXTI_PIN EXTI_SOURCE_PIN14
+
+// Flash pages with learned hall tables and parameters (excluded from the IROM of the project)
+#define FLASH_PAGE_SIZE 0x400
+#define HALL_FLASH_ADDRESS 0x0800F400
+#define PARAM_FLASH_PAGE0 0x0800F800
+#define PARAM_FLASH_PAGE1 0x0800FC00
 
 // Usart master slave defines
 #define USART_MASTERSLAVE USART1
@@ -91,6 +113,8 @@
 #define USART_MASTERSLAVE_TX_PORT GPIOA
 #define USART_MASTERSLAVE_RX_PIN GPIO_PIN_3
 #define USART_MASTERSLAVE_RX_PORT GPIOA
+#define USART_MASTERSLAVE_TX_DMA DMA_CH3
+#define USART_MASTERSLAVE_RX_DMA DMA_CH4
 
 // ADC defines
 #define VBATT_PIN	GPIO_PIN_4
@@ -99,6 +123,11 @@
 #define CURRENT_DC_PIN	GPIO_PIN_6
 #define CURRENT_DC_PORT GPIOA
 #define CURRENT_DC_CHANNEL ADC_CHANNEL_6
+#define ANALOG_INPUT_PIN	GPIO_PIN_0
+#define ANALOG_INPUT_PORT GPIOB
+#define ANALOG_INPUT_CHANNEL ADC_CHANNEL_8
+#define TEMPERATURE_CHANNEL ADC_CHANNEL_16
+#define VREFINT_CHANNEL ADC_CHANNEL_17
 
 // Self hold defines
 #define SELF_HOLD_PIN GPIO_PIN_2
@@ -108,12 +137,19 @@
 #define BUTTON_PIN GPIO_PIN_15
 #define BUTTON_PORT GPIOC
 
+// Buzzer timer defines (master, TIMER1 drives the RGB LEDs on the slave)
+#define RCU_TIMER_BUZZER RCU_TIMER1
+#define TIMER_BUZZER TIMER1
+#define TIMER_BUZZER_CHANNEL TIMER_CH_2
+
 // Usart steer defines
 #define USART_STEER_COM USART0
 #define USART_STEER_COM_TX_PIN GPIO_PIN_6
 #define USART_STEER_COM_TX_PORT GPIOB
 #define USART_STEER_COM_RX_PIN GPIO_PIN_7
 #define USART_STEER_COM_RX_PORT GPIOB
+#define USART_STEER_COM_TX_DMA DMA_CH1
+#define USART_STEER_COM_RX_DMA DMA_CH2
 
 #ifdef MASTER
 // Buzzer defins
@@ -132,9 +168,11 @@
 // ADC value conversion defines
 #define MOTOR_AMP_CONV_DC_AMP 0.201465201465  // 3,3V * 1/3 - 0,004Ohm * IL(ampere) = (ADC-Data/4095) *3,3V
 #define ADC_BATTERY_VOLT      0.024169921875 	// V_Batt to V_BattMeasure = factor 30: ( (ADC-Data/4095) *3,3V *30 )
+#define MOTOR_MILLIAMP_CONV_DC_Q10 206300     // MOTOR_AMP_CONV_DC_AMP * 1000 in Q10 (mA per ADC step)
+#define ADC_BATTERY_MILLIVOLT_Q10  24750      // ADC_BATTERY_VOLT * 1000 in Q10 (mV per ADC step)
 
 // Useful math function defines
-#define ABS(a) (((a) < 0.0) ? -(a) : (a))
+#define ABS(a) (((a) < 0) ? -(a) : (a))
 #define CLAMP(x, low, high) (((x) > (high)) ? (high) : (((x) < (low)) ? (low) : (x)))
 #define MAX(x, high) (((x) > (high)) ? (high) : (x))
 #define MAP(x, xMin, xMax, yMin, yMax) ((x - xMin) * (yMax - yMin) / (xMax - xMin) + yMin)
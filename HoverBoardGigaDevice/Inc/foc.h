@@ -0,0 +1,75 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef FOC_H
+#define FOC_H
+
+// Only plain integer types are used, so the control math also compiles on a host
+#include "stdint.h"
+
+// Electrical angle constants (16 bit angle, 65536 = 360 degrees)
+#define ANGLE_30_DEG  5461
+#define ANGLE_60_DEG  10923
+#define ANGLE_90_DEG  16384
+#define ANGLE_120_DEG 21845
+#define ANGLE_180_DEG 32768
+
+// PI controller with gains in Q15 and clamped integrator (anti-windup)
+typedef struct
+{
+	int32_t kp;
+	int32_t ki;
+	int32_t integral;
+	int32_t outMin;
+	int32_t outMax;
+} PI_CONTROLLER;
+
+//----------------------------------------------------------------------------
+// Initializes PI controller with gains (Q15) and output limits
+//----------------------------------------------------------------------------
+void PI_Init(PI_CONTROLLER *pi, int32_t kp, int32_t ki, int32_t outMin, int32_t outMax);
+
+//----------------------------------------------------------------------------
+// Resets integrator of PI controller
+//----------------------------------------------------------------------------
+void PI_Reset(PI_CONTROLLER *pi);
+
+//----------------------------------------------------------------------------
+// Calculates PI controller output for the given error
+//----------------------------------------------------------------------------
+int32_t PI_Calculate(PI_CONTROLLER *pi, int32_t error);
+
+//----------------------------------------------------------------------------
+// Sine of a 16 bit angle (65536 = 360 degrees) in Q15
+//----------------------------------------------------------------------------
+int16_t FOC_Sine(uint16_t angle);
+
+#endif
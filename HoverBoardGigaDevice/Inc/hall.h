@@ -0,0 +1,96 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef HALL_H
+#define HALL_H
+
+#include "gd32f1x0.h"
+#include "../Inc/config.h"
+#include "../Inc/foc.h"
+
+// States of the hall sensor learning
+typedef enum
+{
+	HALL_LEARN_IDLE = 0,						// Tables from flash or defaults in use
+	HALL_LEARN_ALIGN = 1,						// Rotor is aligned to the start angle
+	HALL_LEARN_FORWARD = 2,					// Open loop rotation forwards, hall edges are recorded
+	HALL_LEARN_BACKWARD = 3,				// Open loop rotation backwards, hall edges are recorded
+	HALL_LEARN_EVALUATE = 4,				// Recording finished, evaluation pending in main loop
+	HALL_LEARN_DONE = 5,						// Learned tables validated, in use and stored in flash
+	HALL_LEARN_FAILED = 6						// Learning aborted or not valid, previous tables in use
+} HALL_LEARN_STATE;
+
+// Block PWM-position of an electrical angle (sector of +-30 degrees around the center)
+#define HALL_ANGLE_TO_POS(angle) ((((uint16_t)((angle) + ANGLE_30_DEG) / ANGLE_60_DEG) + 3) % 6 + 1)
+
+//----------------------------------------------------------------------------
+// Loads learned tables from flash, defaults when none are stored
+//----------------------------------------------------------------------------
+void HALL_Init(void);
+
+//----------------------------------------------------------------------------
+// Starts hall sensor learning (motor spins open loop!)
+// -> refused while the motor turns or a command is set, a command set
+//    during learning aborts it (see CalculateBLDC)
+//----------------------------------------------------------------------------
+ErrStatus HALL_StartLearning(void);
+
+//----------------------------------------------------------------------------
+// Aborts a running hall sensor learning
+//----------------------------------------------------------------------------
+void HALL_AbortLearning(void);
+
+//----------------------------------------------------------------------------
+// Returns if the learning drives the motor
+//----------------------------------------------------------------------------
+FlagStatus HALL_IsLearning(void);
+
+//----------------------------------------------------------------------------
+// Returns state of the hall sensor learning
+//----------------------------------------------------------------------------
+HALL_LEARN_STATE HALL_GetLearnState(void);
+
+//----------------------------------------------------------------------------
+// Returns if hall_direction has been measured by a learning (stored in flash)
+//----------------------------------------------------------------------------
+FlagStatus HALL_IsDirectionLearned(void);
+
+//----------------------------------------------------------------------------
+// Records hall edges and returns the open loop angle => called from ISR
+//----------------------------------------------------------------------------
+uint16_t HALL_Learn(uint8_t hall);
+
+//----------------------------------------------------------------------------
+// Evaluates and stores finished learning => called from main loop
+//----------------------------------------------------------------------------
+void HALL_Update(void);
+
+#endif
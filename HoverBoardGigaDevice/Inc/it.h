@@ -35,18 +35,8 @@
 #include "../Inc/config.h"
 
 //----------------------------------------------------------------------------
-// Resets the timeout to zero
+// Restarts the timeout (called by every valid steering/master frame)
 //----------------------------------------------------------------------------
 void ResetTimeout(void);
 
-//----------------------------------------------------------------------------
-// Returns number of milliseconds since system start
-//----------------------------------------------------------------------------
-uint32_t millis( void );
-
-//----------------------------------------------------------------------------
-// Delays number of tick Systicks (happens every 10 ms)
-//----------------------------------------------------------------------------
-void Delay (uint32_t dlyTicks);
-
 #endif
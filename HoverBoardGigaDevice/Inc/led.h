@@ -50,7 +50,7 @@ typedef enum
 #define COUNT_PROGRAMS 6	// Count of LED programs!!
 
 //----------------------------------------------------------------------------
-// Update RGB LED output with 16kHz
+// Update RGB LED output at the start of every LED PWM period (1kHz)
 //----------------------------------------------------------------------------
 void CalculateLEDPWM(void);
 
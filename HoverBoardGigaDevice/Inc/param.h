@@ -0,0 +1,102 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef PARAM_H
+#define PARAM_H
+
+#include "gd32f1x0.h"
+#include "../Inc/config.h"
+
+// Identifiers of the stored parameters (same table on master and slave, new
+// parameters are only appended to keep stored records valid)
+typedef enum
+{
+	PARAM_DC_CUR_LIMIT = 0,					// Motor DC current limit [A]
+	PARAM_TIMEOUT_MS = 1,						// Time without steering commands before pwm emergency off [ms]
+	PARAM_COMMUTATION_MODE = 2,			// Commutation after startup
+	PARAM_CONTROL_MODE = 3,					// Control after startup
+	PARAM_INACTIVITY_TIMEOUT = 4,		// Minutes of not driving until poweroff (master)
+	PARAM_BAT_LOW_LVL1 = 5,					// Battery level for gentle beeps [mV] (master)
+	PARAM_BAT_LOW_LVL2 = 6,					// Battery level almost empty [mV] (master)
+	PARAM_BAT_LOW_DEAD = 7,					// Battery level undervoltage lockout [mV] (master)
+	PARAM_SPEED_COEFFICIENT = 8,		// Speed coefficient [%] (master)
+	PARAM_STEER_COEFFICIENT = 9,		// Steer coefficient [%] (master)
+	PARAM_LED_PROGRAM = 10,					// LED program (slave)
+	PARAM_LED_HUE = 11,							// LED hue (slave)
+	PARAM_LED_SATURATION = 12,			// LED saturation (slave)
+	PARAM_LED_BRIGHTNESS = 13,			// LED brightness (slave)
+	PARAM_LED_SPEED_FADING = 14,		// LED fading delay (slave)
+	PARAM_LED_SPEED_BLINK = 15,			// LED blink delay (slave)
+	PARAM_LED_SPEED_STROBE = 16,		// LED strobe delay (slave)
+	COUNT_PARAMS = 17
+} PARAM_ID;
+
+#define PARAM_NONE 0xFF						// No parameter (master slave frame)
+
+// Storage type of a parameter (transfer as 16 bit value)
+typedef enum
+{
+	PARAM_TYPE_UINT8 = 0,
+	PARAM_TYPE_UINT16 = 1,
+	PARAM_TYPE_INT16 = 2
+} PARAM_TYPE;
+
+//----------------------------------------------------------------------------
+// Loads parameters from flash and applies them
+//----------------------------------------------------------------------------
+void PARAM_Init(void);
+
+//----------------------------------------------------------------------------
+// Returns parameter value
+//----------------------------------------------------------------------------
+int32_t PARAM_Get(PARAM_ID identifier);
+
+//----------------------------------------------------------------------------
+// Sets and applies parameter value, flash is written by PARAM_Update
+//----------------------------------------------------------------------------
+void PARAM_Set(PARAM_ID identifier, int32_t value);
+
+//----------------------------------------------------------------------------
+// Returns value limited to the range of the parameter
+//----------------------------------------------------------------------------
+int32_t PARAM_Limit(PARAM_ID identifier, int32_t value);
+
+//----------------------------------------------------------------------------
+// Returns parameter value from a 16 bit transfer value
+//----------------------------------------------------------------------------
+int32_t PARAM_Decode(PARAM_ID identifier, int16_t value);
+
+//----------------------------------------------------------------------------
+// Writes changed parameters to flash => called from main loop
+//----------------------------------------------------------------------------
+void PARAM_Update(void);
+
+#endif
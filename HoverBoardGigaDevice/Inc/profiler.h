@@ -0,0 +1,97 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "gd32f1x0.h"
+#include "../Inc/config.h"
+
+// Cycles available for one calculation ISR (timer update every 31,25us at 72MHz)
+#define PROFILER_BUDGET_CYCLES (72000000 / 2 / PWM_FREQ)
+
+// Sections measured inside CalculateBLDC, each one ends with PROFILER_MARK
+typedef enum
+{
+	PROFILER_SECTION_MEASURE = 0,			// ADC values and current chopping
+	PROFILER_SECTION_HALL = 1,				// Hall sensors, sector timing and pwm filter
+	PROFILER_SECTION_COMMUTATION = 2,	// Block or sinus calculation
+	PROFILER_SECTION_OUTPUT = 3				// PWM registers and speed calculation
+} PROFILER_SECTION;
+#define COUNT_PROFILER_SECTIONS 4	// Count of profiler sections!!
+
+// Values provided for telemetry (cycles, overruns as count)
+typedef enum
+{
+	PROFILER_ISR_MIN = 0,
+	PROFILER_ISR_AVG = 1,
+	PROFILER_ISR_MAX = 2,
+	PROFILER_ISR_OVERRUNS = 3,
+	PROFILER_SECTION_AVG = 4,					// Average of section 0, following sections at +1, +2, ...
+	PROFILER_SECTION_MAX = 8					// Maximum of section 0, following sections at +1, +2, ...
+} PROFILER_VALUE;
+#define COUNT_PROFILER_VALUES 12	// Count of profiler values!!
+
+#ifdef PROFILER
+// Cycle counter value at the end of each section
+extern uint32_t profilerStamp[COUNT_PROFILER_SECTIONS];
+
+// Start and end of the measured ISR, section marks only store the cycle counter
+#define PROFILER_ISR_START()			ProfilerISRStart()
+#define PROFILER_ISR_END()				ProfilerISREnd()
+#define PROFILER_MARK(section)		profilerStamp[section] = DWT->CYCCNT
+#else
+#define PROFILER_ISR_START()
+#define PROFILER_ISR_END()
+#define PROFILER_MARK(section)
+#endif
+
+//----------------------------------------------------------------------------
+// Stores the cycle counter at the beginning of the ISR
+//----------------------------------------------------------------------------
+void ProfilerISRStart(void);
+
+//----------------------------------------------------------------------------
+// Evaluates ISR and section cycles at the end of the ISR
+//----------------------------------------------------------------------------
+void ProfilerISREnd(void);
+
+//----------------------------------------------------------------------------
+// Requests reset of min/max values and overrun count (done in next ISR)
+//----------------------------------------------------------------------------
+void ProfilerReset(void);
+
+//----------------------------------------------------------------------------
+// Returns profiler value (saturated to int16 range for telemetry)
+//----------------------------------------------------------------------------
+int16_t GetProfilerValue(PROFILER_VALUE value);
+
+#endif
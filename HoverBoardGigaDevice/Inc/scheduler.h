@@ -0,0 +1,77 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "gd32f1x0.h"
+#include "../Inc/config.h"
+
+// Tasks of the main loop, same list on master and slave so that telemetry
+// has one layout (tasks without function are not run)
+typedef enum
+{
+	SCHEDULER_TASK_STEERING = 0,			// Request steering data (master)
+	SCHEDULER_TASK_SLAVE_FRAME = 1,		// Mix speed and steering, set pwm and send slave frame (master)
+	SCHEDULER_TASK_BATTERY = 2,				// Battery level, shut off when battery is dead (master)
+	SCHEDULER_TASK_INACTIVITY = 3,		// Power button and inactivity timeout (master)
+	SCHEDULER_TASK_SIGNALS = 4,				// Battery LEDs and buzzer sound (master)
+	SCHEDULER_TASK_STORAGE = 5				// Store hall learning result and parameters in flash
+} SCHEDULER_TASK;
+#define COUNT_SCHEDULER_TASKS 6	// Count of scheduler tasks!!
+
+// Values provided for telemetry per task
+typedef enum
+{
+	SCHEDULER_RUNTIME_AVG = 0,				// Average run time in us (including interrupts)
+	SCHEDULER_RUNTIME_MAX = 1,				// Maximum run time in us (including interrupts)
+	SCHEDULER_DEADLINE_MISSES = 2,		// Count of releases skipped because the task started too late
+	SCHEDULER_LATENCY_MAX = 3					// Maximum delay from release to start in us
+} SCHEDULER_VALUE;
+#define COUNT_SCHEDULER_VALUES 4	// Count of scheduler values!!
+
+//----------------------------------------------------------------------------
+// Adds task to the scheduler, first run is at the next call of SCHEDULER_Run
+//----------------------------------------------------------------------------
+void SCHEDULER_AddTask(SCHEDULER_TASK task, void (*function)(void), uint16_t period_ms);
+
+//----------------------------------------------------------------------------
+// Runs all due tasks and sleeps until the next interrupt => called in main loop
+//----------------------------------------------------------------------------
+void SCHEDULER_Run(void);
+
+//----------------------------------------------------------------------------
+// Returns scheduler value of a task (saturated to int16 range for telemetry)
+//----------------------------------------------------------------------------
+int16_t SCHEDULER_GetValue(SCHEDULER_TASK task, SCHEDULER_VALUE value);
+
+#endif
@@ -35,11 +35,13 @@
 #include "../Inc/config.h"
 
 
-#define USART_MASTERSLAVE_RX_BUFFERSIZE 1
+#define USART_MASTERSLAVE_RX_BUFFERSIZE 32	// Circular DMA buffer, processed on idle line, half and full transfer
 #define USART_MASTERSLAVE_DATA_RX_ADDRESS ((uint32_t)0x40004424)
+#define USART_MASTERSLAVE_DATA_TX_ADDRESS ((uint32_t)0x40004428)
 
-#define USART_STEER_COM_RX_BUFFERSIZE 1
+#define USART_STEER_COM_RX_BUFFERSIZE 32		// Circular DMA buffer, processed on idle line, half and full transfer
 #define USART_STEER_COM_DATA_RX_ADDRESS ((uint32_t)0x40013824)
+#define USART_STEER_COM_DATA_TX_ADDRESS ((uint32_t)0x40013828)
 
 //----------------------------------------------------------------------------
 // Initializes the interrupts
@@ -52,20 +54,44 @@ void Interrupt_init(void);
 ErrStatus Watchdog_init(void);
 
 //----------------------------------------------------------------------------
-// Initializes the timeout timer
+// Initializes the DWT cycle counter
 //----------------------------------------------------------------------------
-void TimeoutTimer_init(void);
+void CycleCounter_init(void);
+
+//----------------------------------------------------------------------------
+// Initializes the timebase (1ms systick)
+//----------------------------------------------------------------------------
+void Timebase_init(void);
 
 //----------------------------------------------------------------------------
 // Initializes the GPIOs
 //----------------------------------------------------------------------------
 void GPIO_init(void);
 
+//----------------------------------------------------------------------------
+// Initializes the hall sensor edge interrupts
+//----------------------------------------------------------------------------
+void HallSensor_init(void);
+
 //----------------------------------------------------------------------------
 // Initializes the PWM
 //----------------------------------------------------------------------------
 void PWM_init(void);
 
+#ifdef MASTER
+//----------------------------------------------------------------------------
+// Initializes the buzzer tone generator
+//----------------------------------------------------------------------------
+void Buzzer_init(void);
+#endif
+
+#ifdef SLAVE
+//----------------------------------------------------------------------------
+// Initializes the RGB LED PWM
+//----------------------------------------------------------------------------
+void LED_PWM_init(void);
+#endif
+
 //----------------------------------------------------------------------------
 // Initializes the ADC
 //----------------------------------------------------------------------------
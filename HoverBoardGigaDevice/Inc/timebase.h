@@ -0,0 +1,81 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include "gd32f1x0.h"
+#include "../Inc/config.h"
+
+// Software timers driven by the 1ms systick (callbacks run in the systick interrupt)
+typedef enum
+{
+	TIMEBASE_TIMER_TIMEOUT = 0,				// Emergency off without steering/master commands (one shot, restarted by every frame)
+	TIMEBASE_TIMER_ANALOG = 1,				// Filtered analog values
+	TIMEBASE_TIMER_BUZZER = 2,				// Buzzer sequencer (master)
+	TIMEBASE_TIMER_HORN = 3,					// Limits horn to 2 seconds (slave, one shot)
+	TIMEBASE_TIMER_LED = 4						// RGB LED program (slave)
+} TIMEBASE_TIMER;
+#define COUNT_TIMEBASE_TIMERS 5	// Count of software timers!!
+
+//----------------------------------------------------------------------------
+// Counts milliseconds and runs expired software timers => called by systick
+//----------------------------------------------------------------------------
+void TIMEBASE_Tick(void);
+
+//----------------------------------------------------------------------------
+// Starts (or restarts) software timer, period 0 means one shot
+//----------------------------------------------------------------------------
+void TIMEBASE_StartTimer(TIMEBASE_TIMER timer, void (*callback)(void), uint16_t delay_ms, uint16_t period_ms);
+
+//----------------------------------------------------------------------------
+// Stops software timer
+//----------------------------------------------------------------------------
+void TIMEBASE_StopTimer(TIMEBASE_TIMER timer);
+
+//----------------------------------------------------------------------------
+// Returns number of milliseconds since system start
+//----------------------------------------------------------------------------
+uint32_t millis(void);
+
+//----------------------------------------------------------------------------
+// Returns number of microseconds since system start (overflows after 71 min,
+// differences stay valid)
+//----------------------------------------------------------------------------
+uint32_t micros(void);
+
+//----------------------------------------------------------------------------
+// Delays number of milliseconds, sleeps meanwhile
+//----------------------------------------------------------------------------
+void Delay(uint32_t delay_ms);
+
+#endif
@@ -19,6 +19,8 @@
 #define RTE_DEVICE_STDPERIPHERALS_ADC
 #define RTE_DEVICE_STDPERIPHERALS_DBG
 #define RTE_DEVICE_STDPERIPHERALS_DMA
+#define RTE_DEVICE_STDPERIPHERALS_EXTI
+#define RTE_DEVICE_STDPERIPHERALS_FMC
 #define RTE_DEVICE_STDPERIPHERALS_FWDGT
 #define RTE_DEVICE_STDPERIPHERALS_GPIO
 #define RTE_DEVICE_STDPERIPHERALS_I2C
@@ -0,0 +1,149 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "gd32f1x0.h"
+#include "../Inc/analog.h"
+#include "../Inc/defines.h"
+
+// Nominal supply voltage the conversion factors of defines.h refer to
+#define ANALOG_NOMINAL_MV     3300
+
+// Internal reference voltage, temperature sensor voltage at 25°C and slope
+#define ANALOG_VREFINT_MV     1200
+#define ANALOG_TEMP_V25_MV    1450
+#define ANALOG_TEMP_SLOPE_UV  4100
+
+// Battery voltage divider (V_Batt to V_BattMeasure)
+#define ANALOG_BATTERY_DIVIDER 30
+
+// DMA buffer, filled by the continuous regular scan
+uint16_t analog_buffer[ANALOG_BUFFER_SIZE];
+
+// Global variables for calibrated values
+extern int32_t batteryVoltage_mV;
+int32_t currentDCFiltered_mA = 0;
+int32_t analogInput_mV = 0;
+int32_t temperature_dC = 250;
+int32_t supplyVoltage_mV = ANALOG_NOMINAL_MV;
+int32_t analogSupply_Q10 = 1024;
+
+// Offset of the DC current measured by the calculation ISR
+extern int16_t offsetdc;
+
+// Decimating low-pass filter per channel: rank k (1ms per step)
+static const uint8_t analogFilterShift[COUNT_ANALOG_CHANNELS] =
+{
+	12,	// ANALOG_VBATT: 4096ms (undervoltage shut off must not react to sag under load)
+	3,	// ANALOG_CURRENT_DC: 8ms
+	4,	// ANALOG_INPUT: 16ms
+	8,	// ANALOG_TEMPERATURE: 256ms
+	8		// ANALOG_VREFINT: 256ms
+};
+
+static int32_t analogFilter_reg[COUNT_ANALOG_CHANNELS];
+static FlagStatus analogStarted = RESET;
+
+//----------------------------------------------------------------------------
+// Calculates filtered and calibrated analog values => called every 1ms
+//----------------------------------------------------------------------------
+void CalculateAnalog(void)
+{
+	int32_t sum[COUNT_ANALOG_CHANNELS] = {0};
+	int32_t vrefint;
+	int32_t millivolt;
+	uint8_t index;
+	uint8_t channel;
+	
+	// Average all scan sequences of the buffer (oversampling, the DMA keeps
+	// writing meanwhile which only mixes in newer samples)
+	for (index = 0; index < ANALOG_BUFFER_SIZE; index += COUNT_ANALOG_CHANNELS)
+	{
+		for (channel = 0; channel < COUNT_ANALOG_CHANNELS; channel++)
+		{
+			sum[channel] += analog_buffer[index + channel];
+		}
+	}
+	
+	// No scan finished yet (reference voltage is never zero)
+	if (sum[ANALOG_VREFINT] == 0)
+	{
+		return;
+	}
+	
+	// Filter each channel, first call initializes the filters
+	for (channel = 0; channel < COUNT_ANALOG_CHANNELS; channel++)
+	{
+		if (analogStarted == RESET)
+		{
+			analogFilter_reg[channel] = sum[channel] << analogFilterShift[channel];
+		}
+		else
+		{
+			analogFilter_reg[channel] += sum[channel] - (analogFilter_reg[channel] >> analogFilterShift[channel]);
+		}
+	}
+	analogStarted = SET;
+	
+	// Supply voltage from the internal reference, all conversions are corrected by it
+	vrefint = GetAnalogRaw(ANALOG_VREFINT);
+	if (vrefint > 0)
+	{
+		supplyVoltage_mV = ANALOG_VREFINT_MV * ANALOG_FULL_SCALE / vrefint;
+	}
+	analogSupply_Q10 = (supplyVoltage_mV << 10) / ANALOG_NOMINAL_MV;
+	
+	// Battery voltage
+	millivolt = GetAnalogRaw(ANALOG_VBATT) * supplyVoltage_mV / ANALOG_FULL_SCALE;
+	batteryVoltage_mV = millivolt * ANALOG_BATTERY_DIVIDER;
+	
+	// DC current (offset in counts of a single sample)
+	currentDCFiltered_mA = (((GetAnalogRaw(ANALOG_CURRENT_DC) - offsetdc * ANALOG_OVERSAMPLING) * (MOTOR_MILLIAMP_CONV_DC_Q10 / ANALOG_OVERSAMPLING)) >> 10) * analogSupply_Q10 >> 10;
+	
+	// Free analog input
+	analogInput_mV = GetAnalogRaw(ANALOG_INPUT) * supplyVoltage_mV / ANALOG_FULL_SCALE;
+	
+	// Temperature in 0.1°C
+	millivolt = GetAnalogRaw(ANALOG_TEMPERATURE) * supplyVoltage_mV / ANALOG_FULL_SCALE;
+	temperature_dC = (ANALOG_TEMP_V25_MV - millivolt) * 10000 / ANALOG_TEMP_SLOPE_UV + 250;
+}
+
+//----------------------------------------------------------------------------
+// Returns filtered raw value of a channel (sum of ANALOG_OVERSAMPLING samples)
+//----------------------------------------------------------------------------
+int32_t GetAnalogRaw(ANALOG_CHANNEL channel)
+{
+	if (channel >= COUNT_ANALOG_CHANNELS)
+	{
+		return 0;
+	}
+	
+	return analogFilter_reg[channel] >> analogFilterShift[channel];
+}
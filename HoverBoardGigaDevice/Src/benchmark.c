@@ -0,0 +1,259 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "gd32f1x0.h"
+#include "../Inc/benchmark.h"
+#include "../Inc/bldc.h"
+#include "../Inc/led.h"
+#include "../Inc/comms.h"
+#include "../Inc/defines.h"
+#include "../Inc/profiler.h"
+#include "stdio.h"
+#include "string.h"
+
+#ifdef BENCHMARK
+// CRC is measured with the master to slave frame (without crc and stop byte)
+#define BENCHMARK_CRC_BYTES 7
+
+// Function measured by the benchmark
+typedef struct
+{
+	const char *name;
+	void (*setup)(void);							// Called before the function is measured (NULL if not needed)
+	void (*function)(void);
+} BENCHMARK_FUNCTION;
+
+#ifdef MASTER
+// Mixer of the main loop
+void MixSpeedSteer(int32_t speedInput, int32_t steerInput, int16_t *pwmMaster, int16_t *pwmSlave);
+#endif
+
+static void BenchmarkEmpty(void);
+static void BenchmarkSetupBlock(void);
+static void BenchmarkSetupSinus(void);
+static void BenchmarkCRC(void);
+#ifdef MASTER
+static void BenchmarkMixer(void);
+#endif
+
+// Functions of the calculation ISR and the main loop, CalculateBLDC runs with
+// the outputs as they are (disabled during startup), all of it is calculated
+static const BENCHMARK_FUNCTION benchmarkFunctions[COUNT_BENCHMARKS] =
+{
+	{"CalculateBLDC block", BenchmarkSetupBlock, CalculateBLDC},
+	{"CalculateBLDC sinus", BenchmarkSetupSinus, CalculateBLDC},
+#ifdef SLAVE
+	{"CalculateLEDPWM", NULL, CalculateLEDPWM},
+#endif
+	{"CalcCRC", NULL, BenchmarkCRC},
+#ifdef MASTER
+	{"MixSpeedSteer", NULL, BenchmarkMixer}
+#endif
+};
+
+// Inputs and results of the measured functions (results are volatile, so
+// the calls are not optimized away)
+static uint8_t benchmarkFrame[BENCHMARK_CRC_BYTES] = {'/', 0x01, 0xF4, 0x02, 0x00, 0x64, 0x01};
+static volatile uint16_t benchmarkCRC = 0;
+#ifdef MASTER
+static uint16_t benchmarkMixerCall = 0;
+static volatile int16_t benchmarkPwmMaster = 0;
+static volatile int16_t benchmarkPwmSlave = 0;
+#endif
+
+//----------------------------------------------------------------------------
+// Empty function, measures the overhead of the measurement
+//----------------------------------------------------------------------------
+static void BenchmarkEmpty(void)
+{
+}
+
+//----------------------------------------------------------------------------
+// Selects block commutation
+//----------------------------------------------------------------------------
+static void BenchmarkSetupBlock(void)
+{
+	SetCommutationMode(COMMUTATION_BLOCK);
+}
+
+//----------------------------------------------------------------------------
+// Selects sinus commutation
+//----------------------------------------------------------------------------
+static void BenchmarkSetupSinus(void)
+{
+	SetCommutationMode(COMMUTATION_SINUS);
+}
+
+//----------------------------------------------------------------------------
+// Calculates CRC of a master to slave frame
+//----------------------------------------------------------------------------
+static void BenchmarkCRC(void)
+{
+	benchmarkCRC = CalcCRC(benchmarkFrame, BENCHMARK_CRC_BYTES);
+}
+
+#ifdef MASTER
+//----------------------------------------------------------------------------
+// Mixes speed and steering, steering alternates between left and right to
+// measure both branches of the mixer
+//----------------------------------------------------------------------------
+static void BenchmarkMixer(void)
+{
+	int16_t pwmMaster = 0;
+	int16_t pwmSlave = 0;
+	
+	benchmarkMixerCall++;
+	MixSpeedSteer(600, (benchmarkMixerCall & 1) ? 400 : -400, &pwmMaster, &pwmSlave);
+	benchmarkPwmMaster = pwmMaster;
+	benchmarkPwmSlave = pwmSlave;
+}
+#endif
+
+//----------------------------------------------------------------------------
+// Measures one function, offset is subtracted from every call
+//----------------------------------------------------------------------------
+static void BenchmarkFunction(void (*function)(void), uint32_t (*counter)(void), uint32_t offset, BENCHMARK_RESULT *result)
+{
+	uint32_t start = 0;
+	uint32_t ticks = 0;
+	uint32_t sum = 0;
+	uint16_t index = 0;
+	
+	// Warm up, e.g. ADC offset calibration of CalculateBLDC
+	for (index = 0; index < BENCHMARK_CALLS; index++)
+	{
+		function();
+	}
+	
+	result->min = 0xFFFFFFFF;
+	result->max = 0;
+	for (index = 0; index < BENCHMARK_CALLS; index++)
+	{
+		start = counter();
+		function();
+		ticks = counter() - start;
+		ticks = ticks > offset ? ticks - offset : 0;
+		
+		if (ticks < result->min)
+		{
+			result->min = ticks;
+		}
+		if (ticks > result->max)
+		{
+			result->max = ticks;
+		}
+		sum += ticks;
+	}
+	result->avg = sum / BENCHMARK_CALLS;
+	
+	// Reload watchdog after every function
+	fwdgt_counter_reload();
+}
+
+//----------------------------------------------------------------------------
+// Measures all functions with the given counter
+//----------------------------------------------------------------------------
+void BenchmarkMeasure(BENCHMARK_RESULT results[COUNT_BENCHMARKS], uint32_t (*counter)(void))
+{
+	BENCHMARK_RESULT empty;
+	COMMUTATION_MODE mode = GetCommutationMode();
+	uint32_t primask = __get_PRIMASK();
+	uint8_t index = 0;
+	
+	// Interrupts would be measured with the functions
+	__disable_irq();
+	
+	// Overhead of the counter and the call
+	BenchmarkFunction(BenchmarkEmpty, counter, 0, &empty);
+	
+	for (index = 0; index < COUNT_BENCHMARKS; index++)
+	{
+		if (benchmarkFunctions[index].setup != NULL)
+		{
+			benchmarkFunctions[index].setup();
+		}
+		results[index].name = benchmarkFunctions[index].name;
+		BenchmarkFunction(benchmarkFunctions[index].function, counter, empty.min, &results[index]);
+	}
+	
+	SetCommutationMode(mode);
+	__set_PRIMASK(primask);
+}
+
+//----------------------------------------------------------------------------
+// Returns DWT cycle counter
+//----------------------------------------------------------------------------
+static uint32_t BenchmarkCycles(void)
+{
+	return DWT->CYCCNT;
+}
+
+//----------------------------------------------------------------------------
+// Prints text over USART_STEER_COM, waits until it has been sent
+//----------------------------------------------------------------------------
+static void BenchmarkPrint(char text[])
+{
+	uint16_t length = strlen(text);
+	uint16_t index = 0;
+	uint16_t part = 0;
+	
+	// Transmit queue takes frames up to USART_TX_FRAME_SIZE
+	for (index = 0; index < length; index += part)
+	{
+		part = length - index < USART_TX_FRAME_SIZE ? length - index : USART_TX_FRAME_SIZE;
+		SendBuffer(USART_STEER_COM, (uint8_t *)&text[index], part);
+		FlushBuffer(USART_STEER_COM);
+	}
+	fwdgt_counter_reload();
+}
+
+//----------------------------------------------------------------------------
+// Measures all functions with the DWT cycle counter and prints the table
+// over USART_STEER_COM
+//----------------------------------------------------------------------------
+void BenchmarkRun(void)
+{
+	BENCHMARK_RESULT results[COUNT_BENCHMARKS];
+	char line[64];
+	uint8_t index = 0;
+	
+	BenchmarkMeasure(results, BenchmarkCycles);
+	
+	sprintf(line, "%-20s%8s%8s%8s\n", "Cycles per call", "min", "avg", "max");
+	BenchmarkPrint(line);
+	for (index = 0; index < COUNT_BENCHMARKS; index++)
+	{
+		sprintf(line, "%-20s%8d%8d%8d\n", results[index].name, (int)results[index].min, (int)results[index].avg, (int)results[index].max);
+		BenchmarkPrint(line);
+	}
+	sprintf(line, "%-20s%8d\n", "ISR budget", PROFILER_BUDGET_CYCLES);
+	BenchmarkPrint(line);
+}
+#endif
@@ -32,23 +32,66 @@
 #include "../Inc/setup.h"
 #include "../Inc/defines.h"
 #include "../Inc/config.h"
+#include "../Inc/bldc.h"
+#include "../Inc/foc.h"
+#include "../Inc/control.h"
+#include "../Inc/profiler.h"
+#include "../Inc/hall.h"
+#include "../Inc/param.h"
 
 // Internal constants
-const int16_t pwm_res = 72000000 / 2 / PWM_FREQ; // = 2000
+const int16_t pwm_res = 72000000 / 2 / PWM_FREQ; // = 2250
 
-// Global variables for voltage and current
-float batteryVoltage = 40.0;
-float currentDC = 0.0;
-float realSpeed = 0.0;
+// Amplitude scaling for sinus commutation: 2/sqrt(3) in Q15. With space vector
+// modulation the phase to phase voltage then equals the one of block commutation
+#define SINUS_AMPLITUDE_SCALE 37837
+
+// Sector time in calculation cycles above which no angle interpolation is done
+#define SINUS_MAX_SECTOR_TIME 4000
+
+// Field weakening: phase advance as electrical angle
+#define FIELD_WEAKENING_ADVANCE ((int32_t)FIELD_WEAKENING_ANGLE * 65536 / 360)
+
+// Regen current must be limited before the current chopping cuts the output
+#if defined(REGEN_BRAKING) && REGEN_CURRENT_MAX_MA >= DC_CUR_LIMIT * 1000
+#error "REGEN_CURRENT_MAX_MA has to be below DC_CUR_LIMIT"
+#endif
+
+// Ramp slopes from config (per second) in Q20 per calculation cycle
+#define RAMP_PER_CYCLE(rate)  ((int32_t)(((int64_t)(rate) << RAMP_SHIFT) / BLDC_CALC_FREQ))
+#define RAMP_PER_CYCLE2(rate) ((int32_t)(((int64_t)(rate) << RAMP_SHIFT) / BLDC_CALC_FREQ / BLDC_CALC_FREQ))
+
+// Speed conversion: distance of one electrical revolution (1991.81 km/h * 62.5us)
+// divided by one sixth revolution in core clock cycles (72MHz), in m/h
+#define SPEED_EDGE_CONV_MH    1493857500
+#define HALL_EDGES            6 					// Hall edges per electrical revolution
+#define HALL_MIN_EDGE_CYCLES  10000 			// Shorter edge periods are treated as bouncing
+#define HALL_TIMEOUT_CYCLES   18000000		// No speed after 250ms without hall edge
+#define HALL_TAILCHAIN_CYCLES 500				// EXTI entry right after the calculation ISR
+#define HALL_EXTI_MASK        (HALL_A_EXTI | HALL_B_EXTI | HALL_C_EXTI)
+
+// Global variables for voltage, current and speed (integer, no soft-float in the ISR)
+int32_t batteryVoltage_mV = 40000;
+int32_t currentDC_mA = 0;
+int32_t realSpeed_mh = 0;
+
+// Supply voltage correction of the conversion factors (analog.c)
+extern int32_t analogSupply_Q10;
 
 // Timeoutvariable set by timeout timer
 extern FlagStatus timedOut;
 
+// Commutation tables (learned or default)
+extern uint8_t hall_to_pos[8];
+extern uint16_t pos_to_angle[7];
+extern int8_t hall_direction;
+
 // Variables to be set from the main routine
 int16_t bldc_inputFilterPwm = 0;
 FlagStatus bldc_enable = RESET;
+FlagStatus bldc_weakening = RESET;
 
-// ADC buffer to be filled by DMA
+// ADC buffer to be filled by the ADC interrupt (inserted group)
 adc_buf_t adc_buffer;
 
 // Internal calculation variables
@@ -59,30 +102,38 @@ uint8_t hall;
 uint8_t pos;
 uint8_t lastPos;
 int16_t bldc_outputFilterPwm = 0;
-int32_t filter_reg;
-FlagStatus buzzerToggle = RESET;
-uint8_t buzzerFreq = 0;
-uint8_t buzzerPattern = 0;
-uint16_t buzzerTimer = 0;
+uint8_t bldcFaults = 0;
+RAMP commandRamp = {0, 0, RAMP_PER_CYCLE(RAMP_ACCEL), RAMP_PER_CYCLE(RAMP_DECEL), RAMP_PER_CYCLE(RAMP_REVERSAL), RAMP_PER_CYCLE2(RAMP_JERK)};
+int32_t command = 0;
 int16_t offsetcount = 0;
 int16_t offsetdc = 2000;
-uint32_t speedCounter = 0;
-
-//----------------------------------------------------------------------------
-// Commutation table
-//----------------------------------------------------------------------------
-const uint8_t hall_to_pos[8] =
-{
-	// annotation: for example SA=0 means hall sensor pulls SA down to Ground
-  0, // hall position [-] - No function (access from 1-6) 
-  3, // hall position [1] (SA=1, SB=0, SC=0) -> PWM-position 3
-  5, // hall position [2] (SA=0, SB=1, SC=0) -> PWM-position 5
-  4, // hall position [3] (SA=1, SB=1, SC=0) -> PWM-position 4
-  1, // hall position [4] (SA=0, SB=0, SC=1) -> PWM-position 1
-  2, // hall position [5] (SA=1, SB=0, SC=1) -> PWM-position 2
-  6, // hall position [6] (SA=0, SB=1, SC=1) -> PWM-position 6
-  0, // hall position [-] - No function (access from 1-6) 
-};
+uint32_t hallEdgeStamp = 0;
+FlagStatus hallEdgeStampValid = RESET;
+uint32_t hallCalcStartStamp = 0;
+uint32_t hallCalcEndStamp = 0;
+uint32_t hallCalcStartPending = 0;
+uint32_t hallCalcEndPending = 0;
+uint32_t hallEdgePeriod[HALL_EDGES];
+uint32_t hallEdgePeriodSum = 0;
+uint8_t hallEdgePeriodCount = 0;
+uint8_t hallEdgeIndex = 0;
+uint32_t sectorCounter = 0;
+uint32_t sectorTime = SINUS_MAX_SECTOR_TIME;
+int8_t sectorDirection = 0;
+uint16_t electricalAngle = 0;
+COMMUTATION_MODE commutationMode = COMMUTATION_MODE_DEFAULT;
+CONTROL_MODE controlMode = CONTROL_MODE_DEFAULT;
+SPEED_CONTROLLER speedController = {{SPEED_KP, SPEED_KI, 0, -CONTROL_PWM_MAX, CONTROL_PWM_MAX}, SPEED_NOLOAD_MH, SPEED_NOMINAL_MV};
+uint8_t speedControlCounter = 0;
+uint8_t speedCurrentLimited = 0;
+int32_t speedTarget_mh = 0;
+TORQUE_CONTROLLER torqueController = {{TORQUE_KP, TORQUE_KI, 0, 0, CONTROL_PWM_MAX}, 0};
+int32_t torqueTarget_mA = 0;
+REGEN_LIMITER regenLimiter = {{REGEN_KP, REGEN_KI, (int32_t)CONTROL_PWM_MAX << 15, 0, CONTROL_PWM_MAX}, REGEN_CURRENT_MAX_MA, REGEN_VOLTAGE_MAX_MV};
+int32_t batteryVoltageFast_mV = 40000;
+FlagStatus regenVoltageLimited = RESET;
+int32_t weakening = 0;
+int32_t weakeningAdvance = 0;
 
 //----------------------------------------------------------------------------
 // Block PWM calculation based on position
@@ -128,6 +179,61 @@ __INLINE void blockPWM(int pwm, int pwmPos, int *y, int *b, int *g)
   }
 }
 
+//----------------------------------------------------------------------------
+// Sinus PWM calculation based on electrical angle (space vector modulation)
+//----------------------------------------------------------------------------
+__INLINE void sinusPWM(int pwm, uint16_t angle, int *y, int *b, int *g)
+{
+	int amplitude = (pwm * SINUS_AMPLITUDE_SCALE) >> 15;
+	int maximum;
+	int minimum;
+	int offset;
+	
+	// Sinusoidal phase voltages, shifted by 120 degrees each
+	*y = (amplitude * FOC_Sine(angle)) >> 15;
+	*b = (amplitude * FOC_Sine(angle - ANGLE_120_DEG)) >> 15;
+	*g = (amplitude * FOC_Sine(angle + ANGLE_120_DEG)) >> 15;
+	
+	// Inject common mode voltage (min/max method) to use the full bus voltage
+	maximum = *y > *b ? *y : *b;
+	maximum = maximum > *g ? maximum : *g;
+	minimum = *y < *b ? *y : *b;
+	minimum = minimum < *g ? minimum : *g;
+	offset = (maximum + minimum) / 2;
+	
+	*y -= offset;
+	*b -= offset;
+	*g -= offset;
+}
+
+//----------------------------------------------------------------------------
+// Calculates interpolated electrical angle based on position and sector time
+//----------------------------------------------------------------------------
+__INLINE uint16_t interpolateAngle(uint8_t pwmPos)
+{
+	uint16_t angle = pos_to_angle[pwmPos];
+	uint32_t delta = 0;
+	
+	// No interpolation at standstill or when direction is unknown
+	if (sectorDirection == 0 || sectorTime >= SINUS_MAX_SECTOR_TIME)
+	{
+		return angle;
+	}
+	
+	// Angle travelled inside of the sector, hold at sector end until next hall edge
+	delta = sectorCounter < sectorTime ? sectorCounter : sectorTime;
+	delta = (ANGLE_60_DEG * delta) / sectorTime;
+	
+	if (sectorDirection > 0)
+	{
+		return angle - ANGLE_30_DEG + delta;
+	}
+	else
+	{
+		return angle + ANGLE_30_DEG - delta;
+	}
+}
+
 //----------------------------------------------------------------------------
 // Set motor enable
 //----------------------------------------------------------------------------
@@ -145,13 +251,149 @@ void SetPWM(int16_t setPwm)
 }
 
 //----------------------------------------------------------------------------
-// Calculation-Routine for BLDC => calculates with 16kHz
+// Set commutation mode
+//----------------------------------------------------------------------------
+void SetCommutationMode(COMMUTATION_MODE mode)
+{
+	// Check mode count
+	if (!(mode < COUNT_COMMUTATION_MODES))
+	{
+		mode = COMMUTATION_BLOCK;
+	}
+	
+	commutationMode = mode;
+}
+
+//----------------------------------------------------------------------------
+// Get commutation mode
+//----------------------------------------------------------------------------
+COMMUTATION_MODE GetCommutationMode(void)
+{
+	return commutationMode;
+}
+
+//----------------------------------------------------------------------------
+// Set control mode
+//----------------------------------------------------------------------------
+void SetControlMode(CONTROL_MODE mode)
+{
+	// Check mode count
+	if (!(mode < COUNT_CONTROL_MODES))
+	{
+		mode = CONTROL_PWM;
+	}
+	
+	// Start speed and torque controller without history
+	SPEED_Reset(&speedController);
+	TORQUE_Reset(&torqueController);
+	
+	// Continue command ramp from the actual duty cycle or speed
+	if (mode == CONTROL_PWM)
+	{
+		RAMP_Set(&commandRamp, bldc_outputFilterPwm);
+	}
+	else if (mode == CONTROL_SPEED)
+	{
+		RAMP_Set(&commandRamp, CLAMP(realSpeed_mh * sectorDirection * hall_direction * CONTROL_PWM_MAX / SPEED_MAX_MH, -CONTROL_PWM_MAX, CONTROL_PWM_MAX));
+	}
+	else
+	{
+		RAMP_Set(&commandRamp, 0);
+	}
+	
+	controlMode = mode;
+}
+
+//----------------------------------------------------------------------------
+// Get control mode
+//----------------------------------------------------------------------------
+CONTROL_MODE GetControlMode(void)
+{
+	return controlMode;
+}
+
+//----------------------------------------------------------------------------
+// Set field weakening
+//----------------------------------------------------------------------------
+void SetWeakening(FlagStatus setWeakening)
+{
+	bldc_weakening = setWeakening;
+}
+
+//----------------------------------------------------------------------------
+// Get field weakening
+//----------------------------------------------------------------------------
+FlagStatus GetWeakening(void)
+{
+	return bldc_weakening;
+}
+
+//----------------------------------------------------------------------------
+// Returns if braking is reduced by the regen voltage ceiling
+//----------------------------------------------------------------------------
+FlagStatus GetRegenVoltageLimited(void)
+{
+	return regenVoltageLimited;
+}
+
+//----------------------------------------------------------------------------
+// Returns fault flags latched until acknowledged
+//----------------------------------------------------------------------------
+uint8_t GetFaults(void)
+{
+	// Faults are latched by the calculation ISR
+	uint8_t faults = bldcFaults;
+	
+	if (timedOut == SET)
+	{
+		faults |= BLDC_FAULT_TIMEOUT;
+	}
+	
+	return faults;
+}
+
+//----------------------------------------------------------------------------
+// Clears latched fault flags the other board has received
+//----------------------------------------------------------------------------
+void AcknowledgeFaults(uint8_t faults)
+{
+	uint32_t primask;
+	
+	// The calculation ISR latches new faults meanwhile
+	primask = __get_PRIMASK();
+	__disable_irq();
+	bldcFaults &= ~faults;
+	__set_PRIMASK(primask);
+}
+
+//----------------------------------------------------------------------------
+// Returns hall sensor inputs (bit 0 A, bit 1 B, bit 2 C)
+//----------------------------------------------------------------------------
+uint8_t GetHallState(void)
+{
+	return hall;
+}
+
+//----------------------------------------------------------------------------
+// Calculation-Routine for BLDC => calculates with 32kHz
 //----------------------------------------------------------------------------
 void CalculateBLDC(void)
 {
 	int y = 0;     // yellow = phase A
 	int b = 0;     // blue   = phase B
 	int g = 0;     // green  = phase C
+	FlagStatus outputEnabled = RESET;
+	FlagStatus overcurrent = RESET;
+	uint32_t elapsed = 0;
+	uint32_t period = 0;
+	uint8_t edgeCount = 0;
+#ifdef REGEN_BRAKING
+	int32_t regenPwm = 0;
+#endif
+	
+	// Hall edges are delayed by this ISR, CalculateHallEdge corrects their timestamps
+	hallCalcStartStamp = DWT->CYCCNT;
+	hallCalcStartPending = EXTI_PD & HALL_EXTI_MASK;
 	
 	// Calibrate ADC offsets for the first 1000 cycles
   if (offsetcount < 1000)
@@ -161,41 +403,53 @@ void CalculateBLDC(void)
     return;
   }
 	
-	// Calculate battery voltage every 100 cycles
-  if (buzzerTimer % 100 == 0)
-	{
-    batteryVoltage = batteryVoltage * 0.999 + ((float)adc_buffer.v_batt * ADC_BATTERY_VOLT) * 0.001;
-  }
+	// Calculate current DC (filtered battery voltage is calculated by analog.c),
+	// conversion corrected by the supply voltage measured with Vrefint
+	currentDC_mA = (((adc_buffer.current_dc - offsetdc) * MOTOR_MILLIAMP_CONV_DC_Q10) >> 10) * analogSupply_Q10 >> 10;
 	
-#ifdef MASTER
-	// Create square wave for buzzer
-  buzzerTimer++;
-  if (buzzerFreq != 0 && (buzzerTimer / 5000) % (buzzerPattern + 1) == 0)
+#ifdef REGEN_BRAKING
+	// Unfiltered battery voltage for the regen voltage ceiling, the filtered
+	// value of analog.c has a time constant of about 4 seconds
+	batteryVoltageFast_mV = ((adc_buffer.v_batt * ADC_BATTERY_MILLIVOLT_Q10) >> 10) * analogSupply_Q10 >> 10;
+#endif
+
+	// Current chopping is reported to the other board
+	overcurrent = ABS(currentDC_mA) > PARAM_Get(PARAM_DC_CUR_LIMIT) * 1000 ? SET : RESET;
+	if (overcurrent == SET)
 	{
-    if (buzzerTimer % buzzerFreq == 0)
-		{
-			buzzerToggle = buzzerToggle == RESET ? SET : RESET; // toggle variable
-		  gpio_bit_write(BUZZER_PORT, BUZZER_PIN, buzzerToggle);
-    }
-  }
-	else
+		bldcFaults |= BLDC_FAULT_OVERCURRENT;
+	}
+	
+	// A command takes over from the hall sensor learning
+	if (bldc_inputFilterPwm != 0)
 	{
-		gpio_bit_write(BUZZER_PORT, BUZZER_PIN, RESET);
-  }
-#endif
+		HALL_AbortLearning();
+	}
 	
-	// Calculate current DC
-	currentDC = ABS((adc_buffer.current_dc - offsetdc) * MOTOR_AMP_CONV_DC_AMP);
-
   // Disable PWM when current limit is reached (current chopping), enable is not set or timeout is reached
-	if (currentDC > DC_CUR_LIMIT || bldc_enable == RESET || timedOut == SET)
+	if (overcurrent == SET || bldc_enable == RESET || timedOut == SET)
 	{
 		timer_automatic_output_disable(TIMER_BLDC);		
+		
+		// Speed and torque controller only restart when the motor is switched off
+		if (bldc_enable == RESET || timedOut == SET)
+		{
+			SPEED_Reset(&speedController);
+			TORQUE_Reset(&torqueController);
+			REGEN_Reset(&regenLimiter);
+			HALL_AbortLearning();
+		}
+		else
+		{
+			speedCurrentLimited = 1;
+		}
   }
 	else
 	{
 		timer_automatic_output_enable(TIMER_BLDC);
+		outputEnabled = SET;
   }
+	PROFILER_MARK(PROFILER_SECTION_MEASURE);
 	
   // Read hall sensors
 	hall_a = gpio_input_bit_get(HALL_A_PORT, HALL_A_PIN);
@@ -205,39 +459,227 @@ void CalculateBLDC(void)
 	// Determine current position based on hall sensors
   hall = hall_a * 1 + hall_b * 2 + hall_c * 4;
   pos = hall_to_pos[hall];
+	if (pos == 0 && HALL_IsLearning() == RESET)
+	{
+		bldcFaults |= BLDC_FAULT_HALL;
+	}
+	
+	// Measure time spent in the last sector and determine direction of rotation
+	if (sectorCounter < SINUS_MAX_SECTOR_TIME)
+	{
+		sectorCounter++;
+	}
+	if (pos != lastPos)
+	{
+		if (pos == (lastPos % 6) + 1)
+		{
+			sectorDirection = 1;
+		}
+		else if (lastPos == (pos % 6) + 1)
+		{
+			sectorDirection = -1;
+		}
+		else
+		{
+			sectorDirection = 0;
+		}
+		sectorTime = sectorCounter;
+		sectorCounter = 0;
+	}
+	else if (sectorCounter >= SINUS_MAX_SECTOR_TIME)
+	{
+		sectorTime = SINUS_MAX_SECTOR_TIME;
+	}
+	
+	// Slew rate limited command (duty cycle, target speed or target current)
+	command = RAMP_Calculate(&commandRamp, bldc_inputFilterPwm);
+	
+	if (controlMode == CONTROL_SPEED)
+	{
+		// Speed controller with PWM_FREQ / SPEED_CONTROL_DIVIDER, input is the target speed
+		speedControlCounter++;
+		if (speedControlCounter >= SPEED_CONTROL_DIVIDER)
+		{
+			speedControlCounter = 0;
+			speedTarget_mh = command * SPEED_MAX_MH / CONTROL_PWM_MAX;
+			bldc_outputFilterPwm = SPEED_Calculate(&speedController, speedTarget_mh, realSpeed_mh * sectorDirection * hall_direction, batteryVoltage_mV, speedCurrentLimited);
+			speedCurrentLimited = 0;
+		}
+	}
+	else if (controlMode == CONTROL_TORQUE)
+	{
+		// DC current controller every cycle, input is the target current. Holds
+		// its output while chopping, as no current flows with disabled output
+		torqueTarget_mA = command * TORQUE_MAX_MA / CONTROL_PWM_MAX;
+		if (outputEnabled == SET)
+		{
+			bldc_outputFilterPwm = TORQUE_Calculate(&torqueController, torqueTarget_mA, currentDC_mA);
+		}
+	}
+	else
+	{
+		// Input is the duty cycle
+		bldc_outputFilterPwm = command;
+	}
+	
+#ifdef REGEN_BRAKING
+	// Braking only regenerates: the duty cycle may fall below the back-EMF duty
+	// cycle by the braking depth of the regen limiter (holds while chopping).
+	// The speed sign is only trusted with a learned direction
+	if (outputEnabled == SET && realSpeed_mh > REGEN_MIN_SPEED_MH && HALL_IsDirectionLearned() == SET)
+	{
+		regenPwm = REGEN_Calculate(&regenLimiter, bldc_outputFilterPwm,
+			SPEED_FeedForward(&speedController, realSpeed_mh * sectorDirection * hall_direction, batteryVoltage_mV),
+			currentDC_mA, batteryVoltageFast_mV);
+		
+		// Braking is reduced by the voltage ceiling (full battery)
+		regenVoltageLimited = (regenPwm != bldc_outputFilterPwm && batteryVoltageFast_mV > REGEN_VOLTAGE_MAX_MV) ? SET : RESET;
+		bldc_outputFilterPwm = regenPwm;
+	}
+	else
+	{
+		regenVoltageLimited = RESET;
+	}
+#endif
 	
-	// Calculate low-pass filter for pwm value
-	filter_reg = filter_reg - (filter_reg >> FILTER_SHIFT) + bldc_inputFilterPwm;
-	bldc_outputFilterPwm = filter_reg >> FILTER_SHIFT;
+	// Field weakening blends in while driving close to the maximum modulation
+	weakening = 0;
+	if (bldc_weakening == SET && bldc_outputFilterPwm * sectorDirection * hall_direction > 0)
+	{
+		weakening = CLAMP((ABS(bldc_outputFilterPwm) - FIELD_WEAKENING_START) * 1000 / (1000 - FIELD_WEAKENING_START), 0, 1000);
+	}
+	weakeningAdvance = FIELD_WEAKENING_ADVANCE * weakening / 1000 * sectorDirection;
+	PROFILER_MARK(PROFILER_SECTION_HALL);
 	
   // Update PWM channels based on position y(ellow), b(lue), g(reen)
-  blockPWM(bldc_outputFilterPwm, pos, &y, &b, &g);
+	if (HALL_IsLearning() == SET)
+	{
+		// Hall sensor learning drives the motor open loop
+		electricalAngle = HALL_Learn(hall);
+		sinusPWM(HALL_LEARN_PWM, electricalAngle, &y, &b, &g);
+	}
+	else if (commutationMode == COMMUTATION_SINUS && pos != 0)
+	{
+		electricalAngle = interpolateAngle(pos) + weakeningAdvance;
+		sinusPWM(bldc_outputFilterPwm, electricalAngle, &y, &b, &g);
+	}
+	else if (weakeningAdvance != 0 && pos != 0)
+	{
+		// Phase advance: commutate to the next block before the hall edge
+		electricalAngle = interpolateAngle(pos) + weakeningAdvance;
+		blockPWM(bldc_outputFilterPwm, HALL_ANGLE_TO_POS(electricalAngle), &y, &b, &g);
+	}
+	else
+	{
+		blockPWM(bldc_outputFilterPwm, pos, &y, &b, &g);
+	}
+	PROFILER_MARK(PROFILER_SECTION_COMMUTATION);
 	
 	// Set PWM output (pwm_res/2 is the mean value, setvalue has to be between 10 and pwm_res-10)
 	timer_channel_output_pulse_value_config(TIMER_BLDC, TIMER_BLDC_CHANNEL_G, CLAMP(g + pwm_res / 2, 10, pwm_res-10));
 	timer_channel_output_pulse_value_config(TIMER_BLDC, TIMER_BLDC_CHANNEL_B, CLAMP(b + pwm_res / 2, 10, pwm_res-10));
 	timer_channel_output_pulse_value_config(TIMER_BLDC, TIMER_BLDC_CHANNEL_Y, CLAMP(y + pwm_res / 2, 10, pwm_res-10));
 	
-	// Increments with 62.5us
-	if(speedCounter < 4000) // No speed after 250ms
+	// Speed from the mean hall edge period of the last electrical revolution,
+	// when the next edge is overdue the elapsed time is used (smooth stop)
+	// (values are copied first, the EXTI interrupt may change them meanwhile)
+	edgeCount = hallEdgePeriodCount;
+	period = hallEdgePeriodSum;
+	elapsed = DWT->CYCCNT - hallEdgeStamp;
+	if (elapsed > HALL_TIMEOUT_CYCLES)
 	{
-		speedCounter++;
+		// Long before the cycle counter wraps (59.6s), the next edge only
+		// stores its timestamp
+		hallEdgeStampValid = RESET;
 	}
-	
-	// Every time position reaches value 1, one round is performed (rising edge)
-	if (lastPos != 1 && pos == 1)
+	if (edgeCount == 0 || elapsed > HALL_TIMEOUT_CYCLES)
 	{
-		realSpeed = 1991.81f / (float)speedCounter; //[km/h]
-		speedCounter = 0;
+		// Standstill, next edge starts a new measurement
+		hallEdgePeriodCount = 0;
+		realSpeed_mh = 0;
 	}
 	else
 	{
-		if (speedCounter >= 4000)
-		{
-			realSpeed = 0;
-		}
+		period = period / edgeCount;
+		realSpeed_mh = SPEED_EDGE_CONV_MH / (elapsed > period ? elapsed : period); //[m/h]
 	}
 
 	// Safe last position
 	lastPos = pos;
+	
+	hallCalcEndPending = EXTI_PD & HALL_EXTI_MASK;
+	hallCalcEndStamp = DWT->CYCCNT;
+	PROFILER_MARK(PROFILER_SECTION_OUTPUT);
+}
+
+//----------------------------------------------------------------------------
+// Timestamps a hall sensor edge => called from EXTI interrupt
+// -> six edges per electrical revolution. The EXTI interrupt waits for the
+//    calculation ISR, an edge during it is stamped at its midpoint (error
+//    below half its run time, at most 1125 cycles = 16us), otherwise the
+//    stamp is late by the interrupt entry (some ten cycles)
+//----------------------------------------------------------------------------
+void CalculateHallEdge(void)
+{
+	uint32_t stamp = DWT->CYCCNT;
+	uint32_t period;
+	
+	// Edge was pending when the calculation ISR ended (this interrupt tail chained)
+	if (hallCalcEndPending != 0 && stamp - hallCalcEndStamp < HALL_TAILCHAIN_CYCLES)
+	{
+		if (hallCalcStartPending != 0)
+		{
+			stamp = hallCalcStartStamp;
+		}
+		else
+		{
+			stamp = hallCalcStartStamp + (hallCalcEndStamp - hallCalcStartStamp) / 2;
+		}
+		hallCalcEndPending = 0;
+	}
+	
+	// First edge after standstill, the old timestamp may be from before a wrap
+	// of the cycle counter
+	if (hallEdgeStampValid == RESET)
+	{
+		hallEdgeStamp = stamp;
+		hallEdgeStampValid = SET;
+		hallEdgePeriodCount = 0;
+		return;
+	}
+	
+	// Ignore bouncing of the hall sensor signals
+	period = stamp - hallEdgeStamp;
+	if (period < HALL_MIN_EDGE_CYCLES)
+	{
+		return;
+	}
+	hallEdgeStamp = stamp;
+	
+	// First edge after standstill has no valid period
+	if (period > HALL_TIMEOUT_CYCLES)
+	{
+		hallEdgePeriodCount = 0;
+		return;
+	}
+	
+	// Start new measurement (count is also reset by CalculateBLDC at standstill)
+	if (hallEdgePeriodCount == 0)
+	{
+		hallEdgePeriodSum = 0;
+		hallEdgeIndex = 0;
+	}
+	
+	// Moving sum over one electrical revolution (evens out hall sensor placement)
+	if (hallEdgePeriodCount < HALL_EDGES)
+	{
+		hallEdgePeriodCount++;
+	}
+	else
+	{
+		hallEdgePeriodSum -= hallEdgePeriod[hallEdgeIndex];
+	}
+	hallEdgePeriod[hallEdgeIndex] = period;
+	hallEdgePeriodSum += period;
+	hallEdgeIndex = (hallEdgeIndex + 1) % HALL_EDGES;
 }
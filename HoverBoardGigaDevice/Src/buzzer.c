@@ -0,0 +1,247 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "gd32f1x0.h"
+#include "../Inc/buzzer.h"
+#include "../Inc/defines.h"
+
+// Only master has a buzzer
+#ifdef MASTER
+
+// Counter clock of the buzzer timer (prescaler is set in setup.c)
+#define BUZZER_TIMER_CLOCK 1000000
+
+// Sounds, the former square wave frequencies were 16kHz / n. Patterns beep
+// 156ms and pause for a multiple of it
+static const BUZZER_STEP soundNone[] =
+{
+	{0, 0, 0, 0}
+};
+static const BUZZER_STEP soundStartup[] =
+{
+	{2000, 10, 0, 0},
+	{2286, 10, 0, 0},
+	{2667, 10, 0, 0},
+	{3200, 10, 0, 0},
+	{4000, 10, 0, 0},
+	{5333, 10, 0, 0},
+	{8000, 10, 0, 0},
+	{16000, 10, 0, 0},
+	{0, 0, 0, 0}
+};
+static const BUZZER_STEP soundShutdown[] =
+{
+	{0, 10, 0, 0},
+	{16000, 10, 0, 0},
+	{8000, 10, 0, 0},
+	{5333, 10, 0, 0},
+	{4000, 10, 0, 0},
+	{3200, 10, 0, 0},
+	{2667, 10, 0, 0},
+	{2286, 10, 0, 0},
+	{0, 0, 0, 0}
+};
+static const BUZZER_STEP soundBackwards[] =
+{
+	{3200, 156, 625, 0},
+	{0, 0, 0, 0}
+};
+static const BUZZER_STEP soundRegenLimit[] =
+{
+	{5333, 156, 313, 0},
+	{0, 0, 0, 0}
+};
+static const BUZZER_STEP soundBatteryLow[] =
+{
+	{3200, 156, 1250, 0},
+	{0, 0, 0, 0}
+};
+static const BUZZER_STEP soundBatteryEmpty[] =
+{
+	{3200, 156, 156, 0},
+	{0, 0, 0, 0}
+};
+
+// Sound table (access with BUZZER_SOUND)
+static const BUZZER_STEP * const soundTable[COUNT_BUZZER_SOUNDS] =
+{
+	soundNone,
+	soundStartup,
+	soundShutdown,
+	soundBackwards,
+	soundRegenLimit,
+	soundBatteryLow,
+	soundBatteryEmpty
+};
+
+// Requested sounds (set from main loop)
+static volatile BUZZER_SOUND requestSequence = BUZZER_SOUND_NONE;
+static volatile BUZZER_SOUND requestSound = BUZZER_SOUND_NONE;
+
+// Sequencer state
+static BUZZER_SOUND playing = BUZZER_SOUND_NONE;
+static volatile FlagStatus playingSequence = RESET;
+static uint8_t stepIndex = 0;
+static uint8_t repeatCounter = 0;
+static uint16_t counter_ms = 0;
+static FlagStatus pausing = RESET;
+
+void BUZZER_Start(BUZZER_SOUND sound, FlagStatus sequence);
+void BUZZER_SetFrequency(uint16_t frequency);
+
+//----------------------------------------------------------------------------
+// Plays a sound once, has priority over the background sound
+//----------------------------------------------------------------------------
+void BUZZER_PlaySequence(BUZZER_SOUND sound)
+{
+	if (sound >= COUNT_BUZZER_SOUNDS)
+	{
+		return;
+	}
+	
+	requestSequence = sound;
+}
+
+//----------------------------------------------------------------------------
+// Returns if a sequence is playing
+//----------------------------------------------------------------------------
+FlagStatus BUZZER_IsPlaying(void)
+{
+	return (requestSequence != BUZZER_SOUND_NONE || playingSequence == SET) ? SET : RESET;
+}
+
+//----------------------------------------------------------------------------
+// Sets the background sound (repeated, restarts only when changed)
+//----------------------------------------------------------------------------
+void BUZZER_SetSound(BUZZER_SOUND sound)
+{
+	if (sound >= COUNT_BUZZER_SOUNDS)
+	{
+		sound = BUZZER_SOUND_NONE;
+	}
+	
+	requestSound = sound;
+}
+
+//----------------------------------------------------------------------------
+// Sound sequencer => called every 1ms
+// -> the timer generates the tone, only step changes touch its registers
+//----------------------------------------------------------------------------
+void BUZZER_Update(void)
+{
+	const BUZZER_STEP *steps;
+	
+	// A sequence interrupts everything, afterwards the background sound starts again
+	if (requestSequence != BUZZER_SOUND_NONE)
+	{
+		BUZZER_Start(requestSequence, SET);
+		requestSequence = BUZZER_SOUND_NONE;
+	}
+	else if (playingSequence == RESET && playing != requestSound)
+	{
+		BUZZER_Start(requestSound, RESET);
+	}
+	
+	if (playing == BUZZER_SOUND_NONE)
+	{
+		return;
+	}
+	steps = soundTable[playing];
+	
+	counter_ms++;
+	if (pausing == RESET && counter_ms >= steps[stepIndex].duration_ms)
+	{
+		pausing = SET;
+		counter_ms = 0;
+		BUZZER_SetFrequency(0);
+	}
+	if (pausing == SET && counter_ms >= steps[stepIndex].pause_ms)
+	{
+		pausing = RESET;
+		counter_ms = 0;
+		
+		// Next repetition, next step or end of the sound
+		if (repeatCounter < steps[stepIndex].repeat)
+		{
+			repeatCounter++;
+		}
+		else
+		{
+			repeatCounter = 0;
+			stepIndex++;
+			if (steps[stepIndex].duration_ms == 0)
+			{
+				stepIndex = 0;
+				if (playingSequence == SET)
+				{
+					playing = BUZZER_SOUND_NONE;
+					playingSequence = RESET;
+					return;
+				}
+			}
+		}
+		BUZZER_SetFrequency(steps[stepIndex].frequency);
+	}
+}
+
+//----------------------------------------------------------------------------
+// Starts a sound with its first step
+//----------------------------------------------------------------------------
+void BUZZER_Start(BUZZER_SOUND sound, FlagStatus sequence)
+{
+	playing = sound;
+	playingSequence = sequence;
+	stepIndex = 0;
+	repeatCounter = 0;
+	counter_ms = 0;
+	pausing = RESET;
+	BUZZER_SetFrequency(soundTable[sound][0].frequency);
+}
+
+//----------------------------------------------------------------------------
+// Sets tone frequency of the timer output (50% duty cycle), 0 = silent
+//----------------------------------------------------------------------------
+void BUZZER_SetFrequency(uint16_t frequency)
+{
+	uint32_t period;
+	
+	if (frequency == 0)
+	{
+		timer_channel_output_pulse_value_config(TIMER_BUZZER, TIMER_BUZZER_CHANNEL, 0);
+		return;
+	}
+	
+	period = BUZZER_TIMER_CLOCK / frequency;
+	timer_autoreload_value_config(TIMER_BUZZER, period - 1);
+	timer_channel_output_pulse_value_config(TIMER_BUZZER, TIMER_BUZZER_CHANNEL, period / 2);
+}
+
+#endif
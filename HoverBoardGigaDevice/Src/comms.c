@@ -29,44 +29,207 @@
 */
 
 #include "gd32f1x0.h"
+#include "../Inc/defines.h"
+#include "../Inc/setup.h"
+#include "../Inc/comms.h"
+#include "string.h"
+
+// Transmit queue for one USART, frames are sent by DMA one after another
+typedef struct
+{
+	uint8_t buffer[USART_TX_QUEUE_FRAMES][USART_TX_FRAME_SIZE];
+	uint8_t length[USART_TX_QUEUE_FRAMES];
+	uint8_t head;																// Frame currently sent by DMA
+	volatile uint8_t count;															// Frames in queue including the one being sent
+	dma_channel_enum dma_channel;
+} USART_TX_QUEUE;
+
+USART_TX_QUEUE usartMasterSlave_tx_queue = {{{0}}, {0}, 0, 0, USART_MASTERSLAVE_TX_DMA};
+USART_TX_QUEUE usartSteer_COM_tx_queue = {{{0}}, {0}, 0, 0, USART_STEER_COM_TX_DMA};
+
+// Receive ring for one USART, written by circular DMA
+typedef struct
+{
+	uint8_t *buffer;
+	uint16_t size;
+	uint16_t readIndex;													// Next byte to be read
+	dma_channel_enum dma_channel;
+} USART_RX_RING;
+
+extern uint8_t usartMasterSlave_rx_buf[USART_MASTERSLAVE_RX_BUFFERSIZE];
+extern uint8_t usartSteer_COM_rx_buf[USART_STEER_COM_RX_BUFFERSIZE];
+USART_RX_RING usartMasterSlave_rx_ring = {usartMasterSlave_rx_buf, USART_MASTERSLAVE_RX_BUFFERSIZE, 0, USART_MASTERSLAVE_RX_DMA};
+USART_RX_RING usartSteer_COM_rx_ring = {usartSteer_COM_rx_buf, USART_STEER_COM_RX_BUFFERSIZE, 0, USART_STEER_COM_RX_DMA};
+
+//----------------------------------------------------------------------------
+// Returns transmit queue of USART
+//----------------------------------------------------------------------------
+USART_TX_QUEUE *GetTXQueue(uint32_t usart_periph)
+{
+	return usart_periph == USART_MASTERSLAVE ? &usartMasterSlave_tx_queue : &usartSteer_COM_tx_queue;
+}
+
+//----------------------------------------------------------------------------
+// Starts DMA transfer of the frame at the head of the queue
+//----------------------------------------------------------------------------
+void StartTXQueue(USART_TX_QUEUE *queue)
+{
+	dma_channel_disable(queue->dma_channel);
+	dma_memory_address_config(queue->dma_channel, (uint32_t)queue->buffer[queue->head]);
+	dma_transfer_number_config(queue->dma_channel, queue->length[queue->head]);
+	dma_channel_enable(queue->dma_channel);
+}
 
 //----------------------------------------------------------------------------
 // Send buffer via USART
+// -> frame is copied into the transmit queue and sent by DMA, function
+//    returns immediately. Frame is dropped if the queue is full.
 //----------------------------------------------------------------------------
 void SendBuffer(uint32_t usart_periph, uint8_t buffer[], uint8_t length)
 {
-	uint8_t index = 0;
+	USART_TX_QUEUE *queue = GetTXQueue(usart_periph);
+	uint8_t tail = 0;
+	uint32_t primask = 0;
+	
+	if (length > USART_TX_FRAME_SIZE)
+	{
+		return;
+	}
+	
+	// Queue is shared by main loop, RX interrupts and DMA TX interrupt
+	primask = __get_PRIMASK();
+	__disable_irq();
+	
+	if (queue->count < USART_TX_QUEUE_FRAMES)
+	{
+		tail = (queue->head + queue->count) % USART_TX_QUEUE_FRAMES;
+		memcpy(queue->buffer[tail], buffer, length);
+		queue->length[tail] = length;
+		queue->count++;
+		
+		// Start DMA if it was idle
+		if (queue->count == 1)
+		{
+			StartTXQueue(queue);
+		}
+	}
+	
+	__set_PRIMASK(primask);
+}
+
+//----------------------------------------------------------------------------
+// Is called from DMA interrupt when a frame has been transferred
+// -> starts transfer of the next queued frame
+//----------------------------------------------------------------------------
+void SendBufferComplete(uint32_t usart_periph)
+{
+	USART_TX_QUEUE *queue = GetTXQueue(usart_periph);
 	
-	for(; index < length; index++)
+	if (queue->count == 0)
 	{
-    usart_data_transmit(usart_periph, buffer[index]);
-    while (usart_flag_get(usart_periph, USART_FLAG_TC) == RESET) {}
+		return;
+	}
+	
+	queue->head = (queue->head + 1) % USART_TX_QUEUE_FRAMES;
+	queue->count--;
+	
+	if (queue->count > 0)
+	{
+		StartTXQueue(queue);
 	}
 }
 
 //----------------------------------------------------------------------------
-// Calculate CRC
+// Read one received byte from the USART ring buffer
+// -> returns RESET if all received bytes have already been read
+//----------------------------------------------------------------------------
+FlagStatus ReadBuffer(uint32_t usart_periph, uint8_t *character)
+{
+	USART_RX_RING *ring = usart_periph == USART_MASTERSLAVE ? &usartMasterSlave_rx_ring : &usartSteer_COM_rx_ring;
+	
+	// DMA write position derived from remaining transfers of the circular DMA
+	uint16_t writeIndex = ring->size - dma_transfer_number_get(ring->dma_channel);
+	if (writeIndex >= ring->size)
+	{
+		writeIndex = 0;
+	}
+	
+	if (ring->readIndex == writeIndex)
+	{
+		return RESET;
+	}
+	
+	*character = ring->buffer[ring->readIndex];
+	ring->readIndex++;
+	if (ring->readIndex >= ring->size)
+	{
+		ring->readIndex = 0;
+	}
+	
+	return SET;
+}
+
+//----------------------------------------------------------------------------
+// Waits until all queued frames have left the USART (shut off and benchmark)
+//----------------------------------------------------------------------------
+void FlushBuffer(uint32_t usart_periph)
+{
+	USART_TX_QUEUE *queue = GetTXQueue(usart_periph);
+	
+	while (queue->count > 0)
+	{
+		// Reload watchdog while waiting
+		fwdgt_counter_reload();
+	}
+	while (usart_flag_get(usart_periph, USART_FLAG_TC) == RESET) {}
+}
+
+// CRC-CCITT (polynomial 0x1021) of every byte value, processes one byte per lookup
+const uint16_t crcTable[256] =
+{
+	0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+	0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+	0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+	0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+	0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+	0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+	0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+	0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+	0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+	0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+	0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+	0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+	0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+	0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+	0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+	0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+	0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+	0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+	0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+	0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+	0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+	0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+	0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+	0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+	0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+	0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+	0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+	0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+	0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+	0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+	0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+	0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
+};
+
+//----------------------------------------------------------------------------
+// Calculate CRC (CRC-CCITT, polynomial 0x1021, initial value 0)
 //----------------------------------------------------------------------------
 uint16_t CalcCRC(uint8_t *ptr, int count)
 {
-  uint16_t  crc;
-  uint8_t i;
-  crc = 0;
+  uint16_t crc = 0;
   while (--count >= 0)
   {
-    crc = crc ^ (uint16_t) *ptr++ << 8;
-    i = 8;
-    do
-    {
-      if (crc & 0x8000)
-      {
-        crc = crc << 1 ^ 0x1021;
-      }
-      else
-      {
-        crc = crc << 1;
-      }
-    } while(--i);
+    crc = (crc << 8) ^ crcTable[((crc >> 8) ^ *ptr++) & 0xFF];
   }
   return (crc);
 }
@@ -35,35 +35,76 @@
 #include "../Inc/commsMasterSlave.h"
 #include "../Inc/commsBluetooth.h"
 #include "../Inc/led.h"
+#include "../Inc/bldc.h"
+#include "../Inc/profiler.h"
+#include "../Inc/hall.h"
+#include "../Inc/param.h"
+#include "../Inc/timebase.h"
 #include "stdio.h"
 #include "string.h"
 
 // Only slave communicates over bluetooth
 #ifdef SLAVE
 // Variables which will be send over bluetooth
-extern float currentDC;
-extern float realSpeed;
+extern int32_t currentDCFiltered_mA;
+extern int32_t realSpeed_mh;
+extern int32_t temperature_dC;
 
-extern uint32_t hornCounter_ms;
+
+// Profiler values: slave from BLUETOOTH_ID_PROFILER_SLAVE, master from BLUETOOTH_ID_PROFILER_MASTER
+#define BLUETOOTH_ID_PROFILER_SLAVE   16
+#define BLUETOOTH_ID_PROFILER_MASTER  (BLUETOOTH_ID_PROFILER_SLAVE + COUNT_PROFILER_VALUES)
+#define BLUETOOTH_ID_CONTROL_MODE     (BLUETOOTH_ID_PROFILER_MASTER + COUNT_PROFILER_VALUES)
+#define BLUETOOTH_ID_WEAKENING        (BLUETOOTH_ID_CONTROL_MODE + 1)
+#define BLUETOOTH_ID_HALL_LEARN       (BLUETOOTH_ID_CONTROL_MODE + 2)
+#define BLUETOOTH_ID_HALL_LEARN_MASTER (BLUETOOTH_ID_CONTROL_MODE + 3)
+
+// Parameters (stored in flash): slave from BLUETOOTH_ID_PARAM_SLAVE, master from BLUETOOTH_ID_PARAM_MASTER
+#define BLUETOOTH_ID_PARAM_SLAVE      (BLUETOOTH_ID_CONTROL_MODE + 4)
+#define BLUETOOTH_ID_PARAM_MASTER     (BLUETOOTH_ID_PARAM_SLAVE + COUNT_PARAMS)
+
+// Run times, deadline misses and latencies of the master main loop tasks: writing BLUETOOTH_ID_SCHEDULER_TASK
+// selects the task, its SCHEDULER_VALUEs follow (identifiers only have two digits, all tasks would not fit)
+#define BLUETOOTH_ID_SCHEDULER_TASK   (BLUETOOTH_ID_PARAM_MASTER + COUNT_PARAMS)
+#define BLUETOOTH_ID_SCHEDULER_MASTER (BLUETOOTH_ID_SCHEDULER_TASK + 1)
+
+// Health values sent by master in every frame and of the slave itself
+#define BLUETOOTH_ID_TEMPERATURE_MASTER (BLUETOOTH_ID_SCHEDULER_MASTER + COUNT_SCHEDULER_VALUES)
+#define BLUETOOTH_ID_FAULTS_MASTER    (BLUETOOTH_ID_TEMPERATURE_MASTER + 1)
+#define BLUETOOTH_ID_TEMPERATURE_SLAVE (BLUETOOTH_ID_TEMPERATURE_MASTER + 2)
 
 #define USART_BLUETOOTH_TX_BYTES 11   // Transmit byte count including start '/' and stop character '\n'
 #define USART_BLUETOOTH_RX_BYTES 11   // Receive byte count including start '/' and stop character '\n'
 
-extern uint8_t usartSteer_COM_rx_buf[USART_STEER_COM_RX_BUFFERSIZE];
 static uint8_t sBluetoothRecord = 0;
 static uint8_t sUSARTBluetoothRecordBuffer[USART_BLUETOOTH_RX_BYTES];
 static uint8_t sUSARTBluetoothRecordBufferCounter = 0;
+static SCHEDULER_TASK sSchedulerTask = (SCHEDULER_TASK)0;		// Task of the scheduler values
 
 void CheckUSARTBluetoothInput(uint8_t USARTBuffer[]);
-void SendBluetoothDevice(uint8_t identifier, int16_t value);
+void ParseUSARTBluetoothInput(uint8_t character);
+void SendBluetoothDevice(uint8_t identifier, int32_t value);
+void StopHorn(void);
 
 //----------------------------------------------------------------------------
 // Update USART bluetooth input
+// -> parses all bytes received since the last call
 //----------------------------------------------------------------------------
 void UpdateUSARTBluetoothInput(void)
 {
-	uint8_t character = usartSteer_COM_rx_buf[0];
+	uint8_t character;
 	
+	while (ReadBuffer(USART_STEER_COM, &character) == SET)
+	{
+		ParseUSARTBluetoothInput(character);
+	}
+}
+
+//----------------------------------------------------------------------------
+// Parse one received byte of the USART bluetooth input
+//----------------------------------------------------------------------------
+void ParseUSARTBluetoothInput(uint8_t character)
+{
 	// Start character is captured, start record
 	if (character == '/')
 	{
@@ -95,13 +136,13 @@ void CheckUSARTBluetoothInput(uint8_t USARTBuffer[])
 	// Auxiliary variables
 	uint8_t identifier = 0;
 	uint8_t readWrite = 0;
-	int16_t sign = 0;
-	int16_t digit1 = 0;
-	int16_t digit2 = 0;
-	int16_t digit3 = 0;
-	int16_t digit4 = 0;
-	int16_t digit5 = 0;
-	int16_t value = 0;
+	int32_t sign = 0;
+	int32_t digit1 = 0;
+	int32_t digit2 = 0;
+	int32_t digit3 = 0;
+	int32_t digit4 = 0;
+	int32_t digit5 = 0;
+	int32_t value = 0;
 	
 	// Check start and stop character
 	if ( USARTBuffer[0] != '/' ||
@@ -133,7 +174,7 @@ void CheckUSARTBluetoothInput(uint8_t USARTBuffer[])
 				break;
 			case 2:
 				// Answer with current from slave
-				value = currentDC * 100;
+				value = ABS(currentDCFiltered_mA) / 10;
 				break;
 			case 3:
 				// Answer with real speed of master
@@ -141,7 +182,7 @@ void CheckUSARTBluetoothInput(uint8_t USARTBuffer[])
 				break;
 			case 4:
 				// Answer with real speed of slave
-				value = realSpeed * 100;
+				value = realSpeed_mh / 10;
 				break;
 			case 5:
 				// Answer with beeps backwards from master
@@ -183,6 +224,67 @@ void CheckUSARTBluetoothInput(uint8_t USARTBuffer[])
 				// Answer with strobe speed
 				value = GetSpeedStrobe();
 				break;
+			case 15:
+				// Answer with commutation mode
+				value = GetCommutationMode();
+				break;
+			case BLUETOOTH_ID_CONTROL_MODE:
+				// Answer with control mode
+				value = GetControlMode();
+				break;
+			case BLUETOOTH_ID_WEAKENING:
+				// Answer with field weakening (requested by steering device or bluetooth)
+				value = GetWeakening();
+				break;
+			case BLUETOOTH_ID_HALL_LEARN:
+				// Answer with hall learning state of slave
+				value = HALL_GetLearnState();
+				break;
+			case BLUETOOTH_ID_HALL_LEARN_MASTER:
+				// Answer with hall learning state of master
+				value = GetHallLearnStateMaster();
+				break;
+			case BLUETOOTH_ID_SCHEDULER_TASK:
+				// Answer with task selected for the scheduler values
+				value = sSchedulerTask;
+				break;
+			case BLUETOOTH_ID_TEMPERATURE_MASTER:
+				// Answer with chip temperature of master in 0.1°C
+				value = GetTemperatureMaster();
+				break;
+			case BLUETOOTH_ID_FAULTS_MASTER:
+				// Answer with fault flags of master (BLDC_FAULT_x)
+				value = GetFaultsMaster();
+				break;
+			case BLUETOOTH_ID_TEMPERATURE_SLAVE:
+				// Answer with chip temperature of slave in 0.1°C
+				value = temperature_dC;
+				break;
+			default:
+				// Answer with profiler values of slave or master
+				if (identifier >= BLUETOOTH_ID_PROFILER_SLAVE && identifier < BLUETOOTH_ID_PROFILER_MASTER)
+				{
+					value = GetProfilerValue((PROFILER_VALUE)(identifier - BLUETOOTH_ID_PROFILER_SLAVE));
+				}
+				else if (identifier >= BLUETOOTH_ID_PROFILER_MASTER && identifier < BLUETOOTH_ID_PROFILER_MASTER + COUNT_PROFILER_VALUES)
+				{
+					value = GetProfilerValueMaster((PROFILER_VALUE)(identifier - BLUETOOTH_ID_PROFILER_MASTER));
+				}
+				// Answer with parameters of slave or master
+				else if (identifier >= BLUETOOTH_ID_PARAM_SLAVE && identifier < BLUETOOTH_ID_PARAM_MASTER)
+				{
+					value = PARAM_Get((PARAM_ID)(identifier - BLUETOOTH_ID_PARAM_SLAVE));
+				}
+				else if (identifier >= BLUETOOTH_ID_PARAM_MASTER && identifier < BLUETOOTH_ID_PARAM_MASTER + COUNT_PARAMS)
+				{
+					value = GetParamMaster((PARAM_ID)(identifier - BLUETOOTH_ID_PARAM_MASTER));
+				}
+				// Answer with task run times of master
+				else if (identifier >= BLUETOOTH_ID_SCHEDULER_MASTER && identifier < BLUETOOTH_ID_SCHEDULER_MASTER + COUNT_SCHEDULER_VALUES)
+				{
+					value = GetSchedulerValueMaster(sSchedulerTask, (SCHEDULER_VALUE)(identifier - BLUETOOTH_ID_SCHEDULER_MASTER));
+				}
+				break;
 		}
 		
 		// Send Answer
@@ -191,7 +293,7 @@ void CheckUSARTBluetoothInput(uint8_t USARTBuffer[])
 	// If write mode, get result value
 	else if ( readWrite == 1)
 	{
-		// Calculate result value (-10000 to 10000)
+		// Calculate result value (-99999 to 99999)
 		sign = USARTBuffer[4] == '-' ? -1 : 1;
 		digit1 = (USARTBuffer[5] - '0') * 10000;
 		digit2 = (USARTBuffer[6] - '0') * 1000;
@@ -210,40 +312,78 @@ void CheckUSARTBluetoothInput(uint8_t USARTBuffer[])
 				SetLowerLEDMaster(value == 0 ? RESET : SET);
 				break;
 			case 7:
-				// Set upper LED of master (horn)
-				hornCounter_ms = 0;
+				// Set upper LED of master (horn), switched off after 2 seconds
 				SetUpperLEDMaster(value == 0 ? RESET : SET);
+				TIMEBASE_StartTimer(TIMEBASE_TIMER_HORN, StopHorn, 2000, 0);
 				break;
 			case 8:
 				// Set LED hue
-				SetHSBHue(value);
+				PARAM_Set(PARAM_LED_HUE, value);
 				break;
 			case 9:
 				// Set LED saturation
-				SetHSBSaturation(value);
+				PARAM_Set(PARAM_LED_SATURATION, value);
 				break;
 			case 10:
 				// Set LED brightness
-				SetHSBBrightness(value);
+				PARAM_Set(PARAM_LED_BRIGHTNESS, value);
 				break;
 			case 11:
 				// Set LED mode
-				SetRGBProgram((LED_PROGRAM)value);
+				PARAM_Set(PARAM_LED_PROGRAM, value);
 				break;
 			case 12:
 				// Set fading speed
-				SetSpeedFading(value);
+				PARAM_Set(PARAM_LED_SPEED_FADING, value);
 				break;
 			case 13:
 				// Set blink speed
-				SetSpeedBlink(value);
+				PARAM_Set(PARAM_LED_SPEED_BLINK, value);
 				break;
 			case 14:
 				// Set strobe speed
-				SetSpeedStrobe(value);
+				PARAM_Set(PARAM_LED_SPEED_STROBE, value);
+				break;
+			case 15:
+				// Set commutation mode
+				PARAM_Set(PARAM_COMMUTATION_MODE, value);
+				break;
+			case BLUETOOTH_ID_CONTROL_MODE:
+				// Set control mode
+				PARAM_Set(PARAM_CONTROL_MODE, value);
+				break;
+			case BLUETOOTH_ID_WEAKENING:
+				// Request field weakening from master
+				SetWeakeningMaster(value == 0 ? RESET : SET);
+				break;
+			case BLUETOOTH_ID_HALL_LEARN:
+				// Start hall learning of slave and master (motors spin open loop, only at rest without command)
+				if (value != 0 && HALL_StartLearning() == SUCCESS)
+				{
+					SetHallLearnMaster(SET);
+				}
+				break;
+			case BLUETOOTH_ID_SCHEDULER_TASK:
+				// Select task for the scheduler values
+				if (value >= 0 && value < COUNT_SCHEDULER_TASKS)
+				{
+					sSchedulerTask = (SCHEDULER_TASK)value;
+				}
+				break;
+			case BLUETOOTH_ID_PROFILER_SLAVE:
+				// Reset min/max values and overrun count of slave profiler
+				ProfilerReset();
 				break;
 			default:
-				// Do nothing for the rest of the identifiers
+				// Set parameters of slave or master, the rest of the identifiers does nothing
+				if (identifier >= BLUETOOTH_ID_PARAM_SLAVE && identifier < BLUETOOTH_ID_PARAM_MASTER)
+				{
+					PARAM_Set((PARAM_ID)(identifier - BLUETOOTH_ID_PARAM_SLAVE), value);
+				}
+				else if (identifier >= BLUETOOTH_ID_PARAM_MASTER && identifier < BLUETOOTH_ID_PARAM_MASTER + COUNT_PARAMS)
+				{
+					SetParamMaster((PARAM_ID)(identifier - BLUETOOTH_ID_PARAM_MASTER), value);
+				}
 				break;
 		}
 	}
@@ -252,10 +392,10 @@ void CheckUSARTBluetoothInput(uint8_t USARTBuffer[])
 //----------------------------------------------------------------------------
 // Send frame to bluetooth device
 //----------------------------------------------------------------------------
-void SendBluetoothDevice(uint8_t identifier, int16_t value)
+void SendBluetoothDevice(uint8_t identifier, int32_t value)
 {
 	int index = 0;
-	char charVal[5];
+	char charVal[6];
 	uint8_t buffer[USART_BLUETOOTH_TX_BYTES];
 	
 	// Send bluetooth frame
@@ -264,7 +404,7 @@ void SendBluetoothDevice(uint8_t identifier, int16_t value)
 	buffer[index++] = charVal[0];
 	buffer[index++] = charVal[1];
 	buffer[index++] = '0';
-	sprintf(charVal, "%05d", value);
+	sprintf(charVal, "%05d", ABS(value) % 100000);
 	buffer[index++] = value < 0 ? '-' : '+';
 	buffer[index++] = charVal[0];
 	buffer[index++] = charVal[1];
@@ -276,4 +416,12 @@ void SendBluetoothDevice(uint8_t identifier, int16_t value)
 	SendBuffer(USART_STEER_COM, buffer, index);
 }
 
+//----------------------------------------------------------------------------
+// Switches horn off (horn timer callback)
+//----------------------------------------------------------------------------
+void StopHorn(void)
+{
+	SetUpperLEDMaster(RESET);
+}
+
 #endif
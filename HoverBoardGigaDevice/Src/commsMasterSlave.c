@@ -36,52 +36,92 @@
 #include "../Inc/config.h"
 #include "../Inc/defines.h"
 #include "../Inc/bldc.h"
+#include "../Inc/hall.h"
+#include "../Inc/profiler.h"
 #include "stdio.h"
 #include "string.h"
 
+// Frame sizes including start '/', version, crc and stop character '\n'
+#define USART_SLAVE_FRAME_BYTES  (8 + MASTERSLAVE_TELEMETRY_BYTES + 4)	// Master to slave
+#define USART_MASTER_FRAME_BYTES (6 + MASTERSLAVE_TELEMETRY_BYTES + 4)	// Slave to master
+
+// Process values of this board sent in every frame
+extern int32_t currentDCFiltered_mA;
+extern int32_t batteryVoltage_mV;
+extern int32_t realSpeed_mh;
+extern int32_t temperature_dC;
+
 #ifdef MASTER
-#define USART_MASTERSLAVE_TX_BYTES 10  // Transmit byte count including start '/' and stop character '\n'
-#define USART_MASTERSLAVE_RX_BYTES 5   // Receive byte count including start '/' and stop character '\n'
+#define USART_MASTERSLAVE_TX_BYTES USART_SLAVE_FRAME_BYTES
+#define USART_MASTERSLAVE_RX_BYTES USART_MASTER_FRAME_BYTES
 
 // Variables which will be written by slave frame
 extern FlagStatus beepsBackwards;
+extern FlagStatus activateWeakeningBluetooth;
+extern uint8_t slaveError;
+MASTERSLAVE_TELEMETRY telemetrySlave;
 #endif
 #ifdef SLAVE
-#define USART_MASTERSLAVE_TX_BYTES 5   // Transmit byte count including start '/' and stop character '\n'
-#define USART_MASTERSLAVE_RX_BYTES 10  // Receive byte count including start '/' and stop character '\n'
+#define USART_MASTERSLAVE_TX_BYTES USART_MASTER_FRAME_BYTES
+#define USART_MASTERSLAVE_RX_BYTES USART_SLAVE_FRAME_BYTES
 
 // Variables which will be send to master
 FlagStatus upperLEDMaster = RESET;
 FlagStatus lowerLEDMaster = RESET;
 FlagStatus mosfetOutMaster = RESET;
 FlagStatus beepsBackwardsMaster = RESET;
+FlagStatus weakeningMaster = RESET;
+FlagStatus hallLearnMaster = RESET;
+uint8_t paramIdentifierMaster = PARAM_NONE;
+int32_t paramValueMaster = 0;
 
 // Variables which will be written by master frame
-int16_t currentDCMaster = 0;
-int16_t batteryMaster = 0;
-int16_t realSpeedMaster = 0;
+MASTERSLAVE_TELEMETRY telemetryMaster;
+int16_t profilerMaster[COUNT_PROFILER_VALUES];
+int16_t schedulerMaster[COUNT_SCHEDULER_TASKS * COUNT_SCHEDULER_VALUES];
+int32_t paramMaster[COUNT_PARAMS];
 
 void CheckGeneralValue(uint8_t identifier, int16_t value);
 #endif
 
-extern uint8_t usartMasterSlave_rx_buf[USART_MASTERSLAVE_RX_BUFFERSIZE];
+// Fault flags of the other board received since the last sent frame,
+// sent back once as acknowledge
+static uint8_t sFaultsReceived = 0;
+
 static uint8_t sMasterSlaveRecord = 0;
 static uint8_t sUSARTMasterSlaveRecordBuffer[USART_MASTERSLAVE_RX_BYTES];
 static uint8_t sUSARTMasterSlaveRecordBufferCounter = 0;
 
-void CheckUSARTMasterSlaveInput(uint8_t u8USARTBuffer[]);
+ErrStatus CheckUSARTMasterSlaveInput(uint8_t u8USARTBuffer[]);
+void ParseUSARTMasterSlaveInput(uint8_t character);
+void GetTelemetry(MASTERSLAVE_TELEMETRY *telemetry);
 void SendBuffer(uint32_t usart_periph, uint8_t buffer[], uint8_t length);
 uint16_t CalcCRC(uint8_t *ptr, int count);
 
 //----------------------------------------------------------------------------
 // Update USART master slave input
+// -> parses all bytes received since the last call
 //----------------------------------------------------------------------------
 void UpdateUSARTMasterSlaveInput(void)
 {
-	uint8_t character = usartMasterSlave_rx_buf[0];
+	uint8_t character;
+	
+	while (ReadBuffer(USART_MASTERSLAVE, &character) == SET)
+	{
+		ParseUSARTMasterSlaveInput(character);
+	}
+}
+
+//----------------------------------------------------------------------------
+// Parse one received byte of the USART master slave input
+//----------------------------------------------------------------------------
+void ParseUSARTMasterSlaveInput(uint8_t character)
+{
+	uint8_t index;
 	
-	// Start character is captured, start record
-	if (character == '/')
+	// Start character is captured, start record (binary values may contain
+	// the start character, so it only starts a record outside of a frame)
+	if (sMasterSlaveRecord == 0 && character == '/')
 	{
 		sUSARTMasterSlaveRecordBufferCounter = 0;
 		sMasterSlaveRecord = 1;
@@ -97,8 +137,21 @@ void UpdateUSARTMasterSlaveInput(void)
 			sUSARTMasterSlaveRecordBufferCounter = 0;
 			sMasterSlaveRecord = 0;
 			
-			// Check input
-			CheckUSARTMasterSlaveInput (sUSARTMasterSlaveRecordBuffer);
+			// Check input, an invalid record started inside a frame: resynchronize
+			// at the next start character of the record
+			if (CheckUSARTMasterSlaveInput(sUSARTMasterSlaveRecordBuffer) == ERROR)
+			{
+				for (index = 1; index < USART_MASTERSLAVE_RX_BYTES; index++)
+				{
+					if (sUSARTMasterSlaveRecordBuffer[index] == '/')
+					{
+						sUSARTMasterSlaveRecordBufferCounter = USART_MASTERSLAVE_RX_BYTES - index;
+						memmove(sUSARTMasterSlaveRecordBuffer, &sUSARTMasterSlaveRecordBuffer[index], sUSARTMasterSlaveRecordBufferCounter);
+						sMasterSlaveRecord = 1;
+						break;
+					}
+				}
+			}
 		}
 	}
 }
@@ -106,16 +159,20 @@ void UpdateUSARTMasterSlaveInput(void)
 //----------------------------------------------------------------------------
 // Check USART master slave input
 //----------------------------------------------------------------------------
-void CheckUSARTMasterSlaveInput(uint8_t USARTBuffer[])
+ErrStatus CheckUSARTMasterSlaveInput(uint8_t USARTBuffer[])
 {
 #ifdef MASTER
 	// Result variables
 	FlagStatus upperLED = RESET;
 	FlagStatus lowerLED = RESET;
 	FlagStatus mosfetOut = RESET;
+	FlagStatus hallLearn = RESET;
+	uint8_t paramIdentifier = PARAM_NONE;
+	int16_t paramValue = 0;
 	
 	// Auxiliary variables
 	uint8_t byte;
+	static FlagStatus lastHallLearn = RESET;
 #endif
 #ifdef SLAVE
 	// Result variables
@@ -123,6 +180,7 @@ void CheckUSARTMasterSlaveInput(uint8_t USARTBuffer[])
 	FlagStatus enable = RESET;
 	FlagStatus shutoff = RESET;
 	FlagStatus chargeStateLowActive = SET;
+	FlagStatus weakening = RESET;
 	
 	// Auxiliary variables
 	uint8_t identifier = 0;
@@ -136,7 +194,7 @@ void CheckUSARTMasterSlaveInput(uint8_t USARTBuffer[])
 	if ( USARTBuffer[0] != '/' ||
 		USARTBuffer[USART_MASTERSLAVE_RX_BYTES - 1] != '\n')
 	{
-		return;
+		return ERROR;
 	}
 	
 	// Calculate CRC (first bytes except crc and stop byte)
@@ -146,42 +204,80 @@ void CheckUSARTMasterSlaveInput(uint8_t USARTBuffer[])
 	if ( USARTBuffer[USART_MASTERSLAVE_RX_BYTES - 3] != ((crc >> 8) & 0xFF) ||
 		USARTBuffer[USART_MASTERSLAVE_RX_BYTES - 2] != (crc & 0xFF))
 	{
-		return;
+		return ERROR;
+	}
+	
+	// Frame layout of another firmware version
+	if (USARTBuffer[1] != MASTERSLAVE_PROTOCOL_VERSION)
+	{
+		return ERROR;
 	}
 	
 #ifdef MASTER
 	// Calculate setvalues for LED and mosfets
-	byte = USARTBuffer[1];
+	byte = USARTBuffer[2];
 	
 	//none = (byte & BIT(7)) ? SET : RESET;
 	//none = (byte & BIT(6)) ? SET : RESET;
-	//none = (byte & BIT(5)) ? SET : RESET;
-	//none = (byte & BIT(4)) ? SET : RESET;
+	hallLearn = (byte & BIT(5)) ? SET : RESET;
+	activateWeakeningBluetooth = (byte & BIT(4)) ? SET : RESET;
 	beepsBackwards = (byte & BIT(3)) ? SET : RESET;
 	mosfetOut = (byte & BIT(2)) ? SET : RESET;
 	lowerLED = (byte & BIT(1)) ? SET : RESET;
 	upperLED = (byte & BIT(0)) ? SET : RESET;
 	
+	// Faults of the master the slave has received
+	AcknowledgeFaults(USARTBuffer[3]);
+	
+	// Get parameter set over bluetooth
+	paramIdentifier = USARTBuffer[4];
+	paramValue = (int16_t)((USARTBuffer[5] << 8) | USARTBuffer[6]);
+	
+	// Process values of slave (faults are acknowledged with the next slave frame)
+	DecodeTelemetry(&USARTBuffer[7], &telemetrySlave);
+	slaveError = telemetrySlave.faults;
+	sFaultsReceived = telemetrySlave.faults;
+	
 	// Set functions according to the variables
 	gpio_bit_write(MOSFET_OUT_PORT, MOSFET_OUT_PIN, mosfetOut);
 	gpio_bit_write(UPPER_LED_PORT, UPPER_LED_PIN, upperLED);
 	gpio_bit_write(LOWER_LED_PORT, LOWER_LED_PIN, lowerLED);
+	
+	// Hall sensor learning starts with the request of the slave (refused
+	// while the master motor turns or has a command)
+	if (hallLearn == SET && lastHallLearn == RESET)
+	{
+		(void)HALL_StartLearning();
+	}
+	lastHallLearn = hallLearn;
+	
+	if (paramIdentifier < COUNT_PARAMS)
+	{
+		PARAM_Set((PARAM_ID)paramIdentifier, PARAM_Decode((PARAM_ID)paramIdentifier, paramValue));
+	}
 #endif
 #ifdef SLAVE
 	// Calculate result pwm value -1000 to 1000
-	pwmSlave = (int16_t)((USARTBuffer[1] << 8) | USARTBuffer[2]);
+	pwmSlave = (int16_t)((USARTBuffer[2] << 8) | USARTBuffer[3]);
+	
+	// Calculate setvalues for enable and shutoff
+	byte = USARTBuffer[4];
+	
+	// Faults of the slave the master has received
+	AcknowledgeFaults(USARTBuffer[5]);
+	
+	// Process values of master (faults are acknowledged with the answer)
+	DecodeTelemetry(&USARTBuffer[6], &telemetryMaster);
+	sFaultsReceived = telemetryMaster.faults;
 	
 	// Get identifier
-	identifier = USARTBuffer[3];
+	identifier = USARTBuffer[6 + MASTERSLAVE_TELEMETRY_BYTES];
 	
 	// Calculate result general value
-	value = (int16_t)((USARTBuffer[4] << 8) | USARTBuffer[5]);
-	
-	// Calculate setvalues for enable and shutoff
-	byte = USARTBuffer[6];
+	value = (int16_t)((USARTBuffer[7 + MASTERSLAVE_TELEMETRY_BYTES] << 8) | USARTBuffer[8 + MASTERSLAVE_TELEMETRY_BYTES]);
 	
 	shutoff = (byte & BIT(7)) ? SET : RESET;
-	//none = (byte & BIT(6)) ? SET : RESET;
+	weakening = (byte & BIT(6)) ? SET : RESET;
 	//none = (byte & BIT(5)) ? SET : RESET;
 	//none = (byte & BIT(4)) ? SET : RESET;
 	//none = (byte & BIT(3)) ? SET : RESET;
@@ -211,25 +307,41 @@ void CheckUSARTMasterSlaveInput(uint8_t USARTBuffer[])
 	gpio_bit_write(LED_RED_PORT, LED_RED, chargeStateLowActive == RESET ? SET : RESET);
 	SetEnable(enable);
 	SetPWM(pwmSlave);
+	SetWeakening(weakening);
 	CheckGeneralValue(identifier, value);
 	
+	// Hall learning request is held while the slave learns (master detects the rising edge)
+	if (HALL_IsLearning() == RESET)
+	{
+		hallLearnMaster = RESET;
+	}
+	
+	// Parameter is sent until the master reports the new value
+	if (paramIdentifierMaster < COUNT_PARAMS && paramMaster[paramIdentifierMaster] == paramValueMaster)
+	{
+		paramIdentifierMaster = PARAM_NONE;
+	}
+	
 	// Send answer
-	SendMaster(upperLEDMaster, lowerLEDMaster, mosfetOutMaster, beepsBackwardsMaster);
+	SendMaster(upperLEDMaster, lowerLEDMaster, mosfetOutMaster, beepsBackwardsMaster, weakeningMaster, hallLearnMaster, paramIdentifierMaster, paramValueMaster);
 	
 	// Reset the pwm timout to avoid stopping motors
 	ResetTimeout();
 #endif
+	
+	return SUCCESS;
 }
 
 #ifdef MASTER
 //----------------------------------------------------------------------------
 // Send slave frame via USART
 //----------------------------------------------------------------------------
-void SendSlave(int16_t pwmSlave, FlagStatus enable, FlagStatus shutoff, FlagStatus chargeState, uint8_t identifier, int16_t value)
+void SendSlave(int16_t pwmSlave, FlagStatus enable, FlagStatus shutoff, FlagStatus chargeState, FlagStatus weakening, uint8_t identifier, int16_t value)
 {
 	uint8_t index = 0;
 	uint16_t crc = 0;
 	uint8_t buffer[USART_MASTERSLAVE_TX_BYTES];
+	MASTERSLAVE_TELEMETRY telemetry;
 	
 	// Format pwmValue and general value
 	int16_t sendPwm = CLAMP(pwmSlave, -1000, 1000);
@@ -238,7 +350,7 @@ void SendSlave(int16_t pwmSlave, FlagStatus enable, FlagStatus shutoff, FlagStat
 	
 	uint8_t sendByte = 0;
 	sendByte |= (shutoff << 7);
-	sendByte |= (0 << 6);
+	sendByte |= (weakening << 6);
 	sendByte |= (0 << 5);
 	sendByte |= (0 << 4);
 	sendByte |= (0 << 3);
@@ -246,14 +358,20 @@ void SendSlave(int16_t pwmSlave, FlagStatus enable, FlagStatus shutoff, FlagStat
 	sendByte |= (chargeState << 1);
 	sendByte |= (enable << 0);
 	
+	// Process values of master
+	GetTelemetry(&telemetry);
+	
 	// Send answer
 	buffer[index++] = '/';
+	buffer[index++] = MASTERSLAVE_PROTOCOL_VERSION;
 	buffer[index++] = (sendPwm_Uint >> 8) & 0xFF;
 	buffer[index++] = sendPwm_Uint & 0xFF;
+	buffer[index++] = sendByte;
+	buffer[index++] = sFaultsReceived;
+	index += EncodeTelemetry(&buffer[index], &telemetry);
 	buffer[index++] = identifier;
 	buffer[index++] = (value_Uint >> 8) & 0xFF;
 	buffer[index++] = value_Uint & 0xFF;	
-	buffer[index++] = sendByte;
 	
 	// Calculate CRC
   crc = CalcCRC(buffer, index);
@@ -264,31 +382,53 @@ void SendSlave(int16_t pwmSlave, FlagStatus enable, FlagStatus shutoff, FlagStat
   buffer[index++] = '\n';
 	
 	SendBuffer(USART_MASTERSLAVE, buffer, index);
+	sFaultsReceived = 0;
+}
+
+//----------------------------------------------------------------------------
+// Returns process values sent by slave
+//----------------------------------------------------------------------------
+void GetTelemetrySlave(MASTERSLAVE_TELEMETRY *telemetry)
+{
+	*telemetry = telemetrySlave;
 }
 #endif
 #ifdef SLAVE
 //----------------------------------------------------------------------------
 // Send master frame via USART
 //----------------------------------------------------------------------------
-void SendMaster(FlagStatus upperLEDMaster, FlagStatus lowerLEDMaster, FlagStatus mosfetOutMaster, FlagStatus beepsBackwards)
+void SendMaster(FlagStatus upperLEDMaster, FlagStatus lowerLEDMaster, FlagStatus mosfetOutMaster, FlagStatus beepsBackwards, FlagStatus weakening, FlagStatus hallLearn, uint8_t paramIdentifier, int16_t paramValue)
 {
 	uint8_t index = 0;
 	uint16_t crc = 0;
 	uint8_t buffer[USART_MASTERSLAVE_TX_BYTES];
+	MASTERSLAVE_TELEMETRY telemetry;
+	
+	// Format parameter value
+	uint16_t paramValue_Uint = (uint16_t)(paramValue);
 	
 	uint8_t sendByte = 0;
 	sendByte |= (0 << 7);
 	sendByte |= (0 << 6);
-	sendByte |= (0 << 5);
-	sendByte |= (0 << 4);
+	sendByte |= (hallLearn << 5);
+	sendByte |= (weakening << 4);
 	sendByte |= (beepsBackwards << 3);
 	sendByte |= (mosfetOutMaster << 2);
 	sendByte |= (lowerLEDMaster << 1);
 	sendByte |= (upperLEDMaster << 0);
 	
+	// Process values of slave
+	GetTelemetry(&telemetry);
+	
 	// Send answer
 	buffer[index++] = '/';
+	buffer[index++] = MASTERSLAVE_PROTOCOL_VERSION;
 	buffer[index++] = sendByte;
+	buffer[index++] = sFaultsReceived;
+	buffer[index++] = paramIdentifier;
+	buffer[index++] = (paramValue_Uint >> 8) & 0xFF;
+	buffer[index++] = paramValue_Uint & 0xFF;
+	index += EncodeTelemetry(&buffer[index], &telemetry);
 	
 	// Calculate CRC
   crc = CalcCRC(buffer, index);
@@ -299,6 +439,7 @@ void SendMaster(FlagStatus upperLEDMaster, FlagStatus lowerLEDMaster, FlagStatus
   buffer[index++] = '\n';
 	
 	SendBuffer(USART_MASTERSLAVE, buffer, index);
+	sFaultsReceived = 0;
 }
 
 //----------------------------------------------------------------------------
@@ -306,21 +447,18 @@ void SendMaster(FlagStatus upperLEDMaster, FlagStatus lowerLEDMaster, FlagStatus
 //----------------------------------------------------------------------------
 void CheckGeneralValue(uint8_t identifier, int16_t value)
 {
-	switch(identifier)
+	// Profiler values, scheduler values and parameters of master
+	if (identifier >= MASTERSLAVE_ID_PARAM && identifier < MASTERSLAVE_ID_PARAM + COUNT_PARAMS)
+	{
+		paramMaster[identifier - MASTERSLAVE_ID_PARAM] = PARAM_Decode((PARAM_ID)(identifier - MASTERSLAVE_ID_PARAM), value);
+	}
+	else if (identifier >= MASTERSLAVE_ID_SCHEDULER && identifier < MASTERSLAVE_ID_PARAM)
+	{
+		schedulerMaster[identifier - MASTERSLAVE_ID_SCHEDULER] = value;
+	}
+	else if (identifier < MASTERSLAVE_ID_SCHEDULER)
 	{
-		case 0:
-			currentDCMaster = value;
-			break;
-		case 1:
-			batteryMaster = value;
-			break;
-		case 2:
-			realSpeedMaster = value;
-			break;
-		case 3:
-			break;
-		default:
-			break;
+		profilerMaster[identifier - MASTERSLAVE_ID_PROFILER] = value;
 	}
 }
 
@@ -329,7 +467,7 @@ void CheckGeneralValue(uint8_t identifier, int16_t value)
 //----------------------------------------------------------------------------
 int16_t GetCurrentDCMaster(void)
 {
-	return currentDCMaster;
+	return telemetryMaster.currentDC;
 }
 
 //----------------------------------------------------------------------------
@@ -337,7 +475,7 @@ int16_t GetCurrentDCMaster(void)
 //----------------------------------------------------------------------------
 int16_t GetBatteryMaster(void)
 {
-	return batteryMaster;
+	return telemetryMaster.battery;
 }
 
 //----------------------------------------------------------------------------
@@ -345,7 +483,84 @@ int16_t GetBatteryMaster(void)
 //----------------------------------------------------------------------------
 int16_t GetRealSpeedMaster(void)
 {
-	return realSpeedMaster;
+	return telemetryMaster.realSpeed;
+}
+
+//----------------------------------------------------------------------------
+// Returns hall learning state sent by master
+//----------------------------------------------------------------------------
+int16_t GetHallLearnStateMaster(void)
+{
+	return telemetryMaster.hallLearnState;
+}
+
+//----------------------------------------------------------------------------
+// Returns temperature value sent by master
+//----------------------------------------------------------------------------
+int16_t GetTemperatureMaster(void)
+{
+	return telemetryMaster.temperature;
+}
+
+//----------------------------------------------------------------------------
+// Returns fault flags sent by master (latched until the slave acknowledged them)
+//----------------------------------------------------------------------------
+uint8_t GetFaultsMaster(void)
+{
+	return telemetryMaster.faults;
+}
+
+//----------------------------------------------------------------------------
+// Returns profiler value sent by master
+//----------------------------------------------------------------------------
+int16_t GetProfilerValueMaster(PROFILER_VALUE value)
+{
+	if (value >= COUNT_PROFILER_VALUES)
+	{
+		return 0;
+	}
+	
+	return profilerMaster[value];
+}
+
+//----------------------------------------------------------------------------
+// Returns scheduler value of a task sent by master
+//----------------------------------------------------------------------------
+int16_t GetSchedulerValueMaster(SCHEDULER_TASK task, SCHEDULER_VALUE value)
+{
+	if (task >= COUNT_SCHEDULER_TASKS || value >= COUNT_SCHEDULER_VALUES)
+	{
+		return 0;
+	}
+	
+	return schedulerMaster[task * COUNT_SCHEDULER_VALUES + value];
+}
+
+//----------------------------------------------------------------------------
+// Returns parameter value sent by master
+//----------------------------------------------------------------------------
+int32_t GetParamMaster(PARAM_ID identifier)
+{
+	if (identifier >= COUNT_PARAMS)
+	{
+		return 0;
+	}
+	
+	return paramMaster[identifier];
+}
+
+//----------------------------------------------------------------------------
+// Sets parameter of master (sent until master reports the value)
+//----------------------------------------------------------------------------
+void SetParamMaster(PARAM_ID identifier, int32_t value)
+{
+	if (identifier >= COUNT_PARAMS)
+	{
+		return;
+	}
+	
+	paramValueMaster = PARAM_Limit(identifier, value);
+	paramIdentifierMaster = identifier;
 }
 
 //----------------------------------------------------------------------------
@@ -411,4 +626,82 @@ FlagStatus GetBeepsBackwardsMaster(void)
 {
 	return beepsBackwardsMaster;
 }
+
+//----------------------------------------------------------------------------
+// Sets weakening value which will be send to master
+//----------------------------------------------------------------------------
+void SetWeakeningMaster(FlagStatus value)
+{
+	weakeningMaster = value;
+}
+
+//----------------------------------------------------------------------------
+// Returns weakeningMaster value sent by master
+//----------------------------------------------------------------------------
+FlagStatus GetWeakeningMaster(void)
+{
+	return weakeningMaster;
+}
+
+//----------------------------------------------------------------------------
+// Sets hall learning request which will be send to master
+//----------------------------------------------------------------------------
+void SetHallLearnMaster(FlagStatus value)
+{
+	hallLearnMaster = value;
+}
 #endif
+
+//----------------------------------------------------------------------------
+// Collects process values of this board for the next frame
+//----------------------------------------------------------------------------
+void GetTelemetry(MASTERSLAVE_TELEMETRY *telemetry)
+{
+	telemetry->currentDC = ABS(currentDCFiltered_mA) / 10;
+	telemetry->battery = batteryVoltage_mV / 10;
+	telemetry->realSpeed = realSpeed_mh / 10;
+	telemetry->temperature = temperature_dC;
+	telemetry->faults = GetFaults();
+	telemetry->hall = GetHallState();
+	telemetry->hallLearnState = HALL_GetLearnState();
+	telemetry->isrLoad = (int32_t)GetProfilerValue(PROFILER_ISR_AVG) * 1000 / PROFILER_BUDGET_CYCLES;
+}
+
+//----------------------------------------------------------------------------
+// Writes telemetry to buffer (big endian), returns number of bytes written
+//----------------------------------------------------------------------------
+uint8_t EncodeTelemetry(uint8_t buffer[], const MASTERSLAVE_TELEMETRY *telemetry)
+{
+	uint8_t index = 0;
+	
+	buffer[index++] = ((uint16_t)telemetry->currentDC >> 8) & 0xFF;
+	buffer[index++] = (uint16_t)telemetry->currentDC & 0xFF;
+	buffer[index++] = ((uint16_t)telemetry->battery >> 8) & 0xFF;
+	buffer[index++] = (uint16_t)telemetry->battery & 0xFF;
+	buffer[index++] = ((uint16_t)telemetry->realSpeed >> 8) & 0xFF;
+	buffer[index++] = (uint16_t)telemetry->realSpeed & 0xFF;
+	buffer[index++] = ((uint16_t)telemetry->temperature >> 8) & 0xFF;
+	buffer[index++] = (uint16_t)telemetry->temperature & 0xFF;
+	buffer[index++] = telemetry->faults;
+	buffer[index++] = telemetry->hall;
+	buffer[index++] = telemetry->hallLearnState;
+	buffer[index++] = ((uint16_t)telemetry->isrLoad >> 8) & 0xFF;
+	buffer[index++] = (uint16_t)telemetry->isrLoad & 0xFF;
+	
+	return index;
+}
+
+//----------------------------------------------------------------------------
+// Reads telemetry from buffer (big endian)
+//----------------------------------------------------------------------------
+void DecodeTelemetry(const uint8_t buffer[], MASTERSLAVE_TELEMETRY *telemetry)
+{
+	telemetry->currentDC = (int16_t)((buffer[0] << 8) | buffer[1]);
+	telemetry->battery = (int16_t)((buffer[2] << 8) | buffer[3]);
+	telemetry->realSpeed = (int16_t)((buffer[4] << 8) | buffer[5]);
+	telemetry->temperature = (int16_t)((buffer[6] << 8) | buffer[7]);
+	telemetry->faults = buffer[8];
+	telemetry->hall = buffer[9];
+	telemetry->hallLearnState = buffer[10];
+	telemetry->isrLoad = (int16_t)((buffer[11] << 8) | buffer[12]);
+}
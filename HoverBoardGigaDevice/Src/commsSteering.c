@@ -42,17 +42,18 @@
 // Only master communicates with steerin device
 #ifdef MASTER
 #define USART_STEER_TX_BYTES 2   // Transmit byte count including start '/' and stop character '\n'
-#define USART_STEER_RX_BYTES 8   // Receive byte count including start '/' and stop character '\n'
+#define USART_STEER_RX_BYTES 9   // Receive byte count including start '/' and stop character '\n'
 
-extern uint8_t usartSteer_COM_rx_buf[USART_STEER_COM_RX_BUFFERSIZE];
 static uint8_t sSteerRecord = 0;
 static uint8_t sUSARTSteerRecordBuffer[USART_STEER_RX_BYTES];
 static uint8_t sUSARTSteerRecordBufferCounter = 0;
 
-void CheckUSARTSteerInput(uint8_t u8USARTBuffer[]);
+ErrStatus CheckUSARTSteerInput(uint8_t u8USARTBuffer[]);
+void ParseUSARTSteerInput(uint8_t character);
 
 extern int32_t steer;
 extern int32_t speed;
+extern FlagStatus activateWeakening;
 
 //----------------------------------------------------------------------------
 // Send frame to steer device
@@ -71,13 +72,28 @@ void SendSteerDevice(void)
 
 //----------------------------------------------------------------------------
 // Update USART steer input
+// -> parses all bytes received since the last call
 //----------------------------------------------------------------------------
 void UpdateUSARTSteerInput(void)
 {
-	uint8_t character = usartSteer_COM_rx_buf[0];
+	uint8_t character;
 	
-	// Start character is captured, start record
-	if (character == '/')
+	while (ReadBuffer(USART_STEER_COM, &character) == SET)
+	{
+		ParseUSARTSteerInput(character);
+	}
+}
+
+//----------------------------------------------------------------------------
+// Parse one received byte of the USART steer input
+//----------------------------------------------------------------------------
+void ParseUSARTSteerInput(uint8_t character)
+{
+	uint8_t index;
+	
+	// Start character is captured, start record (binary values may contain
+	// the start character, so it only starts a record outside of a frame)
+	if (sSteerRecord == 0 && character == '/')
 	{
 		sUSARTSteerRecordBufferCounter = 0;
 		sSteerRecord = 1;
@@ -93,8 +109,21 @@ void UpdateUSARTSteerInput(void)
 			sUSARTSteerRecordBufferCounter = 0;
 			sSteerRecord = 0;
 			
-			// Check input
-			CheckUSARTSteerInput (sUSARTSteerRecordBuffer);
+			// Check input, an invalid record started inside a frame: resynchronize
+			// at the next start character of the record
+			if (CheckUSARTSteerInput(sUSARTSteerRecordBuffer) == ERROR)
+			{
+				for (index = 1; index < USART_STEER_RX_BYTES; index++)
+				{
+					if (sUSARTSteerRecordBuffer[index] == '/')
+					{
+						sUSARTSteerRecordBufferCounter = USART_STEER_RX_BYTES - index;
+						memmove(sUSARTSteerRecordBuffer, &sUSARTSteerRecordBuffer[index], sUSARTSteerRecordBufferCounter);
+						sSteerRecord = 1;
+						break;
+					}
+				}
+			}
 		}
 	}
 }
@@ -102,16 +131,17 @@ void UpdateUSARTSteerInput(void)
 //----------------------------------------------------------------------------
 // Check USART steer input
 //----------------------------------------------------------------------------
-void CheckUSARTSteerInput(uint8_t USARTBuffer[])
+ErrStatus CheckUSARTSteerInput(uint8_t USARTBuffer[])
 {
 	// Auxiliary variables
 	uint16_t crc;
+	uint8_t byte;
 	
 	// Check start and stop character
 	if ( USARTBuffer[0] != '/' ||
 		USARTBuffer[USART_STEER_RX_BYTES - 1] != '\n')
 	{
-		return;
+		return ERROR;
 	}
 	
 	// Calculate CRC (first bytes except crc and stop byte)
@@ -121,7 +151,7 @@ void CheckUSARTSteerInput(uint8_t USARTBuffer[])
 	if ( USARTBuffer[USART_STEER_RX_BYTES - 3] != ((crc >> 8) & 0xFF) ||
 		USARTBuffer[USART_STEER_RX_BYTES - 2] != (crc & 0xFF))
 	{
-		return;
+		return ERROR;
 	}
 	
 	// Calculate result speed value -1000 to 1000
@@ -130,7 +160,14 @@ void CheckUSARTSteerInput(uint8_t USARTBuffer[])
 	// Calculate result steering value -1000 to 1000
 	steer = (int16_t)((USARTBuffer[3] << 8) | USARTBuffer[4]);
 	
+	// Calculate setvalues of the steering device (LED, mosfet and beep bits are not used)
+	byte = USARTBuffer[5];
+	
+	activateWeakening = (byte & BIT(7)) ? SET : RESET;
+	
 	// Reset the pwm timout to avoid stopping motors
 	ResetTimeout();
+	
+	return SUCCESS;
 }
 #endif
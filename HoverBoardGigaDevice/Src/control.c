@@ -0,0 +1,283 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "../Inc/control.h"
+
+//----------------------------------------------------------------------------
+// Sets ramp output to value without ramping (-1000 to 1000)
+//----------------------------------------------------------------------------
+void RAMP_Set(RAMP *ramp, int32_t value)
+{
+	ramp->value = value << RAMP_SHIFT;
+	ramp->slope = 0;
+}
+
+//----------------------------------------------------------------------------
+// Moves ramp output one cycle towards the target (-1000 to 1000)
+//----------------------------------------------------------------------------
+int32_t RAMP_Calculate(RAMP *ramp, int32_t target)
+{
+	int32_t limit;
+	int32_t step;
+	int32_t distance;
+	
+	target = target << RAMP_SHIFT;
+	
+	// Select slope limit: reversal while output and target have different signs,
+	// acceleration away from zero and deceleration towards zero
+	if ((ramp->value > 0 && target < 0) || (ramp->value < 0 && target > 0))
+	{
+		limit = ramp->reversal;
+	}
+	else if ((target > 0 && target > ramp->value) || (target < 0 && target < ramp->value))
+	{
+		limit = ramp->accel;
+	}
+	else
+	{
+		limit = ramp->decel;
+	}
+	
+	step = target - ramp->value;
+	if (step > limit)
+	{
+		step = limit;
+	}
+	else if (step < -limit)
+	{
+		step = -limit;
+	}
+	
+	if (ramp->jerk > 0)
+	{
+		// Reduce slope early enough to reach the target without overshoot
+		distance = target - ramp->value;
+		distance = distance < 0 ? -distance : distance;
+		if ((int64_t)ramp->slope * ramp->slope > 2 * (int64_t)ramp->jerk * distance)
+		{
+			step = 0;
+		}
+		
+		// Change slope by at most jerk per cycle
+		if (step > ramp->slope + ramp->jerk)
+		{
+			step = ramp->slope + ramp->jerk;
+		}
+		else if (step < ramp->slope - ramp->jerk)
+		{
+			step = ramp->slope - ramp->jerk;
+		}
+	}
+	
+	ramp->value += step;
+	ramp->slope = step;
+	
+	// Stop at the target (remaining slope of the jerk limitation)
+	if ((step > 0 && ramp->value > target) || (step < 0 && ramp->value < target))
+	{
+		ramp->value = target;
+		ramp->slope = 0;
+	}
+	
+	return ramp->value >> RAMP_SHIFT;
+}
+
+//----------------------------------------------------------------------------
+// Initializes speed controller with gains (Q15) and feed-forward parameters
+//----------------------------------------------------------------------------
+void SPEED_Init(SPEED_CONTROLLER *ctrl, int32_t kp, int32_t ki, int32_t noLoadSpeed, int32_t nominalVoltage)
+{
+	PI_Init(&ctrl->pi, kp, ki, -CONTROL_PWM_MAX, CONTROL_PWM_MAX);
+	ctrl->noLoadSpeed = noLoadSpeed;
+	ctrl->nominalVoltage = nominalVoltage;
+}
+
+//----------------------------------------------------------------------------
+// Resets integrator of speed controller
+//----------------------------------------------------------------------------
+void SPEED_Reset(SPEED_CONTROLLER *ctrl)
+{
+	PI_Reset(&ctrl->pi);
+}
+
+//----------------------------------------------------------------------------
+// Calculates duty cycle (-1000 to 1000) for target and actual speed (m/h),
+// the integrator does not grow while currentLimited is set
+//----------------------------------------------------------------------------
+int32_t SPEED_Calculate(SPEED_CONTROLLER *ctrl, int32_t target, int32_t speed, int32_t batteryVoltage, uint8_t currentLimited)
+{
+	int32_t feedForward = SPEED_FeedForward(ctrl, target, batteryVoltage);
+	int32_t integral = ctrl->pi.integral;
+	int32_t output;
+	
+	// PI only corrects the remaining range, so its integrator stops at the
+	// duty cycle limits including the feed-forward part (anti-windup)
+	ctrl->pi.outMax = CONTROL_PWM_MAX - feedForward;
+	ctrl->pi.outMin = -CONTROL_PWM_MAX - feedForward;
+	
+	output = feedForward + PI_Calculate(&ctrl->pi, target - speed);
+	
+	// Current chopping holds the motor back, a higher duty cycle would not
+	// help: the integrator may only shrink (anti-windup at the current limit)
+	if (currentLimited && ((integral >= 0 && ctrl->pi.integral > integral) || (integral <= 0 && ctrl->pi.integral < integral)))
+	{
+		ctrl->pi.integral = integral;
+	}
+	
+	return output;
+}
+
+//----------------------------------------------------------------------------
+// Calculates duty cycle (-1000 to 1000) which reaches speed (m/h) without load
+//----------------------------------------------------------------------------
+int32_t SPEED_FeedForward(SPEED_CONTROLLER *ctrl, int32_t speed, int32_t batteryVoltage)
+{
+	int32_t feedForward;
+	
+	// No-load duty cycle corrected by the actual battery voltage
+	feedForward = speed * CONTROL_PWM_MAX / ctrl->noLoadSpeed;
+	if (batteryVoltage > 0)
+	{
+		feedForward = feedForward * ctrl->nominalVoltage / batteryVoltage;
+	}
+	if (feedForward > CONTROL_PWM_MAX)
+	{
+		feedForward = CONTROL_PWM_MAX;
+	}
+	else if (feedForward < -CONTROL_PWM_MAX)
+	{
+		feedForward = -CONTROL_PWM_MAX;
+	}
+	
+	return feedForward;
+}
+
+//----------------------------------------------------------------------------
+// Initializes torque controller with gains (Q15)
+//----------------------------------------------------------------------------
+void TORQUE_Init(TORQUE_CONTROLLER *ctrl, int32_t kp, int32_t ki)
+{
+	PI_Init(&ctrl->pi, kp, ki, 0, CONTROL_PWM_MAX);
+	ctrl->direction = 0;
+}
+
+//----------------------------------------------------------------------------
+// Resets integrator of torque controller
+//----------------------------------------------------------------------------
+void TORQUE_Reset(TORQUE_CONTROLLER *ctrl)
+{
+	PI_Reset(&ctrl->pi);
+	ctrl->direction = 0;
+}
+
+//----------------------------------------------------------------------------
+// Calculates duty cycle (-1000 to 1000) for target and measured DC current (mA)
+//----------------------------------------------------------------------------
+int32_t TORQUE_Calculate(TORQUE_CONTROLLER *ctrl, int32_t target, int32_t current)
+{
+	int8_t direction = target > 0 ? 1 : (target < 0 ? -1 : 0);
+	int32_t duty;
+	
+	// DC link current is positive when driving in both directions, so the
+	// controller works on magnitudes and the target only gives the direction
+	if (direction != ctrl->direction)
+	{
+		PI_Reset(&ctrl->pi);
+		ctrl->direction = direction;
+	}
+	if (target < 0)
+	{
+		target = -target;
+	}
+	
+	duty = PI_Calculate(&ctrl->pi, target - current);
+	
+	return direction < 0 ? -duty : duty;
+}
+
+//----------------------------------------------------------------------------
+// Initializes regen limiter with gains (Q15), current (mA) and voltage (mV) limit
+//----------------------------------------------------------------------------
+void REGEN_Init(REGEN_LIMITER *ctrl, int32_t kp, int32_t ki, int32_t currentMax, int32_t voltageMax)
+{
+	PI_Init(&ctrl->pi, kp, ki, 0, CONTROL_PWM_MAX);
+	ctrl->currentMax = currentMax;
+	ctrl->voltageMax = voltageMax;
+	REGEN_Reset(ctrl);
+}
+
+//----------------------------------------------------------------------------
+// Resets regen limiter to full braking depth
+//----------------------------------------------------------------------------
+void REGEN_Reset(REGEN_LIMITER *ctrl)
+{
+	ctrl->pi.integral = ctrl->pi.outMax << 15;
+}
+
+//----------------------------------------------------------------------------
+// Limits braking of the duty cycle (-1000 to 1000) below the back-EMF duty
+// cycle by measured DC current (mA) and battery voltage (mV)
+//----------------------------------------------------------------------------
+int32_t REGEN_Calculate(REGEN_LIMITER *ctrl, int32_t pwm, int32_t backEmfPwm, int32_t current, int32_t batteryVoltage)
+{
+	int32_t error;
+	int32_t voltageError;
+	int32_t depth;
+	int32_t limit;
+	
+	// Regenerative current is negative, the voltage ceiling weighs 1mV like 1mA
+	// and the tighter limit wins
+	error = ctrl->currentMax + current;
+	voltageError = ctrl->voltageMax - batteryVoltage;
+	if (voltageError < error)
+	{
+		error = voltageError;
+	}
+	depth = PI_Calculate(&ctrl->pi, error);
+	
+	// Duty cycle stays on the side of the rotation: braking below zero would
+	// drive the motor backwards with energy from the battery (plugging)
+	if (backEmfPwm > 0)
+	{
+		limit = backEmfPwm - depth;
+		limit = limit < 0 ? 0 : limit;
+		pwm = pwm < limit ? limit : pwm;
+	}
+	else if (backEmfPwm < 0)
+	{
+		limit = backEmfPwm + depth;
+		limit = limit > 0 ? 0 : limit;
+		pwm = pwm > limit ? limit : pwm;
+	}
+	
+	return pwm;
+}
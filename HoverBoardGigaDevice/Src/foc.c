@@ -0,0 +1,117 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "../Inc/foc.h"
+
+//----------------------------------------------------------------------------
+// Sine lookuptable, first quarter wave in 64 steps (Q15)
+//----------------------------------------------------------------------------
+static const int16_t sin_table[65] =
+{
+	0, 804, 1608, 2410, 3212, 4011, 4808, 5602, 6393, 7179, 7962, 8739, 9512,
+	10278, 11039, 11793, 12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530, 18204, 18868,
+	19519, 20159, 20787, 21403, 22005, 22594, 23170, 23731, 24279, 24811, 25329, 25832, 26319,
+	26790, 27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956, 30273, 30571, 30852, 31113,
+	31356, 31580, 31785, 31971, 32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757, 32767,
+};
+
+//----------------------------------------------------------------------------
+// Initializes PI controller with gains (Q15) and output limits
+//----------------------------------------------------------------------------
+void PI_Init(PI_CONTROLLER *pi, int32_t kp, int32_t ki, int32_t outMin, int32_t outMax)
+{
+	pi->kp = kp;
+	pi->ki = ki;
+	pi->outMin = outMin;
+	pi->outMax = outMax;
+	pi->integral = 0;
+}
+
+//----------------------------------------------------------------------------
+// Resets integrator of PI controller
+//----------------------------------------------------------------------------
+void PI_Reset(PI_CONTROLLER *pi)
+{
+	pi->integral = 0;
+}
+
+//----------------------------------------------------------------------------
+// Calculates PI controller output for the given error
+//----------------------------------------------------------------------------
+int32_t PI_Calculate(PI_CONTROLLER *pi, int32_t error)
+{
+	int32_t output;
+	
+	// Integrate and clamp integrator to the output limits (anti-windup)
+	pi->integral += pi->ki * error;
+	if (pi->integral > (pi->outMax << 15))
+	{
+		pi->integral = pi->outMax << 15;
+	}
+	else if (pi->integral < (pi->outMin << 15))
+	{
+		pi->integral = pi->outMin << 15;
+	}
+	
+	// Add proportional part and limit output
+	output = (pi->kp * error + pi->integral) >> 15;
+	if (output > pi->outMax)
+	{
+		output = pi->outMax;
+	}
+	else if (output < pi->outMin)
+	{
+		output = pi->outMin;
+	}
+	
+	return output;
+}
+
+//----------------------------------------------------------------------------
+// Sine of a 16 bit angle (65536 = 360 degrees) in Q15
+//----------------------------------------------------------------------------
+int16_t FOC_Sine(uint16_t angle)
+{
+	uint8_t index = (uint16_t)(angle + 128) >> 8;
+	uint8_t step = index & 0x3F;
+	
+	switch(index >> 6)
+	{
+		case 0:
+			return sin_table[step];
+		case 1:
+			return sin_table[64 - step];
+		case 2:
+			return -sin_table[step];
+		default:
+			return -sin_table[64 - step];
+	}
+}
@@ -0,0 +1,431 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "gd32f1x0.h"
+#include "../Inc/hall.h"
+#include "../Inc/defines.h"
+#include "../Inc/bldc.h"
+#include "../Inc/comms.h"
+#include "string.h"
+
+// Open loop learning: align time, speed (1 electrical revolution per second
+// as Q16 angle per cycle) and electrical revolutions per direction
+#define HALL_LEARN_ALIGN_CYCLES (BLDC_CALC_FREQ / 2)
+#define HALL_LEARN_STEP         ((uint32_t)(((uint64_t)1 << 32) / BLDC_CALC_FREQ))
+#define HALL_LEARN_CYCLES       (BLDC_CALC_FREQ * HALL_LEARN_REVOLUTIONS)
+#define HALL_LEARN_REVOLUTIONS  4
+
+// Maximum deviation of a learned angle from the center of its position
+#define HALL_LEARN_TOLERANCE    3641 // 20 degrees
+
+// Learned tables stored in flash, CRC over all bytes before crc
+#define HALL_FLASH_MAGIC        0x48414C4C // 'HALL'
+typedef union
+{
+	struct
+	{
+		uint32_t magic;
+		uint8_t hallToPos[8];
+		uint16_t posToAngle[7];
+		int8_t direction;
+		uint8_t reserved[3];
+		uint16_t crc;
+	} record;
+	uint32_t words[8];
+} HALL_FLASH_RECORD;
+
+// Tables used by CalculateBLDC (defaults of the original motor wiring)
+uint8_t hall_to_pos[8] =
+{
+	// annotation: for example SA=0 means hall sensor pulls SA down to Ground
+  0, // hall position [-] - No function (access from 1-6) 
+  3, // hall position [1] (SA=1, SB=0, SC=0) -> PWM-position 3
+  5, // hall position [2] (SA=0, SB=1, SC=0) -> PWM-position 5
+  4, // hall position [3] (SA=1, SB=1, SC=0) -> PWM-position 4
+  1, // hall position [4] (SA=0, SB=0, SC=1) -> PWM-position 1
+  2, // hall position [5] (SA=1, SB=0, SC=1) -> PWM-position 2
+  6, // hall position [6] (SA=0, SB=1, SC=1) -> PWM-position 6
+  0, // hall position [-] - No function (access from 1-6) 
+};
+
+// Electrical angle at the center of each PWM-position (access from 1-6)
+uint16_t pos_to_angle[7] =
+{
+	0,     // PWM-position [-] - No function
+	32768, // PWM-position [1] -> 180 degrees
+	43691, // PWM-position [2] -> 240 degrees
+	54613, // PWM-position [3] -> 300 degrees
+	0,     // PWM-position [4] ->   0 degrees
+	10923, // PWM-position [5] ->  60 degrees
+	21845, // PWM-position [6] -> 120 degrees
+};
+
+// Sign between positive pwm and the PWM-position sequence (+1: positive pwm
+// steps 1, 2, .. 6), the default tables are assumed to match the motor
+int8_t hall_direction = 1;
+static FlagStatus directionLearned = RESET;
+
+// Learning variables (written by the ISR)
+static volatile HALL_LEARN_STATE learnState = HALL_LEARN_IDLE;
+static uint32_t learnAngle = 0;									// Q16 electrical angle
+static uint32_t learnCounter = 0;
+static uint8_t learnLastHall = 0;
+static uint8_t learnNextHall[2][8];							// [forward, backward][hall], following hall state
+static FlagStatus learnInvalidHall = RESET;
+static uint16_t learnEdgeFirst[2][8];						// [forward, backward][hall]
+static int32_t learnEdgeSum[2][8];
+static uint16_t learnEdgeCount[2][8];
+
+// Learning only starts with the motor at rest and no command
+extern int32_t realSpeed_mh;
+extern int16_t bldc_inputFilterPwm;
+
+ErrStatus HALL_Evaluate(uint8_t hallToPos[], uint16_t posToAngle[], int8_t *direction);
+ErrStatus HALL_CheckTables(uint8_t hallToPos[]);
+ErrStatus HALL_WriteFlash(uint8_t hallToPos[], uint16_t posToAngle[], int8_t direction);
+
+//----------------------------------------------------------------------------
+// Loads learned tables from flash, defaults when none are stored
+//----------------------------------------------------------------------------
+void HALL_Init(void)
+{
+	HALL_FLASH_RECORD record;
+	
+	memcpy(&record, (const void *)HALL_FLASH_ADDRESS, sizeof(record));
+	
+	// Keep defaults for an erased page, a corrupted record or invalid tables
+	if (record.record.magic != HALL_FLASH_MAGIC ||
+		record.record.crc != CalcCRC((uint8_t *)&record, sizeof(record) - sizeof(record.record.crc)) ||
+		HALL_CheckTables(record.record.hallToPos) == ERROR ||
+		(record.record.direction != 1 && record.record.direction != -1))
+	{
+		return;
+	}
+	
+	memcpy(hall_to_pos, record.record.hallToPos, sizeof(hall_to_pos));
+	memcpy(pos_to_angle, record.record.posToAngle, sizeof(pos_to_angle));
+	hall_direction = record.record.direction;
+	directionLearned = SET;
+}
+
+//----------------------------------------------------------------------------
+// Starts hall sensor learning (motor spins open loop!)
+// -> refused while the motor turns or a command is set, a command set
+//    during learning aborts it (see CalculateBLDC)
+//----------------------------------------------------------------------------
+ErrStatus HALL_StartLearning(void)
+{
+	if (HALL_IsLearning() == SET || learnState == HALL_LEARN_EVALUATE ||
+		realSpeed_mh != 0 || bldc_inputFilterPwm != 0)
+	{
+		return ERROR;
+	}
+	
+	memset(learnEdgeCount, 0, sizeof(learnEdgeCount));
+	memset(learnNextHall, 0, sizeof(learnNextHall));
+	learnInvalidHall = RESET;
+	learnAngle = 0;
+	learnCounter = 0;
+	learnLastHall = 0;
+	learnState = HALL_LEARN_ALIGN;
+	return SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+// Aborts a running hall sensor learning
+//----------------------------------------------------------------------------
+void HALL_AbortLearning(void)
+{
+	if (HALL_IsLearning() == SET)
+	{
+		learnState = HALL_LEARN_FAILED;
+	}
+}
+
+//----------------------------------------------------------------------------
+// Returns if the learning drives the motor
+//----------------------------------------------------------------------------
+FlagStatus HALL_IsLearning(void)
+{
+	return (learnState == HALL_LEARN_ALIGN || learnState == HALL_LEARN_FORWARD || learnState == HALL_LEARN_BACKWARD) ? SET : RESET;
+}
+
+//----------------------------------------------------------------------------
+// Returns state of the hall sensor learning
+//----------------------------------------------------------------------------
+HALL_LEARN_STATE HALL_GetLearnState(void)
+{
+	return learnState;
+}
+
+//----------------------------------------------------------------------------
+// Returns if hall_direction has been measured by a learning (stored in flash)
+//----------------------------------------------------------------------------
+FlagStatus HALL_IsDirectionLearned(void)
+{
+	return directionLearned;
+}
+
+//----------------------------------------------------------------------------
+// Records hall edges and returns the open loop angle => called from ISR
+// -> the rotor aligns to the applied voltage vector and follows it slowly,
+//    edges are recorded in both directions to cancel the load angle
+//----------------------------------------------------------------------------
+uint16_t HALL_Learn(uint8_t hall)
+{
+	uint8_t direction;
+	uint16_t angle;
+	
+	if (hall == 0 || hall == 7)
+	{
+		learnInvalidHall = SET;
+	}
+	
+	learnCounter++;
+	switch (learnState)
+	{
+		case HALL_LEARN_ALIGN:
+			if (learnCounter >= HALL_LEARN_ALIGN_CYCLES)
+			{
+				learnCounter = 0;
+				learnState = HALL_LEARN_FORWARD;
+			}
+			break;
+		case HALL_LEARN_FORWARD:
+			learnAngle += HALL_LEARN_STEP;
+			if (learnCounter >= HALL_LEARN_CYCLES)
+			{
+				learnCounter = 0;
+				learnState = HALL_LEARN_BACKWARD;
+			}
+			break;
+		case HALL_LEARN_BACKWARD:
+			learnAngle -= HALL_LEARN_STEP;
+			if (learnCounter >= HALL_LEARN_CYCLES)
+			{
+				learnCounter = 0;
+				learnState = HALL_LEARN_EVALUATE;
+			}
+			break;
+		default:
+			break;
+	}
+	angle = learnAngle >> 16;
+	
+	// Record the angle at which a hall state is entered, relative to its first edge
+	if ((learnState == HALL_LEARN_FORWARD || learnState == HALL_LEARN_BACKWARD) &&
+		hall != learnLastHall && learnLastHall != 0 && hall != 0 && hall != 7)
+	{
+		direction = learnState == HALL_LEARN_FORWARD ? 0 : 1;
+		if (learnEdgeCount[direction][hall] == 0)
+		{
+			learnEdgeFirst[direction][hall] = angle;
+			learnEdgeSum[direction][hall] = 0;
+		}
+		else
+		{
+			learnEdgeSum[direction][hall] += (int16_t)(angle - learnEdgeFirst[direction][hall]);
+		}
+		learnEdgeCount[direction][hall]++;
+		learnNextHall[direction][learnLastHall] = hall;
+	}
+	learnLastHall = hall;
+	
+	return angle;
+}
+
+//----------------------------------------------------------------------------
+// Evaluates and stores finished learning => called from main loop
+//----------------------------------------------------------------------------
+void HALL_Update(void)
+{
+	uint8_t hallToPos[8];
+	uint16_t posToAngle[7];
+	int8_t direction;
+	
+	if (learnState != HALL_LEARN_EVALUATE)
+	{
+		return;
+	}
+	
+	if (HALL_Evaluate(hallToPos, posToAngle, &direction) == ERROR)
+	{
+		learnState = HALL_LEARN_FAILED;
+		return;
+	}
+	
+	// Use new tables (motor is not driven by the learning anymore)
+	memcpy(hall_to_pos, hallToPos, sizeof(hall_to_pos));
+	memcpy(pos_to_angle, posToAngle, sizeof(pos_to_angle));
+	hall_direction = direction;
+	directionLearned = SET;
+	
+	learnState = HALL_WriteFlash(hallToPos, posToAngle, direction) == SUCCESS ? HALL_LEARN_DONE : HALL_LEARN_FAILED;
+}
+
+//----------------------------------------------------------------------------
+// Calculates tables and direction from the recorded hall edges
+//----------------------------------------------------------------------------
+ErrStatus HALL_Evaluate(uint8_t hallToPos[], uint16_t posToAngle[], int8_t *direction)
+{
+	uint8_t hall;
+	uint8_t pos;
+	uint8_t next;
+	uint8_t step;
+	uint16_t forward;
+	uint16_t backward;
+	uint16_t angle;
+	uint8_t used = 0;
+	int8_t steps = 0;
+	
+	if (learnInvalidHall == SET)
+	{
+		return ERROR;
+	}
+	
+	memset(hallToPos, 0, 8);
+	memset(posToAngle, 0, 7 * sizeof(uint16_t));
+	
+	for (hall = 1; hall <= 6; hall++)
+	{
+		if (learnEdgeCount[0][hall] == 0 || learnEdgeCount[1][hall] == 0)
+		{
+			return ERROR;
+		}
+		
+		// Hall state is entered at its lower edge forwards and at its upper edge
+		// backwards, the load angle shifts both edges in opposite directions
+		forward = learnEdgeFirst[0][hall] + learnEdgeSum[0][hall] / learnEdgeCount[0][hall];
+		backward = learnEdgeFirst[1][hall] + learnEdgeSum[1][hall] / learnEdgeCount[1][hall];
+		angle = forward + (int16_t)(backward - forward) / 2;
+		
+		// Rotor aligns 90 degrees behind the commutation angle of sinus commutation
+		angle += ANGLE_90_DEG;
+		
+		// Position with the nearest center, it must be close and unique
+		pos = HALL_ANGLE_TO_POS(angle);
+		if (ABS((int16_t)(angle - (uint16_t)(pos * ANGLE_60_DEG + ANGLE_120_DEG))) > HALL_LEARN_TOLERANCE ||
+			(used & (1 << pos)))
+		{
+			return ERROR;
+		}
+		used |= 1 << pos;
+		hallToPos[hall] = pos;
+		posToAngle[pos] = angle;
+	}
+	
+	// Position steps of the recorded hall sequences with the new tables, the
+	// positive learning pwm turned the voltage vector forwards
+	for (hall = 1; hall <= 6; hall++)
+	{
+		next = learnNextHall[0][hall];
+		step = next != 0 ? (hallToPos[next] + 6 - hallToPos[hall]) % 6 : 0;
+		steps += step == 1 ? 1 : (step == 5 ? -1 : 0);
+		
+		next = learnNextHall[1][hall];
+		step = next != 0 ? (hallToPos[next] + 6 - hallToPos[hall]) % 6 : 0;
+		steps -= step == 1 ? 1 : (step == 5 ? -1 : 0);
+	}
+	
+	// Most steps of both directions must agree
+	if (ABS(steps) < 8)
+	{
+		return ERROR;
+	}
+	*direction = steps > 0 ? 1 : -1;
+	
+	return HALL_CheckTables(hallToPos);
+}
+
+//----------------------------------------------------------------------------
+// Checks that each hall state maps to a different position
+//----------------------------------------------------------------------------
+ErrStatus HALL_CheckTables(uint8_t hallToPos[])
+{
+	uint8_t hall;
+	uint8_t used = 0;
+	
+	if (hallToPos[0] != 0 || hallToPos[7] != 0)
+	{
+		return ERROR;
+	}
+	for (hall = 1; hall <= 6; hall++)
+	{
+		if (hallToPos[hall] < 1 || hallToPos[hall] > 6 || (used & (1 << hallToPos[hall])))
+		{
+			return ERROR;
+		}
+		used |= 1 << hallToPos[hall];
+	}
+	
+	return SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+// Stores tables in flash (CPU stalls during erase, motor must not be driven)
+//----------------------------------------------------------------------------
+ErrStatus HALL_WriteFlash(uint8_t hallToPos[], uint16_t posToAngle[], int8_t direction)
+{
+	HALL_FLASH_RECORD record;
+	uint8_t index;
+	ErrStatus result = SUCCESS;
+	
+	memset(&record, 0, sizeof(record));
+	record.record.magic = HALL_FLASH_MAGIC;
+	memcpy(record.record.hallToPos, hallToPos, sizeof(record.record.hallToPos));
+	memcpy(record.record.posToAngle, posToAngle, sizeof(record.record.posToAngle));
+	record.record.direction = direction;
+	record.record.crc = CalcCRC((uint8_t *)&record, sizeof(record) - sizeof(record.record.crc));
+	
+	fmc_unlock();
+	fmc_flag_clear(FMC_FLAG_END | FMC_FLAG_WPERR | FMC_FLAG_PGERR);
+	if (fmc_page_erase(HALL_FLASH_ADDRESS) != FMC_READY)
+	{
+		result = ERROR;
+	}
+	for (index = 0; index < 8 && result == SUCCESS; index++)
+	{
+		fmc_flag_clear(FMC_FLAG_END | FMC_FLAG_WPERR | FMC_FLAG_PGERR);
+		if (fmc_word_program(HALL_FLASH_ADDRESS + index * 4, record.words[index]) != FMC_READY)
+		{
+			result = ERROR;
+		}
+	}
+	fmc_lock();
+	
+	// Verify written record
+	if (memcmp(&record, (const void *)HALL_FLASH_ADDRESS, sizeof(record)) != 0)
+	{
+		result = ERROR;
+	}
+	
+	return result;
+}
@@ -34,182 +34,234 @@
 #include "../Inc/config.h"
 #include "../Inc/bldc.h"
 #include "../Inc/led.h"
+#include "../Inc/analog.h"
+#include "../Inc/profiler.h"
+#include "../Inc/comms.h"
 #include "../Inc/commsMasterSlave.h"
 #include "../Inc/commsSteering.h"
 #include "../Inc/commsBluetooth.h"
+#include "../Inc/param.h"
+#include "../Inc/timebase.h"
 
-uint32_t msTicks;
-uint32_t timeoutCounter_ms = 0;
 FlagStatus timedOut = SET;
 
-#ifdef SLAVE
-uint32_t hornCounter_ms = 0;
-#endif
-
 extern int32_t steer;
 extern int32_t speed;
 extern FlagStatus activateWeakening;
 extern FlagStatus beepsBackwards;
 
+// ADC buffer filled by the ADC interrupt
+extern adc_buf_t adc_buffer;
+
+void UpdateUSARTSteerCOMInput(void);
+void Timeout(void);
+
 //----------------------------------------------------------------------------
 // SysTick_Handler
+// -> systick runs with 1kHz, runs the software timers and wakes the main loop
+//    scheduler
 //----------------------------------------------------------------------------
 void SysTick_Handler(void)
 {
-  msTicks++;
+	TIMEBASE_Tick();
 }
 
 //----------------------------------------------------------------------------
-// Resets the timeout to zero
+// Restarts the timeout (called by every valid steering/master frame)
 //----------------------------------------------------------------------------
 void ResetTimeout(void)
 {
-  timeoutCounter_ms = 0;
+	TIMEBASE_StartTimer(TIMEBASE_TIMER_TIMEOUT, Timeout, PARAM_Get(PARAM_TIMEOUT_MS), 0);
+	timedOut = RESET;
 }
 
 //----------------------------------------------------------------------------
-// Timer13_Update_Handler
-// Is called when upcouting of timer13 is finished and the UPDATE-flag is set
-// -> period of timer13 running with 1kHz -> interrupt every 1ms
+// Timeout callback
+// Is called when no frame was received for PARAM_TIMEOUT_MS
 //----------------------------------------------------------------------------
-void TIMER13_IRQHandler(void)
-{	
-	if (timeoutCounter_ms > TIMEOUT_MS)
-	{
-		// First timeout reset all process values
-		if (timedOut == RESET)
-		{
+void Timeout(void)
+{
+	// Reset all process values
 #ifdef MASTER
-			steer = 0;
-			speed = 0;
-			beepsBackwards = RESET;
+	steer = 0;
+	speed = 0;
+	activateWeakening = RESET;
+	beepsBackwards = RESET;
 #endif
 #ifdef SLAVE
-			SetPWM(0);
+	SetPWM(0);
 #endif
-		}
-		
-		timedOut = SET;
-	}
-	else
-	{
-		timedOut = RESET;
-		timeoutCounter_ms++;
-	}
+	
+	timedOut = SET;
+}
 
-#ifdef SLAVE
-	if (hornCounter_ms >= 2000)
-	{
-		// Avoid horn to be activated longer than 2 seconds
-		SetUpperLEDMaster(RESET);
-	}
-	else if (hornCounter_ms < 2000)
+//----------------------------------------------------------------------------
+// This function handles EXTI0_1_IRQHandler interrupt
+// Is called on every edge of hall sensor B (PF1)
+//----------------------------------------------------------------------------
+void EXTI0_1_IRQHandler(void)
+{
+	if (exti_interrupt_flag_get(HALL_B_EXTI) == SET)
 	{
-		hornCounter_ms++;
+		exti_interrupt_flag_clear(HALL_B_EXTI);
+		CalculateHallEdge();
 	}
-	
-	// Update LED program
-	CalculateLEDProgram();
-#endif
-	
-	// Clear timer update interrupt flag
-	timer_interrupt_flag_clear(TIMER13, TIMER_INT_UP);
 }
 
 //----------------------------------------------------------------------------
-// Timer0_Update_Handler
-// Is called when upcouting of timer0 is finished and the UPDATE-flag is set
-// AND when downcouting of timer0 is finished and the UPDATE-flag is set
-// -> pwm of timer0 running with 16kHz -> interrupt every 31,25us
+// This function handles EXTI4_15_IRQHandler interrupt
+// Is called on every edge of hall sensor A (PB11) and C (PC14)
 //----------------------------------------------------------------------------
-void TIMER0_BRK_UP_TRG_COM_IRQHandler(void)
+void EXTI4_15_IRQHandler(void)
 {
-	// Start ADC conversion
-	adc_software_trigger_enable(ADC_REGULAR_CHANNEL);
-	
-	// Clear timer update interrupt flag
-	timer_interrupt_flag_clear(TIMER_BLDC, TIMER_INT_UP);
+	if (exti_interrupt_flag_get(HALL_A_EXTI) == SET ||
+		exti_interrupt_flag_get(HALL_C_EXTI) == SET)
+	{
+		exti_interrupt_flag_clear(HALL_A_EXTI);
+		exti_interrupt_flag_clear(HALL_C_EXTI);
+		CalculateHallEdge();
+	}
 }
 
 //----------------------------------------------------------------------------
-// This function handles DMA_Channel0_IRQHandler interrupt
-// Is called, when the ADC scan sequence is finished
-// -> ADC is triggered from timer0-update-interrupt -> every 31,25us
+// This function handles ADC_CMP_IRQHandler interrupt
+// Is called, when the ADC inserted sequence is finished
+// -> ADC is triggered by timer0 TRGO when upcounting AND downcounting of
+//    timer0 is finished (pwm center) -> every 31,25us
+// -> cycles of this ISR are measured by the profiler
 //----------------------------------------------------------------------------
-void DMA_Channel0_IRQHandler(void)
+void ADC_CMP_IRQHandler(void)
 {
+	// Start cycle measurement
+	PROFILER_ISR_START();
+	
+	// Clear end of inserted group flag
+	adc_interrupt_flag_clear(ADC_INT_FLAG_EOIC);
+	
+	// Copy results of the inserted group
+	adc_buffer.v_batt = adc_inserted_data_read(ADC_INSERTED_CHANNEL_0);
+	adc_buffer.current_dc = adc_inserted_data_read(ADC_INSERTED_CHANNEL_1);
+	
 	// Calculate motor PWMs
 	CalculateBLDC();
 	
-	#ifdef SLAVE
-	// Calculates RGB LED
-	CalculateLEDPWM();
-	#endif
-	
-	if (dma_interrupt_flag_get(DMA_CH0, DMA_INT_FLAG_FTF))
+	// Evaluate cycle measurement
+	PROFILER_ISR_END();
+}
+
+
+#ifdef SLAVE
+//----------------------------------------------------------------------------
+// This function handles TIMER1_IRQHandler interrupt
+// Is called at the start of every LED PWM period (update) -> 1kHz
+//----------------------------------------------------------------------------
+void TIMER1_IRQHandler(void)
+{
+	if (timer_interrupt_flag_get(TIMER_LED, TIMER_INT_UP) == SET)
 	{
-		dma_interrupt_flag_clear(DMA_CH0, DMA_INT_FLAG_FTF);        
+		timer_interrupt_flag_clear(TIMER_LED, TIMER_INT_UP);
+		CalculateLEDPWM();
 	}
 }
-
+#endif
 
 //----------------------------------------------------------------------------
 // This function handles DMA_Channel1_2_IRQHandler interrupt
-// Is asynchronously called when USART0 RX finished
+// Is asynchronously called when USART0 TX finished or RX ring buffer is half/completely filled
 //----------------------------------------------------------------------------
 void DMA_Channel1_2_IRQHandler(void)
 {
-	// USART steer/bluetooth RX
-	if (dma_interrupt_flag_get(DMA_CH2, DMA_INT_FLAG_FTF))
+	// USART steer/bluetooth TX
+	if (dma_interrupt_flag_get(USART_STEER_COM_TX_DMA, DMA_INT_FLAG_FTF))
+	{
+		dma_interrupt_flag_clear(USART_STEER_COM_TX_DMA, DMA_INT_FLAG_FTF);
+		
+		// Start next queued frame
+		SendBufferComplete(USART_STEER_COM);
+	}
+	
+	// USART steer/bluetooth RX ring buffer half or completely filled
+	if (dma_interrupt_flag_get(USART_STEER_COM_RX_DMA, DMA_INT_FLAG_HTF) ||
+		dma_interrupt_flag_get(USART_STEER_COM_RX_DMA, DMA_INT_FLAG_FTF))
+	{
+		dma_interrupt_flag_clear(USART_STEER_COM_RX_DMA, DMA_INT_FLAG_HTF);
+		dma_interrupt_flag_clear(USART_STEER_COM_RX_DMA, DMA_INT_FLAG_FTF);
+		
+		// Update USART steer/bluetooth input mechanism
+		UpdateUSARTSteerCOMInput();
+	}
+}
+
+//----------------------------------------------------------------------------
+// This function handles USART0_IRQHandler interrupt
+// Is called when the steer/bluetooth RX line becomes idle (end of frame)
+//----------------------------------------------------------------------------
+void USART0_IRQHandler(void)
+{
+	if (usart_interrupt_flag_get(USART_STEER_COM, USART_INT_FLAG_IDLE))
 	{
+		usart_interrupt_flag_clear(USART_STEER_COM, USART_INT_FLAG_IDLE);
+		
+		// Update USART steer/bluetooth input mechanism
+		UpdateUSARTSteerCOMInput();
+	}
+}
+
+//----------------------------------------------------------------------------
+// Updates the input mechanism connected to the steer/bluetooth USART
+//----------------------------------------------------------------------------
+void UpdateUSARTSteerCOMInput(void)
+{
 #ifdef MASTER
-		// Update USART steer input mechanism
-		UpdateUSARTSteerInput();
+	// Update USART steer input mechanism
+	UpdateUSARTSteerInput();
 #endif
 #ifdef SLAVE
-		// Update USART bluetooth input mechanism
-		UpdateUSARTBluetoothInput();
+	// Update USART bluetooth input mechanism
+	UpdateUSARTBluetoothInput();
 #endif
-		dma_interrupt_flag_clear(DMA_CH2, DMA_INT_FLAG_FTF);        
-	}
 }
 
 
 //----------------------------------------------------------------------------
 // This function handles DMA_Channel3_4_IRQHandler interrupt
-// Is asynchronously called when USART_SLAVE RX finished
+// Is asynchronously called when USART_SLAVE TX finished or RX ring buffer is half/completely filled
 //----------------------------------------------------------------------------
 void DMA_Channel3_4_IRQHandler(void)
 {
-	// USART master slave RX
-	if (dma_interrupt_flag_get(DMA_CH4, DMA_INT_FLAG_FTF))
+	// USART master slave TX
+	if (dma_interrupt_flag_get(USART_MASTERSLAVE_TX_DMA, DMA_INT_FLAG_FTF))
 	{
+		dma_interrupt_flag_clear(USART_MASTERSLAVE_TX_DMA, DMA_INT_FLAG_FTF);
+		
+		// Start next queued frame
+		SendBufferComplete(USART_MASTERSLAVE);
+	}
+	
+	// USART master slave RX ring buffer half or completely filled
+	if (dma_interrupt_flag_get(USART_MASTERSLAVE_RX_DMA, DMA_INT_FLAG_HTF) ||
+		dma_interrupt_flag_get(USART_MASTERSLAVE_RX_DMA, DMA_INT_FLAG_FTF))
+	{
+		dma_interrupt_flag_clear(USART_MASTERSLAVE_RX_DMA, DMA_INT_FLAG_HTF);
+		dma_interrupt_flag_clear(USART_MASTERSLAVE_RX_DMA, DMA_INT_FLAG_FTF);
+		
 		// Update USART master slave input mechanism
 		UpdateUSARTMasterSlaveInput();
-		
-		dma_interrupt_flag_clear(DMA_CH4, DMA_INT_FLAG_FTF);        
 	}
 }
 
 //----------------------------------------------------------------------------
-// Returns number of milliseconds since system start
+// This function handles USART1_IRQHandler interrupt
+// Is called when the master slave RX line becomes idle (end of frame)
 //----------------------------------------------------------------------------
-uint32_t millis()
+void USART1_IRQHandler(void)
 {
-	return msTicks;
-}
-
-//----------------------------------------------------------------------------
-// Delays number of tick Systicks (happens every 10 ms)
-//----------------------------------------------------------------------------
-void Delay (uint32_t dlyTicks)
-{
-  uint32_t curTicks;
-
-  curTicks = msTicks;
-  while ((msTicks - curTicks) < dlyTicks)
+	if (usart_interrupt_flag_get(USART_MASTERSLAVE, USART_INT_FLAG_IDLE))
 	{
-		__NOP();
+		usart_interrupt_flag_clear(USART_MASTERSLAVE, USART_INT_FLAG_IDLE);
+		
+		// Update USART master slave input mechanism
+		UpdateUSARTMasterSlaveInput();
 	}
 }
 
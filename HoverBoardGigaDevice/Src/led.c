@@ -43,25 +43,22 @@ static unsigned char su8BrightnessTable[64] =
 	97,106,116,126,138,150,164,179,196,214,234,255};
 
 // Variables for RGB output
-uint8_t counter_Red = 0;
-uint8_t counter_Green = 0;
-uint8_t counter_Blue = 0;
 uint8_t setValue_Red = 0;
 uint8_t setValue_Green = 0;
 uint8_t setValue_Blue = 0;
 	
 // Variables for HSB calculation
-static uint16_t hueValue = 0;
-static uint8_t saturationValue = 128;
-static uint8_t brightnessValue = 63;
+static uint16_t hueValue = LED_HUE_DEFAULT;
+static uint8_t saturationValue = LED_SATURATION_DEFAULT;
+static uint8_t brightnessValue = LED_BRIGHTNESS_DEFAULT;
 	
 // Variable for LED-program
-static LED_PROGRAM sLEDProgram = LED_OFF;
+static LED_PROGRAM sLEDProgram = (LED_PROGRAM)LED_PROGRAM_DEFAULT;
 
 // Variables for effects
-static uint16_t speedFading = 150;		// Fading-Delay	
-static uint16_t speedBlink = 1274;		// Blink-Delay
-static uint16_t speedStrobe = 40;			// Strobe-Delay
+static uint16_t speedFading = LED_SPEED_FADING_DEFAULT;		// Fading-Delay	
+static uint16_t speedBlink = LED_SPEED_BLINK_DEFAULT;			// Blink-Delay
+static uint16_t speedStrobe = LED_SPEED_STROBE_DEFAULT;		// Strobe-Delay
 
 // Counter for effects
 static uint16_t fadingCounter = 0;
@@ -75,19 +72,29 @@ uint8_t HSBtoGreen(uint16_t hue, uint8_t sat);
 uint8_t HSBtoBlue(uint16_t hue, uint8_t sat);
 
 //----------------------------------------------------------------------------
-// Update RGB LED output with 16kHz
+// Update RGB LED output at the start of every LED PWM period (1kHz)
+// -> LED outputs are high for setValue of 256 timer steps. Compare values
+//    written here take effect with the next period
 //----------------------------------------------------------------------------
 void CalculateLEDPWM(void)
 {
-	// Upcounting with overflow
-	counter_Red++;
-	counter_Green++;
-	counter_Blue++;
+	// Mosfet output has no timer channel and is switched once per period,
+	// high in setValue of 256 periods (first order sigma delta)
+	static uint16_t sigmaDelta_Blue = 0;
 	
-	// Set LEDs
-	gpio_bit_write(UPPER_LED_PORT, UPPER_LED_PIN, counter_Red >= setValue_Red ? RESET : SET);
-	gpio_bit_write(LOWER_LED_PORT, LOWER_LED_PIN, counter_Green >= setValue_Green ? RESET : SET);
-	gpio_bit_write(MOSFET_OUT_PORT, MOSFET_OUT_PIN, counter_Blue >= setValue_Blue ? RESET : SET);
+	sigmaDelta_Blue += setValue_Blue;
+	if (sigmaDelta_Blue >= 256)
+	{
+		sigmaDelta_Blue -= 256;
+		gpio_bit_write(MOSFET_OUT_PORT, MOSFET_OUT_PIN, SET);
+	}
+	else
+	{
+		gpio_bit_write(MOSFET_OUT_PORT, MOSFET_OUT_PIN, RESET);
+	}
+	
+	timer_channel_output_pulse_value_config(TIMER_LED, TIMER_LED_CHANNEL_UPPER, setValue_Red);
+	timer_channel_output_pulse_value_config(TIMER_LED, TIMER_LED_CHANNEL_LOWER, setValue_Green);
 }
 
 //----------------------------------------------------------------------------
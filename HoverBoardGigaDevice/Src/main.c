@@ -40,6 +40,16 @@
 #include "../Inc/commsMasterSlave.h"
 #include "../Inc/commsSteering.h"
 #include "../Inc/commsBluetooth.h"
+#include "../Inc/profiler.h"
+#include "../Inc/benchmark.h"
+#include "../Inc/hall.h"
+#include "../Inc/param.h"
+#include "../Inc/buzzer.h"
+#include "../Inc/scheduler.h"
+#include "../Inc/timebase.h"
+#include "../Inc/analog.h"
+#include "../Inc/led.h"
+#include "../Inc/comms.h"
 #include "stdio.h"
 #include "stdlib.h"
 #include "string.h"
@@ -50,25 +60,34 @@
 int32_t steer = 0; 												// global variable for steering. -1000 to 1000
 int32_t speed = 0; 												// global variable for speed.    -1000 to 1000
 FlagStatus activateWeakening = RESET;			// global variable for weakening
+FlagStatus activateWeakeningBluetooth = RESET;	// global variable for weakening requested over bluetooth (slave)
 FlagStatus beepsBackwards = RESET;  			// global variable for beeps backwards
 			
-extern uint8_t buzzerFreq;    						// global variable for the buzzer pitch. can be 1, 2, 3, 4, 5, 6, 7...
-extern uint8_t buzzerPattern; 						// global variable for the buzzer pattern. can be 1, 2, 3, 4, 5, 6, 7...
-			
-extern float batteryVoltage; 							// global variable for battery voltage
-extern float currentDC; 									// global variable for current dc
-extern float realSpeed; 									// global variable for real Speed
-uint8_t slaveError = 0;										// global variable for slave error
+extern int32_t batteryVoltage_mV; 				// global variable for battery voltage [mV]
+uint8_t slaveError = 0;										// global variable for slave error (BLDC_FAULT_x flags sent by slave)
 	
 extern FlagStatus timedOut;								// Timeoutvariable set by timeout timer
 
-uint32_t inactivity_timeout_counter = 0;	// Inactivity counter
-uint32_t steerCounter = 0;								// Steer counter for setting update rate
+uint32_t inactivity_timeout_ms = 0;				// Inactivity time in ms
+
+// State shared by the main loop tasks
+FlagStatus chargeStateLowActive = SET;
+int16_t pwmSlave = 0;
+int16_t pwmMaster = 0;
+uint32_t batteryLED = LED_GREEN;
+uint8_t sendSlaveIdentifier = 0;
 
+void TaskSteering(void);
+void TaskSlaveFrame(void);
+void TaskBattery(void);
+void TaskInactivity(void);
+void TaskSignals(void);
 void ShowBatteryState(uint32_t pin);
 void BeepsBackwards(FlagStatus beepsBackwards);
 void ShutOff(void);
+void MixSpeedSteer(int32_t speedInput, int32_t steerInput, int16_t *pwmMaster, int16_t *pwmSlave);
 #endif
+void TaskStorage(void);
 
 const float lookUpTableAngle[181] =  
 {
@@ -261,25 +280,8 @@ const float lookUpTableAngle[181] =
 //----------------------------------------------------------------------------
 int main (void)
 {
-#ifdef MASTER
-	FlagStatus enable = RESET;
-	FlagStatus enableSlave = RESET;
-	FlagStatus chargeStateLowActive = SET;
-	int16_t sendSlaveValue = 0;
-	uint8_t sendSlaveIdentifier = 0;
-	int8_t index = 8;
-  int16_t pwmSlave = 0;
-	int16_t pwmMaster = 0;
-	int16_t scaledSpeed = 0;
-	int16_t scaledSteer  = 0;
-	float expo = 0;
-	float steerAngle = 0;
-	float xScale = 0;
-#endif
-	
 	//SystemClock_Config();
   SystemCoreClockUpdate();
-  SysTick_Config(SystemCoreClock / 100);
 	
 	// Init watchdog
 	if (Watchdog_init() == ERROR)
@@ -291,8 +293,11 @@ int main (void)
 	// Init Interrupts
 	Interrupt_init();
 	
-	// Init timeout timer
-	TimeoutTimer_init();
+	// Init cycle counter
+	CycleCounter_init();
+	
+	// Init timebase
+	Timebase_init();
 	
 	// Init GPIOs
 	GPIO_init();
@@ -306,24 +311,50 @@ int main (void)
 	// Init ADC
 	ADC_init();
 	
+	// Init hall sensor edge interrupts
+	HallSensor_init();
+	
+	// Load parameters and learned hall tables
+	PARAM_Init();
+	HALL_Init();
+	
 	// Init PWM
 	PWM_init();
 	
+#ifdef MASTER
+	// Init buzzer
+	Buzzer_init();
+#endif
+	
+#ifdef SLAVE
+	// Init RGB LED PWM
+	LED_PWM_init();
+#endif
+	
+	// Start periodic software timers
+	TIMEBASE_StartTimer(TIMEBASE_TIMER_ANALOG, CalculateAnalog, 1, 1);
+#ifdef MASTER
+	TIMEBASE_StartTimer(TIMEBASE_TIMER_BUZZER, BUZZER_Update, 1, 1);
+#endif
+#ifdef SLAVE
+	TIMEBASE_StartTimer(TIMEBASE_TIMER_LED, CalculateLEDProgram, 1, 1);
+#endif
+	
 	// Device has 1,6 seconds to do all the initialization
 	// afterwards watchdog will be fired
 	fwdgt_counter_reload();
 
 	// Init usart steer/bluetooth
 	USART_Steer_COM_init();
+	
+#ifdef BENCHMARK
+	// Measure control functions and print the table
+	BenchmarkRun();
+#endif
 
 #ifdef MASTER
-	// Startup-Sound
-	for (; index >= 0; index--)
-	{
-    buzzerFreq = index;
-    Delay(10);
-  }
-  buzzerFreq = 0;
+	// Startup-Sound (played in background)
+	BUZZER_PlaySequence(BUZZER_SOUND_STARTUP);
 
 	// Wait until button is pressed
 	while (gpio_input_bit_get(BUTTON_PORT, BUTTON_PIN))
@@ -333,145 +364,193 @@ int main (void)
 	}
 #endif
 
+	// Main loop tasks, each one runs with its own period
+#ifdef MASTER
+	SCHEDULER_AddTask(SCHEDULER_TASK_STEERING, TaskSteering, TASK_PERIOD_STEERING);
+	SCHEDULER_AddTask(SCHEDULER_TASK_SLAVE_FRAME, TaskSlaveFrame, TASK_PERIOD_SLAVE_FRAME);
+	SCHEDULER_AddTask(SCHEDULER_TASK_BATTERY, TaskBattery, TASK_PERIOD_BATTERY);
+	SCHEDULER_AddTask(SCHEDULER_TASK_INACTIVITY, TaskInactivity, TASK_PERIOD_INACTIVITY);
+	SCHEDULER_AddTask(SCHEDULER_TASK_SIGNALS, TaskSignals, TASK_PERIOD_SIGNALS);
+#endif
+	SCHEDULER_AddTask(SCHEDULER_TASK_STORAGE, TaskStorage, TASK_PERIOD_STORAGE);
+
   while(1)
 	{
-#ifdef MASTER
-		steerCounter++;	
-		if ((steerCounter % 2) == 0)
-		{	
-			// Request steering data
-			SendSteerDevice();
-		}
+		// Run due tasks, sleep until the next interrupt
+		SCHEDULER_Run();
 		
-		// Calculate expo rate for less steering with higher speeds
-		expo = MAP((float)ABS(speed), 0, 1000, 1, 0.5);
-		
-	  // Each speedvalue or steervalue between 50 and -50 means absolutely no pwm
-		// -> to get the device calm 'around zero speed'
-		scaledSpeed = speed < 50 && speed > -50 ? 0 : CLAMP(speed, -1000, 1000) * SPEED_COEFFICIENT;
-		scaledSteer = steer < 50 && steer > -50 ? 0 : CLAMP(steer, -1000, 1000) * STEER_COEFFICIENT * expo;
-		
-		// Map to an angle of 180 degress to 0 degrees for array access (means angle -90 to 90 degrees)
-		steerAngle = MAP((float)scaledSteer, -1000, 1000, 180, 0);
-		xScale = lookUpTableAngle[(uint16_t)steerAngle];
+		// Reload watchdog (watchdog fires after 1,6 seconds)
+		fwdgt_counter_reload();
+  }
+}
 
-		// Mix steering and speed value for right and left speed
-		if(steerAngle >= 90)
-		{
-			pwmSlave = CLAMP(scaledSpeed, -1000, 1000);
-			pwmMaster = CLAMP(pwmSlave / xScale, -1000, 1000);
-		}
-		else
-		{
-			pwmMaster = CLAMP(scaledSpeed, -1000, 1000);
-			pwmSlave = CLAMP(xScale * pwmMaster, -1000, 1000);
-		}
-		
-		// Read charge state
-		chargeStateLowActive = gpio_input_bit_get(CHARGE_STATE_PORT, CHARGE_STATE_PIN);
-		
-		// Enable is depending on charger is connected or not
-		enable = chargeStateLowActive;
-		
-		// Enable channel output
-		SetEnable(enable);
+#ifdef MASTER
+//----------------------------------------------------------------------------
+// Task: requests steering data
+//----------------------------------------------------------------------------
+void TaskSteering(void)
+{
+	SendSteerDevice();
+}
 
-		// Decide if slave will be enabled
-		enableSlave = (enable == SET && timedOut == RESET) ? SET : RESET;
-		
-		// Decide which process value has to be sent
-		switch(sendSlaveIdentifier)
-		{
-			case 0:
-				sendSlaveValue = currentDC * 100;
-				break;
-			case 1:
-				sendSlaveValue = batteryVoltage * 100;
-				break;
-			case 2:
-				sendSlaveValue = realSpeed * 100;
-				break;
-				default:
-					break;
-		}
-		
-    // Set output
-		SetPWM(pwmMaster);
-		SendSlave(-pwmSlave, enableSlave, RESET, chargeStateLowActive, sendSlaveIdentifier, sendSlaveValue);
-		
-		// Increment identifier
-		sendSlaveIdentifier++;
-		if (sendSlaveIdentifier > 2)
+//----------------------------------------------------------------------------
+// Task: mixes speed and steering, sets pwm and sends slave frame
+//----------------------------------------------------------------------------
+void TaskSlaveFrame(void)
+{
+	FlagStatus enable = RESET;
+	FlagStatus enableSlave = RESET;
+	FlagStatus weakening = RESET;
+	int16_t sendSlaveValue = 0;
+	
+	// Mix steering and speed value for right and left speed
+	MixSpeedSteer(speed, steer, &pwmMaster, &pwmSlave);
+	
+	// Read charge state
+	chargeStateLowActive = gpio_input_bit_get(CHARGE_STATE_PORT, CHARGE_STATE_PIN);
+	
+	// Enable is depending on charger is connected or not
+	enable = chargeStateLowActive;
+	
+	// Enable channel output
+	SetEnable(enable);
+
+	// Decide if slave will be enabled
+	enableSlave = (enable == SET && timedOut == RESET) ? SET : RESET;
+	
+	// Field weakening is requested by the steering device or over bluetooth
+	weakening = (activateWeakening == SET || activateWeakeningBluetooth == SET) ? SET : RESET;
+	SetWeakening(weakening);
+	
+	// Decide which general value has to be sent (process values are part of every frame)
+	if (sendSlaveIdentifier >= MASTERSLAVE_ID_PARAM)
+	{
+		// Parameters of master
+		sendSlaveValue = PARAM_Get((PARAM_ID)(sendSlaveIdentifier - MASTERSLAVE_ID_PARAM));
+	}
+	else if (sendSlaveIdentifier >= MASTERSLAVE_ID_SCHEDULER)
+	{
+		// Task run times of master
+		sendSlaveValue = SCHEDULER_GetValue((SCHEDULER_TASK)((sendSlaveIdentifier - MASTERSLAVE_ID_SCHEDULER) / COUNT_SCHEDULER_VALUES),
+			(SCHEDULER_VALUE)((sendSlaveIdentifier - MASTERSLAVE_ID_SCHEDULER) % COUNT_SCHEDULER_VALUES));
+	}
+	else
+	{
+		// Profiler values of master
+		sendSlaveValue = GetProfilerValue((PROFILER_VALUE)(sendSlaveIdentifier - MASTERSLAVE_ID_PROFILER));
+	}
+	
+	// Set output
+	SetPWM(pwmMaster);
+	SendSlave(-pwmSlave, enableSlave, RESET, chargeStateLowActive, weakening, sendSlaveIdentifier, sendSlaveValue);
+	
+	// Increment identifier
+	sendSlaveIdentifier++;
+	if (sendSlaveIdentifier >= COUNT_MASTERSLAVE_IDS)
+	{
+		sendSlaveIdentifier = 0;
+	}
+}
+
+//----------------------------------------------------------------------------
+// Task: evaluates battery level, shuts device off when battery is dead
+//----------------------------------------------------------------------------
+void TaskBattery(void)
+{
+	// Green battery symbol when battery level BAT_LOW_LVL1 is reached
+	if (batteryVoltage_mV >= PARAM_Get(PARAM_BAT_LOW_LVL1))
+	{
+		batteryLED = LED_GREEN;
+	}
+	// Orange battery symbol when battery level BAT_LOW_LVL2 is reached
+	else if (batteryVoltage_mV >= PARAM_Get(PARAM_BAT_LOW_LVL2))
+	{
+		batteryLED = LED_ORANGE;
+	}
+	// Red battery symbol when battery level BAT_LOW_DEAD is reached
+	else if (batteryVoltage_mV >= PARAM_Get(PARAM_BAT_LOW_DEAD))
+	{
+		batteryLED = LED_RED;
+	}
+	// Shut device off, when battery is below BAT_LOW_DEAD
+	else
+	{
+		ShutOff();
+	}
+}
+
+//----------------------------------------------------------------------------
+// Task: shuts device off when button is pressed or after inactivity timeout
+//----------------------------------------------------------------------------
+void TaskInactivity(void)
+{
+	// Shut device off when button is pressed
+	if (gpio_input_bit_get(BUTTON_PORT, BUTTON_PIN))
+	{
+		while (gpio_input_bit_get(BUTTON_PORT, BUTTON_PIN)) {}
+		ShutOff();
+	}
+	
+	// Calculate inactivity timeout (Except, when charger is active -> keep device running)
+	if (ABS(pwmMaster) > 50 || ABS(pwmSlave) > 50 || !chargeStateLowActive)
+	{
+		inactivity_timeout_ms = 0;
+	}
+	else
+	{
+		inactivity_timeout_ms += TASK_PERIOD_INACTIVITY;
+	}
+	
+	// Shut off device after INACTIVITY_TIMEOUT in minutes
+	if (inactivity_timeout_ms > (uint32_t)PARAM_Get(PARAM_INACTIVITY_TIMEOUT) * 60 * 1000)
+	{
+		ShutOff();
+	}
+}
+
+//----------------------------------------------------------------------------
+// Task: shows battery level on the LEDs and selects the buzzer sound
+//----------------------------------------------------------------------------
+void TaskSignals(void)
+{
+	ShowBatteryState(batteryLED);
+	
+	if (batteryLED == LED_GREEN)
+	{
+#ifdef REGEN_BRAKING
+		// Warn while braking is reduced by the regen voltage ceiling (full battery)
+		if (GetRegenVoltageLimited() == SET)
 		{
-			sendSlaveIdentifier = 0;
+			BUZZER_SetSound(BUZZER_SOUND_REGEN_LIMIT);
 		}
-		
-		// Show green battery symbol when battery level BAT_LOW_LVL1 is reached
-    if (batteryVoltage > BAT_LOW_LVL1)
+		else
+#endif
 		{
-			// Show green battery light
-			ShowBatteryState(LED_GREEN);
-			
 			// Beeps backwards
 			BeepsBackwards(beepsBackwards);
 		}
-		// Make silent sound and show orange battery symbol when battery level BAT_LOW_LVL2 is reached
-    else if (batteryVoltage > BAT_LOW_LVL2 && batteryVoltage < BAT_LOW_LVL1)
-		{
-			// Show orange battery light
-			ShowBatteryState(LED_ORANGE);
-			
-      buzzerFreq = 5;
-      buzzerPattern = 8;
-    }
-		// Make even more sound and show red battery symbol when battery level BAT_LOW_DEAD is reached
-		else if  (batteryVoltage > BAT_LOW_DEAD && batteryVoltage < BAT_LOW_LVL2)
-		{
-			// Show red battery light
-			ShowBatteryState(LED_RED);
-			
-      buzzerFreq = 5;
-      buzzerPattern = 1;
-    }
-		// Shut device off, when battery is dead
-		else if (batteryVoltage < BAT_LOW_DEAD)
-		{
-      ShutOff();
-    }
-		else
-		{
-			ShutOff();
-    }
-
-		// Shut device off when button is pressed
-		if (gpio_input_bit_get(BUTTON_PORT, BUTTON_PIN))
-		{
-      while (gpio_input_bit_get(BUTTON_PORT, BUTTON_PIN)) {}
-			ShutOff();
-    }
-		
-		// Calculate inactivity timeout (Except, when charger is active -> keep device running)
-    if (ABS(pwmMaster) > 50 || ABS(pwmSlave) > 50 || !chargeStateLowActive)
-		{
-      inactivity_timeout_counter = 0;
-    }
-		else
-		{
-      inactivity_timeout_counter++;
-    }
-		
-		// Shut off device after INACTIVITY_TIMEOUT in minutes
-    if (inactivity_timeout_counter > (INACTIVITY_TIMEOUT * 60 * 1000) / (DELAY_IN_MAIN_LOOP + 1))
-		{ 
-      ShutOff();
-    }
-#endif	
+	}
+	// Make silent sound when battery is almost empty
+	else if (batteryLED == LED_ORANGE)
+	{
+		BUZZER_SetSound(BUZZER_SOUND_BATTERY_LOW);
+	}
+	// Make even more sound when battery is empty
+	else
+	{
+		BUZZER_SetSound(BUZZER_SOUND_BATTERY_EMPTY);
+	}
+}
+#endif
 
-		Delay(DELAY_IN_MAIN_LOOP);
-		
-		// Reload watchdog (watchdog fires after 1,6 seconds)
-		fwdgt_counter_reload();
-  }
+//----------------------------------------------------------------------------
+// Task: stores finished hall learning and changed parameters
+// (both stall the CPU during flash erase)
+//----------------------------------------------------------------------------
+void TaskStorage(void)
+{
+	HALL_Update();
+	PARAM_Update();
 }
 
 #ifdef MASTER
@@ -480,18 +559,14 @@ int main (void)
 //----------------------------------------------------------------------------
 void ShutOff(void)
 {
-	int index = 0;
-
-	buzzerPattern = 0;
-	for (; index < 8; index++)
-	{
-		buzzerFreq = index;
-		Delay(10);
-	}
-	buzzerFreq = 0;
+	// Shutdown sound (played while the slave is shut off)
+	BUZZER_PlaySequence(BUZZER_SOUND_SHUTDOWN);
 	
 	// Send shut off command to slave
-	SendSlave(0, RESET, SET, RESET, RESET, RESET);
+	SendSlave(0, RESET, SET, RESET, RESET, RESET, RESET);
+	
+	// Wait until shut off command has been sent
+	FlushBuffer(USART_MASTERSLAVE);
 	
 	// Disable usart
 	usart_deinit(USART_MASTERSLAVE);
@@ -500,6 +575,12 @@ void ShutOff(void)
 	SetEnable(RESET);
 	SetPWM(0);
 	
+	// Wait until shutdown sound has been played
+	while (BUZZER_IsPlaying() == SET)
+	{
+		fwdgt_counter_reload();
+	}
+	
 	gpio_bit_write(SELF_HOLD_PORT, SELF_HOLD_PIN, RESET);
 	while(1)
 	{
@@ -508,6 +589,42 @@ void ShutOff(void)
 	}
 }
 
+//----------------------------------------------------------------------------
+// Mixes speed and steering input to the pwm of master and slave
+//----------------------------------------------------------------------------
+void MixSpeedSteer(int32_t speedInput, int32_t steerInput, int16_t *pwmMaster, int16_t *pwmSlave)
+{
+	int16_t scaledSpeed = 0;
+	int16_t scaledSteer  = 0;
+	float expo = 0;
+	float steerAngle = 0;
+	float xScale = 0;
+	
+	// Calculate expo rate for less steering with higher speeds
+	expo = MAP((float)ABS(speedInput), 0, 1000, 1, 0.5);
+	
+	// Each speedvalue or steervalue between 50 and -50 means absolutely no pwm
+	// -> to get the device calm 'around zero speed'
+	scaledSpeed = speedInput < 50 && speedInput > -50 ? 0 : CLAMP(speedInput, -1000, 1000) * PARAM_Get(PARAM_SPEED_COEFFICIENT) / 100;
+	scaledSteer = steerInput < 50 && steerInput > -50 ? 0 : CLAMP(steerInput, -1000, 1000) * PARAM_Get(PARAM_STEER_COEFFICIENT) / 100 * expo;
+	
+	// Map to an angle of 180 degress to 0 degrees for array access (means angle -90 to 90 degrees)
+	steerAngle = MAP((float)scaledSteer, -1000, 1000, 180, 0);
+	xScale = lookUpTableAngle[(uint16_t)steerAngle];
+	
+	// Mix steering and speed value for right and left speed
+	if(steerAngle >= 90)
+	{
+		*pwmSlave = CLAMP(scaledSpeed, -1000, 1000);
+		*pwmMaster = CLAMP(*pwmSlave / xScale, -1000, 1000);
+	}
+	else
+	{
+		*pwmMaster = CLAMP(scaledSpeed, -1000, 1000);
+		*pwmSlave = CLAMP(xScale * *pwmMaster, -1000, 1000);
+	}
+}
+
 //----------------------------------------------------------------------------
 // Shows the battery state on the LEDs
 //----------------------------------------------------------------------------
@@ -526,13 +643,11 @@ void BeepsBackwards(FlagStatus beepsBackwards)
 	// If the speed is less than -50, beep while driving backwards
 	if (beepsBackwards == SET && speed < -50)
 	{
-		buzzerFreq = 5;
-    buzzerPattern = 4;
+		BUZZER_SetSound(BUZZER_SOUND_BACKWARDS);
 	}
 	else
 	{
-		buzzerFreq = 0;
-		buzzerPattern = 0;
+		BUZZER_SetSound(BUZZER_SOUND_NONE);
 	}
 }
 #endif
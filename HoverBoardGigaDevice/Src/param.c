@@ -0,0 +1,457 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "gd32f1x0.h"
+#include "../Inc/param.h"
+#include "../Inc/defines.h"
+#include "../Inc/config.h"
+#include "../Inc/bldc.h"
+#include "../Inc/led.h"
+#include "../Inc/comms.h"
+
+// EEPROM emulation in two flash pages: each page starts with a header and
+// is filled with records (newest record of a parameter is valid). When the
+// active page is full, the values are copied to the other page and the pages
+// change roles, so both pages wear evenly.
+#define PARAM_PAGE_MAGIC        0x50415241 // 'PARA', written when a page is complete
+#define PARAM_ERASED            0xFFFFFFFF
+#define PARAM_SLOTS             (FLASH_PAGE_SIZE / sizeof(PARAM_RECORD))
+
+// Record (8 bytes), CRC over value and identifier. Value is programmed first,
+// an interrupted write leaves a record with invalid CRC
+typedef union
+{
+	struct
+	{
+		int32_t value;
+		uint8_t identifier;
+		uint8_t reserved;
+		uint16_t crc;
+	} record;
+	struct
+	{
+		uint32_t counter;				// Counts page changes, newer page wins if both are complete
+		uint32_t magic;
+	} header;
+	uint32_t words[2];
+} PARAM_RECORD;
+
+// Parameter table
+typedef struct
+{
+	PARAM_TYPE type;
+	int32_t defaultValue;
+	int32_t minimum;
+	int32_t maximum;
+} PARAM_INFO;
+
+// Lower bound of the current limit: regen braking has to regulate below it
+#ifdef REGEN_BRAKING
+#define PARAM_DC_CUR_LIMIT_MIN (REGEN_CURRENT_MAX_MA / 1000 + 1)
+#else
+#define PARAM_DC_CUR_LIMIT_MIN 1
+#endif
+
+static const PARAM_INFO paramInfo[COUNT_PARAMS] =
+{
+	// Type             Default                              Minimum                 Maximum
+	{PARAM_TYPE_UINT8,  DC_CUR_LIMIT,                        PARAM_DC_CUR_LIMIT_MIN, DC_CUR_LIMIT},                // PARAM_DC_CUR_LIMIT
+	{PARAM_TYPE_UINT16, TIMEOUT_MS,                          100,                    10000},                       // PARAM_TIMEOUT_MS
+	{PARAM_TYPE_UINT8,  COMMUTATION_MODE_DEFAULT,            0,                      COUNT_COMMUTATION_MODES - 1}, // PARAM_COMMUTATION_MODE
+	{PARAM_TYPE_UINT8,  CONTROL_MODE_DEFAULT,                0,                      COUNT_CONTROL_MODES - 1},     // PARAM_CONTROL_MODE
+	{PARAM_TYPE_UINT8,  INACTIVITY_TIMEOUT,                  1,                      60},                          // PARAM_INACTIVITY_TIMEOUT
+	{PARAM_TYPE_UINT16, (int32_t)(BAT_LOW_LVL1 * 1000),      25000,                  42000},                       // PARAM_BAT_LOW_LVL1
+	{PARAM_TYPE_UINT16, (int32_t)(BAT_LOW_LVL2 * 1000),      25000,                  42000},                       // PARAM_BAT_LOW_LVL2
+	{PARAM_TYPE_UINT16, (int32_t)(BAT_LOW_DEAD * 1000),      25000,                  42000},                       // PARAM_BAT_LOW_DEAD
+	{PARAM_TYPE_INT16,  SPEED_COEFFICIENT * 100,             -100,                   100},                         // PARAM_SPEED_COEFFICIENT
+	{PARAM_TYPE_INT16,  STEER_COEFFICIENT * 100,             -100,                   100},                         // PARAM_STEER_COEFFICIENT
+	{PARAM_TYPE_UINT8,  LED_PROGRAM_DEFAULT,                 0,                      4},                           // PARAM_LED_PROGRAM
+	{PARAM_TYPE_UINT16, LED_HUE_DEFAULT,                     0,                      764},                         // PARAM_LED_HUE
+	{PARAM_TYPE_UINT8,  LED_SATURATION_DEFAULT,              0,                      128},                         // PARAM_LED_SATURATION
+	{PARAM_TYPE_UINT8,  LED_BRIGHTNESS_DEFAULT,              0,                      63},                          // PARAM_LED_BRIGHTNESS
+	{PARAM_TYPE_UINT16, LED_SPEED_FADING_DEFAULT,            LED_SPEED_FADING_DEFAULT, 1000},                      // PARAM_LED_SPEED_FADING
+	{PARAM_TYPE_UINT16, LED_SPEED_BLINK_DEFAULT,             700,                    2400},                        // PARAM_LED_SPEED_BLINK
+	{PARAM_TYPE_UINT16, LED_SPEED_STROBE_DEFAULT,            40,                     400},                         // PARAM_LED_SPEED_STROBE
+};
+
+// Variables which will be written by PARAM_Init or bluetooth/master slave frames
+static int32_t paramValue[COUNT_PARAMS];
+static volatile uint32_t paramPending = 0;			// Parameters to be written (bit per identifier)
+
+// Flash state
+static uint32_t activePage = 0;									// Address of the active page, 0 if none
+static uint16_t writeSlot = 0;									// First free slot of the active page
+
+extern int32_t realSpeed_mh;
+extern FlagStatus bldc_enable;
+extern int16_t bldc_inputFilterPwm;
+
+void PARAM_Apply(PARAM_ID identifier);
+uint32_t PARAM_FindActivePage(void);
+void PARAM_ReadPage(uint32_t page);
+ErrStatus PARAM_WriteRecord(PARAM_ID identifier);
+ErrStatus PARAM_TransferPage(void);
+ErrStatus PARAM_ProgramSlot(uint32_t page, uint16_t slot, PARAM_RECORD *record);
+
+//----------------------------------------------------------------------------
+// Loads parameters from flash and applies them
+//----------------------------------------------------------------------------
+void PARAM_Init(void)
+{
+	uint8_t identifier;
+	
+	for (identifier = 0; identifier < COUNT_PARAMS; identifier++)
+	{
+		paramValue[identifier] = paramInfo[identifier].defaultValue;
+	}
+	
+	// Read newest records of the active page (defaults if there is none)
+	activePage = PARAM_FindActivePage();
+	if (activePage != 0)
+	{
+		PARAM_ReadPage(activePage);
+	}
+	
+	// Stored values replace the startup values of the modules
+	for (identifier = 0; identifier < COUNT_PARAMS; identifier++)
+	{
+		if (paramValue[identifier] != paramInfo[identifier].defaultValue)
+		{
+			PARAM_Apply((PARAM_ID)identifier);
+		}
+	}
+}
+
+//----------------------------------------------------------------------------
+// Returns parameter value
+//----------------------------------------------------------------------------
+int32_t PARAM_Get(PARAM_ID identifier)
+{
+	if (identifier >= COUNT_PARAMS)
+	{
+		return 0;
+	}
+	
+	return paramValue[identifier];
+}
+
+//----------------------------------------------------------------------------
+// Sets and applies parameter value, flash is written by PARAM_Update
+//----------------------------------------------------------------------------
+void PARAM_Set(PARAM_ID identifier, int32_t value)
+{
+	if (identifier >= COUNT_PARAMS)
+	{
+		return;
+	}
+	
+	// Repeated values are ignored (master receives a parameter until it reports it)
+	value = PARAM_Limit(identifier, value);
+	if (value == paramValue[identifier])
+	{
+		return;
+	}
+	
+	paramValue[identifier] = value;
+	PARAM_Apply(identifier);
+	paramPending |= 1UL << identifier;
+}
+
+//----------------------------------------------------------------------------
+// Returns value limited to the range of the parameter
+//----------------------------------------------------------------------------
+int32_t PARAM_Limit(PARAM_ID identifier, int32_t value)
+{
+	if (identifier >= COUNT_PARAMS)
+	{
+		return 0;
+	}
+	
+	return CLAMP(value, paramInfo[identifier].minimum, paramInfo[identifier].maximum);
+}
+
+//----------------------------------------------------------------------------
+// Returns parameter value from a 16 bit transfer value
+//----------------------------------------------------------------------------
+int32_t PARAM_Decode(PARAM_ID identifier, int16_t value)
+{
+	if (identifier < COUNT_PARAMS && paramInfo[identifier].type != PARAM_TYPE_INT16)
+	{
+		return (uint16_t)value;
+	}
+	
+	return value;
+}
+
+//----------------------------------------------------------------------------
+// Writes changed parameters to flash => called from main loop
+// -> only at standstill with the motor disabled or without command, the CPU
+//    stalls while the flash is erased. Failed writes are retried next time
+//----------------------------------------------------------------------------
+void PARAM_Update(void)
+{
+	uint8_t identifier;
+	uint32_t pending;
+	
+	if (paramPending == 0 || realSpeed_mh != 0 ||
+		(bldc_enable == SET && bldc_inputFilterPwm != 0))
+	{
+		return;
+	}
+	
+	// Take pending parameters (set from USART interrupts)
+	__disable_irq();
+	pending = paramPending;
+	paramPending = 0;
+	__enable_irq();
+	
+	for (identifier = 0; identifier < COUNT_PARAMS; identifier++)
+	{
+		if ((pending & (1UL << identifier)) && PARAM_WriteRecord((PARAM_ID)identifier) == ERROR)
+		{
+			__disable_irq();
+			paramPending |= 1UL << identifier;
+			__enable_irq();
+		}
+	}
+}
+
+//----------------------------------------------------------------------------
+// Passes parameter value to its module
+//----------------------------------------------------------------------------
+void PARAM_Apply(PARAM_ID identifier)
+{
+	switch (identifier)
+	{
+		case PARAM_COMMUTATION_MODE:
+			SetCommutationMode((COMMUTATION_MODE)paramValue[identifier]);
+			break;
+		case PARAM_CONTROL_MODE:
+			SetControlMode((CONTROL_MODE)paramValue[identifier]);
+			break;
+#ifdef SLAVE
+		case PARAM_LED_PROGRAM:
+			SetRGBProgram((LED_PROGRAM)paramValue[identifier]);
+			break;
+		case PARAM_LED_HUE:
+			SetHSBHue(paramValue[identifier]);
+			break;
+		case PARAM_LED_SATURATION:
+			SetHSBSaturation(paramValue[identifier]);
+			break;
+		case PARAM_LED_BRIGHTNESS:
+			SetHSBBrightness(paramValue[identifier]);
+			break;
+		case PARAM_LED_SPEED_FADING:
+			SetSpeedFading(paramValue[identifier]);
+			break;
+		case PARAM_LED_SPEED_BLINK:
+			SetSpeedBlink(paramValue[identifier]);
+			break;
+		case PARAM_LED_SPEED_STROBE:
+			SetSpeedStrobe(paramValue[identifier]);
+			break;
+#endif
+		default:
+			// Rest of the parameters is read with PARAM_Get
+			break;
+	}
+}
+
+//----------------------------------------------------------------------------
+// Returns address of the complete page with the newest data, 0 if none
+//----------------------------------------------------------------------------
+uint32_t PARAM_FindActivePage(void)
+{
+	const PARAM_RECORD *header0 = (const PARAM_RECORD *)PARAM_FLASH_PAGE0;
+	const PARAM_RECORD *header1 = (const PARAM_RECORD *)PARAM_FLASH_PAGE1;
+	
+	if (header0->header.magic == PARAM_PAGE_MAGIC && header1->header.magic == PARAM_PAGE_MAGIC)
+	{
+		// Page change was interrupted before the old page was erased
+		return (int32_t)(header1->header.counter - header0->header.counter) > 0 ? PARAM_FLASH_PAGE1 : PARAM_FLASH_PAGE0;
+	}
+	if (header0->header.magic == PARAM_PAGE_MAGIC)
+	{
+		return PARAM_FLASH_PAGE0;
+	}
+	if (header1->header.magic == PARAM_PAGE_MAGIC)
+	{
+		return PARAM_FLASH_PAGE1;
+	}
+	
+	return 0;
+}
+
+//----------------------------------------------------------------------------
+// Reads all records of a page (newer records replace older) and the first
+// free slot. One pass over the page, values are kept in RAM afterwards
+//----------------------------------------------------------------------------
+void PARAM_ReadPage(uint32_t page)
+{
+	const PARAM_RECORD *record;
+	uint16_t slot;
+	
+	for (slot = 1; slot < PARAM_SLOTS; slot++)
+	{
+		record = (const PARAM_RECORD *)(page + slot * sizeof(PARAM_RECORD));
+		if (record->words[0] == PARAM_ERASED && record->words[1] == PARAM_ERASED)
+		{
+			break;
+		}
+		
+		if (record->record.identifier < COUNT_PARAMS &&
+			record->record.crc == CalcCRC((uint8_t *)record, sizeof(PARAM_RECORD) - sizeof(record->record.crc)) &&
+			record->record.value == PARAM_Limit((PARAM_ID)record->record.identifier, record->record.value))
+		{
+			paramValue[record->record.identifier] = record->record.value;
+		}
+	}
+	writeSlot = slot;
+}
+
+//----------------------------------------------------------------------------
+// Appends record of a parameter, changes page if the active page is full
+//----------------------------------------------------------------------------
+ErrStatus PARAM_WriteRecord(PARAM_ID identifier)
+{
+	PARAM_RECORD record;
+	
+	if (activePage == 0 || writeSlot >= PARAM_SLOTS)
+	{
+		// New page holds the actual values of all parameters
+		return PARAM_TransferPage();
+	}
+	
+	record.record.value = paramValue[identifier];
+	record.record.identifier = identifier;
+	record.record.reserved = 0;
+	record.record.crc = CalcCRC((uint8_t *)&record, sizeof(record) - sizeof(record.record.crc));
+	
+	if (PARAM_ProgramSlot(activePage, writeSlot, &record) == ERROR)
+	{
+		// Slot may be partly programmed, the retry starts a new page
+		writeSlot = PARAM_SLOTS;
+		return ERROR;
+	}
+	
+	writeSlot++;
+	return SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+// Copies actual values to the other page and erases the active page
+//----------------------------------------------------------------------------
+ErrStatus PARAM_TransferPage(void)
+{
+	PARAM_RECORD record;
+	uint32_t page = activePage == PARAM_FLASH_PAGE0 ? PARAM_FLASH_PAGE1 : PARAM_FLASH_PAGE0;
+	uint32_t counter = activePage != 0 ? ((const PARAM_RECORD *)activePage)->header.counter + 1 : 0;
+	uint8_t identifier;
+	uint16_t slot = 1;
+	ErrStatus result = SUCCESS;
+	
+	fmc_unlock();
+	fmc_flag_clear(FMC_FLAG_END | FMC_FLAG_WPERR | FMC_FLAG_PGERR);
+	if (fmc_page_erase(page) != FMC_READY)
+	{
+		result = ERROR;
+	}
+	fmc_lock();
+	
+	// Values equal to the default need no record
+	for (identifier = 0; identifier < COUNT_PARAMS && result == SUCCESS; identifier++)
+	{
+		if (paramValue[identifier] != paramInfo[identifier].defaultValue)
+		{
+			record.record.value = paramValue[identifier];
+			record.record.identifier = identifier;
+			record.record.reserved = 0;
+			record.record.crc = CalcCRC((uint8_t *)&record, sizeof(record) - sizeof(record.record.crc));
+			result = PARAM_ProgramSlot(page, slot++, &record);
+		}
+	}
+	
+	// Header completes the page, afterwards the old page is not needed anymore
+	if (result == SUCCESS)
+	{
+		record.header.magic = PARAM_PAGE_MAGIC;
+		record.header.counter = counter;
+		result = PARAM_ProgramSlot(page, 0, &record);
+	}
+	if (result == ERROR)
+	{
+		return ERROR;
+	}
+	
+	if (activePage != 0)
+	{
+		fmc_unlock();
+		fmc_flag_clear(FMC_FLAG_END | FMC_FLAG_WPERR | FMC_FLAG_PGERR);
+		fmc_page_erase(activePage);
+		fmc_lock();
+	}
+	
+	activePage = page;
+	writeSlot = slot;
+	
+	return SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+// Programs a slot (second word last) and verifies it
+//----------------------------------------------------------------------------
+ErrStatus PARAM_ProgramSlot(uint32_t page, uint16_t slot, PARAM_RECORD *record)
+{
+	uint32_t address = page + slot * sizeof(PARAM_RECORD);
+	ErrStatus result = SUCCESS;
+	
+	fmc_unlock();
+	fmc_flag_clear(FMC_FLAG_END | FMC_FLAG_WPERR | FMC_FLAG_PGERR);
+	if (fmc_word_program(address, record->words[0]) != FMC_READY)
+	{
+		result = ERROR;
+	}
+	fmc_flag_clear(FMC_FLAG_END | FMC_FLAG_WPERR | FMC_FLAG_PGERR);
+	if (result == SUCCESS && fmc_word_program(address + 4, record->words[1]) != FMC_READY)
+	{
+		result = ERROR;
+	}
+	fmc_lock();
+	
+	if (((const PARAM_RECORD *)address)->words[0] != record->words[0] ||
+		((const PARAM_RECORD *)address)->words[1] != record->words[1])
+	{
+		result = ERROR;
+	}
+	
+	return result;
+}
@@ -0,0 +1,183 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "gd32f1x0.h"
+#include "../Inc/profiler.h"
+
+// Average filter for cycle values, rank k=4
+#define PROFILER_FILTER_SHIFT 4
+
+#ifdef PROFILER
+// Cycle counter values of the current ISR
+uint32_t profilerStart = 0;
+uint32_t profilerStamp[COUNT_PROFILER_SECTIONS];
+
+// Results of the measurement
+uint32_t profilerISRMin = 0xFFFFFFFF;
+uint32_t profilerISRMax = 0;
+uint32_t profilerISRAvg_reg = 0;
+uint32_t profilerOverruns = 0;
+uint32_t profilerSectionMax[COUNT_PROFILER_SECTIONS];
+uint32_t profilerSectionAvg_reg[COUNT_PROFILER_SECTIONS];
+FlagStatus profilerResetRequest = RESET;
+
+//----------------------------------------------------------------------------
+// Stores the cycle counter at the beginning of the ISR
+//----------------------------------------------------------------------------
+void ProfilerISRStart(void)
+{
+	profilerStart = DWT->CYCCNT;
+}
+
+//----------------------------------------------------------------------------
+// Evaluates ISR and section cycles at the end of the ISR
+//----------------------------------------------------------------------------
+void ProfilerISREnd(void)
+{
+	uint32_t cycles = DWT->CYCCNT - profilerStart;
+	uint32_t lastStamp = profilerStart;
+	uint32_t sectionCycles = 0;
+	uint8_t index = 0;
+	
+	// Reset of min/max values requested by communication
+	if (profilerResetRequest == SET)
+	{
+		profilerISRMin = 0xFFFFFFFF;
+		profilerISRMax = 0;
+		profilerOverruns = 0;
+		for (index = 0; index < COUNT_PROFILER_SECTIONS; index++)
+		{
+			profilerSectionMax[index] = 0;
+		}
+		profilerResetRequest = RESET;
+	}
+	
+	// Whole ISR
+	if (cycles < profilerISRMin)
+	{
+		profilerISRMin = cycles;
+	}
+	if (cycles > profilerISRMax)
+	{
+		profilerISRMax = cycles;
+	}
+	profilerISRAvg_reg = profilerISRAvg_reg - (profilerISRAvg_reg >> PROFILER_FILTER_SHIFT) + cycles;
+	
+	// ISR took longer than the time between two calculations
+	if (cycles > PROFILER_BUDGET_CYCLES)
+	{
+		profilerOverruns++;
+	}
+	
+	// Sections are only valid, if all marks have been passed in this ISR
+	// (CalculateBLDC returns early during ADC offset calibration)
+	if (profilerStamp[COUNT_PROFILER_SECTIONS - 1] - profilerStart > cycles)
+	{
+		return;
+	}
+	
+	for (index = 0; index < COUNT_PROFILER_SECTIONS; index++)
+	{
+		sectionCycles = profilerStamp[index] - lastStamp;
+		lastStamp = profilerStamp[index];
+		
+		if (sectionCycles > profilerSectionMax[index])
+		{
+			profilerSectionMax[index] = sectionCycles;
+		}
+		profilerSectionAvg_reg[index] = profilerSectionAvg_reg[index] - (profilerSectionAvg_reg[index] >> PROFILER_FILTER_SHIFT) + sectionCycles;
+	}
+}
+
+//----------------------------------------------------------------------------
+// Requests reset of min/max values and overrun count (done in next ISR)
+//----------------------------------------------------------------------------
+void ProfilerReset(void)
+{
+	profilerResetRequest = SET;
+}
+
+//----------------------------------------------------------------------------
+// Returns profiler value (saturated to int16 range for telemetry)
+//----------------------------------------------------------------------------
+int16_t GetProfilerValue(PROFILER_VALUE value)
+{
+	uint32_t result = 0;
+	
+	if (value == PROFILER_ISR_MIN)
+	{
+		result = profilerISRMin == 0xFFFFFFFF ? 0 : profilerISRMin;
+	}
+	else if (value == PROFILER_ISR_AVG)
+	{
+		result = profilerISRAvg_reg >> PROFILER_FILTER_SHIFT;
+	}
+	else if (value == PROFILER_ISR_MAX)
+	{
+		result = profilerISRMax;
+	}
+	else if (value == PROFILER_ISR_OVERRUNS)
+	{
+		result = profilerOverruns;
+	}
+	else if (value >= PROFILER_SECTION_AVG && value < PROFILER_SECTION_AVG + COUNT_PROFILER_SECTIONS)
+	{
+		result = profilerSectionAvg_reg[value - PROFILER_SECTION_AVG] >> PROFILER_FILTER_SHIFT;
+	}
+	else if (value >= PROFILER_SECTION_MAX && value < PROFILER_SECTION_MAX + COUNT_PROFILER_SECTIONS)
+	{
+		result = profilerSectionMax[value - PROFILER_SECTION_MAX];
+	}
+	
+	return result > 32767 ? 32767 : result;
+}
+#else
+//----------------------------------------------------------------------------
+// Profiler is disabled, all functions are empty
+//----------------------------------------------------------------------------
+void ProfilerISRStart(void)
+{
+}
+
+void ProfilerISREnd(void)
+{
+}
+
+void ProfilerReset(void)
+{
+}
+
+int16_t GetProfilerValue(PROFILER_VALUE value)
+{
+	(void)value;
+	return 0;
+}
+#endif
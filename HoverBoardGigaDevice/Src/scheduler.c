@@ -0,0 +1,160 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "gd32f1x0.h"
+#include "../Inc/scheduler.h"
+#include "../Inc/timebase.h"
+#include "stddef.h"
+
+// Average filter for run times, rank k=4
+#define SCHEDULER_FILTER_SHIFT 4
+
+// Task and its measurement
+typedef struct
+{
+	void (*function)(void);						// Task function, NULL = not used
+	uint16_t period_ms;								// Period between two releases
+	uint32_t release_ms;							// Time of the next release
+	uint32_t runtimeAvg_reg;					// Filtered run time in us
+	uint32_t runtimeMax;							// Maximum run time in us
+	uint32_t latencyMax;							// Maximum delay from release to start in us
+	uint32_t deadlineMisses;					// Skipped releases
+} SCHEDULER_TASK_ENTRY;
+
+static SCHEDULER_TASK_ENTRY tasks[COUNT_SCHEDULER_TASKS];
+
+//----------------------------------------------------------------------------
+// Adds task to the scheduler, first run is at the next call of SCHEDULER_Run
+//----------------------------------------------------------------------------
+void SCHEDULER_AddTask(SCHEDULER_TASK task, void (*function)(void), uint16_t period_ms)
+{
+	if (task >= COUNT_SCHEDULER_TASKS || period_ms == 0)
+	{
+		return;
+	}
+	
+	tasks[task].function = function;
+	tasks[task].period_ms = period_ms;
+	tasks[task].release_ms = millis();
+	tasks[task].runtimeAvg_reg = 0;
+	tasks[task].runtimeMax = 0;
+	tasks[task].latencyMax = 0;
+	tasks[task].deadlineMisses = 0;
+}
+
+//----------------------------------------------------------------------------
+// Runs all due tasks and sleeps until the next interrupt => called in main loop
+// -> tasks run to completion in the order of SCHEDULER_TASK, the 1ms systick
+//    wakes the CPU at the latest
+//----------------------------------------------------------------------------
+void SCHEDULER_Run(void)
+{
+	SCHEDULER_TASK_ENTRY *entry;
+	uint32_t now_ms;
+	uint32_t start_us;
+	uint32_t latency_us;
+	uint32_t runtime_us;
+	uint8_t index;
+	
+	for (index = 0; index < COUNT_SCHEDULER_TASKS; index++)
+	{
+		entry = &tasks[index];
+		now_ms = millis();
+		
+		// Task is not used or not released yet
+		if (entry->function == NULL || (int32_t)(now_ms - entry->release_ms) < 0)
+		{
+			continue;
+		}
+		
+		// Delay from release to start, milliseconds and microseconds share the system start
+		start_us = micros();
+		latency_us = start_us - entry->release_ms * 1000;
+		if (latency_us > entry->latencyMax)
+		{
+			entry->latencyMax = latency_us;
+		}
+		
+		// Deadline (next release) already passed, skip the missed releases
+		if (now_ms - entry->release_ms >= entry->period_ms)
+		{
+			entry->deadlineMisses++;
+			entry->release_ms = now_ms;
+		}
+		entry->release_ms += entry->period_ms;
+		
+		// Run task and measure its run time
+		entry->function();
+		runtime_us = micros() - start_us;
+		
+		if (runtime_us > entry->runtimeMax)
+		{
+			entry->runtimeMax = runtime_us;
+		}
+		entry->runtimeAvg_reg = entry->runtimeAvg_reg - (entry->runtimeAvg_reg >> SCHEDULER_FILTER_SHIFT) + runtime_us;
+	}
+	
+	// Sleep until the next interrupt
+	__WFI();
+}
+
+//----------------------------------------------------------------------------
+// Returns scheduler value of a task (saturated to int16 range for telemetry)
+//----------------------------------------------------------------------------
+int16_t SCHEDULER_GetValue(SCHEDULER_TASK task, SCHEDULER_VALUE value)
+{
+	uint32_t result = 0;
+	
+	if (task >= COUNT_SCHEDULER_TASKS)
+	{
+		return 0;
+	}
+	
+	if (value == SCHEDULER_RUNTIME_AVG)
+	{
+		result = tasks[task].runtimeAvg_reg >> SCHEDULER_FILTER_SHIFT;
+	}
+	else if (value == SCHEDULER_RUNTIME_MAX)
+	{
+		result = tasks[task].runtimeMax;
+	}
+	else if (value == SCHEDULER_LATENCY_MAX)
+	{
+		result = tasks[task].latencyMax;
+	}
+	else if (value == SCHEDULER_DEADLINE_MISSES)
+	{
+		result = tasks[task].deadlineMisses;
+	}
+	
+	return result > 32767 ? 32767 : result;
+}
@@ -33,17 +33,27 @@
 #include "../Inc/defines.h"
 #include "../Inc/config.h"
 #include "../Inc/it.h"
+#include "../Inc/analog.h"
 
-#define TIMEOUT_FREQ  1000
-
-// timeout timer parameter structs
-timer_parameter_struct timeoutTimer_paramter_struct;
+#define TIMEBASE_FREQ 1000
+#define LED_PWM_FREQ  1000
 
 // PWM timer Parameter structs
 timer_parameter_struct timerBldc_paramter_struct;	
 timer_break_parameter_struct timerBldc_break_parameter_struct;
 timer_oc_parameter_struct timerBldc_oc_parameter_struct;
 
+#ifdef MASTER
+// Buzzer timer parameter structs
+timer_parameter_struct timerBuzzer_paramter_struct;
+timer_oc_parameter_struct timerBuzzer_oc_parameter_struct;
+#endif
+#ifdef SLAVE
+// LED PWM timer parameter structs
+timer_parameter_struct timerLed_paramter_struct;
+timer_oc_parameter_struct timerLed_oc_parameter_struct;
+#endif
+
 // DMA (USART) structs
 dma_parameter_struct dma_init_struct_usart;
 uint8_t usartMasterSlave_rx_buf[USART_MASTERSLAVE_RX_BUFFERSIZE];
@@ -51,7 +61,8 @@ uint8_t usartSteer_COM_rx_buf[USART_STEER_COM_RX_BUFFERSIZE];
 
 // DMA (ADC) structs
 dma_parameter_struct dma_init_struct_adc;
-extern adc_buf_t adc_buffer;
+extern uint16_t analog_buffer[ANALOG_BUFFER_SIZE];
+
 
 //----------------------------------------------------------------------------
 // Initializes the interrupts
@@ -91,33 +102,29 @@ ErrStatus Watchdog_init(void)
 }
 
 //----------------------------------------------------------------------------
-// Initializes the timeout timer
+// Initializes the DWT cycle counter
+// -> counts core clock cycles (72MHz), overflows after 59,6s
 //----------------------------------------------------------------------------
-void TimeoutTimer_init(void)
+void CycleCounter_init(void)
 {
-	// Enable timer clock
-	rcu_periph_clock_enable(RCU_TIMER13);
-	
-	// Initial deinitialize of the timer
-	timer_deinit(TIMER13);
-	
-	// Set up the basic parameter struct for the timer
-	// Update event will be fired every 1ms
-	timeoutTimer_paramter_struct.counterdirection 	= TIMER_COUNTER_UP;
-	timeoutTimer_paramter_struct.prescaler 					= 0;
-	timeoutTimer_paramter_struct.alignedmode 				= TIMER_COUNTER_CENTER_DOWN;
-	timeoutTimer_paramter_struct.period							= 72000000 / 2 / TIMEOUT_FREQ;
-	timeoutTimer_paramter_struct.clockdivision 			= TIMER_CKDIV_DIV1;
-	timeoutTimer_paramter_struct.repetitioncounter 	= 0;
-	timer_auto_reload_shadow_disable(TIMER13);
-	timer_init(TIMER13, &timeoutTimer_paramter_struct);
-	
-	// Enable TIMER_INT_UP interrupt and set priority
-	nvic_irq_enable(TIMER13_IRQn, 0, 0);
-	timer_interrupt_enable(TIMER13, TIMER_INT_UP);
+	// Enable trace and debug blocks (needed for DWT without debugger)
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
 	
-	// Enable timer
-	timer_enable(TIMER13);
+	// Reset and start cycle counter
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+//----------------------------------------------------------------------------
+// Initializes the timebase
+// -> systick interrupt every 1ms below the calculation ISR, hall and timer
+//    interrupts (same level as the usart), it runs all software timers
+//    (see timebase.c)
+//----------------------------------------------------------------------------
+void Timebase_init(void)
+{
+	SysTick_Config(SystemCoreClock / TIMEBASE_FREQ);
+	NVIC_SetPriority(SysTick_IRQn, 2);
 }
 
 //----------------------------------------------------------------------------
@@ -144,10 +151,21 @@ void GPIO_init(void)
 	gpio_output_options_set(LED_ORANGE_PORT, GPIO_OTYPE_PP, GPIO_OSPEED_10MHZ, LED_ORANGE);
 	
 	// Init UPPER/LOWER LED
+#ifdef MASTER
 	gpio_mode_set(UPPER_LED_PORT , GPIO_MODE_OUTPUT, GPIO_PUPD_NONE,UPPER_LED_PIN);	
 	gpio_output_options_set(UPPER_LED_PORT, GPIO_OTYPE_PP, GPIO_OSPEED_10MHZ, UPPER_LED_PIN);
 	gpio_mode_set(LOWER_LED_PORT , GPIO_MODE_OUTPUT, GPIO_PUPD_NONE,LOWER_LED_PIN);	
 	gpio_output_options_set(LOWER_LED_PORT, GPIO_OTYPE_PP, GPIO_OSPEED_10MHZ, LOWER_LED_PIN);
+#endif
+#ifdef SLAVE
+	// Slave: RGB LED PWM outputs of the LED timer
+	gpio_mode_set(UPPER_LED_PORT , GPIO_MODE_AF, GPIO_PUPD_NONE,UPPER_LED_PIN);	
+	gpio_output_options_set(UPPER_LED_PORT, GPIO_OTYPE_PP, GPIO_OSPEED_10MHZ, UPPER_LED_PIN);
+	gpio_af_set(UPPER_LED_PORT, GPIO_AF_2, UPPER_LED_PIN);
+	gpio_mode_set(LOWER_LED_PORT , GPIO_MODE_AF, GPIO_PUPD_NONE,LOWER_LED_PIN);	
+	gpio_output_options_set(LOWER_LED_PORT, GPIO_OTYPE_PP, GPIO_OSPEED_10MHZ, LOWER_LED_PIN);
+	gpio_af_set(LOWER_LED_PORT, GPIO_AF_2, LOWER_LED_PIN);
+#endif
 	
 	// Init mosfet output
 	gpio_mode_set(MOSFET_OUT_PORT, GPIO_MODE_OUTPUT, GPIO_PUPD_NONE, MOSFET_OUT_PIN);	
@@ -169,8 +187,7 @@ void GPIO_init(void)
 	// Init ADC pins
 	gpio_mode_set(VBATT_PORT, GPIO_MODE_ANALOG, GPIO_PUPD_NONE, VBATT_PIN);
 	gpio_mode_set(CURRENT_DC_PORT, GPIO_MODE_ANALOG, GPIO_PUPD_NONE, CURRENT_DC_PIN);
-	gpio_mode_set(GPIOA, GPIO_MODE_ANALOG, GPIO_PUPD_NONE, GPIO_PIN_6);
-	gpio_mode_set(GPIOB, GPIO_MODE_ANALOG, GPIO_PUPD_NONE, GPIO_PIN_0);
+	gpio_mode_set(ANALOG_INPUT_PORT, GPIO_MODE_ANALOG, GPIO_PUPD_NONE, ANALOG_INPUT_PIN);
 	
 	// Init debug pin
 	gpio_mode_set(DEBUG_PORT , GPIO_MODE_OUTPUT, GPIO_PUPD_NONE, DEBUG_PIN);	
@@ -215,9 +232,10 @@ void GPIO_init(void)
 	gpio_af_set(USART_STEER_COM_RX_PORT, GPIO_AF_0, USART_STEER_COM_RX_PIN);
 	
 #ifdef MASTER	
-	// Init buzzer
-	gpio_mode_set(BUZZER_PORT , GPIO_MODE_OUTPUT, GPIO_PUPD_NONE, BUZZER_PIN);	
+	// Init buzzer (output of the buzzer timer)
+	gpio_mode_set(BUZZER_PORT , GPIO_MODE_AF, GPIO_PUPD_NONE, BUZZER_PIN);	
 	gpio_output_options_set(BUZZER_PORT, GPIO_OTYPE_PP, GPIO_OSPEED_50MHZ, BUZZER_PIN);
+	gpio_af_set(BUZZER_PORT, GPIO_AF_2, BUZZER_PIN);
 	
 	// Init button
 	gpio_mode_set(BUTTON_PORT , GPIO_MODE_INPUT, GPIO_PUPD_NONE, BUTTON_PIN);	
@@ -227,6 +245,33 @@ void GPIO_init(void)
 #endif
 }
 	
+//----------------------------------------------------------------------------
+// Initializes the hall sensor edge interrupts
+// -> every edge of every hall sensor is timestamped with the DWT cycle counter
+//----------------------------------------------------------------------------
+void HallSensor_init(void)
+{
+	// Enable system configuration clock (EXTI source selection)
+	rcu_periph_clock_enable(RCU_CFGCMP);
+	
+	// Connect hall sensor pins to EXTI lines
+	syscfg_exti_line_config(HALL_A_EXTI_PORT, HALL_A_EXTI_PIN);
+	syscfg_exti_line_config(HALL_B_EXTI_PORT, HALL_B_EXTI_PIN);
+	syscfg_exti_line_config(HALL_C_EXTI_PORT, HALL_C_EXTI_PIN);
+	
+	// Interrupt on rising and falling edge
+	exti_init(HALL_A_EXTI, EXTI_INTERRUPT, EXTI_TRIG_BOTH);
+	exti_init(HALL_B_EXTI, EXTI_INTERRUPT, EXTI_TRIG_BOTH);
+	exti_init(HALL_C_EXTI, EXTI_INTERRUPT, EXTI_TRIG_BOTH);
+	exti_interrupt_flag_clear(HALL_A_EXTI);
+	exti_interrupt_flag_clear(HALL_B_EXTI);
+	exti_interrupt_flag_clear(HALL_C_EXTI);
+	
+	// Below the calculation ISR, CalculateHallEdge corrects the delayed timestamp
+	nvic_irq_enable(EXTI0_1_IRQn, 1, 0);
+	nvic_irq_enable(EXTI4_15_IRQn, 1, 0);
+}
+
 //----------------------------------------------------------------------------
 // Initializes the PWM
 //----------------------------------------------------------------------------
@@ -306,14 +351,110 @@ void PWM_init(void)
 	timer_channel_complementary_output_state_config(TIMER_BLDC, TIMER_BLDC_CHANNEL_B, TIMER_CCXN_ENABLE);
 	timer_channel_complementary_output_state_config(TIMER_BLDC, TIMER_BLDC_CHANNEL_Y, TIMER_CCXN_ENABLE);
 	
-	// Enable TIMER_INT_UP interrupt and set priority
-	nvic_irq_enable(TIMER0_BRK_UP_TRG_COM_IRQn, 0, 0);
-	timer_interrupt_enable(TIMER_BLDC, TIMER_INT_UP);
+	// Update event (counter top and bottom = center of the pwm pulses) triggers
+	// the ADC inserted group directly over TRGO, no interrupt needed
+	timer_master_output_trigger_source_select(TIMER_BLDC, TIMER_TRI_OUT_SRC_UPDATE);
 	
 	// Enable the timer and start PWM
 	timer_enable(TIMER_BLDC);
 }
 
+#ifdef MASTER
+//----------------------------------------------------------------------------
+// Initializes the buzzer tone generator
+// -> 1MHz counter clock, period and compare value (50%) set the tone,
+//    compare value 0 is silent. Sounds are sequenced by buzzer.c
+//----------------------------------------------------------------------------
+void Buzzer_init(void)
+{
+	// Enable timer clock
+	rcu_periph_clock_enable(RCU_TIMER_BUZZER);
+	
+	// Initial deinitialize of the timer
+	timer_deinit(TIMER_BUZZER);
+	
+	// Set up the basic parameter struct for the timer
+	timerBuzzer_paramter_struct.counterdirection 	= TIMER_COUNTER_UP;
+	timerBuzzer_paramter_struct.prescaler 				= 72000000 / 1000000 - 1;
+	timerBuzzer_paramter_struct.alignedmode 			= TIMER_COUNTER_EDGE;
+	timerBuzzer_paramter_struct.period						= 999;
+	timerBuzzer_paramter_struct.clockdivision 		= TIMER_CKDIV_DIV1;
+	timerBuzzer_paramter_struct.repetitioncounter = 0;
+	timer_auto_reload_shadow_enable(TIMER_BUZZER);
+	timer_init(TIMER_BUZZER, &timerBuzzer_paramter_struct);
+	
+	// Output is high while the counter is below the compare value (PWM0),
+	// tone changes are taken over at the end of a period
+	timerBuzzer_oc_parameter_struct.ocpolarity 		= TIMER_OC_POLARITY_HIGH;
+	timerBuzzer_oc_parameter_struct.ocnpolarity 	= TIMER_OCN_POLARITY_HIGH;
+	timerBuzzer_oc_parameter_struct.ocidlestate 	= TIMER_OC_IDLE_STATE_LOW;
+	timerBuzzer_oc_parameter_struct.ocnidlestate 	= TIMER_OCN_IDLE_STATE_LOW;
+	
+	timer_channel_output_config(TIMER_BUZZER, TIMER_BUZZER_CHANNEL, &timerBuzzer_oc_parameter_struct);
+	timer_channel_output_mode_config(TIMER_BUZZER, TIMER_BUZZER_CHANNEL, TIMER_OC_MODE_PWM0);
+	timer_channel_output_shadow_config(TIMER_BUZZER, TIMER_BUZZER_CHANNEL, TIMER_OC_SHADOW_ENABLE);
+	timer_channel_output_pulse_value_config(TIMER_BUZZER, TIMER_BUZZER_CHANNEL, 0);
+	timer_channel_output_state_config(TIMER_BUZZER, TIMER_BUZZER_CHANNEL, TIMER_CCX_ENABLE);
+	
+	// Enable timer
+	timer_enable(TIMER_BUZZER);
+}
+#endif
+
+#ifdef SLAVE
+//----------------------------------------------------------------------------
+// Initializes the RGB LED PWM (8 bit, LED_PWM_FREQ)
+// -> upper and lower LED are generated by the timer without CPU, the mosfet
+//    output has no timer channel and is switched by the update interrupt
+//----------------------------------------------------------------------------
+void LED_PWM_init(void)
+{
+	// Enable timer clock
+	rcu_periph_clock_enable(RCU_TIMER_LED);
+	
+	// Initial deinitialize of the timer
+	timer_deinit(TIMER_LED);
+	
+	// Set up the basic parameter struct for the timer
+	// 256 steps per period like the former software PWM counters
+	timerLed_paramter_struct.counterdirection 	= TIMER_COUNTER_UP;
+	timerLed_paramter_struct.prescaler 					= 72000000 / 256 / LED_PWM_FREQ - 1;
+	timerLed_paramter_struct.alignedmode 				= TIMER_COUNTER_EDGE;
+	timerLed_paramter_struct.period							= 255;
+	timerLed_paramter_struct.clockdivision 			= TIMER_CKDIV_DIV1;
+	timerLed_paramter_struct.repetitioncounter 	= 0;
+	timer_auto_reload_shadow_enable(TIMER_LED);
+	timer_init(TIMER_LED, &timerLed_paramter_struct);
+	
+	// Output is high while the counter is below the compare value (PWM0),
+	// new compare values are taken over at the start of the next period
+	timerLed_oc_parameter_struct.ocpolarity 		= TIMER_OC_POLARITY_HIGH;
+	timerLed_oc_parameter_struct.ocnpolarity 		= TIMER_OCN_POLARITY_HIGH;
+	timerLed_oc_parameter_struct.ocidlestate 		= TIMER_OC_IDLE_STATE_LOW;
+	timerLed_oc_parameter_struct.ocnidlestate 	= TIMER_OCN_IDLE_STATE_LOW;
+	
+	timer_channel_output_config(TIMER_LED, TIMER_LED_CHANNEL_UPPER, &timerLed_oc_parameter_struct);
+	timer_channel_output_mode_config(TIMER_LED, TIMER_LED_CHANNEL_UPPER, TIMER_OC_MODE_PWM0);
+	timer_channel_output_shadow_config(TIMER_LED, TIMER_LED_CHANNEL_UPPER, TIMER_OC_SHADOW_ENABLE);
+	timer_channel_output_pulse_value_config(TIMER_LED, TIMER_LED_CHANNEL_UPPER, 0);
+	timer_channel_output_state_config(TIMER_LED, TIMER_LED_CHANNEL_UPPER, TIMER_CCX_ENABLE);
+	
+	timer_channel_output_config(TIMER_LED, TIMER_LED_CHANNEL_LOWER, &timerLed_oc_parameter_struct);
+	timer_channel_output_mode_config(TIMER_LED, TIMER_LED_CHANNEL_LOWER, TIMER_OC_MODE_PWM0);
+	timer_channel_output_shadow_config(TIMER_LED, TIMER_LED_CHANNEL_LOWER, TIMER_OC_SHADOW_ENABLE);
+	timer_channel_output_pulse_value_config(TIMER_LED, TIMER_LED_CHANNEL_LOWER, 0);
+	timer_channel_output_state_config(TIMER_LED, TIMER_LED_CHANNEL_LOWER, TIMER_CCX_ENABLE);
+	
+	// Enable update interrupt, it loads the compare values and switches the
+	// mosfet output (one interrupt per period)
+	nvic_irq_enable(TIMER1_IRQn, 1, 0);
+	timer_interrupt_enable(TIMER_LED, TIMER_INT_UP);
+	
+	// Enable timer
+	timer_enable(TIMER_LED);
+}
+#endif
+
 //----------------------------------------------------------------------------
 // Initializes the ADC
 //----------------------------------------------------------------------------
@@ -326,46 +467,51 @@ void ADC_init(void)
   // Configure ADC clock (APB2 clock is DIV1 -> 72MHz, ADC clock is DIV6 -> 12MHz)
 	rcu_adc_clock_config(RCU_ADCCK_APB2_DIV6);
 	
-	// Interrupt channel 0 enable
-	nvic_irq_enable(DMA_Channel0_IRQn, 1, 0);
+	// Interrupt end of inserted group enable, highest priority so nothing delays the motor control
+	nvic_irq_enable(ADC_CMP_IRQn, 0, 0);
 	
-	// Initialize DMA channel 0 for ADC
+	// Initialize DMA channel 0 for the regular scan (circular, no interrupt)
 	dma_deinit(DMA_CH0);
 	dma_init_struct_adc.direction = DMA_PERIPHERAL_TO_MEMORY;
-	dma_init_struct_adc.memory_addr = (uint32_t)&adc_buffer;
+	dma_init_struct_adc.memory_addr = (uint32_t)analog_buffer;
 	dma_init_struct_adc.memory_inc = DMA_MEMORY_INCREASE_ENABLE;
 	dma_init_struct_adc.memory_width = DMA_MEMORY_WIDTH_16BIT;
-	dma_init_struct_adc.number = 2;
+	dma_init_struct_adc.number = ANALOG_BUFFER_SIZE;
 	dma_init_struct_adc.periph_addr = (uint32_t)&ADC_RDATA;
 	dma_init_struct_adc.periph_inc = DMA_PERIPH_INCREASE_DISABLE;
 	dma_init_struct_adc.periph_width = DMA_PERIPHERAL_WIDTH_16BIT;
-	dma_init_struct_adc.priority = DMA_PRIORITY_ULTRA_HIGH;
+	dma_init_struct_adc.priority = DMA_PRIORITY_HIGH;
 	dma_init(DMA_CH0, dma_init_struct_adc);
 	
 	// Configure DMA mode
 	dma_circulation_enable(DMA_CH0);
 	dma_memory_to_memory_disable(DMA_CH0);
 	
-	// Enable DMA transfer complete interrupt
-	dma_interrupt_enable(DMA_CH0, DMA_CHXCTL_FTFIE);
-	
-	// At least clear number of remaining data to be transferred by the DMA 
-	dma_transfer_number_config(DMA_CH0, 2);
-	
 	// Enable DMA channel 0
 	dma_channel_enable(DMA_CH0);
 	
-	adc_channel_length_config(ADC_REGULAR_CHANNEL, 2);
-	adc_regular_channel_config(0, VBATT_CHANNEL, ADC_SAMPLETIME_13POINT5);
-	adc_regular_channel_config(1, CURRENT_DC_CHANNEL, ADC_SAMPLETIME_13POINT5);
+	// Regular group, order of ANALOG_CHANNEL (internal channels need 17us sampling)
+	adc_channel_length_config(ADC_REGULAR_CHANNEL, COUNT_ANALOG_CHANNELS);
+	adc_regular_channel_config(ANALOG_VBATT, VBATT_CHANNEL, ADC_SAMPLETIME_55POINT5);
+	adc_regular_channel_config(ANALOG_CURRENT_DC, CURRENT_DC_CHANNEL, ADC_SAMPLETIME_55POINT5);
+	adc_regular_channel_config(ANALOG_INPUT, ANALOG_INPUT_CHANNEL, ADC_SAMPLETIME_55POINT5);
+	adc_regular_channel_config(ANALOG_TEMPERATURE, TEMPERATURE_CHANNEL, ADC_SAMPLETIME_239POINT5);
+	adc_regular_channel_config(ANALOG_VREFINT, VREFINT_CHANNEL, ADC_SAMPLETIME_239POINT5);
+	
+	// Inserted group (length before channels, ranks depend on it)
+	adc_channel_length_config(ADC_INSERTED_CHANNEL, 2);
+	adc_inserted_channel_config(0, VBATT_CHANNEL, ADC_SAMPLETIME_13POINT5);
+	adc_inserted_channel_config(1, CURRENT_DC_CHANNEL, ADC_SAMPLETIME_13POINT5);
 	adc_data_alignment_config(ADC_DATAALIGN_RIGHT);
 	
-	// Set trigger of ADC
+	// Set trigger of ADC to TIMER0 TRGO (pwm center), regular group by software
+	adc_external_trigger_config(ADC_INSERTED_CHANNEL, ENABLE);
+	adc_external_trigger_source_config(ADC_INSERTED_CHANNEL, ADC_EXTTRIG_INSERTED_T0_TRGO);
 	adc_external_trigger_config(ADC_REGULAR_CHANNEL, ENABLE);
 	adc_external_trigger_source_config(ADC_REGULAR_CHANNEL, ADC_EXTTRIG_REGULAR_SWRCST);
 	
-	// Disable the temperature sensor, Vrefint and vbat channel
-	adc_tempsensor_vrefint_disable();
+	// Enable the temperature sensor and Vrefint, disable vbat channel
+	adc_tempsensor_vrefint_enable();
 	adc_vbat_disable();
 	
 	// ADC analog watchdog disable
@@ -379,9 +525,17 @@ void ADC_init(void)
 	
 	// Enable DMA request
 	adc_dma_mode_enable();
-    
-	// Set ADC to scan mode
+	
+	// Set ADC to scan mode, regular group runs continuously (interrupted by the inserted group)
 	adc_special_function_config(ADC_SCAN_MODE, ENABLE);
+	adc_special_function_config(ADC_CONTINUOUS_MODE, ENABLE);
+	
+	// Enable end of inserted group interrupt
+	adc_interrupt_flag_clear(ADC_INT_FLAG_EOIC);
+	adc_interrupt_enable(ADC_INT_EOIC);
+	
+	// Start regular scan
+	adc_software_trigger_enable(ADC_REGULAR_CHANNEL);
 }
 
 //----------------------------------------------------------------------------
@@ -410,8 +564,8 @@ void USART_MasterSlave_init(void)
 	// Interrupt channel 3/4 enable
 	nvic_irq_enable(DMA_Channel3_4_IRQn, 2, 0);
 	
-	// Initialize DMA channel 4 for USART_SLAVE RX
-	dma_deinit(DMA_CH4);
+	// Initialize DMA channel 4 for USART_SLAVE RX (circular ring buffer)
+	dma_deinit(USART_MASTERSLAVE_RX_DMA);
 	dma_init_struct_usart.direction = DMA_PERIPHERAL_TO_MEMORY;
 	dma_init_struct_usart.memory_addr = (uint32_t)usartMasterSlave_rx_buf;
 	dma_init_struct_usart.memory_inc = DMA_MEMORY_INCREASE_ENABLE;
@@ -421,23 +575,44 @@ void USART_MasterSlave_init(void)
 	dma_init_struct_usart.periph_inc = DMA_PERIPH_INCREASE_DISABLE;
 	dma_init_struct_usart.periph_width = DMA_PERIPHERAL_WIDTH_8BIT;
 	dma_init_struct_usart.priority = DMA_PRIORITY_ULTRA_HIGH;
-	dma_init(DMA_CH4, dma_init_struct_usart);
+	dma_init(USART_MASTERSLAVE_RX_DMA, dma_init_struct_usart);
 	
 	// Configure DMA mode
-	dma_circulation_enable(DMA_CH4);
-	dma_memory_to_memory_disable(DMA_CH4);
+	dma_circulation_enable(USART_MASTERSLAVE_RX_DMA);
+	dma_memory_to_memory_disable(USART_MASTERSLAVE_RX_DMA);
+
+	// Initialize DMA channel for USART_MASTERSLAVE TX (memory address and length are set for each frame)
+	dma_deinit(USART_MASTERSLAVE_TX_DMA);
+	dma_init_struct_usart.direction = DMA_MEMORY_TO_PERIPHERAL;
+	dma_init_struct_usart.memory_addr = 0;
+	dma_init_struct_usart.memory_inc = DMA_MEMORY_INCREASE_ENABLE;
+	dma_init_struct_usart.memory_width = DMA_MEMORY_WIDTH_8BIT;
+	dma_init_struct_usart.number = 0;
+	dma_init_struct_usart.periph_addr = USART_MASTERSLAVE_DATA_TX_ADDRESS;
+	dma_init_struct_usart.periph_inc = DMA_PERIPH_INCREASE_DISABLE;
+	dma_init_struct_usart.periph_width = DMA_PERIPHERAL_WIDTH_8BIT;
+	dma_init_struct_usart.priority = DMA_PRIORITY_MEDIUM;
+	dma_init(USART_MASTERSLAVE_TX_DMA, dma_init_struct_usart);
+	dma_circulation_disable(USART_MASTERSLAVE_TX_DMA);
+	dma_memory_to_memory_disable(USART_MASTERSLAVE_TX_DMA);
+	
+	// Enable DMA transfer complete interrupt for TX
+	dma_interrupt_enable(USART_MASTERSLAVE_TX_DMA, DMA_CHXCTL_FTFIE);
 
 	// USART DMA enable for transmission and receive
+	usart_dma_transmit_config(USART_MASTERSLAVE, USART_DENT_ENABLE);
 	usart_dma_receive_config(USART_MASTERSLAVE, USART_DENR_ENABLE);
 	
-	// Enable DMA transfer complete interrupt
-	dma_interrupt_enable(DMA_CH4, DMA_CHXCTL_FTFIE);
-	
-	// At least clear number of remaining data to be transferred by the DMA 
-	dma_transfer_number_config(DMA_CH4, 1);
+	// Enable DMA half and full transfer interrupt (ring buffer)
+	dma_interrupt_enable(USART_MASTERSLAVE_RX_DMA, DMA_CHXCTL_HTFIE);
+	dma_interrupt_enable(USART_MASTERSLAVE_RX_DMA, DMA_CHXCTL_FTFIE);
 	
 	// Enable dma receive channel
-	dma_channel_enable(DMA_CH4);
+	dma_channel_enable(USART_MASTERSLAVE_RX_DMA);
+	
+	// Enable idle line interrupt (end of frame)
+	nvic_irq_enable(USART1_IRQn, 2, 0);
+	usart_interrupt_enable(USART_MASTERSLAVE, USART_INT_IDLE);
 }
 
 //----------------------------------------------------------------------------
@@ -466,8 +641,8 @@ void USART_Steer_COM_init(void)
 	// Interrupt channel 1/2 enable
 	nvic_irq_enable(DMA_Channel1_2_IRQn, 2, 0);
 	
-	// Initialize DMA channel 2 for USART_STEER_COM RX
-	dma_deinit(DMA_CH2);
+	// Initialize DMA channel 2 for USART_STEER_COM RX (circular ring buffer)
+	dma_deinit(USART_STEER_COM_RX_DMA);
 	dma_init_struct_usart.direction = DMA_PERIPHERAL_TO_MEMORY;
 	dma_init_struct_usart.memory_addr = (uint32_t)usartSteer_COM_rx_buf;
 	dma_init_struct_usart.memory_inc = DMA_MEMORY_INCREASE_ENABLE;
@@ -477,21 +652,42 @@ void USART_Steer_COM_init(void)
 	dma_init_struct_usart.periph_inc = DMA_PERIPH_INCREASE_DISABLE;
 	dma_init_struct_usart.periph_width = DMA_PERIPHERAL_WIDTH_8BIT;
 	dma_init_struct_usart.priority = DMA_PRIORITY_ULTRA_HIGH;
-	dma_init(DMA_CH2, dma_init_struct_usart);
+	dma_init(USART_STEER_COM_RX_DMA, dma_init_struct_usart);
 	
 	// Configure DMA mode
-	dma_circulation_enable(DMA_CH2);
-	dma_memory_to_memory_disable(DMA_CH2);
+	dma_circulation_enable(USART_STEER_COM_RX_DMA);
+	dma_memory_to_memory_disable(USART_STEER_COM_RX_DMA);
+
+	// Initialize DMA channel for USART_STEER_COM TX (memory address and length are set for each frame)
+	dma_deinit(USART_STEER_COM_TX_DMA);
+	dma_init_struct_usart.direction = DMA_MEMORY_TO_PERIPHERAL;
+	dma_init_struct_usart.memory_addr = 0;
+	dma_init_struct_usart.memory_inc = DMA_MEMORY_INCREASE_ENABLE;
+	dma_init_struct_usart.memory_width = DMA_MEMORY_WIDTH_8BIT;
+	dma_init_struct_usart.number = 0;
+	dma_init_struct_usart.periph_addr = USART_STEER_COM_DATA_TX_ADDRESS;
+	dma_init_struct_usart.periph_inc = DMA_PERIPH_INCREASE_DISABLE;
+	dma_init_struct_usart.periph_width = DMA_PERIPHERAL_WIDTH_8BIT;
+	dma_init_struct_usart.priority = DMA_PRIORITY_MEDIUM;
+	dma_init(USART_STEER_COM_TX_DMA, dma_init_struct_usart);
+	dma_circulation_disable(USART_STEER_COM_TX_DMA);
+	dma_memory_to_memory_disable(USART_STEER_COM_TX_DMA);
+	
+	// Enable DMA transfer complete interrupt for TX
+	dma_interrupt_enable(USART_STEER_COM_TX_DMA, DMA_CHXCTL_FTFIE);
 
 	// USART DMA enable for transmission and receive
+	usart_dma_transmit_config(USART_STEER_COM, USART_DENT_ENABLE);
 	usart_dma_receive_config(USART_STEER_COM, USART_DENR_ENABLE);
 	
-	// Enable DMA transfer complete interrupt
-	dma_interrupt_enable(DMA_CH2, DMA_CHXCTL_FTFIE);
-	
-	// At least clear number of remaining data to be transferred by the DMA 
-	dma_transfer_number_config(DMA_CH2, 1);
+	// Enable DMA half and full transfer interrupt (ring buffer)
+	dma_interrupt_enable(USART_STEER_COM_RX_DMA, DMA_CHXCTL_HTFIE);
+	dma_interrupt_enable(USART_STEER_COM_RX_DMA, DMA_CHXCTL_FTFIE);
 	
 	// Enable dma receive channel
-	dma_channel_enable(DMA_CH2);
+	dma_channel_enable(USART_STEER_COM_RX_DMA);
+	
+	// Enable idle line interrupt (end of frame)
+	nvic_irq_enable(USART0_IRQn, 2, 0);
+	usart_interrupt_enable(USART_STEER_COM, USART_INT_IDLE);
 }
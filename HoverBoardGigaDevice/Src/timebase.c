@@ -0,0 +1,175 @@
+/*
+* This file is part of the hoverboard-firmware-hack-V2 project. The 
+* firmware is used to hack the generation 2 board of the hoverboard.
+* These new hoverboards have no mainboard anymore. They consist of 
+* two Sensorboards which have their own BLDC-Bridge per Motor and an
+* ARM Cortex-M3 processor GD32F130C8.
+*
+* Copyright (C) 2018 Florian Staeblein
+* Copyright (C) 2018 Jakob Broemauer
+* Copyright (C) 2018 Kai Liebich
+* Copyright (C) 2018 Christoph Lehnert
+*
+* The program is based on the hoverboard project by Niklas Fauth. The 
+* structure was tried to be as similar as possible, so that everyone 
+* could find a better way through the code.
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "gd32f1x0.h"
+#include "../Inc/timebase.h"
+#include "stddef.h"
+
+// Software timer
+typedef struct
+{
+	void (*callback)(void);						// Called when timer expires, NULL = stopped
+	uint32_t expiry_ms;								// Time of the next expiry
+	uint16_t period_ms;								// Period, 0 = one shot
+} TIMEBASE_TIMER_ENTRY;
+
+static TIMEBASE_TIMER_ENTRY timers[COUNT_TIMEBASE_TIMERS];
+
+// Milliseconds since system start (systick runs with 1kHz, see setup.c)
+static volatile uint32_t msTicks = 0;
+
+//----------------------------------------------------------------------------
+// Counts milliseconds and runs expired software timers => called by systick
+//----------------------------------------------------------------------------
+void TIMEBASE_Tick(void)
+{
+	TIMEBASE_TIMER_ENTRY *entry;
+	void (*callback)(void);
+	uint8_t index;
+	
+	msTicks++;
+	
+	for (index = 0; index < COUNT_TIMEBASE_TIMERS; index++)
+	{
+		entry = &timers[index];
+		if (entry->callback == NULL || (int32_t)(msTicks - entry->expiry_ms) < 0)
+		{
+			continue;
+		}
+		
+		// Rearm before the callback, so it can restart or stop its own timer
+		callback = entry->callback;
+		if (entry->period_ms == 0)
+		{
+			entry->callback = NULL;
+		}
+		else
+		{
+			entry->expiry_ms += entry->period_ms;
+		}
+		callback();
+	}
+}
+
+//----------------------------------------------------------------------------
+// Starts (or restarts) software timer, period 0 means one shot
+//----------------------------------------------------------------------------
+void TIMEBASE_StartTimer(TIMEBASE_TIMER timer, void (*callback)(void), uint16_t delay_ms, uint16_t period_ms)
+{
+	uint32_t primask;
+	
+	if (timer >= COUNT_TIMEBASE_TIMERS)
+	{
+		return;
+	}
+	
+	// Timers are restarted from the main loop and the usart interrupts
+	primask = __get_PRIMASK();
+	__disable_irq();
+	timers[timer].expiry_ms = msTicks + delay_ms;
+	timers[timer].period_ms = period_ms;
+	timers[timer].callback = callback;
+	__set_PRIMASK(primask);
+}
+
+//----------------------------------------------------------------------------
+// Stops software timer
+//----------------------------------------------------------------------------
+void TIMEBASE_StopTimer(TIMEBASE_TIMER timer)
+{
+	uint32_t primask;
+	
+	if (timer >= COUNT_TIMEBASE_TIMERS)
+	{
+		return;
+	}
+	
+	// Same as start, the systick must not rearm the timer meanwhile
+	primask = __get_PRIMASK();
+	__disable_irq();
+	timers[timer].callback = NULL;
+	__set_PRIMASK(primask);
+}
+
+//----------------------------------------------------------------------------
+// Returns number of milliseconds since system start
+//----------------------------------------------------------------------------
+uint32_t millis(void)
+{
+	return msTicks;
+}
+
+//----------------------------------------------------------------------------
+// Returns number of microseconds since system start (overflows after 71 min,
+// differences stay valid)
+// -> milliseconds plus elapsed systick counter cycles
+//----------------------------------------------------------------------------
+uint32_t micros(void)
+{
+	uint32_t ms;
+	uint32_t value;
+	uint32_t pending;
+	
+	do
+	{
+		ms = msTicks;
+		value = SysTick->VAL;
+		
+		// Systick has wrapped, but its interrupt is blocked by an interrupt of
+		// the same or higher priority (counter value is read again after the wrap)
+		pending = SCB->ICSR & SCB_ICSR_PENDSTSET_Msk;
+		if (pending != 0)
+		{
+			value = SysTick->VAL;
+		}
+	} while (ms != msTicks);
+	
+	if (pending != 0)
+	{
+		ms++;
+	}
+	
+	return ms * 1000 + (SysTick->LOAD - value) / (SystemCoreClock / 1000000);
+}
+
+//----------------------------------------------------------------------------
+// Delays number of milliseconds, sleeps meanwhile
+//----------------------------------------------------------------------------
+void Delay(uint32_t delay_ms)
+{
+	uint32_t start = msTicks;
+	
+	while ((msTicks - start) < delay_ms)
+	{
+		__WFI();
+	}
+}
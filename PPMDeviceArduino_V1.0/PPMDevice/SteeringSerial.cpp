@@ -130,29 +130,23 @@ void SendAnswer(void)
   SendBuffer(buffer, index);
 }
 
+// CRC-CCITT (polynomial 0x1021) of every nibble value, processes four bits per lookup
+const uint16_t crcNibbleTable[16] =
+{
+  0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+  0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
 //----------------------------------------------------------------------------
-// Calculates CRC value
+// Calculates CRC value (CRC-CCITT, polynomial 0x1021, initial value 0)
 //----------------------------------------------------------------------------
 uint16_t CalcCRC(uint8_t *ptr, int count)
 {
-  uint16_t  crc;
-  uint8_t i;
-  crc = 0;
+  uint16_t crc = 0;
   while (--count >= 0)
   {
-    crc = crc ^ (uint16_t) *ptr++ << 8;
-    i = 8;
-    do
-    {
-      if (crc & 0x8000)
-      {
-        crc = crc << 1 ^ 0x1021;
-      }
-      else
-      {
-        crc = crc << 1;
-      }
-    } while(--i);
+    crc = (crc << 4) ^ crcNibbleTable[(crc >> 12) ^ (*ptr >> 4)];
+    crc = (crc << 4) ^ crcNibbleTable[(crc >> 12) ^ (*ptr++ & 0x0F)];
   }
   return (crc);
 }